@@ -430,6 +430,53 @@ static const unsigned char temp_binary_data_6[] =
 
 const char* ElementIconTemplate_png = (const char*) temp_binary_data_6;
 
+//================== el.command.luac ==================
+static const unsigned char temp_binary_data_7[] =
+{ 27,76,117,97,84,0,25,147,13,10,26,10,4,8,8,120,86,0,0,0,0,0,0,0,0,0,0,0,40,119,64,1,161,64,108,105,98,115,47,101,108,101,109,101,110,116,47,108,117,97,47,101,108,47,99,111,109,109,97,110,100,46,108,117,97,128,128,0,1,14,178,81,0,0,0,11,0,0,0,131,128,
+0,0,68,0,2,2,139,0,0,0,3,1,1,0,196,0,2,2,19,1,0,0,82,0,0,0,207,1,0,0,18,1,3,3,207,129,0,0,18,1,4,3,207,1,1,0,18,1,5,3,139,1,0,6,14,2,0,7,68,2,1,0,196,1,0,5,203,129,12,0,139,4,0,0,3,5,4,0,196,4,2,2,14,5,0,9,128,5,8,0,68,5,2,2,139,5,0,10,142,5,11,11,0,
+6,10,0,196,5,2,2,192,5,127,0,56,6,0,128,142,5,9,12,0,6,10,0,196,5,2,2,194,5,0,0,184,3,0,128,142,5,9,13,0,6,10,0,196,5,2,2,11,6,0,10,14,6,12,14,128,6,11,0,68,6,2,2,16,1,12,8,204,1,0,2,205,129,13,0,182,1,0,0,70,129,2,1,198,129,1,1,143,4,136,114,101,113,
+117,105,114,101,4,146,101,108,46,67,111,109,109,97,110,100,77,97,110,97,103,101,114,4,139,101,108,46,71,108,111,98,97,108,115,4,136,109,97,110,97,103,101,114,4,135,105,110,118,111,107,101,4,136,99,108,111,115,117,114,101,4,135,105,112,97,105,114,115,
+4,137,115,116,97,110,100,97,114,100,4,136,107,118,46,115,108,117,103,4,137,116,111,115,116,114,105,110,103,4,135,115,116,114,105,110,103,4,132,108,101,110,4,134,118,97,108,105,100,4,136,116,111,115,110,97,107,101,4,134,117,112,112,101,114,129,1,0,0,131,
+128,138,141,0,0,3,139,11,0,0,0,68,0,1,2,66,0,0,0,184,1,0,128,148,128,0,1,196,0,2,2,194,128,0,0,56,0,0,128,136,0,0,0,200,0,2,0,199,0,1,0,130,4,137,105,110,115,116,97,110,99,101,4,143,99,111,109,109,97,110,100,109,97,110,97,103,101,114,129,1,1,0,128,139,
+1,0,1,0,0,0,0,0,0,0,1,128,129,130,103,130,139,129,136,71,108,111,98,97,108,115,128,146,160,2,0,7,161,11,1,0,0,128,1,0,0,68,1,2,2,60,1,1,0,184,2,0,128,11,1,0,2,14,1,2,3,128,1,0,0,68,1,2,2,0,0,2,0,56,0,0,128,1,128,255,127,64,0,127,0,184,7,0,128,11,1,1,
+4,68,1,1,2,139,1,0,5,60,1,6,0,56,0,0,128,6,2,0,0,7,2,0,0,131,130,3,0,196,1,3,1,148,129,2,8,128,2,0,0,67,131,1,0,56,0,0,128,5,3,0,0,197,1,4,0,198,1,0,0,5,1,0,0,72,1,2,0,71,1,1,0,137,4,133,116,121,112,101,4,135,110,117,109,98,101,114,4,133,109,97,116,104,
+4,138,116,111,105,110,116,101,103,101,114,4,136,109,97,110,97,103,101,114,4,135,97,115,115,101,114,116,0,4,150,110,105,108,32,101,108,46,67,111,109,109,97,110,100,77,97,110,97,103,101,114,4,143,105,110,118,111,107,101,100,105,114,101,99,116,108,121,130,
+0,0,0,1,2,0,128,161,1,0,0,0,0,1,0,0,0,0,0,2,3,0,1,0,1,0,0,0,0,0,0,1,0,0,0,0,0,0,3,0,1,128,131,132,99,109,100,128,161,134,97,115,121,110,99,128,161,130,109,144,158,130,133,95,69,78,86,130,77,128,171,187,2,0,6,183,11,1,0,0,139,1,0,1,0,2,0,0,196,1,2,2,188,
+129,2,0,56,0,0,128,134,1,0,0,135,1,0,0,3,130,1,0,68,1,3,1,11,1,0,4,14,1,2,5,128,1,0,0,68,1,2,2,135,1,0,0,11,2,0,1,128,2,1,0,68,2,2,2,60,2,6,0,184,0,0,128,128,1,1,0,184,14,0,128,11,2,0,1,128,2,1,0,68,2,2,2,60,2,2,0,56,2,0,128,189,0,127,1,56,0,0,128,134,
+1,0,0,135,1,0,0,184,9,0,128,11,2,0,1,128,2,1,0,68,2,2,2,60,2,7,0,56,4,0,128,11,2,0,7,14,2,4,8,128,2,1,0,68,2,2,2,64,130,127,0,56,0,0,128,134,1,0,0,135,1,0,0,184,2,0,128,11,2,0,1,128,2,1,0,68,2,2,2,60,2,9,0,56,0,0,128,135,1,0,0,79,2,0,0,70,130,2,0,70,
+130,1,0,138,4,135,97,115,115,101,114,116,4,133,116,121,112,101,4,135,110,117,109,98,101,114,4,153,99,111,109,109,97,110,100,32,109,117,115,116,32,98,101,32,97,32,110,117,109,98,101,114,4,133,109,97,116,104,4,138,116,111,105,110,116,101,103,101,114,4,
+136,98,111,111,108,101,97,110,4,135,115,116,114,105,110,103,4,132,108,101,110,4,132,110,105,108,130,0,0,0,1,2,0,129,128,186,186,0,0,3,134,11,0,0,0,137,0,1,0,9,1,2,0,69,0,3,0,70,0,0,0,71,0,1,0,129,4,135,105,110,118,111,107,101,131,0,1,0,1,2,0,1,3,0,128,
+134,0,0,0,0,0,0,128,128,131,130,77,130,99,130,97,183,1,0,0,0,0,0,0,0,0,0,2,0,0,0,1,1,0,0,0,0,1,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,0,0,0,0,1,0,0,0,0,1,3,0,1,128,132,132,99,109,100,128,183,134,97,115,121,110,99,128,183,130,99,142,183,130,97,143,
+183,130,133,95,69,78,86,130,77,178,1,3,0,0,1,0,0,2,0,6,253,22,242,41,240,20,0,0,0,0,1,0,0,1,0,0,1,0,0,0,0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,251,0,7,2,0,128,140,143,67,111,109,109,97,110,100,77,97,110,97,103,101,114,132,178,136,71,108,111,98,97,108,115,135,
+178,130,77,137,178,140,40,102,111,114,32,115,116,97,116,101,41,147,176,140,40,102,111,114,32,115,116,97,116,101,41,147,176,140,40,102,111,114,32,115,116,97,116,101,41,147,176,140,40,102,111,114,32,115,116,97,116,101,41,147,176,130,95,148,173,132,99,109,
+100,148,173,133,115,108,117,103,151,173,130,115,154,173,130,107,168,173,129,133,95,69,78,86,0,0 };
+
+const char* el_command_luac = (const char*) temp_binary_data_7;
+
+//================== el.script.luac ==================
+static const unsigned char temp_binary_data_8[] =
+{ 27,76,117,97,84,0,25,147,13,10,26,10,4,8,8,120,86,0,0,0,0,0,0,0,0,0,0,0,40,119,64,1,160,64,108,105,98,115,47,101,108,101,109,101,110,116,47,108,117,97,47,101,108,47,115,99,114,105,112,116,46,108,117,97,128,128,0,1,3,142,81,0,0,0,19,0,0,0,82,0,0,0,207,
+0,0,0,79,129,0,0,18,0,0,2,79,1,1,0,18,0,1,2,79,129,1,0,18,0,2,2,79,1,2,0,18,0,3,2,70,128,2,1,70,129,1,1,132,4,132,100,115,112,4,134,100,115,112,117,105,4,133,108,111,97,100,4,133,101,120,101,99,129,1,0,0,133,128,133,137,2,0,5,147,11,1,0,0,139,1,0,1,0,
+2,0,0,196,1,2,2,188,129,2,0,56,0,0,128,134,1,0,0,135,1,0,0,3,130,1,0,68,1,3,1,11,1,0,4,128,1,1,0,68,1,2,2,66,129,0,0,56,0,0,128,3,129,2,0,18,0,1,2,72,0,2,0,71,1,1,0,134,4,135,97,115,115,101,114,116,4,133,116,121,112,101,4,134,116,97,98,108,101,4,154,
+69,120,112,101,99,116,101,100,32,116,97,98,108,101,32,100,101,115,99,114,105,112,116,111,114,4,137,116,111,115,116,114,105,110,103,4,129,129,0,0,0,128,147,1,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0,0,1,1,128,130,133,100,101,115,99,128,147,133,107,105,110,100,128,
+147,129,133,95,69,78,86,128,143,143,1,0,4,134,137,0,0,0,0,1,0,0,131,1,0,0,197,0,3,0,198,0,0,0,199,0,1,0,129,4,132,68,83,80,129,1,1,0,128,134,0,0,0,0,0,0,128,129,133,100,101,115,99,128,134,129,135,100,101,102,105,110,101,128,146,146,1,0,4,134,137,0,0,
+0,0,1,0,0,131,1,0,0,197,0,3,0,198,0,0,0,199,0,1,0,129,4,134,68,83,80,85,73,129,1,1,0,128,134,0,0,0,0,0,0,128,129,133,100,101,115,99,128,134,129,135,100,101,102,105,110,101,128,154,158,2,0,8,148,11,1,0,0,14,1,2,1,128,1,0,0,11,2,0,0,14,2,4,2,68,1,3,3,66,
+1,0,0,184,3,0,128,11,2,0,3,128,2,2,0,3,3,2,0,195,131,1,0,56,0,0,128,137,3,0,0,69,2,4,0,70,2,0,0,8,2,0,0,128,2,3,0,70,2,3,0,71,2,1,0,133,4,136,112,97,99,107,97,103,101,4,139,115,101,97,114,99,104,112,97,116,104,4,134,115,112,97,116,104,4,137,108,111,97,
+100,102,105,108,101,4,131,98,116,129,0,0,0,128,148,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,1,0,0,1,128,132,133,112,97,116,104,128,148,132,101,110,118,128,148,132,115,114,99,134,148,130,101,134,148,129,133,95,69,78,86,128,167,171,2,1,6,141,81,1,0,0,11,1,0,0,128,
+1,0,0,0,2,1,0,68,1,3,3,194,1,0,0,56,0,0,128,198,1,2,3,0,2,2,0,208,2,0,0,69,2,0,3,70,2,0,3,70,2,1,3,129,4,133,108,111,97,100,129,1,0,0,128,141,0,1,0,0,0,1,0,0,1,0,0,0,1,128,132,133,112,97,116,104,128,141,132,101,110,118,128,141,135,105,110,118,111,107,
+101,133,141,132,101,114,114,133,141,129,130,77,142,1,2,0,6,6,0,3,0,12,252,17,252,6,0,128,130,130,77,131,142,135,100,101,102,105,110,101,132,142,129,133,95,69,78,86,0,0 };
+
+const char* el_script_luac = (const char*) temp_binary_data_8;
+
+//================== element.luac ==================
+static const unsigned char temp_binary_data_9[] =
+{ 27,76,117,97,84,0,25,147,13,10,26,10,4,8,8,120,86,0,0,0,0,0,0,0,0,0,0,0,40,119,64,1,158,64,108,105,98,115,47,101,108,101,109,101,110,116,47,108,117,97,47,101,108,101,109,101,110,116,46,108,117,97,128,128,0,1,4,145,81,0,0,0,19,0,0,0,82,0,0,0,139,0,0,0,
+142,0,1,1,194,128,0,0,184,1,0,128,11,1,0,2,131,129,1,0,69,129,2,1,70,129,0,1,79,1,0,0,18,0,4,2,79,129,0,0,18,0,5,2,70,128,2,1,70,129,1,1,134,4,131,95,71,4,142,101,108,101,109,101,110,116,46,119,111,114,108,100,4,134,101,114,114,111,114,4,145,119,111,
+114,108,100,32,110,111,116,32,108,111,97,100,101,100,4,134,119,111,114,108,100,4,136,118,101,114,115,105,111,110,129,1,0,0,130,128,139,139,0,0,2,131,9,0,0,0,72,0,2,0,71,0,1,0,128,129,1,1,0,128,131,0,0,0,128,128,129,134,119,111,114,108,100,128,141,143,
+0,0,2,131,3,0,0,0,72,0,2,0,71,0,1,0,129,4,134,49,46,48,46,48,128,128,131,1,0,1,128,128,128,145,1,2,0,2,0,1,0,0,0,0,0,5,0,4,254,4,0,128,130,130,77,131,145,134,119,111,114,108,100,133,145,129,133,95,69,78,86,0,0 };
+
+const char* element_luac = (const char*) temp_binary_data_9;
+
 
 const char* getNamedResource (const char* resourceNameUTF8, int& numBytes)
 {
@@ -448,6 +495,9 @@ const char* getNamedResource (const char* resourceNameUTF8, int& numBytes)
         case 0x117be71a:  numBytes = 164; return developers_txt;
         case 0x9eb8b85f:  numBytes = 11697; return ElementIcon_png;
         case 0xcd7846f9:  numBytes = 7122; return ElementIconTemplate_png;
+        case 0xb457f077:  numBytes = 1478; return el_command_luac;
+        case 0x83c532c7:  numBytes = 822; return el_script_luac;
+        case 0xddd272ce:  numBytes = 314; return element_luac;
         default: break;
     }
 
@@ -463,7 +513,10 @@ const char* namedResourceList[] =
     "acknowledgements_txt",
     "developers_txt",
     "ElementIcon_png",
-    "ElementIconTemplate_png"
+    "ElementIconTemplate_png",
+    "el_command_luac",
+    "el_script_luac",
+    "element_luac"
 };
 
 const char* originalFilenames[] =
@@ -474,7 +527,10 @@ const char* originalFilenames[] =
     "acknowledgements.txt",
     "developers.txt",
     "ElementIcon.png",
-    "ElementIconTemplate.png"
+    "ElementIconTemplate.png",
+    "el.command.luac",
+    "el.script.luac",
+    "element.luac"
 };
 
 const char* getNamedResourceOriginalFilename (const char* resourceNameUTF8)
@@ -29,8 +29,17 @@ namespace BinaryData
     extern const char*   ElementIconTemplate_png;
     const int            ElementIconTemplate_pngSize = 7122;
 
+    extern const char*   el_command_luac;
+    const int            el_command_luacSize = 1478;
+
+    extern const char*   el_script_luac;
+    const int            el_script_luacSize = 822;
+
+    extern const char*   element_luac;
+    const int            element_luacSize = 314;
+
     // Number of elements in the namedResourceList and originalFileNames arrays.
-    const int namedResourceListSize = 7;
+    const int namedResourceListSize = 10;
 
     // Points to the start of a list of resource names.
     extern const char* namedResourceList[];
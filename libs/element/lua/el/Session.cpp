@@ -3,6 +3,7 @@
 // @pragma nostrip
 
 #include "lua-kv.hpp"
+#include "controllers/GraphManager.h"
 #include "session/Node.h"
 #include "session/Session.h"
 
@@ -60,7 +61,86 @@ LUAMOD_API int luaopen_el_Session (lua_State* L) {
         /// Restore state.
         // Restores all plugin states
         // @function Session:restorestate
-        "restorestate",            &Session::restoreGraphState
+        "restorestate",            &Session::restoreGraphState,
+
+        /// Make many changes in one pass.
+        // Calls a function with graph node and arc updates and session change
+        // notifications held back until it returns. Use it when building
+        // large graphs. An error in the function is raised again after the
+        // batch is closed.
+        // @function Session:batch
+        // @tparam function f Function making the changes
+        // @param ... Arguments passed to f
+        // @return Whatever f returns
+        // @usage session:batch (function()
+        //     local a = session:addnode (graph, "Element", "element.audioRouter")
+        //     local b = session:addnode (graph, "Element", "element.audioRouter")
+        //     session:connect (graph, a, srcport, b, dstport)
+        // end)
+        "batch", [](Session& self, sol::protected_function f, sol::variadic_args args) {
+            sol::variadic_results results;
+            std::string error;
+            {
+                GraphManager::ScopedBatch batch;
+                Session::ScopedFrozenLock freeze (self);
+                auto result = f (args);
+                if (result.valid())
+                {
+                    for (int i = 0; i < result.return_count(); ++i)
+                        results.push_back (result.get<sol::object> (i));
+                }
+                else
+                {
+                    sol::error e = result;
+                    error = e.what();
+                    if (error.empty())
+                        error = "session batch failed";
+                }
+            }
+
+            self.sendChangeMessage();
+            if (! error.empty())
+                throw std::runtime_error (error);
+            return results;
+        },
+
+        /// Add a node to a graph.
+        // Inside a batch the graph's nodes are updated once it ends.
+        // @function Session:addnode
+        // @tparam el.Node graph Graph to add to
+        // @string format Plugin format, e.g. "Element" or "VST3"
+        // @string identifier Plugin identifier
+        // @treturn el.Node The new node or nil
+        // @usage local node = session:addnode (graph, "Element", "element.audioRouter")
+        "addnode", [](Session&, const Node& graph, const char* format, const char* identifier) {
+            auto* const manager = GraphManager::findFor (graph);
+            if (manager == nullptr)
+                return std::shared_ptr<Node>();
+
+            Node node (Tags::node);
+            node.setProperty (Tags::format, String::fromUTF8 (format))
+                .setProperty (Tags::identifier, String::fromUTF8 (identifier));
+            const auto nodeId = manager->addNode (node);
+            return nodeId != KV_INVALID_NODE
+                ? std::make_shared<Node> (manager->getNodeModelForId (nodeId).getValueTree(), false)
+                : std::shared_ptr<Node>();
+        },
+
+        /// Connect two nodes of a graph.
+        // Inside a batch the graph's arcs are updated once it ends.
+        // @function Session:connect
+        // @tparam el.Node graph Graph the nodes are on
+        // @tparam el.Node src Source node
+        // @int srcport Source port index
+        // @tparam el.Node dst Destination node
+        // @int dstport Destination port index
+        // @treturn bool True if connected
+        "connect", [](Session&, const Node& graph, const Node& src, int srcPort,
+                                                   const Node& dst, int dstPort) -> bool {
+            auto* const manager = GraphManager::findFor (graph);
+            return manager != nullptr && manager->addConnection (src.getNodeId(), srcPort,
+                                                                 dst.getNodeId(), dstPort);
+        }
 
        #if 0
         "clear",                    &Session::clear,
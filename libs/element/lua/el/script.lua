@@ -9,8 +9,15 @@ local function define (desc, kind)
 end
 
 --- Define a DSP script.
+-- A layout with `control_rate = N` gets process called about every N
+-- samples instead of every block. Values written to `outputs` are ramped
+-- onto the output parameters until the next call, and `elapsed` says how
+-- many samples went by since the last one. Audio and MIDI in the blocks
+-- between calls aren't seen, so these scripts can only have control
+-- outputs, a layout with audio or MIDI outputs fails to load.
 -- @usage script.dsp {
---     process = process
+--     layout  = function() return { control_rate = 64 } end,
+--     process = function (a, m, params, outputs, elapsed) end
 -- }
 function M.dsp (desc) return define (desc, 'DSP') end
 
@@ -18,6 +18,7 @@
 
 #include "DataPath.h"
 #include "session/Node.h"
+#include "session/PresetIndex.h"
 
 namespace Element
 {
@@ -95,6 +96,23 @@ namespace Element
         if (! presetsDir.exists() || ! presetsDir.isDirectory())
             return;
 
+        // the index narrows it down to the files worth parsing, changes on
+        // disk are picked up in the background for the next lookup
+        SharedResourcePointer<PresetIndex> index;
+        if (index->getDirectory() == presetsDir)
+        {
+            index->update();
+            OwnedArray<PresetDescription> presets;
+            index->getPresetsForFileOrIdentifier (format, identifier, presets);
+            for (const auto* preset : presets)
+            {
+                Node node (Node::parse (preset->file));
+                if (node.isValid() && node.getFileOrIdentifier() == identifier)
+                    nodes.add (node);
+            }
+            return;
+        }
+
         DirectoryIterator iter (presetsDir, true, EL_PRESET_FILE_EXTENSIONS);
         while (iter.next())
         {
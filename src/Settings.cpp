@@ -43,6 +43,11 @@ const char* Settings::oscHostEnabledKey         = "oscHostEnabledKey";
 const char* Settings::systrayKey                = "systrayKey";
 const char* Settings::midiOutLatencyKey         = "midiOutLatency";
 const char* Settings::desktopScaleKey           = "desktopScale";
+const char* Settings::inlineSubGraphsKey        = "inlineSubGraphs";
+const char* Settings::workerThreadsKey          = "workerThreads";
+const char* Settings::workerPriorityOffsetKey   = "workerPriorityOffset";
+const char* Settings::workerAffinityKey         = "workerAffinity";
+const char* Settings::lockMemoryKey             = "lockMemory";
 
 //=============================================================================
 enum OptionsMenuItemId
@@ -408,6 +413,85 @@ void Settings::setDesktopScale (double scale)
         p->setValue (desktopScaleKey, scale);
 }
 
+//=============================================================================
+bool Settings::inlineSubGraphs() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (inlineSubGraphsKey, false);
+    return false;
+}
+
+void Settings::setInlineSubGraphs (bool shouldInline)
+{
+    if (inlineSubGraphs() == shouldInline)
+        return;
+    if (auto* p = getProps())
+        p->setValue (inlineSubGraphsKey, shouldInline);
+}
+
+//=============================================================================
+int Settings::getWorkerThreads() const
+{
+    if (auto* p = getProps())
+        return jlimit (0, SystemStats::getNumCpus(), p->getIntValue (workerThreadsKey, 0));
+    return 0;
+}
+
+void Settings::setWorkerThreads (int numThreads)
+{
+    numThreads = jlimit (0, SystemStats::getNumCpus(), numThreads);
+    if (getWorkerThreads() == numThreads)
+        return;
+    if (auto* p = getProps())
+        p->setValue (workerThreadsKey, numThreads);
+}
+
+int Settings::getWorkerPriorityOffset() const
+{
+    if (auto* p = getProps())
+        return jlimit (-20, 0, p->getIntValue (workerPriorityOffsetKey, 0));
+    return 0;
+}
+
+void Settings::setWorkerPriorityOffset (int offset)
+{
+    offset = jlimit (-20, 0, offset);
+    if (getWorkerPriorityOffset() == offset)
+        return;
+    if (auto* p = getProps())
+        p->setValue (workerPriorityOffsetKey, offset);
+}
+
+String Settings::getWorkerAffinity() const
+{
+    if (auto* p = getProps())
+        return p->getValue (workerAffinityKey);
+    return {};
+}
+
+void Settings::setWorkerAffinity (const String& cpus)
+{
+    if (getWorkerAffinity() == cpus)
+        return;
+    if (auto* p = getProps())
+        p->setValue (workerAffinityKey, cpus);
+}
+
+bool Settings::lockMemory() const
+{
+    if (auto* p = getProps())
+        return p->getBoolValue (lockMemoryKey, false);
+    return false;
+}
+
+void Settings::setLockMemory (bool shouldLock)
+{
+    if (lockMemory() == shouldLock)
+        return;
+    if (auto* p = getProps())
+        p->setValue (lockMemoryKey, shouldLock);
+}
+
 //=============================================================================
 void Settings::addItemsToMenu (Globals& world, PopupMenu& menu)
 {
@@ -52,6 +52,11 @@ public:
     static const char* systrayKey;
     static const char* midiOutLatencyKey;
     static const char* desktopScaleKey;
+    static const char* inlineSubGraphsKey;
+    static const char* workerThreadsKey;
+    static const char* workerPriorityOffsetKey;
+    static const char* workerAffinityKey;
+    static const char* lockMemoryKey;
 
     std::unique_ptr<XmlElement> getLastGraph() const;
     void setLastGraph (const ValueTree& data);
@@ -123,6 +128,26 @@ public:
     double getDesktopScale() const;
     void setDesktopScale (double);
 
+    /** True if nested graphs should be rendered inline with their parent */
+    bool inlineSubGraphs() const;
+    void setInlineSubGraphs (bool);
+
+    /** Number of realtime engine worker threads, zero disables them */
+    int getWorkerThreads() const;
+    void setWorkerThreads (int);
+
+    /** Worker priority relative to the audio device thread */
+    int getWorkerPriorityOffset() const;
+    void setWorkerPriorityOffset (int);
+
+    /** CPUs workers may run on, e.g. "2-3" or empty for any */
+    String getWorkerAffinity() const;
+    void setWorkerAffinity (const String&);
+
+    /** True if engine memory should be locked in RAM */
+    bool lockMemory() const;
+    void setLockMemory (bool);
+
 private:
     PropertiesFile* getProps() const;
 };
@@ -169,10 +169,19 @@ void DevicesController::refresh()
     auto& mapping (getWorld().getMappingEngine());
     auto& midi (getWorld().getMidiEngine());
     auto session = getWorld().getSession();
-    mapping.clear();
 
+    // inputs that stay keep receiving MIDI throughout, and each one swaps
+    // in its new mappings once, when the update ends
+    mapping.beginUpdate();
+
+    Array<ControllerDevice> devices;
     for (int i = 0; i < session->getNumControllerDevices(); ++i)
-        mapping.addInput (session->getControllerDevice (i), midi);
+        devices.add (session->getControllerDevice (i));
+
+    mapping.retainInputs (devices);
+    mapping.clearHandlers();
+    for (const auto& device : devices)
+        mapping.addInput (device, midi);
 
     for (int i = 0; i < session->getNumControllerMaps(); ++i)
     {
@@ -194,6 +203,7 @@ void DevicesController::refresh()
         }
     }
 
+    mapping.endUpdate();
     mapping.startMapping();
 }
 
@@ -177,9 +177,64 @@ private:
     }
 };
 
+//=============================================================================
+namespace {
+struct Batch
+{
+    int depth = 0;
+    Array<GraphManager*> pending;
+};
+
+Batch& getBatch()
+{
+    static Batch batch;
+    return batch;
+}
+
+Array<GraphManager*>& getManagers()
+{
+    static Array<GraphManager*> managers;
+    return managers;
+}
+}
+
+GraphManager::ScopedBatch::ScopedBatch()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    ++getBatch().depth;
+}
+
+GraphManager::ScopedBatch::~ScopedBatch()
+{
+    auto& batch = getBatch();
+    jassert (batch.depth > 0);
+    if (--batch.depth > 0)
+        return;
+
+    while (! batch.pending.isEmpty())
+        batch.pending.removeAndReturn (0)->finishBatch();
+}
+
+bool GraphManager::isBatching() noexcept
+{
+    return getBatch().depth > 0;
+}
+
+GraphManager* GraphManager::findFor (const Node& model)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    for (auto* const manager : getManagers())
+        if (manager->isControlling (model))
+            return manager;
+    return nullptr;
+}
+
+//=============================================================================
 GraphManager::GraphManager (GraphProcessor& pg, PluginManager& pm)
     : pluginManager (pm), processor (pg), lastUID (0)
-{ }
+{
+    getManagers().add (this);
+}
 
 GraphManager::~GraphManager()
 {
@@ -187,8 +242,11 @@ GraphManager::~GraphManager()
     // If you get warnings by juce's leak detector about graph related
     // objects, then there's probably "object" properties lingering that
     // are referenced in the model;
+    restoreNodes();
     Node::sanitizeRuntimeProperties (graph, true);
     graph = arcs = nodes = ValueTree();
+    getBatch().pending.removeAllInstancesOf (this);
+    getManagers().removeFirstMatchingValue (this);
 }
 
 uint32 GraphManager::getNextUID() noexcept
@@ -286,6 +344,7 @@ uint32 GraphManager::addNode (const Node& newNode)
 
         setupNode (data, node);
 
+        holdNodes();
         nodes.addChild (data, -1, nullptr);
         changed();
     }
@@ -366,6 +425,7 @@ uint32 GraphManager::addNode (const PluginDescription* desc, double rx, double r
         // make sure the model ports are correct with the actual processor
         n.resetPorts();
 
+        holdNodes();
         nodes.addChild (model, -1, nullptr);
         changed();
     }
@@ -382,6 +442,7 @@ void GraphManager::removeNode (const uint32 uid)
 {
     if (! processor.removeNode (uid))
         return;
+    holdNodes();
     for (int i = 0; i < nodes.getNumChildren(); ++i)
     {
         const Node node (nodes.getChild (i), false);
@@ -444,7 +505,7 @@ void GraphManager::removeIllegalConnections()
 
 int GraphManager::getNumConnections() const noexcept
 {
-    jassert(arcs.getNumChildren() == processor.getNumConnections());
+    jassert (isBatching() || arcs.getNumChildren() == processor.getNumConnections());
     return processor.getNumConnections();
 }
 
@@ -494,6 +555,7 @@ void GraphManager::removeConnection (uint32 sourceNode, uint32 sourcePort,
 void GraphManager::setNodeModel (const Node& node)
 {
     loaded = false;
+    restoreNodes();
 
     processor.clear();
     graph   = node.getValueTree();
@@ -577,7 +639,7 @@ void GraphManager::setNodeModel (const Node& node)
     loaded = true;
     const int numArcs = arcs.getNumChildren();
     const int numConns = processor.getNumConnections();
-    jassert (arcs.getNumChildren() == processor.getNumConnections());
+    jassert (isBatching() || arcs.getNumChildren() == processor.getNumConnections());
     failed.clearQuick();
 
     IONodeEnforcer enforceIONodes (*this);
@@ -596,6 +658,7 @@ void GraphManager::savePluginStates()
 void GraphManager::clear()
 {
     loaded = false;
+    restoreNodes();
 
     if (graph.isValid())
     {
@@ -614,6 +677,13 @@ void GraphManager::clear()
 
 void GraphManager::processorArcsChanged()
 {
+    if (isBatching())
+    {
+        arcsPending = true;
+        getBatch().pending.addIfNotAlreadyThere (this);
+        return;
+    }
+
     ValueTree newArcs = ValueTree (Tags::arcs);
     for (int i = 0; i < processor.getNumConnections(); ++i)
         newArcs.addChild (Node::makeArc (*processor.getConnection (i)), -1, nullptr);
@@ -644,6 +714,38 @@ void GraphManager::processorArcsChanged()
     changed();
 }
 
+void GraphManager::holdNodes()
+{
+    if (! isBatching() || heldNodesIndex >= 0 || ! graph.isValid())
+        return;
+
+    // lookups use the nodes tree directly, so they keep working while held
+    heldNodesIndex = graph.indexOf (nodes);
+    if (heldNodesIndex < 0)
+        return;
+    graph.removeChild (heldNodesIndex, nullptr);
+    getBatch().pending.addIfNotAlreadyThere (this);
+}
+
+void GraphManager::restoreNodes()
+{
+    if (heldNodesIndex < 0)
+        return;
+    if (graph.isValid() && ! nodes.getParent().isValid())
+        graph.addChild (nodes, heldNodesIndex, nullptr);
+    heldNodesIndex = -1;
+}
+
+void GraphManager::finishBatch()
+{
+    restoreNodes();
+    if (arcsPending)
+    {
+        arcsPending = false;
+        processorArcsChanged();
+    }
+}
+
 void GraphManager::setupNode (const ValueTree& data, GraphNodePtr obj)
 {
     jassert (obj && data.hasType (Tags::node));
@@ -38,6 +38,25 @@ public:
     GraphManager (GraphProcessor&, PluginManager&);
     ~GraphManager();
 
+    /** Holds back model updates on every graph manager while in scope.
+        Nodes added or removed go to a nodes tree detached from the graph
+        model, which is put back when the outermost batch ends, so graph
+        listeners hear about the new nodes once. Each manager touched also
+        rebuilds its arcs once instead of after every connection.
+        Message thread only */
+    struct ScopedBatch
+    {
+        ScopedBatch();
+        ~ScopedBatch();
+        JUCE_DECLARE_NON_COPYABLE (ScopedBatch)
+    };
+
+    /** Returns true while a batch is open */
+    static bool isBatching() noexcept;
+
+    /** Returns the manager controlling a graph model, or nullptr */
+    static GraphManager* findFor (const Node& model);
+
     /** Returns the controlled graph */
     GraphProcessor& getGraph() noexcept { return processor; }
 
@@ -116,6 +135,8 @@ private:
     GraphProcessor& processor;
     ValueTree graph, arcs, nodes;
     bool loaded = false;
+    int heldNodesIndex = -1;
+    bool arcsPending = false;
     
     uint32 lastUID;
     uint32 getNextUID() noexcept;
@@ -126,6 +147,9 @@ private:
     void setupNode (const ValueTree& data, GraphNodePtr object);
     
     void processorArcsChanged();
+    void holdNodes();
+    void restoreNodes();
+    void finishBatch();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphManager)
 };
@@ -63,14 +63,15 @@ void PresetsController::refresh()
 void PresetsController::add (const Node& node, const String& presetName)
 {
     const DataPath path;
-    if (! node.savePresetTo (path, presetName))
+    File file;
+    if (! node.savePresetTo (path, presetName, &file))
     {
         AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, 
             "Preset", "Could not save preset");        
     }
     else
     {
-        getWorld().getPresetCollection().refresh();
+        getWorld().getPresetCollection().add (file);
     }
 
     if (auto* gui = findSibling<GuiController>())
@@ -25,6 +25,7 @@
 #include "engine/MidiEngine.h"
 #include "engine/MidiTranspose.h"
 #include "engine/Transport.h"
+#include "engine/WorkerPool.h"
 #include "Globals.h"
 #include "Settings.h"
 
@@ -99,9 +100,18 @@ struct RootGraphRender : public AsyncUpdater
 {
     std::function<void()> onActiveGraphChanged;
 
+    /** An immutable list of graphs. The message thread never modifies a
+        list once it is published, it builds a new one and swaps it in */
+    struct GraphList : public ReferenceCountedObject
+    {
+        using Ptr = ReferenceCountedObjectPtr<GraphList>;
+        Array<RootGraph*> graphs;
+    };
+
     RootGraphRender()
     {
-        graphs.ensureStorageAllocated (32);
+        list = new GraphList();
+        active.set (list.get());
     }
 
     void handleAsyncUpdate() override
@@ -110,21 +120,23 @@ struct RootGraphRender : public AsyncUpdater
             onActiveGraphChanged();
     }
 
+    /** Audio thread only */
     const int setCurrentGraph (const int index)
     {
-        if (index == currentGraph)
-            return currentGraph;
-        currentGraph = index;
+        if (index == currentGraph.get())
+            return index;
+        currentGraph.set (index);
         triggerAsyncUpdate();
-        return currentGraph;
+        return index;
     }
 
-    const int getCurrentGraphIndex() const { return currentGraph; }
+    const int getCurrentGraphIndex() const { return currentGraph.get(); }
 
     RootGraph* getCurrentGraph() const
     { 
-        return isPositiveAndBelow (currentGraph, graphs.size()) ? graphs.getUnchecked(currentGraph) 
-                                                                : nullptr; 
+        const int index = currentGraph.get();
+        return isPositiveAndBelow (index, list->graphs.size()) ? list->graphs.getUnchecked (index)
+                                                               : nullptr; 
     }
 
     void prepareBuffers (const int numIns, const int numOuts, const int numSamples)
@@ -143,21 +155,138 @@ struct RootGraphRender : public AsyncUpdater
         audioTemp.setSize (1, 1);
         audioOut.setSize (1, 1);
     }
-    void dumpGraphs() {
-        
-    }
 
     void renderGraphs (AudioSampleBuffer& buffer, MidiBuffer& midi)
     {
+        // mark the list as in use, then make sure it wasn't retired before
+        // the mark was visible to the message thread
+        GraphList* snapshot = nullptr;
+        do {
+            snapshot = active.get();
+            rendering.set (snapshot);
+        } while (snapshot != active.get());
+
+        renderGraphs (snapshot->graphs, buffer, midi);
+        rendering.set (nullptr);
+    }
+    
+    /** not realtime safe! */
+    bool addGraph (RootGraph* graph)
+    {
+        jassert (! list->graphs.contains (graph));
+        graph->setLocked (locked);
+
+        GraphList::Ptr newList = new GraphList();
+        newList->graphs.addArray (list->graphs);
+        newList->graphs.add (graph);
+        graph->engineIndex = newList->graphs.size() - 1;
+        publish (newList);
+        return true;
+    }
+
+    /** not realtime safe! Call waitForRetiredGraphs() before releasing
+        the graph, the audio thread might still be rendering it */
+    void removeGraph (RootGraph* graph)
+    {
+        jassert (list->graphs.contains (graph));
+        GraphList::Ptr newList = new GraphList();
+        newList->graphs.addArray (list->graphs);
+        newList->graphs.removeFirstMatchingValue (graph);
+        graph->engineIndex = -1;
+        for (int i = 0 ; i < newList->graphs.size(); ++i)
+            newList->graphs.getUnchecked(i)->engineIndex = i;
+        publish (newList);
+    }
+
+    /** Frees retired lists the audio thread has finished with. Returns true
+        if none are left */
+    bool collectRetiredGraphs()
+    {
+        auto* const inUse = rendering.get();
+        for (int i = retired.size(); --i >= 0;)
+            if (retired.getObjectPointerUnchecked (i) != inUse)
+                retired.remove (i);
+        return retired.isEmpty();
+    }
+
+    /** Blocks until the audio thread is no longer using a retired list. This
+        takes one render cycle at most */
+    void waitForRetiredGraphs()
+    {
+        while (! collectRetiredGraphs())
+            Thread::sleep (1);
+    }
+
+    int size() const { return list->graphs.size(); }
+
+    RootGraph* getGraph (const int i) const { return list->graphs.getUnchecked (i); }
+    int getGraphIndex() const { return currentGraph.get(); }
+    const Array<RootGraph*>& getGraphs() const { return list->graphs; }
+    
+    /** passing in true turns off all rendering features in the paid version */
+    void setLocked (const bool l)
+    {
+        locked = l;
+        for (auto* g : list->graphs)
+            g->setLocked (locked);
+    }
+
+private:
+    // message thread
+    GraphList::Ptr list;
+    ReferenceCountedArray<GraphList> retired;
+    bool locked             = false;
+
+    // shared
+    Atomic<GraphList*> active;
+    Atomic<GraphList*> rendering;
+    Atomic<int> currentGraph { -1 };
+
+    // audio thread
+    RootGraph* lastGraph    = nullptr;
+
+    struct ProgramRequest
+    {
+        int program      = -1;
+        int channel      = -1;
+
+        const bool wasRequested() const { return program >= 0; }
+        void reset()
+        {
+            program = channel = -1;
+        }
+
+    } program;
+
+    int numInputChans       = -1;
+    int numOutputChans      = -1;
+    AudioSampleBuffer   audioOut, audioTemp;
+
+    MidiBuffer midiOut, midiTemp;
+
+    void publish (GraphList* newList)
+    {
+        retired.add (list.get());
+        list = newList;
+        active.set (newList);
+        collectRetiredGraphs();
+    }
+
+    void renderGraphs (const Array<RootGraph*>& graphs, AudioSampleBuffer& buffer, MidiBuffer& midi)
+    {
+        int index = currentGraph.get();
+        if (! isPositiveAndBelow (index, graphs.size()))
+            index = setCurrentGraph (graphs.isEmpty() ? -1 : jlimit (0, graphs.size() - 1, index));
+
        #if defined (EL_PRO)
         if (program.wasRequested())
         {
             if (! locked)
             {
-                const int nextGraph = findGraphForProgram (program);
-                if (nextGraph != currentGraph)
+                const int nextGraph = findGraphForProgram (graphs, program, index);
+                if (nextGraph != index)
                 {
-                    setCurrentGraph (nextGraph);
+                    index = setCurrentGraph (nextGraph);
                 }
             }
             else
@@ -169,19 +298,20 @@ struct RootGraphRender : public AsyncUpdater
         }
        #endif
 
-        auto* const current  = getCurrentGraph();
-        auto* const last     = (lastGraph >= 0 && lastGraph < graphs.size()) ? getGraph(lastGraph) : nullptr;
+        auto* const current  = isPositiveAndBelow (index, graphs.size()) ? graphs.getUnchecked (index) : nullptr;
+        auto* const last     = graphs.contains (lastGraph) ? lastGraph : current;
         
         if (current == nullptr || last == nullptr)
         {
             buffer.clear();
             midi.clear();
+            lastGraph = nullptr;
             return;
         }
 
         const int numSamples = buffer.getNumSamples();
         const int numChans   = buffer.getNumChannels();
-        const bool graphChanged = lastGraph != currentGraph;
+        const bool graphChanged = last != current;
         const bool shouldProcess = true;
         const RootGraph::RenderMode mode = current->getRenderMode();
         const bool modeChanged = graphChanged && mode != last->getRenderMode();
@@ -304,97 +434,23 @@ struct RootGraphRender : public AsyncUpdater
                 zeromem (buffer.getWritePointer(i), sizeof (float) * (size_t) numSamples);
         }
 
-        lastGraph = currentGraph;
-    }
-    
-    /** not realtime safe! */
-
-    bool addGraph (RootGraph* graph)
-    {
-        graph->setLocked (locked);
-        graphs.add (graph);
-        graph->engineIndex = graphs.size() - 1;
-
-        if (graph->engineIndex == 0)
-        {
-            setCurrentGraph (0);
-            lastGraph = 0;
-        }
-        
-        return true;
-    }
-
-    /** not realtime safe! AudioEngine's callback should be locked when you call this */
-    void removeGraph (RootGraph* graph)
-    {
-        jassert (graphs.contains (graph));
-        graphs.removeFirstMatchingValue (graph);
-        graph->engineIndex = -1;
-        updateIndexes();
-        if (currentGraph >= graphs.size())
-            currentGraph = graphs.size() - 1;
-        if (lastGraph >= graphs.size())
-            lastGraph = graphs.size() - 1;
+        lastGraph = current;
     }
 
-    int size() const { return graphs.size(); }
-
-    RootGraph* getGraph (const int i) const { return graphs.getUnchecked (i); }
-    int getGraphIndex() const { return currentGraph; }
-    const Array<RootGraph*>& getGraphs() const { return graphs; }
-    
-    /** passing in true turns off all rendering features in the paid version */
-    void setLocked (const bool l)
+    int findGraphForProgram (const Array<RootGraph*>& graphs, const ProgramRequest& r,
+                             const int currentIndex) const
     {
-        locked = l;
-        for (auto* g : graphs)
-            g->setLocked (locked);
-    }
-
-private:
-    Array<RootGraph*> graphs;
-    bool locked             = false;
-    int currentGraph        = -1;
-    int lastGraph           = -1;
-
-    struct ProgramRequest
-    {
-        int program      = -1;
-        int channel      = -1;
-
-        const bool wasRequested() const { return program >= 0; }
-        void reset()
-        {
-            program = channel = -1;
-        }
-
-    } program;
-
-    int numInputChans       = -1;
-    int numOutputChans      = -1;
-    AudioSampleBuffer   audioOut, audioTemp;
-
-    MidiBuffer midiOut, midiTemp;
-
-    void updateIndexes()
-    {
-        for (int i = 0 ; i < graphs.size(); ++i)
-            graphs.getUnchecked(i)->engineIndex = i;
-    }
-
-    int findGraphForProgram (const ProgramRequest& r) const
-    {
-        if (isPositiveAndBelow (program.program, 128))
+        if (isPositiveAndBelow (r.program, 128))
         {
             for (int i = 0; i < graphs.size(); ++i)
             {
                 auto* const g = graphs.getUnchecked (i);
-                if (g->midiProgram == r.program && g->acceptsMidiChannel (program.channel))
-                    return g->engineIndex;
+                if (g->midiProgram == r.program && g->acceptsMidiChannel (r.channel))
+                    return i;
             }
         }
 
-        return currentGraph;
+        return currentIndex;
     }
 };
 
@@ -412,7 +468,6 @@ public:
     {
         tempoValue.addListener (this);
         externalClockValue.addListener (this);
-        currentGraph.set (-1);
         processMidiClock.set (0);
         sessionWantsExternalClock.set (0);
         midiClock.addListener (this);
@@ -439,17 +494,14 @@ public:
     void timerCallback() override
     {
         midiIOMonitor->notify();
+        graphs.collectRetiredGraphs();
     }
 
     RootGraph* getCurrentGraph() const { return graphs.getCurrentGraph(); }
     
     void onCurrentGraphChanged()
     {
-        int currentGraph = -1;
-        {
-            ScopedLock sl (lock);
-            currentGraph = graphs.getGraphIndex();
-        }
+        const int currentGraph = graphs.getGraphIndex();
 
         auto session = engine.getWorld().getSession();
         if (currentGraph >= 0 && currentGraph != session->getActiveGraphIndex())
@@ -467,6 +519,7 @@ public:
                                 const int numSamples) override
     {
         jassert (sampleRate > 0 && blockSize > 0);
+        const double callbackTimeMs = Time::getMillisecondCounterHiRes();
         int totalNumChans = 0;
         ScopedNoDenormals denormals;
         if (numInputChannels > numOutputChannels)
@@ -510,11 +563,15 @@ public:
 
         const bool wasPlaying = transport.isPlaying();
         AudioSampleBuffer buffer (channels, totalNumChans, numSamples);
+        engine.world.getMidiEngine().renderInputQueues (
+            incomingMidi, callbackTimeMs, numSamples, sampleRate);
+        if (wasPlaying && isUsingExternalClock())
+            followMidiClock (callbackTimeMs, numSamples);
         processCurrentGraph (buffer, incomingMidi);
 
         {
-            ScopedLock lockMidiOut (engine.world.getMidiEngine().getMidiOutputLock());
-            if (auto* const midiOut = engine.world.getMidiEngine().getDefaultMidiOutput())
+            auto& midi = engine.world.getMidiEngine();
+            if (auto* const port = midi.getDefaultOutputPort())
             {
                #if defined (EL_PRO)
                 if (sendMidiClockToInput.get() != 1 && generateMidiClock.get() == 1)
@@ -537,11 +594,11 @@ public:
                 }
                #endif
 
-                const double delayMs = midiOutLatency.get();
                 if (! incomingMidi.isEmpty())
                 {
                     midiIOMonitor->sent();
-                    midiOut->sendBlockOfMessages (incomingMidi, delayMs + Time::getMillisecondCounterHiRes(), sampleRate);
+                    midi.getOutputScheduler().send (port, incomingMidi,
+                        callbackTimeMs + midiOutLatency.get(), sampleRate);
                 }
             }
         }
@@ -554,7 +611,6 @@ public:
         const int numSamples = buffer.getNumSamples();
         messageCollector.removeNextBlockOfMessages (midi, numSamples);
         
-        const ScopedLock sl (lock);
         const bool shouldProcess = shouldBeLocked.get() == 0;
         const bool wasPlaying = transport.isPlaying();
         transport.preProcess (numSamples);
@@ -581,10 +637,10 @@ public:
             }
            #endif
 
-            if (currentGraph.get() != graphs.getCurrentGraphIndex())
-                graphs.setCurrentGraph (currentGraph.get());
+            const int requested = requestedGraph.exchange (-1);
+            if (requested >= 0)
+                graphs.setCurrentGraph (requested);
             graphs.renderGraphs (buffer, midi);  // user requested index can be cancelled by program changed
-            currentGraph.set (graphs.getCurrentGraphIndex());
         }
         else
         {
@@ -620,6 +676,7 @@ public:
                             const int numChansIn, const int numChansOut)
     {
         const ScopedLock sl (lock);
+        workers->deviceThreadChanged();
         
         sampleRate      = newSampleRate;
         blockSize       = newBlockSize;
@@ -629,6 +686,8 @@ public:
         midiClock.reset (sampleRate, blockSize);
         messageCollector.reset (sampleRate);
         keyboardState.addListener (&messageCollector);
+        incomingMidi.ensureSize ((size_t) engine.world.getMidiEngine().getInputBlockSize());
+        engine.world.getMidiEngine().clearInputQueues();
         channels.calloc ((size_t) jmax (numChansIn, numChansOut) + 2);
         
         graphs.prepareBuffers (numInputChans, numOutputChans, blockSize);
@@ -661,27 +720,35 @@ public:
         graphs.releaseBuffers();
     }
     
-    void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message) override
+    void handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message) override
     {
         if (! message.isActiveSense() && ! message.isMidiClock())
             midiIOMonitor->received();
-        messageCollector.addMessageToQueue (message);
+        // device input reaches the graphs through the MidiEngine's input queues
+        if (source == nullptr)
+            messageCollector.addMessageToQueue (message);
         const bool clockWanted = processMidiClock.get() > 0 && sessionWantsExternalClock.get() > 0;
-        if (clockWanted && message.isMidiClock())
+        if (! clockWanted)
+            return;
+
+        if (message.isMidiClock() || message.isSongPositionPointer())
         {
             midiClock.process (message);
         }
-        else if (clockWanted && message.isMidiStart())
+        else if (message.isMidiStart())
         {
+            midiClock.process (message);
             transport.requestPlayState (true);
             transport.requestAudioFrame (0);
         }
-        else if (clockWanted && message.isMidiStop())
+        else if (message.isMidiStop())
         {
+            midiClock.process (message);
             transport.requestPlayState (false);
         }
-        else if (clockWanted && message.isMidiContinue())
+        else if (message.isMidiContinue())
         {
+            midiClock.process (message);
             transport.requestPlayState (true);
         }   
     }
@@ -689,10 +756,16 @@ public:
     void addGraph (RootGraph* graph)
     {
         jassert (graph);
+        graph->setInlineSubGraphs (inlineSubGraphs.get() == 1);
         if (isPrepared)
             prepareGraph (graph, sampleRate, blockSize);
-        ScopedLock sl (lock);
-        if (graphs.addGraph (graph))
+        bool added = false;
+        {
+            ScopedLock sl (lock);
+            added = graphs.addGraph (graph);
+        }
+
+        if (added)
         {
             graph->renderingSequenceChanged.connect (
                 std::bind (&AudioEngine::updateExternalLatencySamples, &engine));
@@ -705,7 +778,8 @@ public:
             ScopedLock sl (lock);
             graphs.removeGraph (graph);
         }
-        
+
+        graphs.waitForRetiredGraphs();
         graph->renderingSequenceChanged.disconnect_all_slots();
         if (isPrepared)
             graph->releaseResources();
@@ -770,6 +844,25 @@ public:
     
     void midiClockSignalAcquired()  override { }
     void midiClockSignalDropped()   override { }
+
+    /** Moves the transport to where the clock says it should be at the end
+        of this block, if it has wandered off by more than a couple of ms.
+        The seek lands when the transport finishes the block */
+    void followMidiClock (const double callbackTimeMs, const int numSamples)
+    {
+        double beats = 0.0;
+        const double bpm = (double) transport.getTempo();
+        if (bpm <= 0.0 || ! midiClock.getBeatPosition (callbackTimeMs * 0.001, beats) || beats < 0.0)
+            return;
+
+        const int64 expected = (int64) std::llround (beats * 60.0 / bpm * sampleRate);
+        const int64 actual   = transport.getPositionFrames() + numSamples;
+        const double offsetMs = (double) (actual - expected) * 1000.0 / sampleRate;
+        const bool realign = std::abs (offsetMs) > 2.0;
+        if (realign)
+            transport.requestAudioFrame (expected);
+        midiClock.reportTransportOffset (offsetMs, realign);
+    }
     
     bool isUsingExternalClock() const
     {
@@ -785,16 +878,19 @@ private:
     AudioEngine&        engine;
     Transport           transport;
     RootGraphRender     graphs;
+    SharedResourcePointer<WorkerPool> workers;
     SessionPtr          session;
     
     Value tempoValue;
     Atomic<float> nextTempo;
     
+    // guards the graph list and prepared state against the device
+    // starting or stopping. The render callback never takes it
     CriticalSection     lock;
     double sampleRate   = 0.0;
     int blockSize       = 0;
     bool isPrepared     = false;
-    Atomic<int> currentGraph;
+    Atomic<int> requestedGraph { -1 };
 
     int numInputChans, numOutputChans;
     HeapBlock<float*> channels;
@@ -811,6 +907,7 @@ private:
     Atomic<int> processMidiClock;
     Atomic<int> generateMidiClock { 0 };
     Atomic<int> sendMidiClockToInput { 0 };
+    Atomic<int> inlineSubGraphs { 0 };
 
     MidiClock midiClock;
     MidiClockMaster midiClockMaster;
@@ -898,6 +995,17 @@ void AudioEngine::applySettings (Settings& settings)
     priv->generateMidiClock.set (settings.generateMidiClock() ? 1 : 0);
     priv->sendMidiClockToInput.set (settings.sendMidiClockToInput() ? 1 : 0);
     priv->midiOutLatency.set (settings.getMidiOutLatency());
+
+    WorkerPool::Options workerOptions;
+    workerOptions.numThreads        = settings.getWorkerThreads();
+    workerOptions.priorityOffset    = settings.getWorkerPriorityOffset();
+    workerOptions.affinityMask      = WorkerPool::parseAffinityMask (settings.getWorkerAffinity());
+    workerOptions.lockMemory        = settings.lockMemory();
+    priv->workers->setOptions (workerOptions);
+
+    priv->inlineSubGraphs.set (settings.inlineSubGraphs() ? 1 : 0);
+    for (int i = 0; i < priv->graphs.size(); ++i)
+        priv->graphs.getGraph(i)->setInlineSubGraphs (settings.inlineSubGraphs());
 }
 
 bool AudioEngine::removeGraph (RootGraph* graph)
@@ -909,7 +1017,6 @@ bool AudioEngine::removeGraph (RootGraph* graph)
 
 RootGraph* AudioEngine::getGraph (const int index)
 {
-    ScopedLock sl (priv->lock);
     if (isPositiveAndBelow (index, priv->graphs.size()))
         return priv->graphs.getGraph (index);
     return nullptr;
@@ -929,10 +1036,16 @@ void AudioEngine::setActiveGraph (const int index)
 {
     if (priv == nullptr)
         return;
-    priv->currentGraph.set (index);
+    priv->requestedGraph.set (index);
 }
 
-int AudioEngine::getActiveGraph() const { return (priv != nullptr) ? priv->currentGraph.get() : -1; }
+int AudioEngine::getActiveGraph() const
+{
+    if (priv == nullptr)
+        return -1;
+    const int requested = priv->requestedGraph.get();
+    return requested >= 0 ? requested : priv->graphs.getCurrentGraphIndex();
+}
 
 void AudioEngine::setSession (SessionPtr session)
 {
@@ -1009,6 +1122,11 @@ bool AudioEngine::isUsingExternalClock() const {
     return priv && priv->isUsingExternalClock();
 }
 
+MidiClock::Diagnostics AudioEngine::getMidiClockDiagnostics() const
+{
+    return priv ? priv->midiClock.getDiagnostics() : MidiClock::Diagnostics();
+}
+
 void AudioEngine::processExternalPlayhead (AudioPlayHead* playhead, const int nframes)
 {
     auto& pos (priv->hostPos);
@@ -1038,8 +1156,6 @@ void AudioEngine::updateExternalLatencySamples()
     int latencySamples = 0;
 
     {
-        ScopedLock sl (priv->lock);
-
         auto* current = priv->getCurrentGraph();
         if (nullptr == current) return;
     
@@ -1069,4 +1185,10 @@ MidiIOMonitorPtr AudioEngine::getMidiIOMonitor() const
     return priv != nullptr ? priv->midiIOMonitor : nullptr;
 }
 
+WorkerPool& AudioEngine::getWorkerPool() const
+{
+    jassert (priv != nullptr);
+    return *priv->workers;
+}
+
 }
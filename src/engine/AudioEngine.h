@@ -22,6 +22,7 @@
 #include "ElementApp.h"
 #include "engine/Engine.h"
 #include "engine/GraphProcessor.h"
+#include "engine/MidiClock.h"
 #include "engine/MidiIOMonitor.h"
 #include "engine/Transport.h"
 #include "session/DeviceManager.h"
@@ -33,6 +34,7 @@ class Globals;
 class ClipFactory;
 class EngineControl;
 class Settings;
+class WorkerPool;
 
 typedef GraphProcessor::AudioGraphIOProcessor IOProcessor;
 
@@ -148,11 +150,19 @@ public:
     void applySettings (Settings&);
     
     bool isUsingExternalClock() const;
+
+    /** Returns tempo, jitter and drift of the MIDI clock being followed */
+    MidiClock::Diagnostics getMidiClockDiagnostics() const;
     
     void setSession (SessionPtr);
     void refreshSession();
     
+    /** Add a graph to the engine. Message thread only */
     bool addGraph (RootGraph* graph);
+
+    /** Remove a graph from the engine. Blocks until the audio thread has
+        finished rendering it, so the graph can be deleted afterwards.
+        Message thread only */
     bool removeGraph (RootGraph* graph);
     
     void setCurrentGraph (const int index) { setActiveGraph (index); }
@@ -187,6 +197,9 @@ public:
     Globals& getWorld() const;
     MidiIOMonitorPtr getMidiIOMonitor() const;
 
+    /** Returns the realtime worker pool shared by all engines */
+    WorkerPool& getWorkerPool() const;
+
 private:
     class Private;
     ScopedPointer<Private> priv;
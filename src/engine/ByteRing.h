@@ -0,0 +1,110 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A lock free ring of bytes with one writer and one reader.
+
+    Records are a fixed size header followed by a variable number of bytes.
+    A record is published in one go, so the reader never sees a header
+    without its bytes. The reader reads the header and then its bytes with
+    read(), or steps over them with skip().
+ */
+class ByteRing
+{
+public:
+    explicit ByteRing (int capacityInBytes)
+        : fifo (capacityInBytes)
+    {
+        buffer.calloc ((size_t) fifo.getTotalSize());
+    }
+
+    /** Returns the capacity in bytes */
+    int getTotalSize() const noexcept   { return fifo.getTotalSize(); }
+
+    /** Returns the number of bytes that can be written */
+    int getFreeSpace() const noexcept   { return fifo.getFreeSpace(); }
+
+    /** Returns the number of bytes ready to read */
+    int getNumReady() const noexcept    { return fifo.getNumReady(); }
+
+    /** Write a header and size bytes after it as one record. Returns false
+        if there isn't room. Writer only */
+    template<class Header>
+    bool write (const Header& header, const void* data, int size) noexcept
+    {
+        const int total = (int) sizeof (Header) + jmax (0, size);
+        if (fifo.getFreeSpace() < total)
+            return false;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (total, start1, size1, start2, size2);
+        copyIn (start1, size1, start2, 0, &header, (int) sizeof (Header));
+        if (size > 0)
+            copyIn (start1, size1, start2, (int) sizeof (Header), data, size);
+        fifo.finishedWrite (size1 + size2);
+        return true;
+    }
+
+    /** Read bytes of a record. Reader only */
+    void read (void* data, int size) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (size, start1, size1, start2, size2);
+        auto* dst = static_cast<uint8*> (data);
+        if (size1 > 0)
+            memcpy (dst, buffer + start1, (size_t) size1);
+        if (size2 > 0)
+            memcpy (dst + size1, buffer + start2, (size_t) size2);
+        fifo.finishedRead (size1 + size2);
+    }
+
+    /** Step over bytes of a record without reading them. Reader only */
+    void skip (int size) noexcept   { fifo.finishedRead (jmin (size, fifo.getNumReady())); }
+
+    /** Drop everything written so far. Reader only */
+    void discard() noexcept         { fifo.finishedRead (fifo.getNumReady()); }
+
+private:
+    AbstractFifo fifo;
+    HeapBlock<uint8> buffer;
+
+    void copyIn (int start1, int size1, int start2, int offset,
+                 const void* data, int size) noexcept
+    {
+        auto* src = static_cast<const uint8*> (data);
+        if (offset < size1)
+        {
+            const int num = jmin (size, size1 - offset);
+            memcpy (buffer + start1 + offset, src, (size_t) num);
+            src += num; size -= num; offset += num;
+        }
+
+        if (size > 0)
+            memcpy (buffer + start2 + (offset - size1), src, (size_t) size);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (ByteRing)
+};
+
+}
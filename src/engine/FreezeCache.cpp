@@ -0,0 +1,191 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/FreezeCache.h"
+
+namespace Element {
+
+FreezeCache::FreezeCache() { }
+
+FreezeCache::~FreezeCache()
+{
+    reset();
+}
+
+void FreezeCache::reset()
+{
+    writer.reset();
+    reader.reset();
+    if (file.existsAsFile())
+        file.deleteFile();
+    file = File();
+    range = {};
+    numChannels = 0;
+}
+
+bool FreezeCache::open (int numChans, double newSampleRate)
+{
+    reset();
+    if (numChans <= 0 || newSampleRate <= 0.0)
+        return false;
+
+    file = File::createTempFile (".wav");
+    std::unique_ptr<FileOutputStream> stream (file.createOutputStream());
+    if (stream == nullptr)
+        return false;
+
+    WavAudioFormat format;
+    writer.reset (format.createWriterFor (stream.get(), newSampleRate,
+                                          (unsigned int) numChans, 32, {}, 0));
+    if (writer == nullptr)
+        return false;
+
+    stream.release(); // owned by the writer now
+    numChannels = numChans;
+    return true;
+}
+
+bool FreezeCache::write (const AudioSampleBuffer& buffer, int numSamples)
+{
+    if (writer == nullptr || buffer.getNumChannels() < numChannels)
+        return false;
+    return writer->writeFromFloatArrays (buffer.getArrayOfReadPointers(), numChannels, numSamples);
+}
+
+bool FreezeCache::finish (Range<int64> frames)
+{
+    if (writer == nullptr)
+        return false;
+    writer.reset(); // flushes the header
+
+    WavAudioFormat format;
+    reader.reset (format.createMemoryMappedReader (file));
+    if (reader == nullptr || ! reader->mapEntireFile())
+    {
+        reader.reset();
+        return false;
+    }
+
+    range = frames;
+    return true;
+}
+
+void FreezeCache::read (AudioSampleBuffer& buffer, int numChans, int64 frame, int numSamples) const noexcept
+{
+    numChans = jmin (numChans, buffer.getNumChannels());
+    const int numToRead = jmin (numChans, numChannels);
+
+    if (reader != nullptr && numToRead > 0 && range.intersects ({ frame, frame + numSamples }))
+    {
+        // 32bit wave data is read as floats into the int pointers
+        reader->read (reinterpret_cast<int* const*> (buffer.getArrayOfWritePointers()),
+                      numToRead, frame - range.getStart(), numSamples, false);
+    }
+    else
+    {
+        for (int ch = 0; ch < numToRead; ++ch)
+            buffer.clear (ch, 0, numSamples);
+    }
+
+    for (int ch = numToRead; ch < numChans; ++ch)
+        buffer.clear (ch, 0, numSamples);
+}
+
+//=============================================================================
+namespace {
+    // longer captures would take more than 512MB of audio
+    const int64 maxCaptureSamples = (int64) 1 << 27;
+}
+
+FreezeCapture::FreezeCapture (int numChannels, Range<int64> frames, int midiBytes)
+    : midi (jmax (64, midiBytes)),
+      range (frames),
+      cursor (frames.getStart())
+{
+    numChannels = jmax (0, numChannels);
+    if (frames.isEmpty() || frames.getLength() * jmax (1, numChannels) > maxCaptureSamples)
+        return;
+
+    audio.setSize (numChannels, (int) frames.getLength());
+    audio.clear();
+    valid = true;
+}
+
+FreezeCapture::~FreezeCapture() { }
+
+void FreezeCapture::write (const AudioSampleBuffer& source, const MidiBuffer& events,
+                           int64 frame, int numSamples) noexcept
+{
+    const int64 next = cursor.get();
+    if (! valid || next < frame || next >= frame + numSamples || next >= range.getEnd())
+        return;
+
+    const int offset = (int) (next - frame);
+    const int numToWrite = (int) jmin ((int64) numSamples - offset, range.getEnd() - next);
+    const int dest = (int) (next - range.getStart());
+
+    for (int ch = jmin (audio.getNumChannels(), source.getNumChannels()); --ch >= 0;)
+        audio.copyFrom (ch, dest, source, ch, offset, numToWrite);
+
+    MidiBuffer::Iterator iter (events);
+    const uint8* data = nullptr;
+    int size = 0, position = 0;
+    iter.setNextSamplePosition (offset);
+    while (iter.getNextEvent (data, size, position) && position < offset + numToWrite)
+        midi.write (EventHeader { frame + position, (int32) size }, data, size);
+
+    cursor.set (next + numToWrite);
+}
+
+void FreezeCapture::read (AudioSampleBuffer& dest, MidiBuffer& events, int64 frame, int numSamples)
+{
+    jassert (isComplete());
+    dest.clear (0, numSamples);
+    events.clear();
+
+    const Range<int64> block (frame, frame + numSamples);
+    const auto overlap = block.getIntersectionWith (range);
+    if (! overlap.isEmpty())
+    {
+        for (int ch = jmin (audio.getNumChannels(), dest.getNumChannels()); --ch >= 0;)
+            dest.copyFrom (ch, (int) (overlap.getStart() - frame), audio, ch,
+                           (int) (overlap.getStart() - range.getStart()), (int) overlap.getLength());
+    }
+
+    for (;;)
+    {
+        if (! hasNextEvent)
+        {
+            if (midi.getNumReady() < (int) sizeof (EventHeader))
+                break;
+            midi.read (&nextEvent, (int) sizeof (EventHeader));
+            eventData.setSize ((size_t) nextEvent.size);
+            midi.read (eventData.getData(), nextEvent.size);
+            hasNextEvent = true;
+        }
+
+        if (nextEvent.frame >= block.getEnd())
+            break;
+        if (nextEvent.frame >= frame)
+            events.addEvent (eventData.getData(), nextEvent.size, (int) (nextEvent.frame - frame));
+        hasNextEvent = false;
+    }
+}
+
+}
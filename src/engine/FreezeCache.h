@@ -0,0 +1,140 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "engine/ByteRing.h"
+
+namespace Element {
+
+/** Holds an offline render of a node's audio output.
+
+    Audio is written to a temporary 32bit wave file and played back through
+    a memory mapped reader, so a frozen node costs a copy per block no matter
+    how heavy the plugins behind it are.
+ */
+class FreezeCache
+{
+public:
+    FreezeCache();
+    ~FreezeCache();
+
+    /** Start a new render. Any previously rendered audio is discarded */
+    bool open (int numChannels, double sampleRate);
+
+    /** Append a block of audio to the render */
+    bool write (const AudioSampleBuffer& buffer, int numSamples);
+
+    /** Finish rendering and map the result for playback.
+
+        @param frames   The range of transport frames the render covers
+     */
+    bool finish (Range<int64> frames);
+
+    /** Returns true if the cache is ready for playback */
+    bool isReady() const noexcept { return reader != nullptr; }
+
+    /** Returns the range of transport frames this cache covers */
+    Range<int64> getRange() const noexcept { return range; }
+
+    /** Returns the number of channels rendered */
+    int getNumChannels() const noexcept { return numChannels; }
+
+    /** Read frozen audio starting at a transport frame. Frames outside of the
+        rendered range are cleared. This is realtime safe.
+
+        @param buffer       Destination audio
+        @param numChans     Channels to fill in the destination
+        @param frame        Transport frame of the first sample
+        @param numSamples   Number of samples to read
+     */
+    void read (AudioSampleBuffer& buffer, int numChans, int64 frame, int numSamples) const noexcept;
+
+private:
+    File file;
+    std::unique_ptr<AudioFormatWriter> writer;
+    std::unique_ptr<MemoryMappedAudioFormatReader> reader;
+    Range<int64> range;
+    int numChannels = 0;
+
+    void reset();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FreezeCache)
+};
+
+/** Records a node's live input over a range of transport frames.
+
+    A node with upstream signal can't be rendered offline on its own, so its
+    input is recorded while the transport plays through the range and then
+    fed to the offline render in place of silence.
+ */
+class FreezeCapture
+{
+public:
+    /** Create a capture. Check isValid() before using it.
+
+        @param numChannels  Audio channels to record
+        @param frames       Transport frames to record
+        @param midiBytes    Room for recorded MIDI
+     */
+    FreezeCapture (int numChannels, Range<int64> frames, int midiBytes = 1 << 18);
+    ~FreezeCapture();
+
+    /** Returns false if the range is empty or too long to hold in memory */
+    bool isValid() const noexcept { return valid; }
+
+    /** Returns the range of transport frames recorded */
+    Range<int64> getRange() const noexcept { return range; }
+
+    /** Returns true once every frame in the range has been recorded */
+    bool isComplete() const noexcept { return cursor.get() >= range.getEnd(); }
+
+    /** Record a block which starts at a transport frame. Recording starts
+        once the transport plays over the start of the range and only moves
+        forward, so blocks that skip past the next frame are ignored. MIDI
+        that doesn't fit is dropped. Realtime safe, audio thread only */
+    void write (const AudioSampleBuffer& audio, const MidiBuffer& midi,
+                int64 frame, int numSamples) noexcept;
+
+    /** Fill a block with the recorded input at a transport frame. Blocks
+        must be read in order once the capture is complete */
+    void read (AudioSampleBuffer& audio, MidiBuffer& midi, int64 frame, int numSamples);
+
+private:
+    struct EventHeader
+    {
+        int64 frame;
+        int32 size;
+    };
+
+    AudioSampleBuffer audio;
+    ByteRing midi;
+    Range<int64> range;
+    Atomic<int64> cursor;
+    bool valid = false;
+
+    EventHeader nextEvent;
+    bool hasNextEvent = false;
+    MemoryBlock eventData;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FreezeCapture)
+};
+
+}
@@ -26,6 +26,7 @@
 #include "engine/nodes/SubGraphProcessor.h"
 
 #include "engine/AudioEngine.h"
+#include "engine/FreezeCache.h"
 #include "engine/GraphNode.h"
 #include "engine/GraphProcessor.h"
 #include "engine/MidiPipe.h"
@@ -40,6 +41,7 @@ GraphNode::GraphNode (const uint32 nodeId_) noexcept
       isPrepared (false),
       enablement (*this),
       midiProgramLoader (*this),
+      freezeWatcher (*this),
       portResetter (*this)
 {
     parent = nullptr;
@@ -51,6 +53,8 @@ GraphNode::GraphNode (const uint32 nodeId_) noexcept
 
 GraphNode::~GraphNode()
 {
+    freezeChanged.disconnect_all_slots();
+    unfreeze();
     clearParameters();
     enablement.cancelPendingUpdate();
     parent = nullptr;
@@ -752,6 +756,257 @@ int GraphNode::getOversamplingFactor()
 
 //=========================================================================
 
+namespace {
+/** Plays a fixed transport position while rendering a node offline */
+class FreezePlayHead : public AudioPlayHead
+{
+public:
+    FreezePlayHead (AudioPlayHead* source)
+    {
+        if (source == nullptr || ! source->getCurrentPosition (info))
+            info.resetToDefault();
+        info.isPlaying = true;
+        info.isRecording = false;
+        info.isLooping = false;
+    }
+
+    void setPosition (int64 frame, double sampleRate)
+    {
+        info.timeInSamples  = frame;
+        info.timeInSeconds  = (double) frame / sampleRate;
+        info.ppqPosition    = info.timeInSeconds * (info.bpm / 60.0);
+    }
+
+    bool getCurrentPosition (CurrentPositionInfo& result) override
+    {
+        result = info;
+        return true;
+    }
+
+private:
+    CurrentPositionInfo info;
+};
+}
+
+bool GraphNode::freeze (Range<int64> frames)
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+    if (parent == nullptr || ! isPrepared || frames.isEmpty() || getNumAudioOutputs() <= 0 ||
+        isAudioIONode() || isMidiIONode() || getOversamplingFactor() > 1)
+        return false;
+
+    unfreeze();
+
+    const String inputs = getInputConnections();
+    if (inputs.isEmpty())
+        return renderFreeze (frames, nullptr);
+
+    // upstream signal can't be rendered here, so record it as it plays
+    std::unique_ptr<FreezeCapture> capture (new FreezeCapture (getNumAudioInputs(), frames));
+    if (! capture->isValid())
+        return false;
+
+    {
+        const ScopedLock sl (parent->getRenderLock());
+        freezeCapture.swap (capture);
+    }
+
+    if (auto* sub = processor<SubGraphProcessor>())
+        sub->refreshInlinedRender();
+    freezeWatcher.inputs = inputs;
+    freezeWatcher.parentConnection = parent->renderingSequenceChanged.connect (
+        std::bind (&FreezeWatcher::parentChanged, &freezeWatcher));
+    freezeWatcher.startTimerHz (10);
+    freezeChanged (this);
+    return true;
+}
+
+void GraphNode::finishFreeze()
+{
+    if (freezeCapture == nullptr || ! freezeCapture->isComplete())
+        return;
+
+    freezeWatcher.stopTimer();
+    freezeWatcher.parentConnection.disconnect();
+    std::unique_ptr<FreezeCapture> capture;
+    {
+        const ScopedLock sl (parent->getRenderLock());
+        freezeCapture.swap (capture);
+    }
+
+    if (! renderFreeze (capture->getRange(), capture.get()))
+        freezeChanged (this); // no longer pending
+}
+
+bool GraphNode::renderFreeze (Range<int64> frames, FreezeCapture* input)
+{
+    // stop the engine from touching the processor while rendering
+    freezing.set (1);
+    if (auto* sub = processor<SubGraphProcessor>())
+        sub->refreshInlinedRender();
+    {
+        const ScopedLock sl (parent->getRenderLock());
+    }
+
+    const double sampleRate = parent->getSampleRate();
+    const int blockSize     = jmax (1, parent->getBlockSize());
+    const int numChans      = jmax (1, getNumAudioInputs(), getNumAudioOutputs());
+
+    std::unique_ptr<FreezeCache> cache (new FreezeCache());
+    bool ok = cache->open (getNumAudioOutputs(), sampleRate);
+
+    if (ok)
+    {
+        AudioSampleBuffer audio (numChans, blockSize);
+        MidiBuffer midi;
+        MidiBuffer* midiBuffers[] = { &midi };
+        FreezePlayHead playhead (parent->getPlayHead());
+        auto* const proc = getAudioProcessor();
+        auto* const lastPlayHead = proc != nullptr ? proc->getPlayHead() : nullptr;
+
+        if (proc != nullptr)
+        {
+            proc->setPlayHead (&playhead);
+            proc->reset();
+        }
+
+        for (int64 frame = frames.getStart(); ok && frame < frames.getEnd(); frame += blockSize)
+        {
+            const int numSamples = (int) jmin ((int64) blockSize, frames.getEnd() - frame);
+            AudioSampleBuffer block (audio.getArrayOfWritePointers(), numChans, numSamples);
+            if (input != nullptr)
+            {
+                input->read (block, midi, frame, numSamples);
+            }
+            else
+            {
+                block.clear();
+                midi.clear();
+            }
+
+            playhead.setPosition (frame, sampleRate);
+
+            if (wantsMidiPipe())
+            {
+                MidiPipe pipe (midiBuffers, 1);
+                render (block, pipe);
+            }
+            else if (proc != nullptr)
+            {
+                const ScopedLock sl (proc->getCallbackLock());
+                proc->processBlock (block, midi);
+            }
+
+            ok = cache->write (block, numSamples);
+        }
+
+        if (proc != nullptr)
+        {
+            proc->setPlayHead (lastPlayHead);
+            proc->reset();
+        }
+
+        ok = ok && cache->finish (frames);
+    }
+
+    if (ok)
+    {
+        freezeCache.swap (cache);
+        frozen.set (1);
+
+        for (auto* param : parameters)
+            param->addListener (&freezeWatcher);
+        freezeWatcher.portsConnection = portsChanged.connect (
+            std::bind (&FreezeWatcher::triggerAsyncUpdate, &freezeWatcher));
+        if (auto* sub = processor<SubGraphProcessor>())
+            freezeWatcher.sequenceConnection = sub->renderingSequenceChanged.connect (
+                std::bind (&FreezeWatcher::triggerAsyncUpdate, &freezeWatcher));
+        freezeWatcher.inputs = getInputConnections();
+        freezeWatcher.parentConnection = parent->renderingSequenceChanged.connect (
+            std::bind (&FreezeWatcher::parentChanged, &freezeWatcher));
+    }
+
+    freezing.set (0);
+
+    if (ok)
+        freezeChanged (this);
+    else if (isSubGraph())
+        parent->triggerAsyncUpdate(); // can be inlined again
+    return ok;
+}
+
+String GraphNode::getInputConnections() const
+{
+    StringArray inputs;
+    if (parent != nullptr)
+    {
+        for (int i = parent->getNumConnections(); --i >= 0;)
+        {
+            const auto* const c = parent->getConnection (i);
+            if (c->destNode == nodeId)
+                inputs.add (String (c->sourceNode) + ":" + String (c->sourcePort) + ">" + String (c->destPort));
+        }
+    }
+
+    inputs.sort (false);
+    return inputs.joinIntoString (" ");
+}
+
+void GraphNode::unfreeze()
+{
+    freezeWatcher.cancelPendingUpdate();
+
+    if (freezeCapture != nullptr)
+    {
+        freezeWatcher.stopTimer();
+        freezeWatcher.parentConnection.disconnect();
+        std::unique_ptr<FreezeCapture> capture;
+        if (parent != nullptr)
+        {
+            const ScopedLock sl (parent->getRenderLock());
+            freezeCapture.swap (capture);
+            if (isSubGraph())
+                parent->triggerAsyncUpdate(); // can be inlined again
+        }
+        else
+        {
+            freezeCapture.swap (capture);
+        }
+
+        capture.reset();
+        freezeChanged (this);
+    }
+
+    if (! isFrozen())
+        return;
+
+    freezeWatcher.portsConnection.disconnect();
+    freezeWatcher.sequenceConnection.disconnect();
+    freezeWatcher.parentConnection.disconnect();
+    for (auto* param : parameters)
+        param->removeListener (&freezeWatcher);
+
+    frozen.set (0);
+    std::unique_ptr<FreezeCache> cache;
+
+    if (parent != nullptr)
+    {
+        const ScopedLock sl (parent->getRenderLock());
+        freezeCache.swap (cache);
+        if (isSubGraph())
+            parent->triggerAsyncUpdate(); // can be inlined again
+    }
+    else
+    {
+        freezeCache.swap (cache);
+    }
+
+    cache.reset();
+    freezeChanged (this);
+}
+
+//=========================================================================
+
 struct ChannelConnectionMap {
     ChannelConnectionMap() {}
     ~ChannelConnectionMap() {}
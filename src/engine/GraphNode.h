@@ -27,8 +27,11 @@ namespace Element {
 /* So render tasks can be friends of graph node */
 namespace GraphRender {
 class ProcessBufferOp;
+class RenderTopology;
 }
 
+class FreezeCache;
+class FreezeCapture;
 class GraphProcessor;
 class MidiPipe;
 
@@ -81,6 +84,17 @@ public:
     virtual bool wantsMidiPipe() const { return false; }
     virtual void render (AudioSampleBuffer&, MidiPipe&) { }
     virtual void renderBypassed (AudioSampleBuffer&, MidiPipe&);
+
+    /** Returns true if this node can render on an engine worker, alongside
+        other nodes that don't depend on it. Graphs check this when building
+        their rendering sequence */
+    virtual bool isParallelSafe() const { return false; }
+
+    /** Called by the graph before each block it could hand this node to an
+        engine worker for. Returns true if this block may render on a worker.
+        Nodes that can change what they render should decide from, and then
+        render, the same state, since it can change before the worker runs */
+    virtual bool beginParallelRender() { return isParallelSafe(); }
     
     /** Returns the total number of audio inputs */
     int getNumAudioInputs() const;
@@ -338,6 +352,31 @@ public:
     void setOversamplingFactor (int osFactor);
     int getOversamplingFactor();
 
+    //=========================================================================
+    /** Render this node offline over a range of transport frames and play
+        back the result instead of processing. The node stays frozen until
+        unfreeze() is called, one of its parameters or ports change, or
+        the connections to its inputs change.
+
+        A node with connected inputs needs its upstream signal, so its input
+        is recorded while the transport plays through the range and the node
+        is rendered once the whole range has played. Until then the freeze is
+        pending and the node processes as usual.
+
+        @param frames   Transport frames to render
+        @returns        True if the node is now frozen or waiting for input
+     */
+    bool freeze (Range<int64> frames);
+
+    /** Discard a frozen render and resume normal processing */
+    void unfreeze();
+
+    /** Returns true if this node is playing back a frozen render */
+    inline bool isFrozen() const { return frozen.get() == 1; }
+
+    /** Returns true if this node is recording its input to be frozen */
+    inline bool isFreezePending() const { return freezeCapture != nullptr; }
+
     //=========================================================================
     /** Triggered when the enabled state changes */
     Signal<void(GraphNode*)> enablementChanged;
@@ -360,6 +399,9 @@ public:
     /** Triggered when the node changes its name */
     Signal<void()> nameChanged;
 
+    /** Triggered when the node is frozen or unfrozen */
+    Signal<void(GraphNode*)> freezeChanged;
+
 protected:
     GraphNode (uint32 nodeId) noexcept;
     virtual void createPorts() = 0;
@@ -390,6 +432,7 @@ protected:
 private:
     friend class GraphProcessor;
     friend class GraphRender::ProcessBufferOp;
+    friend class GraphRender::RenderTopology;
     friend class GraphManager;
     friend class EngineController;
     friend class Node;
@@ -400,6 +443,8 @@ private:
     Atomic<int> bypassed { 0 };
     Atomic<int> mute { 0 };
     Atomic<int> muteInput { 0 };
+    Atomic<int> frozen { 0 };
+    Atomic<int> freezing { 0 };
 
     int latencySamples = 0;
     String name;
@@ -436,6 +481,28 @@ private:
         GraphNode& node;    
     } midiProgramLoader;
 
+    std::unique_ptr<FreezeCache> freezeCache;
+    std::unique_ptr<FreezeCapture> freezeCapture;
+    struct FreezeWatcher : public AsyncUpdater,
+                           public Timer,
+                           public Parameter::Listener
+    {
+        FreezeWatcher (GraphNode& n) : node (n) { }
+        ~FreezeWatcher() { cancelPendingUpdate(); stopTimer(); }
+        void handleAsyncUpdate() override { node.unfreeze(); }
+        void timerCallback() override     { node.finishFreeze(); }
+        void controlValueChanged (int, float) override  { triggerAsyncUpdate(); }
+        void controlTouched (int, bool) override        { }
+        void parentChanged()    { if (node.getInputConnections() != inputs) triggerAsyncUpdate(); }
+        GraphNode& node;
+        String inputs;
+        SignalConnection portsConnection, sequenceConnection, parentConnection;
+    } freezeWatcher;
+
+    String getInputConnections() const;
+    bool renderFreeze (Range<int64> frames, FreezeCapture* input);
+    void finishFreeze();
+
     friend struct PortResetter;
     struct PortResetter : public AsyncUpdater
     {
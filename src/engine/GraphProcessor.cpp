@@ -19,9 +19,12 @@
 
 #include "engine/nodes/AudioProcessorNode.h"
 #include "engine/AudioEngine.h"
+#include "engine/FreezeCache.h"
 #include "engine/GraphProcessor.h"
+#include "engine/MidiKernels.h"
 #include "engine/MidiPipe.h"
 #include "engine/MidiTranspose.h"
+#include "engine/WorkerPool.h"
 #include "engine/nodes/SubGraphProcessor.h"
 #include "session/Node.h"
 
@@ -32,6 +35,36 @@ const int GraphProcessor::midiChannelIndex = 0x1000;
 namespace GraphRender
 {
 
+/** The shared buffers an op reads and writes. MIDI buffers are listed after
+    audio ones, offset by GraphProcessor::midiChannelIndex */
+struct BufferUse
+{
+    Array<int> reads, writes;
+
+    void read (int audio)           { reads.addIfNotAlreadyThere (audio); }
+    void write (int audio)          { writes.addIfNotAlreadyThere (audio); }
+    void readMidi (int midi)        { read (GraphProcessor::midiChannelIndex + midi); }
+    void writeMidi (int midi)       { write (GraphProcessor::midiChannelIndex + midi); }
+
+    void add (const BufferUse& other)
+    {
+        reads.addArray (other.reads);
+        writes.addArray (other.writes);
+    }
+
+    /** Returns true if running ops with these uses at the same time would race */
+    bool conflictsWith (const BufferUse& other) const
+    {
+        for (const auto buffer : writes)
+            if (other.reads.contains (buffer) || other.writes.contains (buffer))
+                return true;
+        for (const auto buffer : other.writes)
+            if (reads.contains (buffer))
+                return true;
+        return false;
+    }
+};
+
 class Task
 {
 public:
@@ -42,6 +75,9 @@ public:
                           const OwnedArray <MidiBuffer>& sharedMidiBuffers,
                           const int numSamples) = 0;
 
+    /** Adds the shared buffers this op touches */
+    virtual void getBufferUse (BufferUse&) const { }
+
     JUCE_LEAK_DETECTOR (Task);
 };
 
@@ -57,6 +93,8 @@ public:
         sharedBufferChans.clear (channelNum, 0, numSamples);
     }
 
+    void getBufferUse (BufferUse& use) const { use.write (channelNum); }
+
 private:
     const int channelNum;
 
@@ -77,6 +115,8 @@ public:
         sharedBufferChans.copyFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
+    void getBufferUse (BufferUse& use) const { use.read (srcChannelNum); use.write (dstChannelNum); }
+
 private:
     const int srcChannelNum, dstChannelNum;
 
@@ -97,6 +137,13 @@ public:
         sharedBufferChans.addFrom (dstChannelNum, 0, sharedBufferChans, srcChannelNum, 0, numSamples);
     }
 
+    void getBufferUse (BufferUse& use) const
+    {
+        use.read (srcChannelNum);
+        use.read (dstChannelNum);
+        use.write (dstChannelNum);
+    }
+
 private:
     const int srcChannelNum, dstChannelNum;
 
@@ -116,6 +163,8 @@ public:
         sharedMidiBuffers.getUnchecked (bufferNum)->clear();
     }
 
+    void getBufferUse (BufferUse& use) const { use.writeMidi (bufferNum); }
+
 private:
     const int bufferNum;
 
@@ -136,6 +185,8 @@ public:
         *sharedMidiBuffers.getUnchecked (dstBufferNum) = *sharedMidiBuffers.getUnchecked (srcBufferNum);
     }
 
+    void getBufferUse (BufferUse& use) const { use.readMidi (srcBufferNum); use.writeMidi (dstBufferNum); }
+
 private:
     const int srcBufferNum, dstBufferNum;
 
@@ -157,6 +208,13 @@ public:
             ->addEvents (*sharedMidiBuffers.getUnchecked (srcBufferNum), 0, numSamples, 0);
     }
 
+    void getBufferUse (BufferUse& use) const
+    {
+        use.readMidi (srcBufferNum);
+        use.readMidi (dstBufferNum);
+        use.writeMidi (dstBufferNum);
+    }
+
 private:
     const int srcBufferNum, dstBufferNum;
 
@@ -188,6 +246,8 @@ public:
         }
     }
 
+    void getBufferUse (BufferUse& use) const { use.read (channel); use.write (channel); }
+
 private:
     HeapBlock<float> buffer;
     const int channel, bufferSize;
@@ -240,6 +300,15 @@ public:
             return;
         }
 
+        if (node->freezing.get() == 1)
+        {
+            // the node is being rendered offline, don't touch it
+            for (int ch = 0; ch < numAudioOuts; ++ch)
+                buffer.clear (ch, 0, numSamples);
+            sharedMidiBuffers.getUnchecked (midiBufferToUse)->clear();
+            return;
+        }
+
         const bool muted = node->isMuted();
         const bool muteInput = node->isMutingInputs();
 
@@ -286,32 +355,27 @@ public:
             if (keyRange.getLength() > 0 || !midiChans.isOmni() || useMidiProgram)
             {
                 auto& midi = *sharedMidiBuffers.getUnchecked (midiBufferToUse);
-                MidiBuffer::Iterator iter (midi);
-                int frame = 0; MidiMessage msg;
-                while (iter.getNextEvent (msg, frame))
-                {
-                    if (msg.isNoteOnOrOff())
-                    {
-                        // out of range 
-                        if (keyRange.getLength() > 0 && (msg.getNoteNumber() < keyRange.getStart() || msg.getNoteNumber() > keyRange.getEnd()))
-                            continue;
-                    }
+                MidiKernels::filter (midi, tempMidi, [&] (const uint8* data, int size, int) {
+                    // out of range
+                    if (keyRange.getLength() > 0 && MidiKernels::isNoteOnOrOff (data, size)
+                            && (data[1] < keyRange.getStart() || data[1] > keyRange.getEnd()))
+                        return false;
 
-                    if (msg.getChannel() > 0 && midiChans.isOff (msg.getChannel()))
-                        continue;
+                    const int channel = MidiKernels::getChannel (data);
+                    if (channel > 0 && midiChans.isOff (channel))
+                        return false;
 
-                    if (useMidiProgram && msg.isProgramChange())
+                    if (useMidiProgram && size >= 2 && (data[0] & 0xf0) == 0xc0)
                     {
-                        node->setMidiProgram (msg.getProgramChangeNumber());
+                        node->setMidiProgram (data[1]);
                         node->reloadMidiProgram();
-                        continue;
+                        return false;
                     }
 
-                    transpose.process (msg);
-                    tempMidi.addEvent (msg, frame);
-                }
+                    return true;
+                });
 
-                midi.swapWith (tempMidi);
+                transpose.process (midi, numSamples);
             }
             else
             {
@@ -321,8 +385,15 @@ public:
         tempMidi.clear();
         // End MIDI filters
        #endif
+
+        if (node->freezeCapture != nullptr)
+            captureFreezeInput (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse), numSamples);
         
-        if (node->wantsMidiPipe())
+        if (node->isFrozen())
+        {
+            renderFrozen (buffer, *sharedMidiBuffers.getUnchecked (midiBufferToUse), numSamples);
+        }
+        else if (node->wantsMidiPipe())
         {
             MidiPipe midiPipe (sharedMidiBuffers, midiChannelsToUse);
             if (! node->isSuspended())
@@ -402,10 +473,65 @@ public:
             node->setOutputRMS (i, buffer.getRMSLevel (i, 0, numSamples));
     }
 
+    void getBufferUse (BufferUse& use) const
+    {
+        for (int i = 0; i < totalChans; ++i)
+        {
+            use.read (audioChannelsToUse.getUnchecked (i));
+            use.write (audioChannelsToUse.getUnchecked (i));
+        }
+
+        if (node->wantsMidiPipe())
+        {
+            for (const auto midi : midiChannelsToUse)
+            {
+                use.readMidi (midi);
+                use.writeMidi (midi);
+            }
+        }
+        else
+        {
+            use.readMidi (midiBufferToUse);
+            use.writeMidi (midiBufferToUse);
+        }
+    }
+
     const GraphNodePtr node;
     AudioProcessor* const processor;
 
 private:
+    void captureFreezeInput (AudioSampleBuffer& buffer, MidiBuffer& midi, const int numSamples)
+    {
+        auto* const graph = node->getParentGraph();
+        auto* const playhead = graph != nullptr ? graph->getPlayHead() : nullptr;
+        AudioPlayHead::CurrentPositionInfo pos;
+
+        if (playhead != nullptr && playhead->getCurrentPosition (pos) && pos.isPlaying)
+        {
+            AudioSampleBuffer inputs (buffer.getArrayOfWritePointers(), numAudioIns, numSamples);
+            node->freezeCapture->write (inputs, midi, pos.timeInSamples, numSamples);
+        }
+    }
+
+    void renderFrozen (AudioSampleBuffer& buffer, MidiBuffer& midi, const int numSamples)
+    {
+        midi.clear();
+        auto* const graph = node->getParentGraph();
+        auto* const playhead = graph != nullptr ? graph->getPlayHead() : nullptr;
+        AudioPlayHead::CurrentPositionInfo pos;
+
+        if (node->freezeCache != nullptr && playhead != nullptr &&
+            playhead->getCurrentPosition (pos) && pos.isPlaying)
+        {
+            node->freezeCache->read (buffer, numAudioOuts, pos.timeInSamples, numSamples);
+        }
+        else
+        {
+            for (int ch = 0; ch < numAudioOuts; ++ch)
+                buffer.clear (ch, 0, numSamples);
+        }
+    }
+
     Array <int> audioChannelsToUse;
     Array <int> midiChannelsToUse;
     HeapBlock <float*> channels;
@@ -418,16 +544,374 @@ private:
 };
 
 
+/** The ordered nodes and arcs a rendering sequence is built from.
+
+    Normally this is the graph's own nodes and connections. When sub graphs are
+    inlined, their nodes are added with ids unique to the topology and arcs
+    passing through a sub graph's IO nodes are replaced by arcs between the nodes
+    on either side of it.
+ */
+class RenderTopology
+{
+public:
+    RenderTopology (GraphProcessor& graph, const bool inlineSubGraphs)
+    {
+        for (int i = 0; i < graph.getNumNodes(); ++i)
+            nextNodeId = jmax (nextNodeId, graph.getNode(i)->nodeId + 1);
+
+        addNodes (*scopes.add (new Scope (graph, nullptr, nullptr)), inlineSubGraphs);
+        for (auto* scope : scopes)
+            addArcs (*scope);
+
+        sortNodes();
+    }
+
+    int size() const noexcept                           { return nodes.size(); }
+    GraphNode* getNode (const int index) const noexcept { return nodes.getObjectPointerUnchecked (index); }
+    uint32 getNodeId (const int index) const noexcept   { return nodeIds.getUnchecked (index); }
+
+    int getNumArcs() const noexcept                     { return arcs.size(); }
+    const Arc* getArc (const int index) const noexcept  { return arcs.getUnchecked (index); }
+
+    const Arc* getArcBetween (uint32 sourceNode, uint32 sourcePort,
+                              uint32 destNode, uint32 destPort) const
+    {
+        const Arc a (sourceNode, sourcePort, destNode, destPort);
+        ArcSorter sorter;
+        return arcs [arcs.indexOfSorted (sorter, &a)];
+    }
+
+    /** Sub graph nodes that were inlined */
+    const ReferenceCountedArray<GraphNode>& getInlinedNodes() const noexcept { return inlinedNodes; }
+
+    /** Returns true if the node is a sub graph which can be rendered inline.
+        This is called from the audio thread by the inline guard.
+     */
+    static bool canInline (GraphNode& node)
+    {
+        auto* const graph = dynamic_cast<GraphProcessor*> (node.getAudioProcessor());
+        if (graph == nullptr || ! node.isEnabled() || node.isSuspended() || node.isMuted() ||
+            node.isFrozen() || node.isFreezePending() || node.freezing.get() == 1 ||
+            node.getOversamplingFactor() > 1 ||
+            node.getGain() != 1.f || node.getInputGain() != 1.f || graph->filtersMidi())
+            return false;
+
+        ScopedLock sl (node.getPropertyLock());
+        return node.getKeyRange().getLength() <= 0 && node.getTransposeOffset() == 0 &&
+            node.getMidiChannels().isOmni() && ! node.areMidiProgramsEnabled();
+    }
+
+private:
+    struct Scope
+    {
+        Scope (GraphProcessor& g, GraphNode* n, Scope* p)
+            : graph (g), node (n), parent (p) { }
+
+        GraphProcessor& graph;
+        GraphNode* const node;      // the sub graph node in the parent scope
+        Scope* const parent;
+        HashMap<uint32, uint32> ids;
+        HashMap<uint32, Scope*> children;
+    };
+
+    OwnedArray<Scope> scopes;
+    ReferenceCountedArray<GraphNode> nodes;
+    Array<uint32> nodeIds;
+    OwnedArray<Arc> arcs;
+    ReferenceCountedArray<GraphNode> inlinedNodes;
+    uint32 nextNodeId = 1;
+
+    static bool isIONode (GraphNode& node)
+    {
+        return nullptr != dynamic_cast<GraphProcessor::AudioGraphIOProcessor*> (node.getAudioProcessor());
+    }
+
+    static GraphNode* findIONode (GraphProcessor& graph, const IODeviceType type)
+    {
+        for (int i = 0; i < graph.getNumNodes(); ++i)
+            if (auto* io = dynamic_cast<GraphProcessor::AudioGraphIOProcessor*> (graph.getNode(i)->getAudioProcessor()))
+                if (io->getType() == type)
+                    return graph.getNode (i);
+        return nullptr;
+    }
+
+    void addNodes (Scope& scope, const bool inlineSubGraphs)
+    {
+        for (int i = 0; i < scope.graph.getNumNodes(); ++i)
+        {
+            GraphNode* const node = scope.graph.getNode (i);
+
+            if (inlineSubGraphs && canInline (*node))
+            {
+                auto* sub = dynamic_cast<GraphProcessor*> (node->getAudioProcessor());
+                auto* child = scopes.add (new Scope (*sub, node, &scope));
+                scope.children.set (node->nodeId, child);
+                inlinedNodes.add (node);
+                addNodes (*child, inlineSubGraphs);
+                continue;
+            }
+
+            if (scope.parent != nullptr)
+            {
+                // inlined IO nodes become direct buffer aliases
+                if (isIONode (*node))
+                    continue;
+                node->prepare (scope.graph.getSampleRate(), scope.graph.getBlockSize(), &scope.graph);
+            }
+
+            const uint32 nodeId = scope.parent == nullptr ? node->nodeId : nextNodeId++;
+            scope.ids.set (node->nodeId, nodeId);
+            nodes.add (node);
+            nodeIds.add (nodeId);
+        }
+    }
+
+    void addArcs (Scope& scope)
+    {
+        ArcSorter sorter;
+        Array<uint32> sourceNodes, sourcePorts;
+
+        for (int i = 0; i < scope.graph.getNumConnections(); ++i)
+        {
+            const auto* const c = scope.graph.getConnection (i);
+            if (! scope.ids.contains (c->destNode))
+                continue;
+
+            sourceNodes.clearQuick(); sourcePorts.clearQuick();
+            resolveSources (scope, c->sourceNode, c->sourcePort, sourceNodes, sourcePorts, 0);
+
+            for (int j = 0; j < sourceNodes.size(); ++j)
+            {
+                auto* arc = new Arc (sourceNodes.getUnchecked (j), sourcePorts.getUnchecked (j),
+                                     scope.ids [c->destNode], c->destPort);
+                if (arcs.indexOfSorted (sorter, arc) < 0)
+                    arcs.addSorted (sorter, arc);
+                else
+                    delete arc;
+            }
+        }
+    }
+
+    /** Finds the nodes in the topology which produce the signal leaving
+        a node's output port. Arcs through inlined IO nodes are followed
+        to the other side of the sub graph boundary. */
+    void resolveSources (Scope& scope, const uint32 nodeId, const uint32 port,
+                         Array<uint32>& sourceNodes, Array<uint32>& sourcePorts,
+                         const int depth)
+    {
+        if (depth > 64)
+        {
+            jassertfalse; // feedback loop through sub graph IO
+            return;
+        }
+
+        if (auto* child = scope.children [nodeId])
+        {
+            // output of an inlined graph: use whatever feeds its output node
+            GraphNode* const node = child->node;
+            const PortType type (node->getPortType (port));
+            const int channel = node->getChannelPort (port);
+            auto* io = findIONode (child->graph, type == PortType::Midi ? IOProcessor::midiOutputNode
+                                                                         : IOProcessor::audioOutputNode);
+            if (io == nullptr)
+                return;
+
+            const uint32 ioPort = io->getPortForChannel (type, channel, true);
+            for (int i = 0; i < child->graph.getNumConnections(); ++i)
+            {
+                const auto* const c = child->graph.getConnection (i);
+                if (c->destNode == io->nodeId && c->destPort == ioPort)
+                    resolveSources (*child, c->sourceNode, c->sourcePort,
+                                    sourceNodes, sourcePorts, depth + 1);
+            }
+
+            return;
+        }
+
+        if (scope.parent != nullptr)
+        {
+            GraphNode* const node = scope.graph.getNodeForId (nodeId);
+            if (node != nullptr && isIONode (*node))
+            {
+                // input of an inlined graph: use whatever feeds the graph in the parent
+                const PortType type (node->getPortType (port));
+                const uint32 hostPort = scope.node->getPortForChannel (type, node->getChannelPort (port), true);
+                Scope& parent = *scope.parent;
+
+                for (int i = 0; i < parent.graph.getNumConnections(); ++i)
+                {
+                    const auto* const c = parent.graph.getConnection (i);
+                    if (c->destNode == scope.node->nodeId && c->destPort == hostPort)
+                        resolveSources (parent, c->sourceNode, c->sourcePort,
+                                        sourceNodes, sourcePorts, depth + 1);
+                }
+
+                return;
+            }
+        }
+
+        if (scope.ids.contains (nodeId))
+        {
+            sourceNodes.add (scope.ids [nodeId]);
+            sourcePorts.add (port);
+        }
+    }
+
+    void sortNodes()
+    {
+        const ArcTable<Arc> table (arcs);
+        ReferenceCountedArray<GraphNode> ordered;
+        Array<uint32> orderedIds;
+
+        for (int i = 0; i < nodes.size(); ++i)
+        {
+            const uint32 nodeId = nodeIds.getUnchecked (i);
+
+            int j = 0;
+            for (; j < ordered.size(); ++j)
+                if (table.isAnInputTo (nodeId, orderedIds.getUnchecked (j)))
+                    break;
+
+            ordered.insert (j, nodes.getObjectPointerUnchecked (i));
+            orderedIds.insert (j, nodeId);
+        }
+
+        nodes.swapWith (ordered);
+        nodeIds.swapWith (orderedIds);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RenderTopology)
+};
+
+/** Asks the graph to rebuild when an inlined sub graph changes in a way that
+    needs its own process op, e.g. it was muted or had its gain changed. */
+class InlineGuardOp : public Task
+{
+public:
+    InlineGuardOp (GraphProcessor& g, const ReferenceCountedArray<GraphNode>& n)
+        : graph (g), nodes (n) { }
+
+    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>&, const int)
+    {
+        if (triggered)
+            return;
+
+        for (auto* node : nodes)
+        {
+            if (! RenderTopology::canInline (*node))
+            {
+                triggered = true;
+                graph.triggerAsyncUpdate();
+                break;
+            }
+        }
+    }
+
+private:
+    GraphProcessor& graph;
+    ReferenceCountedArray<GraphNode> nodes;
+    bool triggered = false;
+
+    JUCE_DECLARE_NON_COPYABLE (InlineGuardOp)
+};
+
+/** Applies queued parameter changes for a graph rendered inline, whose own
+    processBlock isn't called. */
+class ParameterQueueOp : public Task
+{
+public:
+    ParameterQueueOp (ParameterQueue& q)
+        : queue (&q) { }
+
+    void perform (AudioSampleBuffer&, const OwnedArray <MidiBuffer>&, const int)
+    {
+        queue->process();
+    }
+
+private:
+    ParameterQueue::Ptr queue;
+
+    JUCE_DECLARE_NON_COPYABLE (ParameterQueueOp)
+};
+
+/** Renders nodes that don't share buffers on the engine's workers. Each
+    branch holds one node's ops: the copies, mixes and delays feeding it,
+    then the node itself. A node that stopped being parallel safe since
+    the sequence was built renders on the calling thread instead. */
+class ParallelOp : public Task
+{
+public:
+    ParallelOp() { }
+
+    /** Takes ownership of a range of ops as the branch for a node */
+    void addBranch (GraphNode* node, const Array<void*>& ops, Range<int> range)
+    {
+        auto* branch = branches.add (new Branch (node));
+        for (int i = range.getStart(); i < range.getEnd(); ++i)
+            branch->ops.add (static_cast<Task*> (ops.getUnchecked (i)));
+        jobs.ensureStorageAllocated (branches.size());
+    }
+
+    void perform (AudioSampleBuffer& sharedBufferChans, const OwnedArray <MidiBuffer>& sharedMidiBuffers, const int numSamples)
+    {
+        jobs.clearQuick();
+        for (auto* branch : branches)
+        {
+            branch->audio = &sharedBufferChans;
+            branch->midi = &sharedMidiBuffers;
+            branch->numSamples = numSamples;
+
+            if (branch->node->beginParallelRender())
+                jobs.add (branch);
+            else
+                branch->perform();
+        }
+
+        pool->perform (jobs.getRawDataPointer(), jobs.size());
+    }
+
+    void getBufferUse (BufferUse& use) const
+    {
+        for (const auto* branch : branches)
+            for (const auto* op : branch->ops)
+                op->getBufferUse (use);
+    }
+
+private:
+    struct Branch : public WorkerPool::Job
+    {
+        Branch (GraphNode* n) : node (n) { }
+
+        void perform() override
+        {
+            for (auto* op : ops)
+                op->perform (*audio, *midi, numSamples);
+        }
+
+        const GraphNodePtr node;
+        OwnedArray<Task> ops;
+        AudioSampleBuffer* audio = nullptr;
+        const OwnedArray<MidiBuffer>* midi = nullptr;
+        int numSamples = 0;
+    };
+
+    OwnedArray<Branch> branches;
+    Array<WorkerPool::Job*> jobs;
+    SharedResourcePointer<WorkerPool> pool;
+
+    JUCE_DECLARE_NON_COPYABLE (ParallelOp)
+};
+
 /** Used to calculate the correct sequence of rendering ops needed, based on
     the best re-use of shared buffers at each stage. */
 class ProcessorGraphBuilder
 {
 public:
     ProcessorGraphBuilder (GraphProcessor& graph_, 
-                           const Array<void*>& orderedNodes_,
+                           const RenderTopology& topology_,
                            Array<void*>& renderingOps)
         : graph (graph_),
-          orderedNodes (orderedNodes_),
+          topology (topology_),
           totalLatency (0)
     {
         for (int i = 0; i < PortType::Unknown; ++i)
@@ -436,13 +920,21 @@ public:
             allPorts[i].add (KV_INVALID_PORT);
         }
 
-        for (int i = 0; i < orderedNodes.size(); ++i)
+        if (topology.getInlinedNodes().size() > 0)
+            renderingOps.add (new InlineGuardOp (graph, topology.getInlinedNodes()));
+        for (auto* const node : topology.getInlinedNodes())
+            if (auto* const sub = dynamic_cast<GraphProcessor*> (node->getAudioProcessor()))
+                renderingOps.add (new ParameterQueueOp (sub->getParameterQueue()));
+
+        for (int i = 0; i < topology.size(); ++i)
         {
-            createRenderingOpsForNode ((GraphNode*) orderedNodes.getUnchecked (i),
-                                       renderingOps, i);
+            const int firstOp = renderingOps.size();
+            createRenderingOpsForNode (topology.getNode (i), renderingOps, i);
+            nodeOps.add (Range<int> (firstOp, renderingOps.size()));
             markUnusedBuffersFree (i);
         }
 
+        groupParallelNodes (renderingOps);
         graph.setLatencySamples (totalLatency);
     }
 
@@ -451,7 +943,7 @@ public:
 private:
     //==============================================================================
     GraphProcessor& graph;
-    const Array<void*>& orderedNodes;
+    const RenderTopology& topology;
     Array <uint32> allNodes [PortType::Unknown];
     Array <uint32> allPorts [PortType::Unknown];
 
@@ -462,6 +954,7 @@ private:
     Array <uint32> nodeDelayIDs;
     Array <int> nodeDelays;
     int totalLatency;
+    Array <Range<int>> nodeOps;
 
     int getNodeDelay (const uint32 nodeID) const          { return nodeDelays [nodeDelayIDs.indexOf (nodeID)]; }
 
@@ -484,9 +977,9 @@ private:
     {
         int maxLatency = 0;
 
-        for (int i = graph.getNumConnections(); --i >= 0;)
+        for (int i = topology.getNumArcs(); --i >= 0;)
         {
-            const auto* const c = graph.getConnection (i);
+            const auto* const c = topology.getArc (i);
             if (c->destNode == nodeID)
                 maxLatency = jmax (maxLatency, getNodeDelay (c->sourceNode));
         }
@@ -512,7 +1005,8 @@ private:
         }
         
         Array <int> channelsToUse [PortType::Unknown];
-        int maxLatency = getInputLatency (node->nodeId);
+        const uint32 nodeId = topology.getNodeId (ourRenderingIndex);
+        int maxLatency = getInputLatency (nodeId);
 
         const uint32 numPorts (node->getNumPorts());
         for (uint32 port = 0; port < numPorts; ++port)
@@ -539,7 +1033,7 @@ private:
                     jassert (outPort == port);
                     jassert (outPort < node->getNumPorts());
 
-                    markBufferAsContaining (bufIndex, portType, node->nodeId, outPort);
+                    markBufferAsContaining (bufIndex, portType, nodeId, outPort);
                 }
                 continue;
             }
@@ -551,11 +1045,11 @@ private:
             // get a list of all the inputs to this node
             Array <uint32> sourceNodes;
             Array <uint32> sourcePorts;
-            for (int i = graph.getNumConnections(); --i >= 0;)
+            for (int i = topology.getNumArcs(); --i >= 0;)
             {
-                const GraphProcessor::Connection* const c = graph.getConnection (i);
+                const Arc* const c = topology.getArc (i);
 
-                if (c->destNode == node->nodeId && c->destPort == port)
+                if (c->destNode == nodeId && c->destPort == port)
                 {
                     sourceNodes.add (c->sourceNode);
                     sourcePorts.add (c->sourcePort);
@@ -565,8 +1059,9 @@ private:
             int bufIndex = -1;
             if (sourceNodes.size() == 0)
             {
-                // unconnected input channel
-                if (portType == PortType::Audio && inputChan >= (int)numOuts)
+                // unconnected input channel. Nodes that may render on a worker
+                // get a buffer of their own, in case they write to their inputs
+                if (portType == PortType::Audio && inputChan >= (int)numOuts && ! node->isParallelSafe())
                 {
                     bufIndex = getReadOnlyEmptyBuffer();
                     jassert (bufIndex >= 0);
@@ -585,6 +1080,10 @@ private:
                         default:
                             break;
                     }
+
+                    // keeps the next unconnected input off this buffer
+                    if (inputChan >= (int) numOuts)
+                        markBufferAsContaining (bufIndex, portType, anonymousNodeID, 0);
                 }
             }
             else if (sourceNodes.size() == 1)
@@ -743,11 +1242,11 @@ private:
             if (inputChan < (int) numOuts)
             {
                 const int outputPort = node->getNthPort (portType, inputChan, false, false);
-                markBufferAsContaining (bufIndex, portType, node->nodeId, outputPort);
+                markBufferAsContaining (bufIndex, portType, nodeId, outputPort);
             }
         } /* foreach port */
 
-        setNodeDelay (node->nodeId, maxLatency + node->getLatencySamples());
+        setNodeDelay (nodeId, maxLatency + node->getLatencySamples());
         
         if (node->isAudioIONode() && node->getNumPorts (PortType::Audio, false) == 0)
             totalLatency = maxLatency;
@@ -758,6 +1257,62 @@ private:
                                                totalChans, 0, channelsToUse));
     }
 
+    /** Returns true if the ops for a node can go in a parallel branch */
+    bool canRenderInParallel (const int renderingIndex) const
+    {
+        const auto ops = nodeOps.getReference (renderingIndex);
+        return ! ops.isEmpty() && topology.getNode (renderingIndex)->isParallelSafe();
+    }
+
+    /** Moves the ops of neighbouring parallel safe nodes that don't share
+        buffers in to ParallelOps. Only neighbours are grouped, the order of
+        the sequence and the buffers it uses stay as they were */
+    void groupParallelNodes (Array<void*>& renderingOps)
+    {
+        Array<void*> grouped;
+        int nextOp = 0;
+
+        for (int i = 0; i < nodeOps.size();)
+        {
+            BufferUse used;
+            int end = i;
+            while (end < nodeOps.size() && canRenderInParallel (end))
+            {
+                BufferUse use;
+                for (int op = nodeOps[end].getStart(); op < nodeOps[end].getEnd(); ++op)
+                    static_cast<Task*> (renderingOps.getUnchecked (op))->getBufferUse (use);
+                if (end > i && use.conflictsWith (used))
+                    break;
+                used.add (use);
+                ++end;
+            }
+
+            if (end - i < 2)
+            {
+                i = jmax (i + 1, end);
+                continue;
+            }
+
+            while (nextOp < nodeOps[i].getStart())
+                grouped.add (renderingOps.getUnchecked (nextOp++));
+
+            auto* parallel = new ParallelOp();
+            for (int j = i; j < end; ++j)
+                parallel->addBranch (topology.getNode (j), renderingOps, nodeOps[j]);
+
+            grouped.add (parallel);
+            nextOp = nodeOps[end - 1].getEnd();
+            i = end;
+        }
+
+        if (grouped.isEmpty())
+            return;
+
+        while (nextOp < renderingOps.size())
+            grouped.add (renderingOps.getUnchecked (nextOp++));
+        renderingOps.swapWith (grouped);
+    }
+
     int getFreeBuffer (PortType type)
     {
         jassert (type.id() < PortType::Unknown);
@@ -812,15 +1367,16 @@ private:
     bool isBufferNeededLater (int stepIndexToSearchFrom, uint32 inputChannelOfIndexToIgnore,
                               const uint32 sourceNode, const uint32 outputPortIndex) const
     {
-        while (stepIndexToSearchFrom < orderedNodes.size())
+        while (stepIndexToSearchFrom < topology.size())
         {
-            const GraphNode* const node = (const GraphNode*) orderedNodes.getUnchecked (stepIndexToSearchFrom);
+            const GraphNode* const node = topology.getNode (stepIndexToSearchFrom);
+            const uint32 nodeId = topology.getNodeId (stepIndexToSearchFrom);
 
             {
                 for (uint32 port = 0; port < node->getNumPorts(); ++port)
                 {
                     if (port != inputChannelOfIndexToIgnore &&
-                          graph.getConnectionBetween (sourceNode, outputPortIndex, node->nodeId, port) != nullptr)
+                          topology.getArcBetween (sourceNode, outputPortIndex, nodeId, port) != nullptr)
                     {
                         return true;
                     }
@@ -867,6 +1423,7 @@ GraphProcessor::GraphProcessor()
       currentAudioOutputBuffer (1, 1),
       currentMidiInputBuffer (nullptr)
 {
+    parameterQueue = new ParameterQueue();
     for (int i = 0; i < AudioGraphIOProcessor::numDeviceTypes; ++i)
         ioNodes[i] = KV_INVALID_PORT;
 }
@@ -875,6 +1432,7 @@ GraphProcessor::~GraphProcessor()
 {
     renderingSequenceChanged.disconnect_all_slots();
     clearRenderingSequence();
+    setInlinedNodes ({});
     clear();
 }
 
@@ -1222,6 +1780,11 @@ void GraphProcessor::setMidiChannels (const kv::MidiChannels channels) noexcept
     midiChannels = channels;
 }
 
+bool GraphProcessor::filtersMidi() const noexcept
+{
+    return ! midiChannels.isOmni() || velocityCurve.getMode() != VelocityCurve::Linear;
+}
+
 bool GraphProcessor::acceptsMidiChannel (const int channel) const noexcept
 {
     ScopedLock sl (getCallbackLock());
@@ -1278,34 +1841,22 @@ void GraphProcessor::buildRenderingSequence()
     Array<void*> newRenderingOps;
     int numRenderingBuffersNeeded = 2;
     int numMidiBuffersNeeded = 1;
+    ReferenceCountedArray<GraphNode> newInlinedNodes;
 
     {
         //XXX:
         MessageManagerLock mml;
+        const ScopedValueSetter<bool> svs (buildingSequence, true);
 
-        Array<void*> orderedNodes;
-
-        {
-            const LookupTable table (connections);
+        for (int i = 0; i < nodes.size(); ++i)
+            nodes.getUnchecked(i)->prepare (getSampleRate(), getBlockSize(), this);
 
-            for (int i = 0; i < nodes.size(); ++i)
-            {
-                GraphNode* const node = nodes.getUnchecked(i);
-                node->prepare (getSampleRate(), getBlockSize(), this);
-
-                int j = 0;
-                for (; j < orderedNodes.size(); ++j)
-                    if (table.isAnInputTo (node->nodeId, ((GraphNode*) orderedNodes.getUnchecked(j))->nodeId))
-                      break;
-
-                orderedNodes.insert (j, node);
-            }
-        }
-
-        GraphRender::ProcessorGraphBuilder calculator (*this, orderedNodes, newRenderingOps);
+        const GraphRender::RenderTopology topology (*this, inlineSubGraphs);
+        GraphRender::ProcessorGraphBuilder calculator (*this, topology, newRenderingOps);
 
         numRenderingBuffersNeeded = calculator.buffersNeeded (PortType::Audio);
         numMidiBuffersNeeded      = calculator.buffersNeeded (PortType::Midi);
+        newInlinedNodes           = topology.getInlinedNodes();
     }
 
     {
@@ -1326,8 +1877,48 @@ void GraphProcessor::buildRenderingSequence()
 
     // delete the old ones..
     deleteRenderOpArray (newRenderingOps);
+    setInlinedNodes (newInlinedNodes);
 
     renderingSequenceChanged();
+
+    // a graph rendering this one inline needs to pick up the changes
+    if (inliningGraph != nullptr && ! inliningGraph->buildingSequence)
+        inliningGraph->buildRenderingSequence();
+}
+
+void GraphProcessor::setInlinedNodes (const ReferenceCountedArray<GraphNode>& newNodes)
+{
+    for (auto* node : inlinedNodes)
+        if (! newNodes.contains (node))
+            if (auto* graph = dynamic_cast<GraphProcessor*> (node->getAudioProcessor()))
+                if (graph->inliningGraph == this)
+                    graph->inliningGraph = nullptr;
+
+    for (auto* node : newNodes)
+        if (auto* graph = dynamic_cast<GraphProcessor*> (node->getAudioProcessor()))
+            graph->inliningGraph = this;
+
+    inlinedNodes = newNodes;
+}
+
+void GraphProcessor::setInlineSubGraphs (bool shouldInline)
+{
+    if (inlineSubGraphs == shouldInline)
+        return;
+    inlineSubGraphs = shouldInline;
+    triggerAsyncUpdate();
+}
+
+const CriticalSection& GraphProcessor::getRenderLock() const noexcept
+{
+    return inliningGraph != nullptr ? inliningGraph->getRenderLock()
+                                    : getCallbackLock();
+}
+
+void GraphProcessor::refreshInlinedRender()
+{
+    if (inliningGraph != nullptr)
+        inliningGraph->buildRenderingSequence();
 }
 
 void GraphProcessor::getOrderedNodes (ReferenceCountedArray<GraphNode>& orderedNodes)
@@ -1398,37 +1989,34 @@ void GraphProcessor::reset()
 void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
 {
     const int32 numSamples = buffer.getNumSamples();
+    parameterQueue->process();
 
     currentAudioInputBuffer = &buffer;
     currentAudioOutputBuffer.setSize (jmax (1, buffer.getNumChannels()), numSamples);
     currentAudioOutputBuffer.clear();
     
-    if (midiChannels.isOmni() && velocityCurve.getMode() == VelocityCurve::Linear)
+    if (! filtersMidi())
     {
         currentMidiInputBuffer = &midiMessages;
     }
     else
     {
         filteredMidi.clear();
-        MidiBuffer::Iterator iter (midiMessages);
-        MidiMessage msg; int frame = 0, chan = 0;
-        
-        while (iter.getNextEvent (msg, frame))
+        filteredMidi.data.addArray (midiMessages.data.begin(), midiMessages.data.size());
+
+        if (! midiChannels.isOmni())
         {
-            chan = msg.getChannel();
-            if (chan > 0 && midiChannels.isOff (chan))
-                continue;
+            MidiKernels::filter (filteredMidi, scratchMidi, [this] (const uint8* data, int, int) {
+                const int chan = MidiKernels::getChannel (data);
+                return chan <= 0 || midiChannels.isOn (chan);
+            });
+        }
 
-            if (msg.isNoteOn())
-            {
-               #ifndef EL_FREE
-                msg.setVelocity (velocityCurve.process (msg.getFloatVelocity()));
-               #endif
-            }
+       #ifndef EL_FREE
+        if (velocityCurve.getMode() != VelocityCurve::Linear)
+            MidiKernels::applyVelocityTable (filteredMidi, velocityCurve.getTable());
+       #endif
 
-            filteredMidi.addEvent (msg, frame);
-        }
-        
         currentMidiInputBuffer = &filteredMidi;
     }
     
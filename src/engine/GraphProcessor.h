@@ -21,6 +21,7 @@
 
 #include "ElementApp.h"
 #include "engine/GraphNode.h"
+#include "engine/ParameterQueue.h"
 #include "engine/VelocityCurve.h"
 #include "Signals.h"
 
@@ -187,6 +188,36 @@ public:
     /** Set the MIDI curve of this graph */
     void setVelocityCurveMode (const VelocityCurve::Mode) noexcept;
 
+    /** Returns true if MIDI coming in to this graph is filtered by channel
+        or velocity curve */
+    bool filtersMidi() const noexcept;
+
+    /** Enable or disable inlining of nested graphs.
+
+        When enabled, nested graphs that don't alter the signal at their
+        boundary are compiled straight in to this graph's render sequence.
+        Their IO nodes are dropped and the nodes connected to them are wired
+        directly to the buffers feeding, and fed by, the nested graph.
+    */
+    void setInlineSubGraphs (bool shouldInline);
+
+    /** Returns true if nested graphs are inlined when rendering */
+    bool isInliningSubGraphs() const noexcept { return inlineSubGraphs; }
+
+    /** Returns the lock held while this graph's nodes are processed. If the
+        graph is rendered inline by another graph, that graph's callback lock
+        is returned.
+    */
+    const CriticalSection& getRenderLock() const noexcept;
+
+    /** Returns the queue mapped parameter changes for this graph's nodes
+        are pushed to */
+    ParameterQueue& getParameterQueue() const noexcept { return *parameterQueue; }
+
+    /** If this graph is rendered inline by another graph, rebuild that graph's
+        render sequence now */
+    void refreshInlinedRender();
+
     /** A special number that represents the midi channel of a node.
 
         This is used as a channel index value if you want to refer to the midi input
@@ -345,6 +376,13 @@ private:
     OwnedArray <MidiBuffer> midiBuffers;
     Array<void*> renderingOps;
 
+    bool inlineSubGraphs = false;
+    bool buildingSequence = false;
+    GraphProcessor* inliningGraph = nullptr;
+    ReferenceCountedArray<GraphNode> inlinedNodes;
+    ParameterQueue::Ptr parameterQueue;
+    void setInlinedNodes (const ReferenceCountedArray<GraphNode>&);
+
     friend class AudioGraphIOProcessor;
     friend class GraphPort;
 
@@ -355,7 +393,7 @@ private:
     
     kv::MidiChannels midiChannels;
     VelocityCurve velocityCurve;
-    MidiBuffer filteredMidi;
+    MidiBuffer filteredMidi, scratchMidi;
     
     void handleAsyncUpdate() override;
     void clearRenderingSequence();
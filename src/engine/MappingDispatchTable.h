@@ -0,0 +1,149 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Indexes mapping handlers by the kind of message, channel and number they
+    respond to, so an incoming event finds its handlers without scanning
+    them all.
+
+    A table is built on the message thread with add() and compile(), then
+    treated as read only. Handlers listening on channel zero (omni) are
+    visited for every channel.
+ */
+template<class HandlerType>
+class MappingDispatchTable : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<MappingDispatchTable>;
+
+    enum Kind
+    {
+        Controller = 0,
+        Note,
+        numKinds
+    };
+
+    MappingDispatchTable() { }
+    ~MappingDispatchTable() { }
+
+    /** Add a handler. channel is 1-16, or 0 for any */
+    void add (const Kind kind, const int channel, const int number, HandlerType* handler)
+    {
+        jassert (! compiled);
+        const int slot = getSlot (kind, channel, number);
+        if (slot >= 0 && handler != nullptr)
+            pending.add ({ slot, handler });
+    }
+
+    /** Sort the added handlers in to their slots */
+    void compile()
+    {
+        jassert (! compiled);
+        zeromem (offsets, sizeof (offsets));
+        for (const auto& entry : pending)
+            ++offsets[entry.slot + 1];
+        for (int slot = 0; slot < numSlots; ++slot)
+            offsets[slot + 1] += offsets[slot];
+
+        // insertion keeps handlers in the order they were added
+        handlers.insertMultiple (0, nullptr, pending.size());
+        HeapBlock<int> next (numSlots);
+        memcpy (next.get(), offsets, sizeof (int) * (size_t) numSlots);
+        for (const auto& entry : pending)
+            handlers.set (next[entry.slot]++, entry.handler);
+
+        pending.clearQuick();
+        compiled = true;
+    }
+
+    /** Returns the number of handlers in the table */
+    int size() const noexcept { return handlers.size(); }
+
+    /** Call a function with each handler for a raw message, the omni
+        handlers first. Returns the number of handlers visited */
+    template<class Callback>
+    int visit (const uint8* data, const int size, Callback&& callback) const noexcept
+    {
+        jassert (compiled);
+        if (size < 2)
+            return 0;
+
+        int kind;
+        switch (data[0] & 0xf0)
+        {
+            case 0xb0: kind = Controller; break;
+            case 0x80:
+            case 0x90: kind = Note; break;
+            default: return 0;
+        }
+
+        const int channel = (data[0] & 0x0f) + 1;
+        const int number  = data[1] & 0x7f;
+        return visitSlot (getSlotUnchecked (kind, 0, number), callback)
+             + visitSlot (getSlotUnchecked (kind, channel, number), callback);
+    }
+
+    /** Returns the slot for a kind, channel and number or -1 if out of range */
+    static int getSlot (const int kind, const int channel, const int number) noexcept
+    {
+        if (! isPositiveAndBelow (kind, (int) numKinds) ||
+            ! isPositiveAndBelow (channel, 17) ||
+            ! isPositiveAndBelow (number, 128))
+            return -1;
+        return getSlotUnchecked (kind, channel, number);
+    }
+
+private:
+    enum { numSlots = numKinds * 17 * 128 };
+
+    struct Entry
+    {
+        int slot;
+        HandlerType* handler;
+    };
+
+    Array<Entry> pending;
+    Array<HandlerType*> handlers;
+    int offsets [numSlots + 1];
+    bool compiled = false;
+
+    static int getSlotUnchecked (const int kind, const int channel, const int number) noexcept
+    {
+        return (kind * 17 + channel) * 128 + number;
+    }
+
+    template<class Callback>
+    int visitSlot (const int slot, Callback& callback) const noexcept
+    {
+        const int start = offsets[slot];
+        const int end   = offsets[slot + 1];
+        for (int i = start; i < end; ++i)
+            callback (handlers.getUnchecked (i));
+        return end - start;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (MappingDispatchTable)
+};
+
+}
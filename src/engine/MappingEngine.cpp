@@ -18,6 +18,8 @@
 */
 
 #include "engine/GraphNode.h"
+#include "engine/GraphProcessor.h"
+#include "engine/MappingDispatchTable.h"
 #include "engine/MappingEngine.h"
 #include "engine/MidiEngine.h"
 #include "session/ControllerDevice.h"
@@ -25,14 +27,78 @@
 
 namespace Element {
 
-class ControllerMapHandler
+class ControllerMapHandler : public ReferenceCountedObject
 {
 public:
+    using Ptr = ReferenceCountedObjectPtr<ControllerMapHandler>;
+    using DispatchTable = MappingDispatchTable<ControllerMapHandler>;
+
     ControllerMapHandler() { }
-    virtual ~ControllerMapHandler() { }
+    virtual ~ControllerMapHandler()
+    {
+        if (queue != nullptr)
+            queue->removeTarget (target);
+    }
 
     virtual bool wants (const MidiMessage& message) const =0;
     virtual void perform (const MidiMessage& message) =0;
+
+    /** Add this handler to a dispatch table under the messages it wants */
+    virtual void addTo (DispatchTable& table) =0;
+
+    /** Called on the message thread when the messages this handler wants
+        have changed */
+    std::function<void()> onDispatchChanged;
+
+protected:
+    void dispatchChanged()
+    {
+        if (onDispatchChanged)
+            onDispatchChanged();
+    }
+
+    /** Send changes for a parameter through the node's graph, so they are
+        applied on the audio thread */
+    void queueChangesFor (GraphNode& node, Parameter* parameter)
+    {
+        if (parameter == nullptr)
+            return;
+        if (queue != nullptr)
+            queue->removeTarget (target);
+        queue = nullptr;
+        target = nullptr;
+        if (auto* const graph = node.getParentGraph())
+        {
+            queue  = &graph->getParameterQueue();
+            target = queue->addTarget (parameter);
+        }
+    }
+
+    /** Change a parameter from the MIDI thread. Falls back to setting it
+        directly if the node isn't in a graph or the queue is full */
+    void setParameterValue (Parameter& parameter, const float value)
+    {
+        if (target != nullptr && queue->push (target, value))
+            return;
+
+        // older queued values must not overwrite this one later
+        if (target != nullptr)
+            queue->supersede (target, value);
+        parameter.beginChangeGesture();
+        parameter.setValueNotifyingHost (value);
+        parameter.endChangeGesture();
+    }
+
+    /** Returns a parameter's value including changes not applied yet */
+    float getParameterValue (Parameter& parameter) const
+    {
+        return target != nullptr ? queue->getLatestValue (target)
+                                 : parameter.getValue();
+    }
+
+private:
+    ParameterQueue::Ptr queue;
+    ParameterQueue::Target* target = nullptr;
 };
 
 struct MidiNoteControllerMap : public ControllerMapHandler,
@@ -68,6 +134,7 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
         {
             parameter = node->getParameters()[parameterIndex];
             jassert (nullptr != parameter);
+            queueChangesFor (*node, parameter.get());
         }
     }
 
@@ -90,6 +157,11 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
         return wants;
     }
 
+    void addTo (DispatchTable& table) override
+    {
+        table.add (DispatchTable::Note, channel.get(), noteNumber, this);
+    }
+
     void perform (const MidiMessage& message) override
     {
         const bool isInverse = inverse.get() == 1;
@@ -103,18 +175,15 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
        
         if (parameter != nullptr)
         {
-            parameter->beginChangeGesture();
             if (momentary.get() == 0)
             {
-                parameter->setValueNotifyingHost (parameter->getValue() < 0.5 ? 1.f : 0.f);
+                setParameterValue (*parameter, getParameterValue (*parameter) < 0.5 ? 1.f : 0.f);
             }
             else
             {
                 const bool onOrOff = isInverse ? message.isNoteOff() : message.isNoteOn();
-                parameter->setValueNotifyingHost (onOrOff ? 1.f : 0.f);
+                setParameterValue (*parameter, onOrOff ? 1.f : 0.f);
             }
-
-            parameter->endChangeGesture();
         }
         else if (parameterIndex == GraphNode::EnabledParameter ||
                  parameterIndex == GraphNode::BypassParameter ||
@@ -199,6 +268,7 @@ private:
         if (channelObject.refersToSameSourceAs (value))
         {
             channel.set (jlimit (0, 16, (int) channelObject.getValue()));
+            dispatchChanged();
         }
         else if (momentaryObject.refersToSameSourceAs (value))
         {
@@ -247,6 +317,7 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
         {
             parameter = node->getParameters()[parameterIndex];
             jassert (nullptr != parameter);
+            queueChangesFor (*node, parameter.get());
         }
         else if (parameterIndex == GraphNode::EnabledParameter)
         {
@@ -269,15 +340,18 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
             (channel.get() == 0 || (channel.get() > 0 && message.getChannel() == channel.get()));
     }
 
+    void addTo (DispatchTable& table) override
+    {
+        table.add (DispatchTable::Controller, channel.get(), controllerNumber, this);
+    }
+
     void perform (const MidiMessage& message) override
     {
         const auto ccValue = message.getControllerValue();
 
         if (nullptr != parameter)
         {
-            parameter->beginChangeGesture();
-            parameter->setValueNotifyingHost (static_cast<float> (ccValue) / 127.f);
-            parameter->endChangeGesture();
+            setParameterValue (*parameter, static_cast<float> (ccValue) / 127.f);
         }
         else if (parameterIndex == GraphNode::EnabledParameter ||
                  parameterIndex == GraphNode::BypassParameter ||
@@ -410,6 +484,7 @@ private:
         else if (channelObject.refersToSameSourceAs (value))
         {
             channel.set (jlimit (0, 16, (int) channelObject.getValue()));
+            dispatchChanged();
         }
     }
 };
@@ -420,7 +495,8 @@ public:
     explicit ControllerMapInput (MappingEngine& owner, MidiEngine& m, const ControllerDevice& device)
         : midi (m), mapping (owner), controllerDevice (device)
     {
-
+        current = build();
+        activeSet.set (current.get());
     }
     
     ~ControllerMapInput()
@@ -430,52 +506,52 @@ public:
 
     void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message)
     {
-        if ((! message.isController() || !controllerNumbers [message.getControllerNumber()]) &&
-            (!message.isNoteOnOrOff() || !noteNumbers [message.getNoteNumber()]))
-            return;
-
-        // DBG("[EL] handle mapped MIDI: " << message.getControllerNumber() 
-        //     << " : " << message.getControllerValue());
-        if (message.isNoteOn())
-            mapping.captureNextEvent (*this, notes[message.getNoteNumber()], message);
-        else if (message.isController())
-            mapping.captureNextEvent (*this, controls[message.getControllerNumber()], message);
+        // mark the set as in use, then make sure it wasn't retired before
+        // the mark was visible to the message thread
+        MappingSet* set = nullptr;
+        do {
+            set = activeSet.get();
+            dispatchingSet.set (set);
+        } while (set != activeSet.get());
+
+        if (message.isNoteOn() && set->noteNumbers [message.getNoteNumber()])
+            mapping.captureNextEvent (*this, set->notes [message.getNoteNumber()], message);
+        else if (message.isController() && set->controllerNumbers [message.getControllerNumber()])
+            mapping.captureNextEvent (*this, set->controls [message.getControllerNumber()], message);
+
+        set->table->visit (message.getRawData(), message.getRawDataSize(),
+            [&message] (ControllerMapHandler* handler)
+            {
+                if (handler->wants (message))
+                    handler->perform (message);
+            });
 
-        for (auto* handler : handlers)
-            if (handler->wants (message))
-                handler->perform (message);
+        dispatchingSet.set (nullptr);
     }
 
     bool close()
     {
-        const auto deviceName = controllerDevice.getInputDevice().toString();
-        midi.removeMidiInputCallback (this);
+        if (connected)
+            midi.removeMidiInputCallback (this);
+        connected = false;
+        connectedDevice = String();
+        retiredSets.clear();
         return true;
     }
 
+    /** Start receiving MIDI. Does nothing if already listening to the
+        device's input, and moves the callback if the input changed */
     bool open()
     {
-        close();
-
-        for (int i = controllerDevice.getNumControls(); --i >= 0;)
-        {
-            const auto control (controllerDevice.getControl (i));
-            const auto midi (control.getMidiMessage());
-            if (midi.isController())
-            {
-                controllerNumbers.setBit (midi.getControllerNumber(), true);
-                controls.set (midi.getControllerNumber(), control);
-            }
-            else if (midi.isNoteOn())
-            {
-                noteNumbers.setBit (midi.getNoteNumber(), true);
-                notes.set (midi.getNoteNumber(), control);
-            }
-        }
-
         const auto deviceName = controllerDevice.getInputDevice().toString();
+        if (connected && deviceName == connectedDevice)
+            return true;
+
+        if (connected)
+            midi.removeMidiInputCallback (connectedDevice, this);
         midi.addMidiInputCallback (deviceName, this, true);
-        
+        connectedDevice = deviceName;
+        connected = true;
         return true;
     }
 
@@ -501,19 +577,113 @@ public:
 
     void addHandler (ControllerMapHandler* handler)
     {
-        stop();
+        handler->onDispatchChanged = std::bind (&ControllerMapInput::refresh, this);
         handlers.add (handler);
-        start();
+        refresh();
+    }
+
+    /** Drop every handler. They are deleted once the MIDI thread is done
+        with the set they were in */
+    void clearHandlers()
+    {
+        for (auto* handler : handlers)
+            handler->onDispatchChanged = nullptr;
+        handlers.clear();
+        refresh();
+    }
+
+    /** Build a new set from the device's controls and the handlers and swap
+        it in. While the engine is updating this only marks the input, and
+        the swap happens once the update ends */
+    void refresh()
+    {
+        if (mapping.isUpdating())
+        {
+            needsRefresh = true;
+            return;
+        }
+
+        needsRefresh = false;
+        apply (build());
+        if (connected)
+            open();
+    }
+
+    /** Apply a refresh held back by an update */
+    void refreshIfNeeded()
+    {
+        if (needsRefresh)
+            refresh();
     }
 
 private:
+    using DispatchTable = ControllerMapHandler::DispatchTable;
+
+    /** Everything the MIDI thread needs for one input. Built on the message
+        thread and never changed after it is swapped in */
+    struct MappingSet : public ReferenceCountedObject
+    {
+        using Ptr = ReferenceCountedObjectPtr<MappingSet>;
+        DispatchTable::Ptr table;
+        ReferenceCountedArray<ControllerMapHandler> handlers;
+        BigInteger controllerNumbers, noteNumbers;
+        ControllerDevice::Control controls [128], notes [128];
+    };
+
     MidiEngine& midi;
     MappingEngine& mapping;
     ControllerDevice controllerDevice;
-    std::unique_ptr<MidiInput> midiInput;
-    OwnedArray<ControllerMapHandler> handlers;
-    BigInteger controllerNumbers, noteNumbers;
-    HashMap<int, ControllerDevice::Control> controls, notes;
+    ReferenceCountedArray<ControllerMapHandler> handlers;
+    bool connected = false;
+    String connectedDevice;
+    bool needsRefresh = false;
+
+    MappingSet::Ptr current;
+    ReferenceCountedArray<MappingSet> retiredSets;
+    Atomic<MappingSet*> activeSet;
+    Atomic<MappingSet*> dispatchingSet;
+
+    MappingSet::Ptr build() const
+    {
+        MappingSet::Ptr set = new MappingSet();
+        for (int i = controllerDevice.getNumControls(); --i >= 0;)
+        {
+            const auto control (controllerDevice.getControl (i));
+            const auto message (control.getMidiMessage());
+            if (message.isController())
+            {
+                set->controllerNumbers.setBit (message.getControllerNumber(), true);
+                set->controls [message.getControllerNumber()] = control;
+            }
+            else if (message.isNoteOn())
+            {
+                set->noteNumbers.setBit (message.getNoteNumber(), true);
+                set->notes [message.getNoteNumber()] = control;
+            }
+        }
+
+        set->table = new DispatchTable();
+        for (auto* handler : handlers)
+            handler->addTo (*set->table);
+        set->table->compile();
+        set->handlers.addArray (handlers);
+        return set;
+    }
+
+    /** Swap in a new set. Retired sets are freed once the MIDI thread is
+        done with them */
+    void apply (MappingSet::Ptr newSet)
+    {
+        retiredSets.add (current.get());
+        current = newSet;
+        activeSet.set (current.get());
+
+        auto* const inUse = dispatchingSet.get();
+        for (int i = retiredSets.size(); --i >= 0;)
+            if (retiredSets.getObjectPointerUnchecked (i) != inUse)
+                retiredSets.remove (i);
+    }
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ControllerMapInput)
 };
 
@@ -552,11 +722,10 @@ public:
         inputs.clear (true);
     }
 
+    /** Connect inputs that aren't yet. Inputs already running keep their
+        MIDI callbacks, so no events are missed */
     void start()
     {
-        if (isRunning())
-            stop();
-
         for (auto* input : inputs)
             input->start();
 
@@ -570,6 +739,18 @@ public:
             input->stop();
     }
 
+    void removeIf (std::function<bool(ControllerMapInput&)> shouldRemove)
+    {
+        for (int i = inputs.size(); --i >= 0;)
+        {
+            if (shouldRemove (*inputs.getUnchecked (i)))
+            {
+                inputs.getUnchecked(i)->close();
+                inputs.remove (i, true);
+            }
+        }
+    }
+
     ControllerMapInput* findInput (const ControllerDevice& controller) const
     {
         if (! controller.isValid())
@@ -664,15 +845,42 @@ bool MappingEngine::refreshInput (const ControllerDevice& device)
     if (! inputs) return false;
 
     if (auto* const input = inputs->findInput (device))
-    {
-        input->close();
-        if (inputs->isRunning())
-            input->start();
-    }
+        input->refresh();
 
     return true;
 }
 
+void MappingEngine::retainInputs (const Array<ControllerDevice>& devices)
+{
+    inputs->removeIf ([&devices] (ControllerMapInput& input) {
+        for (const auto& device : devices)
+            if (input.isInputFor (device))
+                return false;
+        return true;
+    });
+}
+
+void MappingEngine::clearHandlers()
+{
+    for (auto* input : *inputs)
+        input->clearHandlers();
+}
+
+void MappingEngine::beginUpdate()
+{
+    ++updateDepth;
+}
+
+void MappingEngine::endUpdate()
+{
+    jassert (updateDepth > 0);
+    if (updateDepth <= 0 || --updateDepth > 0)
+        return;
+
+    for (auto* input : *inputs)
+        input->refreshIfNeeded();
+}
+
 void MappingEngine::clear()
 {
     stopMapping();
@@ -681,7 +889,6 @@ void MappingEngine::clear()
 
 void MappingEngine::startMapping()
 {
-    stopMapping();
     inputs->start();
 }
 
@@ -42,8 +42,28 @@ public:
     bool addHandler (const ControllerDevice::Control&, const Node&, const int);
 
     bool removeInput (const ControllerDevice&);
+
+    /** Rebuild an input's mappings after its device changed, and swap them
+        in without reconnecting to MIDI */
     bool refreshInput (const ControllerDevice&);
+
+    /** Remove inputs for devices not in the list */
+    void retainInputs (const Array<ControllerDevice>&);
+
+    /** Remove all handlers, keeping the inputs */
+    void clearHandlers();
+
+    /** Hold back rebuilding mappings until endUpdate(), so each input swaps
+        its mappings once however many handlers are added. Calls nest */
+    void beginUpdate();
+    void endUpdate();
+
+    /** Returns true between beginUpdate() and endUpdate() */
+    bool isUpdating() const noexcept { return updateDepth > 0; }
+
     void clear();
+
+    /** Connect inputs to MIDI. Inputs already connected are left alone */
     void startMapping();
     void stopMapping();
 
@@ -55,6 +75,7 @@ public:
 private:
     friend class ControllerMapInput;
     class Inputs; std::unique_ptr<Inputs> inputs;
+    int updateDepth = 0;
 
     class CapturedEvent : public AsyncUpdater
     {
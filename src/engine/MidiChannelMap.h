@@ -19,7 +19,7 @@
 
 #pragma once
 
-#include "JuceHeader.h"
+#include "engine/MidiKernels.h"
 
 namespace Element {
 
@@ -28,7 +28,6 @@ class MidiChannelMap
 public:
     MidiChannelMap()
     {
-        tempMidi.ensureSize (sizeof(uint8) * 3 * 16);
         reset();
     }
 
@@ -41,13 +40,15 @@ public:
                 channelMap.add (0);
         for (int ch = 0; ch <= 16; ++ch)
             channelMap.getReference(ch) = ch;
+        for (int ch = 0; ch < 16; ++ch)
+            table[ch] = static_cast<uint8> (ch);
     }
 
     inline void set (const int outputChan) noexcept
     {
         jassert (outputChan >= 1 && outputChan <= 16);
         for (int ch = 1; ch <= 16; ++ch)
-            channelMap.getReference (ch) = outputChan;
+            set (ch, outputChan);
     }
 
     inline void set (const int inputChan, const int outputChan) noexcept
@@ -55,6 +56,7 @@ public:
         jassert (inputChan >= 1 && inputChan <= 16 &&
                  outputChan >= 1 && outputChan <= 16);
         channelMap.getReference (inputChan) = outputChan;
+        table[inputChan - 1] = static_cast<uint8> (outputChan - 1);
     }
 
     inline int get (const int channel) const
@@ -69,28 +71,16 @@ public:
             message.setChannel (channelMap.getUnchecked (message.getChannel()));
     }
 
-    inline void render (MidiBuffer& midi)
+    /** Remap a buffer in place */
+    inline void render (MidiBuffer& midi) noexcept
     {
-        MidiBuffer::Iterator iter (midi);
-        MidiMessage msg; int frame = 0;
-        
-        while (iter.getNextEvent (msg, frame))
-        {
-            process (msg);
-            tempMidi.addEvent (msg, frame);
-        }
-
-        midi.swapWith (tempMidi);
-        tempMidi.clear();
+        MidiKernels::remapChannels (midi, table);
     }
 
     const Array<int>& getMap() const { return channelMap; }
 
 private:
-    // TODO: optimize: use plain C array
     Array<int> channelMap;
-    int channels [17];
-    MidiBuffer tempMidi;
+    uint8 table [16];
 };
-
 }
@@ -24,35 +24,183 @@ namespace Element
     
 void MidiClock::process (const MidiMessage& msg)
 {
-    jassert (sampleRate > 0.0 && blockSize > 0);
-    jassert (msg.isMidiClock() || msg.isSongPositionPointer());
-    
-    if (midiClockTicks <= 0)
+    if (msg.isMidiClock())
+    {
+        tick (msg.getTimeStamp());
+        return;
+    }
+
+    if (msg.isMidiStart())
+    {
+        // the first clock after start is song position zero
+        state.running = true;
+        state.songTicks = -1;
+    }
+    else if (msg.isMidiContinue())
+    {
+        state.running = true;
+    }
+    else if (msg.isMidiStop())
     {
-        dll.reset (msg.getTimeStamp(), (double)blockSize / sampleRate, 1.0);
-        dll.setParams ((double)blockSize / sampleRate, 1.0);
+        state.running = false;
+    }
+    else if (msg.isSongPositionPointer())
+    {
+        // six clocks per sixteenth note, the next clock lands on the position
+        state.songTicks = (int64) msg.getSongPositionPointerMidiBeat() * 6 - 1;
     }
     else
     {
-        dll.update (msg.getTimeStamp());
+        return;
     }
-    
-    if (midiClockTicks == syncPeriodTicks)
+
+    publish();
+}
+
+void MidiClock::tick (const double time)
+{
+    if (midiClockTicks > 1 && time - lastTickSeen > 4.0 * state.period)
+    {
+        const bool wasLocked = state.locked;
+        midiClockTicks = 0;
+        state.locked = false;
+        state.period = 0.0;
+        publish();
+
+        if (wasLocked)
+            for (auto* listener : listeners)
+                listener->midiClockSignalDropped();
+    }
+
+    // slower than 10 BPM is not a clock, start over from this tick
+    if (midiClockTicks == 1 && time - state.tickTime > 0.25)
+        midiClockTicks = 0;
+
+    lastTickSeen = time;
+    if (state.running)
+        ++state.songTicks;
+
+    if (midiClockTicks == 0)
+    {
+        state.tickTime = time;
+    }
+    else if (midiClockTicks == 1)
+    {
+        periodError     = jmax (1.0e-4, time - state.tickTime);
+        nextTickTime    = time + periodError;
+        meanSquareError.set (0.0);
+    }
+    else
+    {
+        // follow faster until locked
+        const double bw = midiClockTicks < syncPeriodTicks ? bandwidth * 4.0 : bandwidth;
+        const double omega = MathConstants<double>::twoPi * bw * periodError;
+        const double b = MathConstants<double>::sqrt2 * omega;
+        const double c = omega * omega;
+
+        const double error = time - nextTickTime;
+        nextTickTime += b * error + periodError;
+        periodError  += c * error;
+
+        const double meanSquare = meanSquareError.get();
+        meanSquareError.set (meanSquare + 0.02 * (error * error - meanSquare));
+    }
+
+    if (midiClockTicks >= 1)
+    {
+        state.period   = periodError;
+        state.tickTime = nextTickTime - periodError;
+    }
+
+    ++midiClockTicks;
+    const bool acquired = ! state.locked && midiClockTicks > syncPeriodTicks;
+    if (acquired)
+        state.locked = true;
+    publish();
+
+    if (acquired)
         for (auto* listener : listeners)
             listener->midiClockSignalAcquired();
-    
-    if (midiClockTicks >= syncPeriodTicks && msg.getTimeStamp() - timeOfLastUpdate >= 1.0)
+
+    if (state.locked && time - timeOfLastUpdate >= bpmUpdateSeconds)
     {
-        lastKnownTimeDiff   = dll.timeDiff();
-        const double bpm    = 60.0 / (lastKnownTimeDiff * 24.0);
-        timeOfLastUpdate    = msg.getTimeStamp();
+        const float bpm = (float) (60.0 / (state.period * 24.0));
+        timeOfLastUpdate = time;
         
-        if (bpm >= 20.0 && bpm <= 999.0)
+        if (bpm >= 20.f && bpm <= 999.f && std::abs (bpm - lastBpm) >= 0.01f)
+        {
+            lastBpm = bpm;
             for (auto* listener : listeners)
                 listener->midiClockTempoChanged (bpm);
+        }
     }
-    
-    ++midiClockTicks;
+}
+
+void MidiClock::publish() noexcept
+{
+    // odd while writing, readers retry until they see an even count that
+    // didn't change during their copy
+    sequence.set (sequence.get() + 1);
+    snapshot = state;
+    sequence.set (sequence.get() + 1);
+}
+
+bool MidiClock::readState (State& result) const noexcept
+{
+    for (int attempt = 0; attempt < 8; ++attempt)
+    {
+        const int before = sequence.get();
+        if ((before & 1) != 0)
+            continue;
+        result = snapshot;
+        if (sequence.get() == before)
+            return true;
+    }
+
+    return false;
+}
+
+bool MidiClock::getBeatPosition (const double timeSeconds, double& beats) const noexcept
+{
+    State current;
+    if (! readState (current) || ! current.locked || ! current.running || current.period <= 0.0)
+        return false;
+
+    // don't run on too far past a clock that has gone quiet
+    const double ticksSince = (timeSeconds - current.tickTime) / current.period;
+    if (ticksSince > 4.0)
+        return false;
+
+    beats = ((double) current.songTicks + ticksSince) / 24.0;
+    return true;
+}
+
+double MidiClock::getTempo() const noexcept
+{
+    State current;
+    if (! readState (current) || ! current.locked || current.period <= 0.0)
+        return 0.0;
+    return 60.0 / (current.period * 24.0);
+}
+
+void MidiClock::reportTransportOffset (const double offsetMs, const bool realigned) noexcept
+{
+    transportOffsetMs.set (offsetMs);
+    if (realigned)
+        numRealigns.set (numRealigns.get() + 1);
+}
+
+MidiClock::Diagnostics MidiClock::getDiagnostics() const noexcept
+{
+    Diagnostics diag;
+    State current;
+    readState (current);
+    diag.locked         = current.locked;
+    diag.bpm            = getTempo();
+    diag.jitterMs       = std::sqrt (meanSquareError.get()) * 1000.0;
+    diag.driftMs        = transportOffsetMs.get();
+    diag.numRealigns    = numRealigns.get();
+    return diag;
 }
 
 void MidiClock::reset (const double sr, const int bs)
@@ -60,8 +208,16 @@ void MidiClock::reset (const double sr, const int bs)
     sampleRate          = sr;
     blockSize           = bs;
     timeOfLastUpdate    = 0.0;
-    lastKnownTimeDiff   = 0.0;
+    lastBpm             = 0.f;
     midiClockTicks      = 0;
+    nextTickTime        = 0.0;
+    periodError         = 0.0;
+    lastTickSeen        = 0.0;
+    state               = State();
+    meanSquareError.set (0.0);
+    transportOffsetMs.set (0.0);
+    numRealigns.set (0);
+    publish();
 }
 
 void MidiClock::addListener (Listener* listener)
@@ -23,6 +23,16 @@
 
 namespace Element {
     
+/** Follows an external MIDI clock.
+
+    Clock ticks drive a second order delay locked loop, which smooths the
+    jitter of the MIDI driver out of the tick times. The loop's period gives
+    the tempo, and its phase the song position in between ticks, so the
+    transport can be lined up with the clock at any sample.
+
+    process() is called on the MIDI thread. The position can be read from the
+    audio thread at the same time.
+ */
 class MidiClock
 {
 public:
@@ -36,27 +46,80 @@ public:
         virtual void midiClockSignalDropped() =0;
         virtual void midiClockTempoChanged (const float bpm) =0;
     };
-    
+
+    /** Measurements of the incoming clock */
+    struct Diagnostics
+    {
+        double bpm = 0.0;
+        double jitterMs = 0.0;      ///< RMS difference between tick times and the loop
+        double driftMs = 0.0;       ///< transport offset found at the last alignment check
+        int numRealigns = 0;        ///< times the transport was moved to match the clock
+        bool locked = false;
+    };
+
     MidiClock() = default;
     ~MidiClock() { }
-    
+
+    /** Handle clock, start, continue, stop and song position messages. The
+        timestamp is in seconds, as given by MidiInput */
     void process (const MidiMessage& msg);
     void reset (const double sampleRate, const int blockSize);
-    
+
+    /** Set how quickly the loop follows changes, in Hz. Lower is smoother */
+    void setBandwidth (double hz) noexcept { bandwidth = jlimit (0.01, 10.0, hz); }
+
+    /** Returns the song position in quarter notes at a time in seconds on
+        the MidiInput clock. Returns false if the clock isn't locked and
+        running. Realtime safe */
+    bool getBeatPosition (double timeSeconds, double& beats) const noexcept;
+
+    /** Returns the tempo estimate, or zero if not locked. Realtime safe */
+    double getTempo() const noexcept;
+
+    /** Record how far the transport was from the clock. Audio thread */
+    void reportTransportOffset (double offsetMs, bool realigned) noexcept;
+
+    Diagnostics getDiagnostics() const noexcept;
+
     void addListener (Listener*);
     void removeListener (Listener*);
     
 private:
+    struct State
+    {
+        double tickTime = 0.0;      // smoothed time of the last tick
+        double period = 0.0;        // seconds per tick
+        int64 songTicks = -1;       // ticks since song position zero at tickTime
+        bool running = false;
+        bool locked = false;
+    };
+
+    // state is owned by the MIDI thread, snapshot is the copy the audio
+    // thread reads, guarded by a sequence count
+    State state, snapshot;
+    Atomic<int> sequence { 0 };
+
     double sampleRate = 0.0;
     int blockSize = 0;
-    DelayLockedLoop dll;
-    double timeOfLastUpdate = 0.0;
-    double lastKnownTimeDiff = 0.0;
+    double bandwidth = 0.5;
+    double nextTickTime = 0.0;
+    double periodError = 0.0;
+    double lastTickSeen = 0.0;
     int midiClockTicks = 0;
     int syncPeriodTicks = 48;
-    double bpmUpdateSeconds = 1.0;
-    
+    double timeOfLastUpdate = 0.0;
+    double bpmUpdateSeconds = 0.25;
+    float lastBpm = 0.f;
+
+    Atomic<double> meanSquareError { 0.0 };
+    Atomic<double> transportOffsetMs { 0.0 };
+    Atomic<int> numRealigns { 0 };
+
     Array<Listener*> listeners;
+
+    void tick (double time);
+    void publish() noexcept;
+    bool readState (State&) const noexcept;
 };
 
 class MidiClockMaster
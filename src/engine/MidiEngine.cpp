@@ -135,6 +135,9 @@ void MidiEngine::MidiInputHolder::handleIncomingMidiMessage (MidiInput* source,
         return;
 
     jassert (source == input.get());
+    if (active)
+        queue.push (message);
+
     const ScopedLock sl (engine.midiCallbackLock);
 
     for (auto& mc : engine.midiCallbacks)
@@ -144,6 +147,7 @@ void MidiEngine::MidiInputHolder::handleIncomingMidiMessage (MidiInput* source,
 
 //==============================================================================
 MidiEngine::MidiEngine()
+    : outputScheduler (1 << 16, &sysexPool)
 {
     callbackHandler.reset (new CallbackHandler (*this));
 }
@@ -171,6 +175,15 @@ MidiEngine::MidiInputHolder* MidiEngine::getMidiInput (const String& deviceName,
         if (auto midiIn = MidiInput::openDevice (index, holder.get()))
         {
             holder->input.reset (midiIn.release());
+
+            const int numQueues = numInputQueues.get();
+            jassert (numQueues < maxInputQueues);
+            if (numQueues < maxInputQueues)
+            {
+                inputQueues[numQueues] = &holder->queue;
+                numInputQueues.set (numQueues + 1);
+            }
+
             holder->input->start();
             return openMidiInputs.add (holder.release());
         }
@@ -298,6 +311,19 @@ int MidiEngine::getNumActiveMidiInputs() const
     return total;
 }
 
+void MidiEngine::renderInputQueues (MidiBuffer& dest, double callbackTimeMs,
+                                    int numSamples, double sampleRate) noexcept
+{
+    for (int i = 0; i < numInputQueues.get(); ++i)
+        inputQueues[i]->render (dest, callbackTimeMs, numSamples, sampleRate);
+}
+
+void MidiEngine::clearInputQueues() noexcept
+{
+    for (int i = 0; i < numInputQueues.get(); ++i)
+        inputQueues[i]->clear();
+}
+
 //==============================================================================
 void MidiEngine::setDefaultMidiOutput (const String& deviceName)
 {
@@ -306,21 +332,13 @@ void MidiEngine::setDefaultMidiOutput (const String& deviceName)
         std::unique_ptr<MidiOutput> newMidiOut;
 
         if (deviceName.isNotEmpty())
-            newMidiOut= MidiOutput::openDevice (MidiOutput::getDevices().indexOf (deviceName));
+            newMidiOut = MidiOutput::openDevice (MidiOutput::getDevices().indexOf (deviceName));
 
-        if (newMidiOut)
+        if (newMidiOut || deviceName.isEmpty())
         {
-            newMidiOut->startBackgroundThread();
-            {
-                ScopedLock sl (midiOutputLock);
-                defaultMidiOutput.swap (newMidiOut);
-            }
-
-            if (newMidiOut) // is now the old output
-            {
-                newMidiOut->stopBackgroundThread();
-                newMidiOut.reset();
-            }
+            auto* const newPort = newMidiOut ? outputScheduler.openPort (std::move (newMidiOut)) : nullptr;
+            auto* const oldPort = defaultOutputPort.exchange (newPort);
+            outputScheduler.closePort (oldPort);
         }
 
         defaultMidiOutputName = deviceName;
@@ -18,6 +18,8 @@
 */
 
 #include "JuceHeader.h"
+#include "engine/MidiInputQueue.h"
+#include "engine/MidiOutputScheduler.h"
 
 #pragma once
 
@@ -112,11 +114,40 @@ public:
         If no device has been selected, or the device can't be opened, this will return nullptr.
         @see getDefaultMidiOutputName
     */
-    MidiOutput* getDefaultMidiOutput() const noexcept               { return defaultMidiOutput.get(); }
+    MidiOutput* getDefaultMidiOutput() const noexcept
+    {
+        auto* const port = defaultOutputPort.get();
+        return port != nullptr ? port->getOutput() : nullptr;
+    }
+
+    /** Returns the scheduler port of the default output, or nullptr. Safe to
+        call from the audio thread
+     */
+    MidiOutputScheduler::Port* getDefaultOutputPort() const noexcept { return defaultOutputPort.get(); }
+
+    /** Returns the pool large sysex messages travel through */
+    SysexPool& getSysexPool() noexcept                              { return sysexPool; }
+
+    /** Returns the thread all MIDI output is sent through */
+    MidiOutputScheduler& getOutputScheduler() noexcept              { return outputScheduler; }
 
     void processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate);
 
-    CriticalSection& getMidiOutputLock() { return midiOutputLock; }
+    /** Render messages received from enabled inputs in to a block. Each input
+        has its own lock free queue, so this never waits on a MIDI thread.
+        callbackTimeMs is Time::getMillisecondCounterHiRes() at the start of
+        the audio callback. Audio thread only.
+     */
+    void renderInputQueues (MidiBuffer& dest, double callbackTimeMs,
+                            int numSamples, double sampleRate) noexcept;
+
+    /** Returns the number of bytes to reserve in the block passed to
+        renderInputQueues(). It fits the largest pooled sysex dump next to a
+        full input ring, so rendering doesn't allocate */
+    int getInputBlockSize() const noexcept  { return sysexPool.getMaxSize() + inputQueueSize; }
+
+    /** Discard everything waiting in the input queues. Audio thread only */
+    void clearInputQueues() noexcept;
 
 private:
     struct MidiCallbackInfo
@@ -135,10 +166,11 @@ private:
     struct MidiInputHolder : public MidiInputCallback
     {
         MidiInputHolder (MidiEngine& e)
-            : engine (e) { }
+            : queue (inputQueueSize, &e.sysexPool), engine (e) { }
 
         std::unique_ptr<MidiInput> input;
         bool active = false;  // if true, then will feed to audio engine
+        MidiInputQueue queue;
 
         void handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message) override;
 
@@ -146,13 +178,24 @@ private:
         MidiEngine& engine;
     };
 
+    // shared by the input queues and output scheduler, so must outlive them
+    SysexPool sysexPool;
+    enum { inputQueueSize = 1 << 16 };
+
     StringArray midiInsFromXml;
     OwnedArray<MidiInputHolder> openMidiInputs;
+
+    // inputs are never closed while the engine lives, so the audio thread can
+    // read this without locking as long as the count is published last
+    enum { maxInputQueues = 128 };
+    MidiInputQueue* inputQueues [maxInputQueues];
+    Atomic<int> numInputQueues { 0 };
     Array<MidiCallbackInfo> midiCallbacks;
 
+    MidiOutputScheduler outputScheduler;
     String defaultMidiOutputName;
-    std::unique_ptr<MidiOutput> defaultMidiOutput;
-    CriticalSection audioCallbackLock, midiCallbackLock, midiOutputLock;
+    Atomic<MidiOutputScheduler::Port*> defaultOutputPort { nullptr };
+    CriticalSection audioCallbackLock, midiCallbackLock;
 
     class CallbackHandler;
     std::unique_ptr<CallbackHandler> callbackHandler;
@@ -0,0 +1,124 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+MidiInputQueue::MidiInputQueue (int capacityInBytes, SysexPool* sysexPool)
+    : ring (jmax (256, capacityInBytes)),
+      pool (sysexPool)
+{
+    message.calloc ((size_t) ring.getTotalSize());
+}
+
+MidiInputQueue::~MidiInputQueue()
+{
+    clear();
+}
+
+bool MidiInputQueue::push (const uint8* data, int size, double timeMs) noexcept
+{
+    if (size > 0 && pool != nullptr && SysexPool::shouldPool (data, size))
+    {
+        auto sysex = pool->allocate (data, size);
+        if (sysex.isValid())
+        {
+            auto* const slot = sysex.detach();
+            if (write ({ timeMs, (int32) size, slot }, nullptr, 0))
+                return true;
+
+            // give it back
+            SysexPool::Ref::adopt (slot);
+            return false;
+        }
+    }
+
+    return write ({ timeMs, (int32) size, nullptr }, data, size);
+}
+
+bool MidiInputQueue::write (const Header& header, const uint8* data, int size) noexcept
+{
+    if (header.size <= 0 || ! ring.write (header, data, size))
+    {
+        numDropped.set (numDropped.get() + 1);
+        return false;
+    }
+
+    return true;
+}
+
+bool MidiInputQueue::push (const MidiMessage& msg) noexcept
+{
+    const double timeMs = msg.getTimeStamp() > 0.0 ? msg.getTimeStamp() * 1000.0
+                                                   : Time::getMillisecondCounterHiRes();
+    return push (msg.getRawData(), msg.getRawDataSize(), timeMs);
+}
+
+void MidiInputQueue::render (MidiBuffer& dest, double callbackTimeMs,
+                             int numSamples, double sampleRate) noexcept
+{
+    if (numSamples <= 0 || sampleRate <= 0.0)
+        return;
+
+    const double samplesPerMs = sampleRate * 0.001;
+    const double blockStartMs = callbackTimeMs - (double) numSamples / samplesPerMs;
+    Header header;
+
+    // only read what was complete when we started
+    int numReady = ring.getNumReady();
+    while (numReady >= (int) sizeof (Header))
+    {
+        ring.read (&header, (int) sizeof (Header));
+        const auto sysex = SysexPool::Ref::adopt (header.sysex);
+        if (! sysex.isValid())
+            ring.read (message.get(), header.size);
+        numReady -= (int) sizeof (Header) + (sysex.isValid() ? 0 : header.size);
+
+        if (header.time < blockStartMs - maxAgeMs)
+            continue;
+
+        const int frame = jlimit (0, numSamples - 1,
+            roundToInt ((header.time - blockStartMs) * samplesPerMs));
+        dest.addEvent (sysex.isValid() ? sysex.getData() : message.get(), header.size, frame);
+    }
+}
+
+void MidiInputQueue::clear() noexcept
+{
+    // pooled messages have to be handed back
+    Header header;
+    int numReady = ring.getNumReady();
+    while (numReady >= (int) sizeof (Header))
+    {
+        ring.read (&header, (int) sizeof (Header));
+        numReady -= (int) sizeof (Header);
+        if (header.sysex != nullptr)
+        {
+            SysexPool::Ref::adopt (header.sysex);
+        }
+        else
+        {
+            ring.skip (header.size);
+            numReady -= header.size;
+        }
+    }
+}
+
+}
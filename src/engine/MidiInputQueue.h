@@ -0,0 +1,90 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "engine/ByteRing.h"
+#include "engine/SysexPool.h"
+
+namespace Element {
+
+/** A lock free ring of raw MIDI bytes from one input device.
+
+    The device's MIDI thread pushes each message with its arrival time, and
+    the audio thread renders them in to a block at the sample offset matching
+    that time. Messages are placed one block late, relative to the start of
+    the callback, which keeps the spacing between them intact instead of
+    piling them up at the start of the block.
+
+    Given a SysexPool, large sysex messages are copied in to it and only a
+    reference goes through the ring, so dumps bigger than the ring still
+    get through.
+ */
+class MidiInputQueue
+{
+public:
+    /** Messages older than this when rendered are dropped */
+    static constexpr double maxAgeMs = 1000.0;
+
+    explicit MidiInputQueue (int capacityInBytes = 1 << 16, SysexPool* sysexPool = nullptr);
+    ~MidiInputQueue();
+
+    /** Queue a message. timeMs is on the Time::getMillisecondCounterHiRes()
+        clock. Returns false if there isn't room. MIDI thread only */
+    bool push (const uint8* data, int size, double timeMs) noexcept;
+
+    /** Queue a message using its timestamp, which is in seconds on the same
+        clock as MidiInput uses. MIDI thread only */
+    bool push (const MidiMessage& message) noexcept;
+
+    /** Move queued messages in to a block. callbackTimeMs is the time the
+        audio callback started. Audio thread only.
+
+        Pooled dumps are copied in to dest, so reserve room in it for the
+        pool's largest slot to keep that copy from allocating.
+     */
+    void render (MidiBuffer& dest, double callbackTimeMs,
+                 int numSamples, double sampleRate) noexcept;
+
+    /** Discard everything queued. Audio thread only */
+    void clear() noexcept;
+
+    /** Returns the number of messages dropped because the ring was full */
+    int getNumDropped() const noexcept { return numDropped.get(); }
+
+private:
+    struct Header
+    {
+        double time;
+        int32 size;
+        SysexPool::Slot* sysex;     // bytes are in the pool when set
+    };
+
+    ByteRing ring;
+    SysexPool* const pool;
+    HeapBlock<uint8> message;
+    Atomic<int> numDropped { 0 };
+
+    bool write (const Header& header, const uint8* data, int size) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiInputQueue)
+};
+
+}
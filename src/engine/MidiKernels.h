@@ -0,0 +1,228 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** MIDI processing that works directly on the packed bytes of a MidiBuffer.
+
+    MidiBuffer stores each event as a 32 bit sample position, a 16 bit size
+    and the message bytes. Walking that instead of decoding every event in to
+    a MidiMessage and adding it back one by one avoids a copy per event, and
+    the search addEvent does to find where each event goes.
+
+    Nothing here allocates unless a destination buffer has to grow. Buffers
+    that get filtered or merged should be given enough space up front with
+    MidiBuffer::ensureSize().
+ */
+struct MidiKernels
+{
+    /** Bytes before each event's data */
+    static constexpr int headerSize = (int) (sizeof (int32) + sizeof (uint16));
+
+    /** Returns true if the status byte is a channel voice message */
+    static inline bool isChannelMessage (const uint8 status) noexcept  { return status >= 0x80 && status < 0xf0; }
+
+    /** Returns true if the event is a note on with a non-zero velocity */
+    static inline bool isNoteOn (const uint8* data, int size) noexcept
+    {
+        return size >= 3 && (data[0] & 0xf0) == 0x90 && data[2] != 0;
+    }
+
+    /** Returns true if the event is a note on or note off */
+    static inline bool isNoteOnOrOff (const uint8* data, int size) noexcept
+    {
+        return size >= 3 && ((data[0] & 0xf0) == 0x90 || (data[0] & 0xf0) == 0x80);
+    }
+
+    /** Returns the 1 based channel of an event, or 0 if it has none */
+    static inline int getChannel (const uint8* data) noexcept
+    {
+        return isChannelMessage (data[0]) ? (data[0] & 0x0f) + 1 : 0;
+    }
+
+    /** Calls fn (uint8* data, int size, int frame) for every event. The
+        bytes can be changed as long as the size stays the same */
+    template<class Function>
+    static void forEach (MidiBuffer& midi, Function&& fn) noexcept
+    {
+        uint8* iter = midi.data.begin();
+        uint8* const end = midi.data.end();
+        while (iter < end)
+        {
+            const int frame = readUnaligned<int32> (iter);
+            const int size  = (int) readUnaligned<uint16> (iter + sizeof (int32));
+            fn (iter + headerSize, size, frame);
+            iter += headerSize + size;
+        }
+    }
+
+    /** Calls fn (const uint8* data, int size, int frame) for every event */
+    template<class Function>
+    static void forEach (const MidiBuffer& midi, Function&& fn) noexcept
+    {
+        const uint8* iter = midi.data.begin();
+        const uint8* const end = midi.data.end();
+        while (iter < end)
+        {
+            const int frame = readUnaligned<int32> (iter);
+            const int size  = (int) readUnaligned<uint16> (iter + sizeof (int32));
+            fn (iter + headerSize, size, frame);
+            iter += headerSize + size;
+        }
+    }
+
+    /** Add an event to the end of a buffer. The frame must not be before the
+        last event already there */
+    static inline void append (MidiBuffer& dest, const uint8* data, int size, int frame) noexcept
+    {
+        const int offset = dest.data.size();
+        dest.data.resize (offset + headerSize + size);
+        uint8* const d = dest.data.begin() + offset;
+        writeUnaligned<int32> (d, (int32) frame);
+        writeUnaligned<uint16> (d + sizeof (int32), (uint16) size);
+        memcpy (d + headerSize, data, (size_t) size);
+    }
+
+    /** Remove events for which keep (const uint8* data, int size, int frame)
+        returns false. Kept events are gathered in scratch and swapped in, so
+        scratch is left empty. Nothing is copied if every event is kept */
+    template<class Predicate>
+    static void filter (MidiBuffer& midi, MidiBuffer& scratch, Predicate&& keep) noexcept
+    {
+        const uint8* const begin = midi.data.begin();
+        const uint8* const end = midi.data.end();
+        const uint8* iter = begin;
+
+        // events before the first one dropped are copied in one go
+        while (iter < end)
+        {
+            const int frame = readUnaligned<int32> (iter);
+            const int size  = (int) readUnaligned<uint16> (iter + sizeof (int32));
+            if (! keep (iter + headerSize, size, frame))
+                break;
+            iter += headerSize + size;
+        }
+
+        if (iter >= end)
+            return;
+
+        scratch.clear();
+        scratch.data.addArray (begin, (int) (iter - begin));
+        iter += headerSize + (int) readUnaligned<uint16> (iter + sizeof (int32));
+
+        while (iter < end)
+        {
+            const int frame = readUnaligned<int32> (iter);
+            const int size  = (int) readUnaligned<uint16> (iter + sizeof (int32));
+            if (keep (iter + headerSize, size, frame))
+                append (scratch, iter + headerSize, size, frame);
+            iter += headerSize + size;
+        }
+
+        midi.swapWith (scratch);
+        scratch.clear();
+    }
+
+    /** Move channel messages to other channels. table holds 16 zero based
+        output channels indexed by zero based input channel */
+    static inline void remapChannels (MidiBuffer& midi, const uint8* table) noexcept
+    {
+        forEach (midi, [table] (uint8* data, int, int) {
+            if (isChannelMessage (data[0]))
+                data[0] = (uint8) ((data[0] & 0xf0) | (table[data[0] & 0x0f] & 0x0f));
+        });
+    }
+
+    /** Replace note on velocities using a 128 entry table. Note ons with
+        zero velocity are note offs, and are left alone */
+    static inline void applyVelocityTable (MidiBuffer& midi, const uint8* table) noexcept
+    {
+        forEach (midi, [table] (uint8* data, int size, int) {
+            if (isNoteOn (data, size))
+                data[2] = table[data[2] & 0x7f];
+        });
+    }
+
+    /** Shift note numbers of note ons and offs, wrapping like
+        MidiMessage::setNoteNumber(). Only events before numSamples are
+        changed */
+    static inline void transpose (MidiBuffer& midi, const int offset,
+                                  const int numSamples = std::numeric_limits<int>::max()) noexcept
+    {
+        if (offset == 0)
+            return;
+        forEach (midi, [offset, numSamples] (uint8* data, int size, int frame) {
+            if (frame < numSamples && isNoteOnOrOff (data, size))
+                data[1] = (uint8) ((data[1] + offset) & 0x7f);
+        });
+    }
+
+    /** Append channel messages to one of 16 buffers, by channel. Messages
+        without a channel are skipped */
+    static inline void splitByChannel (const MidiBuffer& source, MidiBuffer* const* dests) noexcept
+    {
+        forEach (source, [dests] (const uint8* data, int size, int frame) {
+            if (isChannelMessage (data[0]))
+                append (*dests[data[0] & 0x0f], data, size, frame);
+        });
+    }
+
+    /** Merge source in to dest, keeping events in order. Events from source
+        go after events already in dest at the same frame, like
+        MidiBuffer::addEvents(). scratch is left empty */
+    static void merge (MidiBuffer& dest, const MidiBuffer& source, MidiBuffer& scratch) noexcept
+    {
+        if (source.data.isEmpty())
+            return;
+
+        if (dest.data.isEmpty())
+        {
+            dest.data.addArray (source.data.begin(), source.data.size());
+            return;
+        }
+
+        const uint8* a = dest.data.begin();
+        const uint8* const aEnd = dest.data.end();
+        const uint8* b = source.data.begin();
+        const uint8* const bEnd = source.data.end();
+
+        scratch.clear();
+        while (a < aEnd && b < bEnd)
+        {
+            const uint8*& next = readUnaligned<int32> (b) < readUnaligned<int32> (a) ? b : a;
+            const int total = headerSize + (int) readUnaligned<uint16> (next + sizeof (int32));
+            scratch.data.addArray (next, total);
+            next += total;
+        }
+
+        if (a < aEnd)
+            scratch.data.addArray (a, (int) (aEnd - a));
+        if (b < bEnd)
+            scratch.data.addArray (b, (int) (bEnd - b));
+
+        dest.swapWith (scratch);
+        scratch.clear();
+    }
+};
+
+}
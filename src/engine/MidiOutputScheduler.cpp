@@ -0,0 +1,269 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiOutputScheduler.h"
+
+namespace Element {
+
+namespace {
+    // longer than any audio callback that may still send to a closed port
+    const double closedPortLifetimeMs = 500.0;
+}
+
+MidiOutputScheduler::MidiOutputScheduler (int capacityInBytes, SysexPool* sysexPool)
+    : Thread ("elMidiOut"),
+      capacity (jmax (256, capacityInBytes)),
+      pool (sysexPool)
+{
+    scratch.calloc ((size_t) capacity);
+    startThread (9);
+}
+
+MidiOutputScheduler::~MidiOutputScheduler()
+{
+    stopThread (500);
+
+    // hands pooled sysex back
+    updatePorts();
+    for (auto* port : active)
+        readQueued (*port);
+    active.clear();
+    ports.clear();
+}
+
+MidiOutputScheduler::Port* MidiOutputScheduler::openPort (std::unique_ptr<MidiOutput> output)
+{
+    auto* const port = new Port (std::move (output), capacity);
+    {
+        const ScopedLock sl (portLock);
+        ports.add (port);
+    }
+
+    portsChanged.set (1);
+    notify();
+    return port;
+}
+
+void MidiOutputScheduler::closePort (Port* port)
+{
+    {
+        const ScopedLock sl (portLock);
+        if (port == nullptr || port->isClosed() || ! ports.contains (port))
+            return;
+    }
+
+    port->closedAt = Time::getMillisecondCounterHiRes();
+    port->closed.set (1);
+    notify();
+}
+
+int MidiOutputScheduler::getNumPorts() const
+{
+    const ScopedLock sl (portLock);
+    return ports.size();
+}
+
+void MidiOutputScheduler::send (Port* port, const MidiBuffer& midi,
+                                double blockStartMs, double sampleRate) noexcept
+{
+    if (port == nullptr || port->isClosed() || sampleRate <= 0.0 || midi.isEmpty())
+        return;
+
+    const double msPerSample = 1000.0 / sampleRate;
+    MidiBuffer::Iterator iter (midi);
+    const uint8* data; int size, frame;
+
+    while (iter.getNextEvent (data, size, frame))
+    {
+        SysexPool::Slot* sysex = nullptr;
+        if (size > 0 && pool != nullptr && SysexPool::shouldPool (data, size))
+            sysex = pool->allocate (data, size).detach();
+
+        const Header header { blockStartMs + (double) frame * msPerSample, (int32) size, sysex };
+        if (size <= 0 || ! port->ring.write (header, data, sysex != nullptr ? 0 : size))
+        {
+            SysexPool::Ref::adopt (sysex);
+            ++numDropped;
+        }
+    }
+}
+
+MidiOutputScheduler::Stats MidiOutputScheduler::getStats() const noexcept
+{
+    Stats stats;
+    stats.numSent           = numSent.get();
+    stats.numDropped        = numDropped.get();
+    stats.averageLatenessMs = averageLateness.get();
+    stats.maxLatenessMs     = maxLateness.get();
+    return stats;
+}
+
+void MidiOutputScheduler::resetStats() noexcept
+{
+    numSent.set (0);
+    numDropped.set (0);
+    averageLateness.set (0.0);
+    maxLateness.set (0.0);
+}
+
+String MidiOutputScheduler::getStatusText() const
+{
+    const auto stats = getStats();
+    String text ("MIDI out: ");
+    text << stats.numSent << " sent, jitter "
+         << String (stats.averageLatenessMs, 2) << " ms avg, "
+         << String (stats.maxLatenessMs, 2) << " ms max";
+    if (stats.numDropped > 0)
+        text << ", " << stats.numDropped << " dropped";
+    return text;
+}
+
+void MidiOutputScheduler::run()
+{
+    while (! threadShouldExit())
+    {
+        updatePorts();
+
+        double untilNext = 1000.0;
+
+        for (auto* port : active)
+        {
+            readQueued (*port);
+            dispatchDue (*port, Time::getMillisecondCounterHiRes());
+
+            if (! port->pending.isEmpty())
+                untilNext = jmin (untilNext, port->pending.getReference (0).time
+                                                - Time::getMillisecondCounterHiRes());
+        }
+
+        removeClosedPorts();
+
+        // sleep while nothing is close, spin on the last stretch
+        if (untilNext > 1.5)
+            wait (1);
+        else if (untilNext > 0.0)
+            Thread::yield();
+    }
+}
+
+void MidiOutputScheduler::updatePorts()
+{
+    // new ports are picked up here, closed ones are removed by this thread
+    if (! portsChanged.compareAndSetBool (0, 1))
+        return;
+
+    const ScopedLock sl (portLock);
+    active.clearQuick();
+    active.addArray (ports);
+}
+
+void MidiOutputScheduler::removeClosedPorts()
+{
+    const double now = Time::getMillisecondCounterHiRes();
+
+    for (int i = active.size(); --i >= 0;)
+    {
+        auto* const port = active.getUnchecked (i);
+        if (! port->isClosed() || now - port->closedAt < closedPortLifetimeMs)
+            continue;
+
+        // hands pooled sysex back
+        readQueued (*port);
+        numDropped += port->pending.size();
+        port->pending.clear();
+        active.remove (i);
+
+        const ScopedLock sl (portLock);
+        ports.removeObject (port);
+    }
+}
+
+void MidiOutputScheduler::readQueued (Port& port)
+{
+    Header header;
+    int numReady = port.ring.getNumReady();
+    while (numReady >= (int) sizeof (Header))
+    {
+        port.ring.read (&header, (int) sizeof (Header));
+        auto sysex = SysexPool::Ref::adopt (header.sysex);
+        if (! sysex.isValid())
+            port.ring.read (scratch.get(), header.size);
+        numReady -= (int) sizeof (Header) + (sysex.isValid() ? 0 : header.size);
+
+        // events mostly arrive in order, search from the back
+        auto& pending = port.pending;
+        int index = pending.size();
+        while (index > 0 && pending.getReference (index - 1).time > header.time)
+            --index;
+        pending.insert (index, { header.time,
+                                 sysex.isValid() ? MidiMessage() : MidiMessage (scratch.get(), header.size, header.time),
+                                 std::move (sysex) });
+    }
+}
+
+void MidiOutputScheduler::dispatchDue (Port& port, double now)
+{
+    auto& pending = port.pending;
+    auto* const output = port.getOutput();
+    int numDone = 0;
+
+    for (auto& event : pending)
+    {
+        if (event.time > now)
+            break;
+
+        if (output == nullptr)
+        {
+            ++numDone;
+            ++numDropped;
+            continue;
+        }
+
+        // device backends expect a dump in one piece, they drop or reset on
+        // fragments that don't start with a status byte
+        if (event.sysex.isValid())
+        {
+            output->sendMessageNow (MidiMessage (event.sysex.getData(), event.sysex.getSize(), event.time));
+            event.sysex.reset();
+        }
+        else
+        {
+            output->sendMessageNow (event.message);
+        }
+
+        recordSent (event);
+
+        ++numDone;
+    }
+
+    if (numDone > 0)
+        pending.removeRange (0, numDone);
+}
+
+void MidiOutputScheduler::recordSent (const Event& event)
+{
+    const double lateness = Time::getMillisecondCounterHiRes() - event.time;
+    const double average = averageLateness.get();
+    averageLateness.set (average + 0.05 * (lateness - average));
+    if (lateness > maxLateness.get())
+        maxLateness.set (lateness);
+    ++numSent;
+}
+
+}
@@ -0,0 +1,152 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "engine/ByteRing.h"
+#include "engine/SysexPool.h"
+
+namespace Element {
+
+/** Sends MIDI to output devices from a dedicated high priority thread.
+
+    Each port has its own lock free queue, which whoever renders the port
+    writes each block to, and the scheduler sends every event when the wall
+    clock reaches the time matching its sample offset. How late each event
+    goes out is measured, so output jitter can be shown to the user.
+
+    Devices are opened as ports. A closed port is deleted by the scheduler
+    thread half a second after it was closed, which leaves time for an audio
+    callback that already read the pointer to finish. Events queued for a
+    closed port are dropped.
+
+    With a SysexPool, large sysex messages pass through the queue by
+    reference and go to the device whole, as one message.
+ */
+class MidiOutputScheduler : private Thread
+{
+public:
+    class Port;
+
+private:
+    struct Header
+    {
+        double time;
+        int32 size;
+        SysexPool::Slot* sysex;     // bytes are in the pool when set
+    };
+
+    struct Event
+    {
+        double time;
+        MidiMessage message;
+        SysexPool::Ref sysex;
+    };
+
+public:
+    class Port
+    {
+    public:
+        /** Returns the device, or nullptr once the port is closed */
+        MidiOutput* getOutput() const noexcept  { return closed.get() == 0 ? output.get() : nullptr; }
+
+        /** Returns true if the port was closed */
+        bool isClosed() const noexcept          { return closed.get() != 0; }
+
+    private:
+        friend class MidiOutputScheduler;
+        Port (std::unique_ptr<MidiOutput> o, int capacityInBytes)
+            : output (std::move (o)), ring (capacityInBytes)
+        {
+            pending.ensureStorageAllocated (256);
+        }
+
+        std::unique_ptr<MidiOutput> output;
+        Atomic<int> closed { 0 };
+        double closedAt = 0.0;
+        ByteRing ring;          // written by the thread sending to the port
+        Array<Event> pending;   // scheduler thread only, in time order
+        JUCE_DECLARE_NON_COPYABLE (Port)
+    };
+
+    struct Stats
+    {
+        int numSent = 0;
+        int numDropped = 0;
+        double averageLatenessMs = 0.0;
+        double maxLatenessMs = 0.0;
+    };
+
+    explicit MidiOutputScheduler (int capacityInBytes = 1 << 16, SysexPool* sysexPool = nullptr);
+    ~MidiOutputScheduler();
+
+    /** Add a device to send to. Message thread only */
+    Port* openPort (std::unique_ptr<MidiOutput> output);
+
+    /** Stop sending to a port. The scheduler thread closes its device and
+        deletes it a little later, so don't use the port after this.
+        Doesn't wait for the scheduler. Message thread only */
+    void closePort (Port* port);
+
+    /** Returns the number of ports, including closed ones not deleted yet */
+    int getNumPorts() const;
+
+    /** Queue a block of MIDI. Event times are blockStartMs plus their sample
+        offset, on the Time::getMillisecondCounterHiRes() clock. Called from
+        the audio thread or a worker rendering the port; only one thread may
+        send to a port at a time */
+    void send (Port* port, const MidiBuffer& buffer,
+               double blockStartMs, double sampleRate) noexcept;
+
+    /** Returns output timing since the last call to resetStats() */
+    Stats getStats() const noexcept;
+
+    /** Clear the timing measurements */
+    void resetStats() noexcept;
+
+    /** Returns a short description of the output timing */
+    String getStatusText() const;
+
+private:
+    const int capacity;
+    SysexPool* const pool;
+
+    CriticalSection portLock;
+    OwnedArray<Port> ports;
+    Array<Port*> active;            // scheduler thread's copy of ports
+    Atomic<int> portsChanged { 0 };
+    HeapBlock<uint8> scratch;
+
+    Atomic<int> numSent { 0 };
+    Atomic<int> numDropped { 0 };
+    Atomic<double> averageLateness { 0.0 };
+    Atomic<double> maxLateness { 0.0 };
+
+    void run() override;
+    void updatePorts();
+    void removeClosedPorts();
+    void readQueued (Port& port);
+    void dispatchDue (Port& port, double now);
+    void recordSent (const Event& event);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiOutputScheduler)
+};
+
+}
@@ -20,6 +20,7 @@
 #include "lua.hpp"
 #include "kv/lua/midi_buffer.hpp"
 #include "kv/lua/factories.hpp"
+#include "engine/MidiKernels.h"
 #include "engine/MidiPipe.h"
 
 namespace Element {
@@ -91,7 +92,10 @@ void MidiPipe::clear (int channel, int startSample, int numSamples)
         buffer->clear (startSample, numSamples);
 }
 
-LuaMidiPipe::LuaMidiPipe() {}
+LuaMidiPipe::LuaMidiPipe()
+{
+    scratch.ensureSize (2048);
+}
 LuaMidiPipe::~LuaMidiPipe()
 {
     for (int i = refs.size(); --i >= 0;)
@@ -115,23 +119,28 @@ LuaMidiPipe** LuaMidiPipe::create (lua_State* L, int numReserved)
 void LuaMidiPipe::setSize (int newsize)
 {
     newsize = jmax (0, newsize);
+    reserve (newsize);
+    used = newsize;
+}
 
-    while (buffers.size() < newsize)
+void LuaMidiPipe::reserve (int numBuffers)
+{
+    while (buffers.size() < numBuffers)
     {
         buffers.add (kv::lua::new_midibuffer (state));
         refs.add (luaL_ref (state, LUA_REGISTRYINDEX));
     }
-
-    used = newsize;
 }
 
 const MidiBuffer* const LuaMidiPipe::getReadBuffer (int index) const
 {
-    return &(**buffers.getUnchecked(index)).buffer;
+    return getWriteBuffer (index);
 }
 
 MidiBuffer* LuaMidiPipe::getWriteBuffer (int index) const
 {
+    if (view != nullptr && (swapped & (1u << index)) == 0)
+        return view->getWriteBuffer (index);
     return &(**buffers.getUnchecked(index)).buffer;
 }
 
@@ -146,11 +155,47 @@ void LuaMidiPipe::swapWith (MidiPipe& pipe)
     }
 }
 
+void LuaMidiPipe::referTo (MidiPipe* pipe)
+{
+    if (view != nullptr)
+    {
+        for (int i = 0; swapped != 0; ++i)
+        {
+            if ((swapped & (1u << i)) != 0)
+            {
+                view->getWriteBuffer(i)->swapWith ((*buffers.getUnchecked(i))->buffer);
+                swapped &= ~(1u << i);
+            }
+        }
+    }
+
+    jassert (pipe == nullptr || pipe->getNumBuffers() <= 32);
+    view = pipe;
+    swapped = 0;
+}
+
+void LuaMidiPipe::swapIn (int index)
+{
+    const auto bit = 1u << index;
+    if (view == nullptr || (swapped & bit) != 0)
+        return;
+
+    // reserved ahead in prepare, so this doesn't normally allocate
+    reserve (index + 1);
+    view->getWriteBuffer(index)->swapWith ((*buffers.getUnchecked(index))->buffer);
+    swapped |= bit;
+}
+
 //==============================================================================
 int LuaMidiPipe::get (lua_State* L)
 {
     auto* pipe = *(LuaMidiPipe**) lua_touserdata (L, 1);
-    lua_rawgeti (L, LUA_REGISTRYINDEX, pipe->refs.getUnchecked (lua_tointeger (L, 2)));
+    const auto index = (int) lua_tointeger (L, 2);
+    luaL_argcheck (L, isPositiveAndBelow (index, jmax (pipe->getNumBuffers(), pipe->refs.size())),
+                   2, "buffer index out of range");
+    if (pipe->view != nullptr && index < pipe->view->getNumBuffers())
+        pipe->swapIn (index);
+    lua_rawgeti (L, LUA_REGISTRYINDEX, pipe->refs.getUnchecked (index));
     return 1;
 }
 
@@ -168,6 +213,155 @@ int LuaMidiPipe::size (lua_State* L)
     return 1;
 }
 
+template<class Function>
+int LuaMidiPipe::forBuffers (lua_State* L, int indexArg, Function&& fn)
+{
+    auto* pipe = *(LuaMidiPipe**) luaL_checkudata (L, 1, "el.MidiPipe");
+    if (lua_isnoneornil (L, indexArg))
+    {
+        for (int i = 0; i < pipe->getNumBuffers(); ++i)
+            fn (*pipe, *pipe->getWriteBuffer (i));
+        return 0;
+    }
+
+    const auto index = (int) luaL_checkinteger (L, indexArg);
+    luaL_argcheck (L, isPositiveAndBelow (index, pipe->getNumBuffers()), indexArg, "buffer index out of range");
+    fn (*pipe, *pipe->getWriteBuffer (index));
+    return 0;
+}
+
+/** The iterator state is the pipe itself and the position packs the
+    buffer index above the byte offset, so nothing is made per loop or per
+    event, and a loop kept past the render call just ends */
+static int midipipe_next_event (lua_State* L)
+{
+    auto* pipe = *(LuaMidiPipe**) luaL_checkudata (L, 1, "el.MidiPipe");
+    const auto position = lua_tointeger (L, 2);
+    const auto index  = (int) (position >> 32);
+    const auto offset = (int) (position & 0xffffffff);
+    if (! isPositiveAndBelow (index, pipe->getNumBuffers()))
+        return 0;
+
+    const auto& midi = *pipe->getReadBuffer (index);
+    if (offset >= midi.data.size())
+        return 0;
+
+    const uint8* const iter = midi.data.begin() + offset;
+    const int frame = readUnaligned<int32> (iter);
+    const int size  = (int) readUnaligned<uint16> (iter + sizeof (int32));
+    const uint8* const data = iter + MidiKernels::headerSize;
+
+    lua_pushinteger (L, ((lua_Integer) index << 32) | (offset + MidiKernels::headerSize + size));
+    lua_pushinteger (L, frame);
+    for (int i = 0; i < 3; ++i)
+        lua_pushinteger (L, i < size ? data[i] : 0);
+    return 5;
+}
+
+int LuaMidiPipe::events (lua_State* L)
+{
+    auto* pipe = *(LuaMidiPipe**) luaL_checkudata (L, 1, "el.MidiPipe");
+    const auto index = (int) luaL_optinteger (L, 2, 0);
+    luaL_argcheck (L, isPositiveAndBelow (index, pipe->getNumBuffers()), 2, "buffer index out of range");
+    lua_pushcfunction (L, midipipe_next_event);
+    lua_pushvalue (L, 1);
+    lua_pushinteger (L, (lua_Integer) index << 32);
+    return 3;
+}
+
+int LuaMidiPipe::numEvents (lua_State* L)
+{
+    auto* pipe = *(LuaMidiPipe**) luaL_checkudata (L, 1, "el.MidiPipe");
+    const auto index = (int) luaL_optinteger (L, 2, 0);
+    luaL_argcheck (L, isPositiveAndBelow (index, pipe->getNumBuffers()), 2, "buffer index out of range");
+    lua_pushinteger (L, pipe->getReadBuffer (index)->getNumEvents());
+    return 1;
+}
+
+int LuaMidiPipe::addEvent (lua_State* L)
+{
+    auto* pipe = *(LuaMidiPipe**) luaL_checkudata (L, 1, "el.MidiPipe");
+    const uint8 data[] = { (uint8) luaL_checkinteger (L, 2),
+                           (uint8) luaL_optinteger (L, 3, 0),
+                           (uint8) luaL_optinteger (L, 4, 0) };
+    const auto frame = (int) luaL_optinteger (L, 5, 0);
+    const auto index = (int) luaL_optinteger (L, 6, 0);
+    luaL_argcheck (L, data[0] >= 0x80 && data[0] != 0xf0 && data[0] != 0xf7, 2, "expected a short message status byte");
+    luaL_argcheck (L, isPositiveAndBelow (index, pipe->getNumBuffers()), 6, "buffer index out of range");
+    const int size = MidiMessage::getMessageLengthFromFirstByte (data[0]);
+    pipe->getWriteBuffer (index)->addEvent (data, size, frame);
+    return 0;
+}
+
+int LuaMidiPipe::filter (lua_State* L)
+{
+    luaL_checktype (L, 2, LUA_TFUNCTION);
+    bool failed = false;
+    forBuffers (L, 3, [L, &failed] (LuaMidiPipe& pipe, MidiBuffer& midi) {
+        // errors are raised once the buffer is whole again
+        MidiKernels::filter (midi, pipe.scratch, [L, &failed] (const uint8* data, int size, int frame) {
+            if (failed)
+                return true;
+            lua_pushvalue (L, 2);
+            for (int i = 0; i < 3; ++i)
+                lua_pushinteger (L, i < size ? data[i] : 0);
+            lua_pushinteger (L, frame);
+            if (lua_pcall (L, 4, 1, 0) != LUA_OK)
+            {
+                failed = true;
+                return true;
+            }
+            const bool keep = lua_toboolean (L, -1) != 0;
+            lua_pop (L, 1);
+            return keep;
+        });
+    });
+
+    return failed ? lua_error (L) : 0;
+}
+
+int LuaMidiPipe::keepChannels (lua_State* L)
+{
+    const auto mask = (uint32) luaL_checkinteger (L, 2);
+    return forBuffers (L, 3, [mask] (LuaMidiPipe& pipe, MidiBuffer& midi) {
+        MidiKernels::filter (midi, pipe.scratch, [mask] (const uint8* data, int, int) {
+            const int channel = MidiKernels::getChannel (data);
+            return channel == 0 || (mask & (1u << (channel - 1))) != 0;
+        });
+    });
+}
+
+int LuaMidiPipe::setChannel (lua_State* L)
+{
+    const auto channel = (int) luaL_checkinteger (L, 2);
+    luaL_argcheck (L, channel >= 1 && channel <= 16, 2, "channel must be 1 to 16");
+    uint8 table [16];
+    memset (table, channel - 1, sizeof (table));
+    return forBuffers (L, 3, [&table] (LuaMidiPipe&, MidiBuffer& midi) {
+        MidiKernels::remapChannels (midi, table);
+    });
+}
+
+int LuaMidiPipe::transpose (lua_State* L)
+{
+    const auto offset = (int) luaL_checkinteger (L, 2);
+    return forBuffers (L, 3, [offset] (LuaMidiPipe&, MidiBuffer& midi) {
+        MidiKernels::transpose (midi, offset);
+    });
+}
+
+int LuaMidiPipe::scaleVelocity (lua_State* L)
+{
+    const auto scale = luaL_checknumber (L, 2);
+    uint8 table [128];
+    table[0] = 0;
+    for (int i = 1; i < 128; ++i)
+        table[i] = (uint8) jlimit (1, 127, roundToInt (i * scale));
+    return forBuffers (L, 3, [&table] (LuaMidiPipe&, MidiBuffer& midi) {
+        MidiKernels::applyVelocityTable (midi, table);
+    });
+}
+
 }
 
 static int midipipe_new (lua_State* L)
@@ -190,6 +384,14 @@ static const luaL_Reg methods[] = {
     { "get",        Element::LuaMidiPipe::get },
     { "resize",     Element::LuaMidiPipe::resize },
     { "size",       Element::LuaMidiPipe::size },
+    { "events",     Element::LuaMidiPipe::events },
+    { "numevents",  Element::LuaMidiPipe::numEvents },
+    { "add",        Element::LuaMidiPipe::addEvent },
+    { "filter",     Element::LuaMidiPipe::filter },
+    { "keepchannels", Element::LuaMidiPipe::keepChannels },
+    { "setchannel", Element::LuaMidiPipe::setChannel },
+    { "transpose",  Element::LuaMidiPipe::transpose },
+    { "velocity",   Element::LuaMidiPipe::scaleVelocity },
     { nullptr, nullptr }
 };
 
@@ -64,8 +64,8 @@ public:
      */
     static LuaMidiPipe** create (lua_State* L, int numReserved);
 
-    /** Returns the number of midi buffers contained */
-    int getNumBuffers() const { return used; }
+    /** Returns the number of midi buffers contained, or referred to */
+    int getNumBuffers() const { return view != nullptr ? view->getNumBuffers() : used; }
     
     /** Get a read only buffer */
     const MidiBuffer* const getReadBuffer (int index) const;
@@ -79,16 +79,43 @@ public:
     /** Swap */
     void swapWith (MidiPipe&);
 
+    /** Refer to the buffers of a pipe for the length of a render call,
+        instead of swapping them in. The bulk methods and event accessors
+        work on them in place. Only a buffer a script asks for with get()
+        is swapped in, so it can be used as a kv.MidiBuffer. Pass nullptr
+        after the call to swap those back and stop referring to the pipe */
+    void referTo (MidiPipe* pipe);
+
     /** Lua impls */
     static int get (lua_State* L);
     static int resize (lua_State* L);
     static int size (lua_State* L);
 
+    /** Bulk Lua impls. These work on the packed bytes of every buffer, or
+        the one at an optional index, without making message objects */
+    static int events (lua_State* L);
+    static int numEvents (lua_State* L);
+    static int addEvent (lua_State* L);
+    static int filter (lua_State* L);
+    static int keepChannels (lua_State* L);
+    static int setChannel (lua_State* L);
+    static int transpose (lua_State* L);
+    static int scaleVelocity (lua_State* L);
+
 private:
     lua_State* state = nullptr;
     Array<kv::lua::MidiBufferImpl**> buffers;
     Array<int> refs;
     int used { 0 };
+    MidiBuffer scratch;
+    MidiPipe* view = nullptr;
+    uint32 swapped = 0;
+
+    void reserve (int numBuffers);
+    void swapIn (int index);
+
+    template<class Function>
+    static int forBuffers (lua_State* L, int indexArg, Function&& fn);
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LuaMidiPipe);
 };
 
@@ -19,22 +19,15 @@
 
 #pragma once
 
-#include "JuceHeader.h"
+#include "engine/MidiKernels.h"
 
 namespace Element {
 
 class MidiTranspose
 {
 public:
-    MidiTranspose()
-    {
-        output.ensureSize (sizeof (uint8) * 3 * 16);
-    }
-
-    ~MidiTranspose()
-    { 
-        output.clear();
-    }
+    MidiTranspose() { }
+    ~MidiTranspose() { }
 
     /** Set the note offset to transpose by. e.g -12 is down one octave */
     inline void setNoteOffset (const int noteOffset) { offset.set (noteOffset); }
@@ -56,31 +49,14 @@ public:
             message.setNoteNumber (offset.get() + message.getNoteNumber());
     }
 
-    /** Process a MidiBuffer */
-    inline void process (MidiBuffer& midi, int numSamples)
+    /** Process the events of a block in place */
+    inline void process (MidiBuffer& midi, int numSamples) noexcept
     {
-        if (0 == offset.get())
-            return;
-
-        MidiBuffer::Iterator iter (midi);
-        MidiMessage msg; int frame = 0;
-        
-        while (iter.getNextEvent (msg, frame))
-        {
-            if (frame >= numSamples)
-                break;
-            if (msg.isNoteOnOrOff())
-                msg.setNoteNumber (offset.get() + msg.getNoteNumber());
-            output.addEvent (msg, frame);
-        }
-
-        midi.swapWith (output);
-        output.clear();
+        MidiKernels::transpose (midi, offset.get(), numSamples);
     }
 
 private:
     Atomic<int> offset { 0 };
-    MidiBuffer output;
 };
 
 }
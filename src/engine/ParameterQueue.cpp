@@ -0,0 +1,214 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/ParameterQueue.h"
+
+namespace Element {
+
+/** Notifies listeners and applies idle queues for every queue */
+class ParameterQueue::Notifier : private Timer
+{
+public:
+    Notifier()  { startTimerHz (30); }
+    ~Notifier() { stopTimer(); }
+
+    void add (ParameterQueue* queue)     { queues.add (queue); }
+    void remove (ParameterQueue* queue)  { queues.removeFirstMatchingValue (queue); }
+
+private:
+    Array<ParameterQueue*> queues;
+
+    void timerCallback() override
+    {
+        for (auto* const queue : queues)
+            queue->update();
+    }
+};
+
+//=============================================================================
+namespace {
+    // a graph that hasn't rendered for this long is treated as stopped
+    const uint32 idleMillis = 100;
+}
+
+ParameterQueue::ParameterQueue (int size)
+    : capacity ((uint32) nextPowerOfTwo (jmax (16, size)))
+{
+    entries.calloc ((size_t) capacity);
+    for (uint32 i = 0; i < capacity; ++i)
+        entries[i].sequence.set (i);
+    touched.calloc ((size_t) capacity);
+    notifier->add (this);
+}
+
+ParameterQueue::~ParameterQueue()
+{
+    notifier->remove (this);
+}
+
+ParameterQueue::Target* ParameterQueue::addTarget (Parameter* parameter)
+{
+    jassert (parameter != nullptr);
+    for (auto* const target : targets)
+    {
+        if (target->parameter.get() == parameter)
+        {
+            ++target->numUsers;
+            return target;
+        }
+    }
+
+    auto* const target = targets.add (new Target (parameter));
+    target->numUsers = 1;
+    return target;
+}
+
+void ParameterQueue::removeTarget (Target* target)
+{
+    if (target == nullptr || ! targets.contains (target))
+        return;
+
+    // other handlers may still push to it
+    if (--target->numUsers > 0)
+        return;
+
+    // nothing left in the fifo may point at the target once it's gone
+    {
+        SpinLock::ScopedLockType sl (processLock);
+        applyQueued();
+    }
+
+    if (target->changed.compareAndSetBool (0, 1))
+        target->parameter->sendValueChangedMessageToListeners (target->parameter->getValue());
+    targets.removeObject (target);
+}
+
+bool ParameterQueue::push (Target* target, float value) noexcept
+{
+    // each slot's sequence says whose turn it is: a writer claims the slot
+    // when it equals the write position, the reader when it's one past it
+    const uint32 mask = capacity - 1;
+    uint32 pos = writePos.get();
+    Entry* entry = nullptr;
+
+    for (;;)
+    {
+        entry = &entries [pos & mask];
+        const auto diff = (int32) (entry->sequence.get() - pos);
+        if (diff == 0)
+        {
+            if (writePos.compareAndSetBool (pos + 1, pos))
+                break;
+            pos = writePos.get();
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = writePos.get();
+        }
+    }
+
+    entry->target       = target;
+    entry->generation   = target->generation.get();
+    entry->value        = value;
+    target->latest.set (value);
+    ++target->numQueued;
+    entry->sequence.set (pos + 1);
+    return true;
+}
+
+void ParameterQueue::supersede (Target* target, float value) noexcept
+{
+    // entries pushed under an older generation are skipped when applied
+    target->latest.set (value);
+    ++target->generation;
+}
+
+float ParameterQueue::getLatestValue (Target* target) const noexcept
+{
+    return target->numQueued.get() > 0 ? target->latest.get()
+                                       : target->parameter->getValue();
+}
+
+void ParameterQueue::process() noexcept
+{
+    lastProcessed.set (Time::getMillisecondCounter());
+
+    // the message thread is removing a target or applying changes while
+    // the graph was idle, it'll apply what's queued
+    SpinLock::ScopedTryLockType sl (processLock);
+    if (sl.isLocked())
+        applyQueued();
+}
+
+void ParameterQueue::applyQueued() noexcept
+{
+    // keep the latest value per target
+    const uint32 mask = capacity - 1;
+    int numTouched = 0;
+
+    // stop after one lap so a busy producer can't keep the reader here
+    for (uint32 i = 0; i < capacity; ++i)
+    {
+        auto& entry = entries [readPos & mask];
+        if (entry.sequence.get() != readPos + 1)
+            break;
+
+        auto* const target = entry.target;
+        if (entry.generation == target->generation.get())
+        {
+            if (! target->pending)
+            {
+                target->pending = true;
+                touched[numTouched++] = target;
+            }
+            target->value = entry.value;
+        }
+
+        entry.sequence.set (readPos + capacity);
+        ++readPos;
+        --target->numQueued;
+    }
+
+    for (int i = 0; i < numTouched; ++i)
+    {
+        auto* const target = touched[i];
+        target->pending = false;
+        target->parameter->setValue (target->value);
+        target->changed.set (1);
+    }
+}
+
+void ParameterQueue::update()
+{
+    if (Time::getMillisecondCounter() - lastProcessed.get() > idleMillis)
+    {
+        SpinLock::ScopedLockType sl (processLock);
+        applyQueued();
+    }
+
+    for (auto* const target : targets)
+        if (target->changed.compareAndSetBool (0, 1))
+            target->parameter->sendValueChangedMessageToListeners (target->parameter->getValue());
+}
+
+}
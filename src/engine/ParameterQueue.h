@@ -0,0 +1,124 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/Parameter.h"
+
+namespace Element {
+
+/** Carries parameter changes from a MIDI thread to the audio thread.
+
+    Changes are pushed lock free and applied when the graph renders, once per
+    parameter per block with the latest value. Listeners are told about the
+    changes later on the message thread, at a throttled rate, so a stream of
+    controller messages doesn't fire listener chains for every event. One
+    timer serves every queue.
+
+    A graph that isn't rendering, e.g. an inactive root graph, a suspended
+    subgraph or one on a stopped device, doesn't apply its queue, so the
+    timer applies it on the message thread instead.
+
+    Each graph owns a queue. Parameters are registered as targets on the
+    message thread before changes are pushed for them. Any number of MIDI
+    threads can push at the same time.
+ */
+class ParameterQueue : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<ParameterQueue>;
+
+    /** A parameter changes can be pushed for */
+    class Target : public ReferenceCountedObject
+    {
+    public:
+        using Ptr = ReferenceCountedObjectPtr<Target>;
+        Parameter* getParameter() const noexcept { return parameter.get(); }
+
+    private:
+        friend class ParameterQueue;
+        Target (Parameter* p) : parameter (p) { }
+        Parameter::Ptr parameter;
+        float value = 0.f;
+        bool pending = false;
+        int numUsers = 0;
+        Atomic<int> changed { 0 };
+        Atomic<int> numQueued { 0 };
+        Atomic<uint32> generation { 0 };
+        Atomic<float> latest { 0.f };
+    };
+
+    explicit ParameterQueue (int capacity = 1024);
+    ~ParameterQueue();
+
+    /** Register a parameter. Every call must be matched by a call to
+        removeTarget(). Message thread only */
+    Target* addTarget (Parameter* parameter);
+
+    /** Unregister a target. When the last user of it is gone any changes
+        still queued for it are applied and the target is freed.
+        Message thread only */
+    void removeTarget (Target* target);
+
+    /** Queue a new normalized value. Returns false if the queue is full.
+        Safe to call from several threads at once */
+    bool push (Target* target, float value) noexcept;
+
+    /** Drop the changes queued for a target, because a newer value was set
+        on its parameter directly. Call it from the thread that pushes */
+    void supersede (Target* target, float value) noexcept;
+
+    /** Returns the latest value pushed or set for a target. This may not
+        have been applied to the parameter yet */
+    float getLatestValue (Target* target) const noexcept;
+
+    /** Apply queued changes. Called by the graph on the audio thread */
+    void process() noexcept;
+
+    /** Returns the number of targets registered */
+    int getNumTargets() const noexcept { return targets.size(); }
+
+private:
+    struct Entry
+    {
+        Atomic<uint32> sequence;
+        Target* target;
+        uint32 generation;
+        float value;
+    };
+
+    class Notifier;
+    SharedResourcePointer<Notifier> notifier;
+
+    const uint32 capacity;
+    Atomic<uint32> writePos { 0 };
+    uint32 readPos = 0;
+    HeapBlock<Entry> entries;
+    HeapBlock<Target*> touched;
+    ReferenceCountedArray<Target> targets;
+    SpinLock processLock;
+    Atomic<uint32> lastProcessed { 0 };
+
+    void applyQueued() noexcept;
+    void update();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParameterQueue)
+};
+
+}
@@ -0,0 +1,198 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/SysexPool.h"
+
+namespace Element {
+
+struct SysexPool::Slot
+{
+    SizeClass* owner = nullptr;
+    int index = 0;
+    uint8* data = nullptr;
+    int size = 0;
+    Atomic<int> refs { 0 };
+};
+
+struct SysexPool::SizeClass
+{
+    SizeClass (int bytes, int count)
+        : slotSize (bytes), numSlots (count),
+          numWords ((count + 63) / 64)
+    {
+        memory.calloc ((size_t) slotSize * (size_t) numSlots);
+        slots.reset (new Slot [(size_t) numSlots]);
+        freeBits.reset (new Atomic<uint64> [(size_t) numWords]);
+
+        for (int i = 0; i < numSlots; ++i)
+        {
+            slots[i].owner = this;
+            slots[i].index = i;
+            slots[i].data  = memory + (size_t) slotSize * (size_t) i;
+            release (i);
+        }
+    }
+
+    /** Claim a free slot, or return nullptr */
+    Slot* claim() noexcept
+    {
+        for (int w = 0; w < numWords; ++w)
+        {
+            auto& word = freeBits[w].value;
+            uint64 bits = word.load();
+            while (bits != 0)
+            {
+                const uint64 lowest = bits & (~bits + 1);
+                if (word.compare_exchange_weak (bits, bits & ~lowest))
+                    return &slots[w * 64 + countNumberOfBits (lowest - 1)];
+            }
+        }
+
+        return nullptr;
+    }
+
+    void release (int index) noexcept
+    {
+        freeBits[index / 64].value.fetch_or ((uint64) 1 << (index % 64));
+    }
+
+    int getNumFree() const noexcept
+    {
+        int count = 0;
+        for (int w = 0; w < numWords; ++w)
+            count += countNumberOfBits (freeBits[w].get());
+        return count;
+    }
+
+    const int slotSize, numSlots, numWords;
+    HeapBlock<uint8> memory;
+    std::unique_ptr<Slot[]> slots;
+    std::unique_ptr<Atomic<uint64>[]> freeBits;
+};
+
+//==============================================================================
+SysexPool::Ref::Ref (const Ref& other) noexcept
+    : slot (other.slot)
+{
+    if (slot != nullptr)
+        ++slot->refs;
+}
+
+SysexPool::Ref::Ref (Ref&& other) noexcept
+    : slot (other.slot)
+{
+    other.slot = nullptr;
+}
+
+SysexPool::Ref::~Ref()
+{
+    reset();
+}
+
+SysexPool::Ref& SysexPool::Ref::operator= (const Ref& other) noexcept
+{
+    if (other.slot != nullptr)
+        ++other.slot->refs;
+    reset();
+    slot = other.slot;
+    return *this;
+}
+
+SysexPool::Ref& SysexPool::Ref::operator= (Ref&& other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        slot = other.slot;
+        other.slot = nullptr;
+    }
+    return *this;
+}
+
+const uint8* SysexPool::Ref::getData() const noexcept   { return slot != nullptr ? slot->data : nullptr; }
+int SysexPool::Ref::getSize() const noexcept            { return slot != nullptr ? slot->size : 0; }
+
+void SysexPool::Ref::reset() noexcept
+{
+    if (slot == nullptr)
+        return;
+    if (--slot->refs == 0)
+        slot->owner->release (slot->index);
+    slot = nullptr;
+}
+
+//==============================================================================
+SysexPool::SysexPool()
+{
+    classes.add (new SizeClass (1 << 10, 128));
+    classes.add (new SizeClass (1 << 14, 32));
+    classes.add (new SizeClass (1 << 18, 8));
+    classes.add (new SizeClass (1 << 20, 2));
+    classes.add (new SizeClass (1 << 23, 1));
+
+    for (auto* sizeClass : classes)
+        numSlots += sizeClass->numSlots;
+}
+
+SysexPool::~SysexPool()
+{
+    // every Ref should be gone before the pool
+    jassert (getNumFree() == numSlots);
+}
+
+SysexPool::Ref SysexPool::allocate (const uint8* data, int size) noexcept
+{
+    Ref ref;
+    if (size <= 0)
+        return ref;
+
+    // fall back to a bigger slot when the best fit is used up
+    for (auto* sizeClass : classes)
+    {
+        if (size > sizeClass->slotSize)
+            continue;
+
+        if (auto* slot = sizeClass->claim())
+        {
+            memcpy (slot->data, data, (size_t) size);
+            slot->size = size;
+            slot->refs = 1;
+            ref.slot = slot;
+            return ref;
+        }
+    }
+
+    numFailed.set (numFailed.get() + 1);
+    return ref;
+}
+
+int SysexPool::getMaxSize() const noexcept
+{
+    return classes.getLast()->slotSize;
+}
+
+int SysexPool::getNumFree() const noexcept
+{
+    int count = 0;
+    for (auto* sizeClass : classes)
+        count += sizeClass->getNumFree();
+    return count;
+}
+
+}
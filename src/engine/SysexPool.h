@@ -0,0 +1,109 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Preallocated storage for system exclusive messages.
+
+    A sysex dump can be far bigger than the rings MIDI passes through between
+    threads. Instead of copying the bytes along every hop, the message is
+    copied once in to a pooled slot, and a reference counted Ref to it is
+    passed around. Slots come in a few fixed sizes and are claimed and
+    returned with atomic bit flags, so allocating and releasing never lock or
+    touch the heap, on any thread.
+ */
+class SysexPool
+{
+public:
+    struct Slot;
+
+    /** A counted reference to a payload in the pool. The slot goes back to
+        the pool when the last Ref to it is gone */
+    class Ref
+    {
+    public:
+        Ref() = default;
+        Ref (const Ref& other) noexcept;
+        Ref (Ref&& other) noexcept;
+        ~Ref();
+
+        Ref& operator= (const Ref& other) noexcept;
+        Ref& operator= (Ref&& other) noexcept;
+
+        bool isValid() const noexcept           { return slot != nullptr; }
+        const uint8* getData() const noexcept;
+        int getSize() const noexcept;
+
+        /** Drop this reference */
+        void reset() noexcept;
+
+        /** Hand the reference over as a raw pointer, for passing through a
+            byte ring. It must be taken back with adopt() exactly once */
+        Slot* detach() noexcept                 { auto* s = slot; slot = nullptr; return s; }
+
+        /** Take back a reference given out by detach() */
+        static Ref adopt (Slot* slot) noexcept  { Ref ref; ref.slot = slot; return ref; }
+
+    private:
+        friend class SysexPool;
+        Slot* slot = nullptr;
+    };
+
+    /** Messages this size or smaller are cheap enough to copy inline */
+    static constexpr int inlineLimit = 256;
+
+    /** Creates a pool with slots of 1KB, 16KB, 256KB, 1MB and one of 8MB
+        for whole bank dumps */
+    SysexPool();
+    ~SysexPool();
+
+    /** Copy a message in to the smallest free slot that fits it. Returns an
+        invalid Ref if it is too big, or no slot is free. Realtime safe */
+    Ref allocate (const uint8* data, int size) noexcept;
+
+    /** Returns the largest message the pool can hold */
+    int getMaxSize() const noexcept;
+
+    /** Returns the number of slots not in use */
+    int getNumFree() const noexcept;
+
+    /** Returns the number of messages that didn't get a slot */
+    int getNumFailed() const noexcept { return numFailed.get(); }
+
+    /** Returns true if a message should go through a pool rather than be
+        copied inline */
+    static bool shouldPool (const uint8* data, int size) noexcept
+    {
+        return size > inlineLimit && data[0] == 0xf0;
+    }
+
+private:
+    struct SizeClass;
+    OwnedArray<SizeClass> classes;
+    int numSlots = 0;
+    Atomic<int> numFailed { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SysexPool)
+};
+
+}
@@ -21,14 +21,25 @@
 
 namespace Element {
 
-/** Similar to a kv::MatrixState but is intended to be used in a realtime context */
+/** Similar to a kv::MatrixState but is intended to be used in a realtime context
+
+    Each input is a row of bits, one per output, so routes can be found by
+    scanning whole words instead of testing every cell.
+ */
 class ToggleGrid
 {
 public:
+    /** How a route differs between two grids */
+    enum Change
+    {
+        Steady = 0,     ///< connected in both
+        FadeIn,         ///< only connected in the next grid
+        FadeOut         ///< only connected in the current grid
+    };
+
     /** This ctor will allocate: DO NOT create these on the stack in a realtime 
         thread, use two instances ToggleGrid::swapWith or operator= instead */
     explicit ToggleGrid (const int ins = 4, const int outs = 4)
-        : numIns (ins), numOuts (outs)
     {
         jassert (ins > 0 && outs > 0);
         resize (ins, outs);
@@ -40,23 +51,18 @@ public:
         resize (matrix.getNumRows(), matrix.getNumColumns());
         for (int i = 0; i < matrix.getNumRows(); ++i)
             for (int o = 0; o < matrix.getNumColumns(); ++o)
-                toggles[i][o] = matrix.connected (i, o);
+                set (i, o, matrix.connected (i, o));
     }
 
-    ~ToggleGrid() noexcept 
-    {
-        free();
-    }
+    ~ToggleGrid() noexcept { }
 
     inline void resize (int ins, int outs)
     {
-        free();
         jassert(ins > 0 && outs > 0);
         numIns = ins;
         numOuts = outs;
-        toggles = new bool* [numIns];
-        for (int i = 0; i < numIns; ++i)
-            toggles[i] = new bool [numOuts];
+        wordsPerRow = (outs + 63) / 64;
+        bits.calloc ((size_t) (numIns * wordsPerRow));
     }
 
     inline bool sameSizeAs (const ToggleGrid& other) const noexcept
@@ -71,65 +77,107 @@ public:
 
     inline void clear() noexcept
     {
-        for (int i = 0; i < numIns; ++i)
-            for (int o = 0; o < numOuts; ++o)
-                toggles[i][o] = false;
+        zeromem (bits.get(), sizeof (uint64) * (size_t) (numIns * wordsPerRow));
     }
 
     inline bool get (const int in, const int out) const noexcept
     {
         jassert (isPositiveAndBelow (in, numIns) && isPositiveAndBelow (out, numOuts));
-        return toggles[in][out];
+        return ((row (in)[out >> 6] >> (out & 63)) & 1) != 0;
     }
 
     inline void set (const int in, const int out, const bool value) noexcept
     {
         jassert (isPositiveAndBelow (in, numIns) && isPositiveAndBelow (out, numOuts));
-        toggles[in][out] = value;
+        const uint64 mask = (uint64) 1 << (out & 63);
+        auto& word = row (in)[out >> 6];
+        word = value ? (word | mask) : (word & ~mask);
     }
 
     inline int getNumInputs() const noexcept    { return numIns; }
     inline int getNumOutputs() const noexcept   { return numOuts; }
 
+    /** Returns the number of connected cells */
+    inline int getNumRoutes() const noexcept
+    {
+        int total = 0;
+        for (int i = 0; i < numIns * wordsPerRow; ++i)
+            total += countNumberOfBits (bits[i]);
+        return total;
+    }
+
+    /** Calls fn (int in, int out) for every connected cell */
+    template<class Function>
+    inline void forEachRoute (Function&& fn) const noexcept
+    {
+        for (int in = 0; in < numIns; ++in)
+            for (int w = 0; w < wordsPerRow; ++w)
+                forEachBit (row (in)[w], [&] (int bit) { fn (in, w * 64 + bit); });
+    }
+
+    /** Calls fn (int in, int out, Change change) for every cell connected in
+        either grid. Cells off in both are never visited. The grids must be
+        the same size */
+    template<class Function>
+    static void forEachChange (const ToggleGrid& current, const ToggleGrid& next, Function&& fn) noexcept
+    {
+        jassert (current.sameSizeAs (next));
+        for (int in = 0; in < current.numIns; ++in)
+        {
+            const uint64* a = current.row (in);
+            const uint64* b = next.row (in);
+            for (int w = 0; w < current.wordsPerRow; ++w)
+            {
+                const uint64 on = a[w] & b[w];
+                forEachBit (a[w] | b[w], [&] (int bit) {
+                    const uint64 mask = (uint64) 1 << bit;
+                    fn (in, w * 64 + bit, (on & mask) != 0 ? Steady
+                                        : (b[w] & mask) != 0 ? FadeIn : FadeOut);
+                });
+            }
+        }
+    }
+
     inline void swapWith (ToggleGrid& other) noexcept
     {
-        std::swap (toggles, other.toggles);
+        bits.swapWith (other.bits);
         std::swap (numIns, other.numIns);
         std::swap (numOuts, other.numOuts);
+        std::swap (wordsPerRow, other.wordsPerRow);
     }
 
     ToggleGrid& operator= (const ToggleGrid& other)
     {
         if (sameSizeAs (other))
         {
-            for (int i = 0; i < numIns; ++i)
-                for (int o = 0; o < numOuts; ++o)
-                    toggles[i][o] = other.toggles[i][o];
+            memcpy (bits.get(), other.bits.get(), sizeof (uint64) * (size_t) (numIns * wordsPerRow));
         }
         else
         {
             for (int i = 0; i < jmin (numIns, other.numIns); ++i)
                 for (int o = 0; o < jmin (numOuts, other.numOuts); ++o)
-                    toggles[i][o] = other.toggles[i][o];
+                    set (i, o, other.get (i, o));
         }
 
         return *this;
     }
 
 private:
-    int numIns, numOuts;
-    bool** toggles = nullptr;
+    int numIns = 0, numOuts = 0, wordsPerRow = 0;
+    HeapBlock<uint64> bits;
+
+    inline uint64* row (int in) noexcept                { return bits.get() + in * wordsPerRow; }
+    inline const uint64* row (int in) const noexcept    { return bits.get() + in * wordsPerRow; }
 
-    void free()
+    template<class Function>
+    static inline void forEachBit (uint64 word, Function&& fn) noexcept
     {
-        if (toggles != nullptr)
+        while (word != 0)
         {
-            for (int i = 0; i < numIns; ++i)
-                delete [] toggles [i];
-            delete [] toggles;
-            toggles = nullptr;
+            const uint64 lowest = word & (~word + 1);
+            fn (countNumberOfBits (lowest - 1));
+            word ^= lowest;
         }
-        numIns = numOuts = 0;
     }
 };
 
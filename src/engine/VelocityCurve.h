@@ -78,8 +78,17 @@ public:
             case Hard_2: setOffset (0.65); break;
             case Hard_3: setOffset (0.75); break;
         }
+
+        // zero is a note off and stays that way
+        table[0] = 0;
+        for (int i = 1; i < 128; ++i)
+            table[i] = static_cast<uint8> (jlimit (0, 127,
+                roundToInt (127.f * process (static_cast<float> (i) / 127.f))));
     }
 
+    /** Returns 128 output velocities indexed by input velocity */
+    inline const uint8* getTable() const noexcept { return table; }
+
     inline float process (float velocity)
     {
         if (mode == Linear)
@@ -110,18 +119,14 @@ public:
         return velocity / 127.f;
     }
 
-    inline uint8 process (const uint8 velocity)
+    inline uint8 process (const uint8 velocity) const noexcept
     {
-        if (mode == Linear)
-            return velocity;
-        else if (mode == Max)
-            return 127;
-        return static_cast<uint8> (roundToIntAccurate (
-            process (static_cast<float> (velocity) / 127.f)));
+        return table [velocity & 0x7f];
     }
 
 private:
-    Mode mode;
+    Mode mode = numModes;
+    uint8 table [128];
     float rsq;
     float c0, c1;
     float t;
@@ -0,0 +1,360 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/WorkerPool.h"
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/mman.h>
+ #include <sys/resource.h>
+#endif
+
+namespace Element {
+
+namespace {
+    /** Batches are claimed from one 64 bit word: the generation in the top
+        23 bits, then the number of jobs and the next job's index in 20 bits
+        each. */
+    const int jobBits = 20;
+    const int64 jobMask = (1 << jobBits) - 1;
+
+    inline int64 packJobs (uint32 generation, int numJobs) noexcept
+    {
+        return ((int64) (generation & 0x7fffff) << (jobBits * 2)) | ((int64) numJobs << jobBits);
+    }
+
+    inline int getNumJobs (int64 word) noexcept     { return (int) ((word >> jobBits) & jobMask); }
+    inline int getJobIndex (int64 word) noexcept    { return (int) (word & jobMask); }
+
+    /** Returns the realtime priority of the calling thread, or zero if it
+        isn't realtime */
+    int getCurrentThreadRealtimePriority()
+    {
+       #if JUCE_LINUX || JUCE_MAC
+        int policy = 0;
+        sched_param param;
+        if (pthread_getschedparam (pthread_self(), &policy, &param) == 0 &&
+            (policy == SCHED_FIFO || policy == SCHED_RR))
+            return param.sched_priority;
+        return 0;
+       #else
+        return 1;
+       #endif
+    }
+
+    /** Switch the calling thread to realtime scheduling, or back to normal
+        scheduling if priority is zero. Returns true if realtime was granted */
+    bool setCurrentThreadRealtimePriority (const int priority)
+    {
+       #if JUCE_LINUX || JUCE_MAC
+        sched_param param;
+        if (priority > 0)
+        {
+            param.sched_priority = jlimit (sched_get_priority_min (SCHED_FIFO),
+                                           sched_get_priority_max (SCHED_FIFO),
+                                           priority);
+            if (pthread_setschedparam (pthread_self(), SCHED_FIFO, &param) == 0)
+                return true;
+        }
+
+        param.sched_priority = 0;
+        pthread_setschedparam (pthread_self(), SCHED_OTHER, &param);
+        return false;
+       #else
+        return Thread::setCurrentThreadPriority (priority > 0 ? 10 : 8) && priority > 0;
+       #endif
+    }
+}
+
+//=============================================================================
+class WorkerPool::Worker : public Thread
+{
+public:
+    Worker (WorkerPool& p, const int index, const uint32 mask)
+        : Thread ("Element Worker " + String (index + 1)),
+          pool (p), affinityMask (mask) { }
+
+    ~Worker()
+    {
+        signalThreadShouldExit();
+        wake();
+        stopThread (1000);
+    }
+
+    void wake() noexcept                { wakeup.signal(); }
+    bool isRealtime() const noexcept    { return realtime.get() == 1; }
+
+    void run() override
+    {
+        if (affinityMask != 0)
+            Thread::setCurrentThreadAffinityMask (affinityMask);
+
+        while (! threadShouldExit())
+        {
+            wakeup.wait (-1);
+            if (threadShouldExit())
+                break;
+
+            updatePriority();
+            pool.runJobs();
+        }
+    }
+
+private:
+    WorkerPool& pool;
+    const uint32 affinityMask;
+    WaitableEvent wakeup;
+    Atomic<int> realtime { 0 };
+    int priority = -1;
+
+    void updatePriority()
+    {
+        const int newPriority = pool.getWorkerPriority();
+        if (newPriority == priority)
+            return;
+        priority = newPriority;
+        realtime.set (setCurrentThreadRealtimePriority (priority) ? 1 : 0);
+    }
+};
+
+//=============================================================================
+WorkerPool::WorkerPool() { }
+
+WorkerPool::~WorkerPool()
+{
+    stopWorkers();
+   #if JUCE_LINUX || JUCE_MAC
+    if (isMemoryLocked())
+        munlockall();
+   #endif
+}
+
+void WorkerPool::setOptions (const Options& newOptions)
+{
+    jassert (MessageManager::getInstance()->isThisTheMessageThread());
+
+    Options opts (newOptions);
+    opts.numThreads     = jlimit (0, SystemStats::getNumCpus(), opts.numThreads);
+    opts.priorityOffset = jlimit (-20, 0, opts.priorityOffset);
+
+    bool restart = false;
+    {
+        const ScopedLock sl (optionsLock);
+        restart = opts.numThreads != options.numThreads ||
+                  opts.affinityMask != options.affinityMask;
+        options = opts;
+    }
+
+    priorityOffset.set (opts.priorityOffset);
+
+    if (restart)
+    {
+        stopWorkers();
+        startWorkers();
+    }
+
+    updateMemoryLock();
+}
+
+WorkerPool::Options WorkerPool::getOptions() const
+{
+    const ScopedLock sl (optionsLock);
+    return options;
+}
+
+int WorkerPool::getNumRealtimeWorkers() const noexcept
+{
+    int count = 0;
+    for (int i = 0; i < numActive.get(); ++i)
+        if (workers.getUnchecked(i)->isRealtime())
+            ++count;
+    return count;
+}
+
+String WorkerPool::getStatusText() const
+{
+    String text;
+    const int numWorkers = getNumWorkers();
+
+    if (numWorkers <= 0)
+    {
+        text << "Workers disabled";
+    }
+    else
+    {
+        text << numWorkers << (numWorkers == 1 ? " worker, " : " workers, ")
+             << getNumRealtimeWorkers() << " realtime";
+
+        const int priority = devicePriority.get();
+        if (priority > 0)
+            text << " (priority " << getWorkerPriority() << ")";
+        else if (priority == 0)
+            text << " (device thread isn't realtime)";
+    }
+
+    if (getOptions().lockMemory)
+        text << (isMemoryLocked() ? ", memory locked" : ", memory lock denied");
+
+    return text;
+}
+
+void WorkerPool::deviceThreadChanged() noexcept
+{
+    devicePriority.set (-1);
+}
+
+void WorkerPool::perform (Job* const* newJobs, const int newNumJobs) noexcept
+{
+    if (newNumJobs <= 0)
+        return;
+
+    // another thread has the workers, e.g. a second plugin instance sharing
+    // the pool, so this one runs its jobs itself
+    if (newNumJobs > jobMask || ! performing.compareAndSetBool (1, 0))
+    {
+        for (int i = 0; i < newNumJobs; ++i)
+            newJobs[i]->perform();
+        return;
+    }
+
+    const int numWorkers = jmin (numActive.get(), newNumJobs - 1);
+    if (numWorkers <= 0)
+    {
+        for (int i = 0; i < newNumJobs; ++i)
+            newJobs[i]->perform();
+        performing.set (0);
+        return;
+    }
+
+    if (devicePriority.get() < 0)
+        devicePriority.set (getCurrentThreadRealtimePriority());
+
+    // every job of the last batch was claimed and finished, so no worker
+    // reads the job list until the new batch is published
+    jobs = newJobs;
+    jobsRemaining.set (newNumJobs);
+    nextJob.set (packJobs (++generation, newNumJobs));
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.getUnchecked(i)->wake();
+
+    runJobs();
+
+    // workers might share a core with this thread, so don't spin forever
+    for (int spins = 0; jobsRemaining.get() > 0; ++spins)
+        if (spins > 512)
+            Thread::yield();
+
+    performing.set (0);
+}
+
+void WorkerPool::runJobs() noexcept
+{
+    for (;;)
+    {
+        const int64 word = nextJob.get();
+        const int index = getJobIndex (word);
+        if (index >= getNumJobs (word))
+            break;
+
+        // fails if another thread claimed it or a new batch started
+        if (! nextJob.compareAndSetBool (word + 1, word))
+            continue;
+
+        jobs[index]->perform();
+        --jobsRemaining;
+    }
+}
+
+int WorkerPool::getWorkerPriority() const noexcept
+{
+    const int priority = devicePriority.get();
+    if (priority <= 0)
+        return 0;
+    return jmax (1, priority + priorityOffset.get());
+}
+
+void WorkerPool::stopWorkers()
+{
+    numActive.set (0);
+    while (performing.get() != 0)
+        Thread::sleep (1);
+    workers.clear();
+}
+
+void WorkerPool::startWorkers()
+{
+    jassert (workers.isEmpty());
+    const auto opts = getOptions();
+
+    for (int i = 0; i < opts.numThreads; ++i)
+    {
+        auto* worker = workers.add (new Worker (*this, i, opts.affinityMask));
+        worker->startThread (9);
+    }
+
+    numActive.set (workers.size());
+}
+
+void WorkerPool::updateMemoryLock()
+{
+   #if JUCE_LINUX || JUCE_MAC
+    const bool shouldLock = getOptions().lockMemory;
+
+    if (shouldLock && ! isMemoryLocked())
+    {
+        // future allocations are only locked if there is no limit, otherwise
+        // they would start failing once the limit is reached
+        struct rlimit limit;
+        const bool unlimited = getrlimit (RLIMIT_MEMLOCK, &limit) == 0 &&
+                               limit.rlim_cur == RLIM_INFINITY;
+        const int flags = unlimited ? (MCL_CURRENT | MCL_FUTURE) : MCL_CURRENT;
+        memoryLocked.set (mlockall (flags) == 0 ? 1 : 0);
+    }
+    else if (! shouldLock && isMemoryLocked())
+    {
+        munlockall();
+        memoryLocked.set (0);
+    }
+   #endif
+}
+
+uint32 WorkerPool::parseAffinityMask (const String& cpus)
+{
+    uint32 mask = 0;
+
+    for (const auto& token : StringArray::fromTokens (cpus, ",", {}))
+    {
+        const auto range = token.trim();
+        if (range.isEmpty())
+            continue;
+
+        const int first = range.upToFirstOccurrenceOf ("-", false, false).getIntValue();
+        const int last  = range.containsChar ('-') ? range.fromFirstOccurrenceOf ("-", false, false).getIntValue()
+                                                  : first;
+
+        for (int cpu = jmax (0, first); cpu <= jmin (31, last); ++cpu)
+            mask |= (1u << cpu);
+    }
+
+    return mask;
+}
+
+}
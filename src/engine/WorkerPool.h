@@ -0,0 +1,128 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A pool of realtime threads the engine can spread render work across.
+
+    Workers follow the scheduling of the audio device thread: the first time
+    jobs are performed the device thread's SCHED_FIFO priority is sampled and
+    the workers switch themselves to it, plus a configurable offset. Workers
+    never take locks shared with the message thread, so they can't be held up
+    by it.
+
+    Engines hold the pool with a SharedResourcePointer, so plugin instances
+    loaded in the same host process share one set of workers.
+ */
+class WorkerPool
+{
+public:
+    struct Options
+    {
+        /** Number of worker threads, zero disables the pool */
+        int numThreads = 0;
+
+        /** Worker priority relative to the device thread. Workers never run
+            above the device thread, so this is clamped to zero or less */
+        int priorityOffset = 0;
+
+        /** CPUs the workers may run on, zero for any */
+        uint32 affinityMask = 0;
+
+        /** Lock the process' memory so engine buffers aren't paged out */
+        bool lockMemory = false;
+    };
+
+    /** A unit of work performed by the pool */
+    class Job
+    {
+    public:
+        virtual ~Job() { }
+        virtual void perform() = 0;
+    };
+
+    WorkerPool();
+    ~WorkerPool();
+
+    /** Apply new options, restarting the workers if needed. Call this from
+        the message thread only */
+    void setOptions (const Options& newOptions);
+
+    /** Returns the current options */
+    Options getOptions() const;
+
+    /** Returns the number of running workers */
+    int getNumWorkers() const noexcept { return numActive.get(); }
+
+    /** Returns the number of workers that were granted realtime scheduling */
+    int getNumRealtimeWorkers() const noexcept;
+
+    /** Returns true if the engine's memory is locked */
+    bool isMemoryLocked() const noexcept { return memoryLocked.get() == 1; }
+
+    /** Returns a short description of the pool's realtime status */
+    String getStatusText() const;
+
+    /** Call this when the audio device restarts so the workers pick up the
+        scheduling of the new device thread */
+    void deviceThreadChanged() noexcept;
+
+    /** Perform jobs in parallel and return when all have finished. The caller
+        takes part, so this works even when the pool is disabled. Call from the
+        audio thread. If another thread is performing jobs already, the caller
+        performs all of its own.
+     */
+    void perform (Job* const* jobs, int numJobs) noexcept;
+
+    /** Parse a CPU list like "0-3,6" in to an affinity mask */
+    static uint32 parseAffinityMask (const String& cpus);
+
+private:
+    class Worker;
+    OwnedArray<Worker> workers;
+    CriticalSection optionsLock;
+    Options options;
+
+    Atomic<int> numActive { 0 };
+    Atomic<int> performing { 0 };
+    Atomic<int> memoryLocked { 0 };
+    Atomic<int> devicePriority { -1 };
+    Atomic<int> priorityOffset { 0 };
+
+    // the batch generation, job count and next job index packed in one
+    // word, so a worker can only claim a job from the batch it looked at
+    Job* const* jobs = nullptr;
+    uint32 generation = 0;
+    Atomic<int64> nextJob { 0 };
+    Atomic<int> jobsRemaining { 0 };
+
+    void runJobs() noexcept;
+    void stopWorkers();
+    void startWorkers();
+    void updateMemoryLock();
+    int getWorkerPriority() const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WorkerPool)
+};
+
+}
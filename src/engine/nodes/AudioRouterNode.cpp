@@ -162,18 +162,6 @@ MatrixState AudioRouterNode::getMatrixState() const
 void AudioRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     jassert (midi.getNumBuffers() == 1);
-    const auto& midiBuffer = *midi.getReadBuffer (0);
-
-    MidiBuffer::Iterator iter (midiBuffer);
-    MidiMessage msg; int midiFrame = 0;
-    
-    while (iter.getNextEvent (msg, midiFrame))
-    {
-        if (! msg.isProgramChange())
-            continue;
-        if (3 == msg.getProgramChangeNumber())
-            { DBG("program "); }
-    }
 
     const int numFrames = audio.getNumSamples();
     const int numChannels = audio.getNumChannels();
@@ -208,111 +196,52 @@ void AudioRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 
     if (fadeIn.isActive() || fadeOut.isActive())
     {
-        auto framesToProcess = numFrames;
-        int frame = 0;
         ScopedLock sl (lock);
-        
-        float fadeInGain  = 0.0f;
-        float fadeOutGain = 1.0f;
 
-        while (--framesToProcess >= 0)
+        // one gain ramp per direction for the whole block, shared by every
+        // route that is fading
+        fadeGains.setSize (2, numFrames, false, false, true);
+        float* const fadeInGains  = fadeGains.getWritePointer (0);
+        float* const fadeOutGains = fadeGains.getWritePointer (1);
+        for (int frame = 0; frame < numFrames; ++frame)
         {
-            fadeInGain  = fadeIn.isActive()  ? fadeIn.getNextEnvelopeValue()  : 1.0f;
-            fadeOutGain = fadeOut.isActive() ? fadeOut.getNextEnvelopeValue() : 0.0f;
-
-            if (!fadeIn.isActive() && !fadeOut.isActive())
-            {
-                TRACE_AUDIO_ROUTER("last frame fade in gain  : " << fadeInGain);
-                TRACE_AUDIO_ROUTER("last frame fade out gain : " << fadeOutGain);
-            }
-
-            for (int i = 0; i < numSources; ++i)
-            {
-                for (int j = 0; j < numDestinations; ++j)
-                {
-                    if (toggles.get (i, j) && nextToggles.get (i, j))
-                    {
-                        // no patch change and on means 1 to 1 mix
-                        tempAudio.getWritePointer(j)[frame] += 
-                            audio.getReadPointer(i)[frame];
-                    }
-                    else if (! toggles.get (i, j) && ! nextToggles.get (i, j))
-                    {
-                        // no patch change and off means no fade and zero'd
-                        tempAudio.getWritePointer(j)[frame] += 0.0f;
-                    }
-                    else if (!toggles.get (i, j) && nextToggles.get (i, j))
-                    {
-                        tempAudio.getWritePointer(j)[frame] += 
-                            (audio.getReadPointer(i)[frame] * fadeInGain);
-                    }
-                    else if (toggles.get (i, j) && !nextToggles.get (i, j))
-                    {
-                        tempAudio.getWritePointer(j)[frame] += 
-                            (audio.getReadPointer(i)[frame] * fadeOutGain);
-                    }
-                }
-            }
-
-            ++frame;
-
-            if (!fadeIn.isActive() && !fadeOut.isActive())
-                break;
+            fadeInGains[frame]  = fadeIn.isActive()  ? fadeIn.getNextEnvelopeValue()  : 1.0f;
+            fadeOutGains[frame] = fadeOut.isActive() ? fadeOut.getNextEnvelopeValue() : 0.0f;
         }
 
-        if (!fadeOut.isActive() && !fadeIn.isActive())
-        {
-            TRACE_AUDIO_ROUTER("fade stopped @ frame: " << (frame));
-            TRACE_AUDIO_ROUTER("fade in level  : " << fadeInGain);
-            TRACE_AUDIO_ROUTER("fade out level : " << fadeOutGain);
+        ToggleGrid::forEachChange (toggles, nextToggles, [&] (int i, int j, ToggleGrid::Change change) {
+            if (i >= numSources || j >= numDestinations)
+                return;
 
-            if (framesToProcess > 0)
+            float* const dst = tempAudio.getWritePointer (j);
+            const float* const src = audio.getReadPointer (i);
+            switch (change)
             {
-                TRACE_AUDIO_ROUTER("rendering " << framesToProcess << " remainging frames");
-                for (int i = 0; i < numSources; ++i)
-                {
-                    for (int j = 0; j < numDestinations; ++j)
-                    {
-                        if (toggles.get(i, j) && nextToggles.get (i, j))
-                        {
-                            // no patch change and on means 1 to 1 mix
-                            tempAudio.addFrom (j, frame, audio.getReadPointer (i, frame), 
-                                               framesToProcess);
-                        }
-                        else if (! toggles.get (i, j) && ! nextToggles.get (i, j))
-                        {
-                            // patch not changed and of, so clear the out channel.
-                            // nothing to do
-                        }
-                        else if (!toggles.get (i, j) && nextToggles.get (i, j))
-                        {
-                            tempAudio.addFromWithRamp (j, frame, audio.getReadPointer (i, frame), 
-                                                          framesToProcess, fadeInGain, 1.0f);
-                        }
-                        else if (toggles.get (i, j) && !nextToggles.get (i, j))
-                        {
-                            tempAudio.addFromWithRamp (j, frame, audio.getReadPointer (i, frame),
-                                                          framesToProcess, fadeOutGain, 0.0f);
-                        }
-                        else
-                        {
-                            // this would be an unhandled fading scenario
-                            jassertfalse;
-                        }
-                    }
-                }
+                case ToggleGrid::Steady:
+                    FloatVectorOperations::add (dst, src, numFrames);
+                    break;
+                case ToggleGrid::FadeIn:
+                    FloatVectorOperations::addWithMultiply (dst, src, fadeInGains, numFrames);
+                    break;
+                case ToggleGrid::FadeOut:
+                    FloatVectorOperations::addWithMultiply (dst, src, fadeOutGains, numFrames);
+                    break;
             }
+        });
 
+        if (! fadeOut.isActive() && ! fadeIn.isActive())
+        {
+            TRACE_AUDIO_ROUTER("fade stopped");
             toggles.swapWith (nextToggles);
         }
     }
     else
     {
         ScopedLock sl (lock);
-        for (int i = 0; i < numSources; ++i)
-            for (int j = 0; j < numDestinations; ++j)
-                if (toggles.get (i, j))
-                    tempAudio.addFrom (j, 0, audio, i, 0, numFrames);
+        toggles.forEachRoute ([&] (int i, int j) {
+            if (i < numSources && j < numDestinations)
+                tempAudio.addFrom (j, 0, audio, i, 0, numFrames);
+        });
     }
 
     for (int c = 0; c < numChannels; ++c)
@@ -117,6 +117,7 @@ private:
     int numSources, nextNumSources;
     int numDestinations, nextNumDestinations;
     AudioSampleBuffer tempAudio { 1, 1 };
+    AudioSampleBuffer fadeGains { 2, 1 };
     bool rebuildPorts = true;
 
     struct Program
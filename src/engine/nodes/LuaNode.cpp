@@ -24,23 +24,17 @@
 
 #include "ElementApp.h"
 #include "engine/nodes/LuaNode.h"
+#include "engine/GraphProcessor.h"
 #include "engine/MidiPipe.h"
 #include "engine/Parameter.h"
+#include "scripting/BytecodeCache.h"
+#include "scripting/LuaAllocator.h"
 #include "scripting/LuaBindings.h"
+#include "scripting/LuaStatePool.h"
 
 #define EL_LUA_DBG(x)
 // #define EL_LUA_DBG(x) DBG(x)
 
-static const String initScript = 
-R"(
-require ('kv.AudioBuffer')
-require ('kv.MidiBuffer')
-require ('kv.MidiMessage')
-require ('kv.midi')
-require ('kv.audio')
-require ('el.MidiPipe')
-)";
-
 static const String stereoAmpScript = 
 R"(--- Stereo Amplifier in Lua
 --
@@ -169,9 +163,13 @@ private:
 //=============================================================================
 struct LuaNode::Context
 {
-    explicit Context ()
+    explicit Context()
+        : pooled (statePool->acquire()),
+          allocator (pooled->getAllocator()),
+          state (pooled->getState())
     {
         L = state.lua_state();
+        resetParameters();
     }
 
     ~Context()
@@ -188,13 +186,17 @@ struct LuaNode::Context
         luaL_unref (state, LUA_REGISTRYINDEX, audioBufRef);
         midiPipe = nullptr;
         luaL_unref (state, LUA_REGISTRYINDEX, midiPipeRef);
-        state.collect_garbage();
+        renderf = sol::function();
+        statePool->recycle (std::move (pooled));
     }
 
     String getName() const { return name; }
 
     bool ready() const { return loaded; }
 
+    /** Returns true if the script set node_parallel */
+    bool isParallel() const { return parallel; }
+
     Result load (const String& script)
     {
         if (ready())
@@ -203,35 +205,55 @@ struct LuaNode::Context
         String errorMsg;
         try
         {
-            Lua::initializeState (state);
-            auto res = state.script (initScript.toRawUTF8());
-            if (res.valid())
-                res = state.script (script.toRawUTF8());
-            if (res.valid())
+            // the pooled state comes with the bindings and DSP modules. Validating
+            // and loading compile the same code, so it's only parsed once
+            SharedResourcePointer<BytecodeCache> cache;
+            auto chunk = cache->load (state, script, "=LuaNode");
+            if (! chunk.valid())
             {
-                bool ok = false;
-                if (lua_getglobal (state, "node_render") == LUA_TFUNCTION)
-                {
-                    renderRef = luaL_ref (state, LUA_REGISTRYINDEX);
-                    ok = renderRef != LUA_REFNIL && renderRef != LUA_NOREF;
-                }
+                sol::error error = chunk;
+                throw error;
+            }
 
-                if (ok)
-                {
-                    audioBuffer = kv::lua::new_userdata<AudioBuffer<float>> (state, LKV_MT_AUDIO_BUFFER_32);
-                    audioBufRef = luaL_ref (state, LUA_REGISTRYINDEX);
-                    ok = audioBufRef != LUA_REFNIL && audioBufRef != LUA_NOREF;
-                }
+            sol::protected_function run = chunk;
+            auto res = run();
+            if (! res.valid())
+            {
+                sol::error error = res;
+                throw error;
+            }
 
-                if (ok)
-                {
-                    midiPipe = LuaMidiPipe::create (L, 4);
-                    midiPipeRef = luaL_ref (state, LUA_REGISTRYINDEX);
-                    ok = midiPipeRef != LUA_REFNIL && midiPipeRef != LUA_NOREF;
-                }
+            // parallel scripts render on engine workers, away from the session
+            parallel = state["node_parallel"].get_or (false);
+            if (parallel && ! Lua::isolateState (state))
+                throw std::runtime_error ("parallel scripts can't use the session modules");
 
-                loaded = ok;
+            bool ok = false;
+            if (lua_getglobal (state, "node_render") == LUA_TFUNCTION)
+            {
+                renderRef = luaL_ref (state, LUA_REGISTRYINDEX);
+                ok = renderRef != LUA_REFNIL && renderRef != LUA_NOREF;
             }
+
+            if (ok)
+            {
+                audioBuffer = kv::lua::new_userdata<AudioBuffer<float>> (state, LKV_MT_AUDIO_BUFFER_32);
+                audioBufRef = luaL_ref (state, LUA_REGISTRYINDEX);
+                ok = audioBufRef != LUA_REFNIL && audioBufRef != LUA_NOREF;
+            }
+
+            if (ok)
+            {
+                midiPipe = LuaMidiPipe::create (L, 4);
+                midiPipeRef = luaL_ref (state, LUA_REGISTRYINDEX);
+                ok = midiPipeRef != LUA_REFNIL && midiPipeRef != LUA_NOREF;
+            }
+
+            loaded = ok;
+
+            // from here on garbage is collected in steps after rendering
+            state.collect_garbage();
+            LuaAllocator::stopCollector (L);
         }
         catch (const std::exception& e)
         {
@@ -257,6 +279,18 @@ struct LuaNode::Context
                 ? errorMsg : String("unknown error in script"));
     }
 
+    /** Validate and load a script, then prepare it like the node. This
+        doesn't touch the node, so it can run on any thread */
+    Result build (const String& script, bool shouldPrepare, double rate, int block)
+    {
+        auto result = validate (script);
+        if (result.wasOk())
+            result = load (script);
+        if (result.wasOk() && shouldPrepare)
+            prepare (rate, block);
+        return result;
+    }
+
     static Result validate (const String& script)
     {
         if (script.isEmpty())
@@ -381,7 +415,7 @@ struct LuaNode::Context
         state.collect_garbage();
     }
 
-    void render (AudioSampleBuffer& audio, MidiPipe& midi) noexcept
+    void render (AudioSampleBuffer& audio, MidiPipe& midi)
     {
         if (! loaded)
             return;
@@ -400,11 +434,25 @@ struct LuaNode::Context
                     // (*audioBuffer)->setSize (audio.getNumChannels(), audio.getNumSamples(), true, false, true);
                     (*audioBuffer)->setDataToReferTo (audio.getArrayOfWritePointers(),
                             audio.getNumChannels(), audio.getNumSamples());
-                    (*midiPipe)->swapWith (midi);
+                    (*midiPipe)->referTo (&midi);
+                    syncParameters();
 
-                    lua_call (L, 2, 0);
-                    
-                    (*midiPipe)->swapWith (midi);
+                    if (profiler != nullptr)
+                        profiler->begin (L, &allocator);
+
+                    // a protected call, so the pipe never outlives the block
+                    if (lua_pcall (L, 2, 0, 0) != LUA_OK)
+                    {
+                        lua_pop (L, 1);
+                        audio.clear();
+                        midi.clear();
+                    }
+
+                    if (profiler != nullptr)
+                        profiler->end (L);
+
+                    (*midiPipe)->referTo (nullptr);
+                    allocator.step (L);
                 }
             }
         }
@@ -415,6 +463,11 @@ struct LuaNode::Context
 #endif
     }
     
+    const LuaAllocator& getAllocator() const noexcept { return allocator; }
+
+    /** Times render calls when set, owned by the node */
+    LuaProfiler* profiler = nullptr;
+
     const OwnedArray<PortDescription>& getPortArray() const noexcept
     {
         return ports.getPorts();
@@ -440,6 +493,20 @@ struct LuaNode::Context
         paramData[index] = value;
     }
 
+    /** Picks up values set on the parameters without notifying listeners,
+        like the mapped changes a graph applies at the start of a block */
+    void syncParameters() noexcept
+    {
+        for (auto* const ip : inParams)
+        {
+            auto* const param = static_cast<LuaParameter*> (ip);
+            const int channel = param->getPortChannel();
+            const float value = param->get();
+            if (value != paramSynced[channel])
+                paramData[channel] = paramSynced[channel] = value;
+        }
+    }
+
     void getParameterData (MemoryBlock& block) const
     {
         block.append (paramData, sizeof(float) * (size_t) inParams.size());
@@ -532,12 +599,16 @@ struct LuaNode::Context
     }
 
 private:
-    sol::state state;
+    SharedResourcePointer<LuaStatePool> statePool;
+    std::unique_ptr<LuaStatePool::State> pooled;
+    LuaAllocator& allocator;
+    sol::state& state;
     lua_State* L { nullptr };
     sol::function renderf;
     std::function<void(AudioSampleBuffer&, MidiPipe&)> renderstdf;
     String name;
     bool loaded = false;
+    bool parallel = false;
 
     int renderRef   = LUA_NOREF;
     int audioBufRef = LUA_NOREF;
@@ -552,6 +623,7 @@ private:
     enum { maxParams = 512 };
     float paramData [maxParams];
     float paramDataOut [maxParams];
+    float paramSynced [maxParams];      // parameter values last copied to paramData
 
     LuaParameter* findParameter (const PortDescription& port) const
     {
@@ -568,6 +640,7 @@ private:
     void resetParameters() noexcept
     {
         memset (paramData, 0, sizeof(float) * (size_t) maxParams);
+        memset (paramSynced, 0, sizeof(float) * (size_t) maxParams);
     }
 
     void addParameters()
@@ -704,20 +777,20 @@ void LuaParameter::controlTouched (int, bool) {}
 LuaNode::LuaNode() noexcept
     : GraphNode (0)
 {
-    context = std::make_unique<Context>();
+    auto context = std::make_unique<Context>();
+    context->profiler = &profiler;
+    contexts.publish (std::move (context));
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, EL_INTERNAL_FORMAT_NAME, nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_LUA, nullptr);
     loadScript (stereoAmpScript);
 }
 
-LuaNode::~LuaNode()
-{
-    context.reset();
-}
+LuaNode::~LuaNode() { }
 
 void LuaNode::createPorts()
 {
+    auto* const context = contexts.getContext();
     if (context == nullptr)
         return;
     ports.clearQuick();
@@ -726,37 +799,63 @@ void LuaNode::createPorts()
 
 Parameter::Ptr LuaNode::getParameter (const PortDescription& port)
 {
-    return context->getParameter (port);
+    return contexts.getContext()->getParameter (port);
 }
 
 Result LuaNode::loadScript (const String& newScript)
 {
-    auto result = Context::validate (newScript);
-    if (result.failed())
-        return result;
-    
     auto newContext = std::make_unique<Context>();
-    result = newContext->load (newScript);
-
+    auto result = newContext->build (newScript, prepared, sampleRate, blockSize);
     if (result.wasOk())
-    {
-        script = draftScript = newScript;
-        if (prepared)
-            newContext->prepare (sampleRate, blockSize);
-        triggerPortReset();
-        ScopedLock sl (lock);
-        if (context != nullptr)
-            newContext->copyParameterValues (*context);
-        context.swap (newContext);
-    }
+        swapContext (newScript, std::move (newContext), prepared, sampleRate, blockSize);
+    return result;
+}
 
-    if (newContext != nullptr)
-    {
-        newContext->release();
-        newContext.reset();
-    }
+void LuaNode::loadScriptAsync (const String& newScript, std::function<void (const Result&)> callback)
+{
+    const bool wasPrepared = prepared;
+    const double rate = sampleRate;
+    const int block = blockSize;
+
+    contexts.compile (
+        [newScript, wasPrepared, rate, block] (Context& context) {
+            return context.build (newScript, wasPrepared, rate, block);
+        },
+        [this, newScript, wasPrepared, rate, block, callback] (const Result& result, std::unique_ptr<Context> context) {
+            if (context != nullptr)
+                swapContext (newScript, std::move (context), wasPrepared, rate, block);
+            if (callback)
+                callback (result);
+        });
+}
 
-    return result;
+void LuaNode::swapContext (const String& newScript, std::unique_ptr<Context> newContext,
+                           bool wasPrepared, double rate, int block)
+{
+    // the node may have been prepared or released while compiling
+    const bool sameSetup = wasPrepared == prepared && rate == sampleRate && block == blockSize;
+    if (wasPrepared && ! sameSetup)
+        newContext->release();
+    if (prepared && ! sameSetup)
+        newContext->prepare (sampleRate, blockSize);
+
+    script = draftScript = newScript;
+    if (auto* const oldContext = contexts.getContext())
+        newContext->copyParameterValues (*oldContext);
+    newContext->profiler = &profiler;
+    profiler.reset();
+
+    // blocks already decide from the context they render, the graph only
+    // needs to regroup its nodes
+    const bool wasParallel = isParallelSafe();
+    const bool nowParallel = newContext->isParallel();
+    contexts.publish (std::move (newContext));
+    parallel.set (nowParallel ? 1 : 0);
+
+    if (wasParallel != nowParallel)
+        if (auto* const graph = getParentGraph())
+            graph->triggerAsyncUpdate();
+    triggerPortReset();
 }
 
 void LuaNode::fillInPluginDescription (PluginDescription& desc)
@@ -780,7 +879,9 @@ void LuaNode::prepareToRender (double rate, int block)
         return;
     sampleRate = rate;
     blockSize = block;
-    context->prepare (sampleRate, blockSize);
+    contexts.getContext()->prepare (sampleRate, blockSize);
+    contexts.prepare (sampleRate, jmax (getNumPorts (PortType::Audio, true),
+                                        getNumPorts (PortType::Audio, false)), blockSize);
     prepared = true;
 }
 
@@ -789,13 +890,20 @@ void LuaNode::releaseResources()
     if (! prepared)
         return;
     prepared = false;
-    context->release();
+    contexts.getContext()->release();
+    contexts.release();
+}
+
+bool LuaNode::beginParallelRender()
+{
+    // decide from the contexts this block renders, not the flag, which a
+    // swap can change before the worker gets to the node
+    return contexts.pin ([] (const Context& context) { return context.isParallel(); });
 }
 
 void LuaNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
-    ScopedLock sl (lock);
-    context->render (audio, midi);
+    contexts.render (audio, midi);
 }
 
 void LuaNode::setState (const void* data, int size)
@@ -813,7 +921,7 @@ void LuaNode::setState (const void* data, int size)
                 const var& params = state.getProperty ("params");
                 if (params.isBinaryData())
                     if (auto* block = params.getBinaryData())
-                        context->setParameterData (*block);
+                        contexts.getContext()->setParameterData (*block);
             }
 
             if (state.hasProperty ("data"))
@@ -821,9 +929,12 @@ void LuaNode::setState (const void* data, int size)
                 const var& data = state.getProperty ("data");
                 if (data.isBinaryData())
                     if (auto* block = data.getBinaryData())
-                        context->setState (block->getData(), block->getSize());
+                        contexts.getContext()->setState (block->getData(), block->getSize());
             }
         }
+
+        if (state.hasProperty ("crossfade"))
+            setCrossfadeTime ((double) state.getProperty ("crossfade"));
         sendChangeMessage();
     }
 }
@@ -832,8 +943,10 @@ void LuaNode::getState (MemoryBlock& block)
 {
     ValueTree state ("LuaNodeState");
     state.setProperty ("script", script, nullptr)
-         .setProperty ("draft",  draftScript, nullptr);
+         .setProperty ("draft",  draftScript, nullptr)
+         .setProperty ("crossfade", getCrossfadeTime(), nullptr);
 
+    auto* const context = contexts.getContext();
     MemoryBlock scriptBlock;
     context->getParameterData (scriptBlock);
     if (scriptBlock.getSize() > 0)
@@ -851,10 +964,21 @@ void LuaNode::getState (MemoryBlock& block)
     }
 }
 
+LuaAllocator::Stats LuaNode::getMemoryStats() const
+{
+    auto* const context = contexts.getContext();
+    return context != nullptr ? context->getAllocator().getStats() : LuaAllocator::Stats();
+}
+
+String LuaNode::getMemoryStatusText() const
+{
+    auto* const context = contexts.getContext();
+    return context != nullptr ? context->getAllocator().getStatusText() : String();
+}
+
 void LuaNode::setParameter (int index, float value)
 {
-    ScopedLock sl (lock);
-    context->setParameter (index, value);
+    contexts.getContext()->setParameter (index, value);
 }
 
 }
@@ -20,7 +20,10 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/nodes/ScriptHotSwap.h"
 #include "engine/GraphNode.h"
+#include "scripting/LuaAllocator.h"
+#include "scripting/LuaProfiler.h"
 
 namespace Element {
 
@@ -39,16 +42,53 @@ public:
     void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override;
     void render (AudioSampleBuffer& audio, MidiPipe& midi) override;
+
+    /** Returns true if the running script declared itself parallel safe
+        with node_parallel = true */
+    bool isParallelSafe() const override { return parallel.get() == 1; }
+    bool beginParallelRender() override;
     void setState (const void* data, int size) override;
     void getState (MemoryBlock& block) override;
     
+    /** Compile a script and swap it in. This blocks until the script
+        is compiled, but never holds up rendering */
     Result loadScript (const String&);
 
+    /** Compile a script on a background thread, then swap it in. The
+        callback gets the result on the message thread */
+    void loadScriptAsync (const String&, std::function<void (const Result&)> callback = nullptr);
+
+    /** Returns true while a script is compiling in the background */
+    bool isCompiling() const { return contexts.isCompiling(); }
+
+    /** Set how long the old and new scripts are crossfaded when a script
+        is swapped in during playback. Zero swaps immediately */
+    void setCrossfadeTime (double seconds) { contexts.setFadeTime (seconds); }
+
+    /** Returns the crossfade time in seconds */
+    double getCrossfadeTime() const { return contexts.getFadeTime(); }
+
     const String& getScript() const { return script; }
     const String& getDraftScript() const { return draftScript; }
     void setDraftScript (const String& draft) { draftScript = draft; }
     bool hasChanges() const { return script.hashCode64() != draftScript.hashCode64(); }
 
+    /** Returns memory pool and garbage collection measurements of the
+        running script. Message thread only */
+    LuaAllocator::Stats getMemoryStats() const;
+
+    /** Returns the memory measurements as a line of text */
+    String getMemoryStatusText() const;
+
+    /** Turn the profiler on or off for the running script */
+    void setProfiling (bool shouldProfile) { profiler.setEnabled (shouldProfile); }
+
+    /** Returns true if the running script is being profiled */
+    bool isProfiling() const { return profiler.isEnabled(); }
+
+    /** Returns the profiler that times the running script */
+    LuaProfiler& getProfiler() noexcept { return profiler; }
+
     /** Set a parameter value by index
      
         @param index    The parameter index to set
@@ -66,9 +106,12 @@ private:
     int blockSize = 512;
     double sampleRate = 44100.0;
     bool prepared = false;
-    CriticalSection lock;
-    std::unique_ptr<Context> context;
+    LuaProfiler profiler;
+    ScriptHotSwap<Context> contexts;
     ParameterArray inParams, outParams;
+    Atomic<int> parallel { 0 };
+
+    void swapContext (const String&, std::unique_ptr<Context>, bool wasPrepared, double rate, int block);
 };
 
 }
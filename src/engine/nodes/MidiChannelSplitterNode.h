@@ -20,6 +20,7 @@
 #pragma once
 
 #include "engine/nodes/MidiFilterNode.h"
+#include "engine/MidiKernels.h"
 #include "engine/MidiPipe.h"
 #include "engine/nodes/BaseProcessor.h"
 
@@ -66,16 +67,7 @@ public:
         }
         
         MidiBuffer& input (*midi.getWriteBuffer (0));
-        MidiBuffer::Iterator iter (input);
-        MidiMessage msg; int frame = 0;
-
-        while (iter.getNextEvent (msg, frame))
-        {
-            if (msg.getChannel() <= 0)
-                continue;
-            buffers[msg.getChannel() - 1]->addEvent (msg, frame);
-        }
-
+        MidiKernels::splitByChannel (input, buffers);
         input.swapWith (tempMidi);
         tempMidi.clear();
     }
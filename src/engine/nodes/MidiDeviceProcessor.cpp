@@ -214,12 +214,10 @@ void MidiDeviceProcessor::prepareToPlay (double sampleRate, int maximumExpectedS
     }
     else
     {
-        output = MidiOutput::openDevice (deviceIdx);
-        if (output)
+        if (auto device = MidiOutput::openDevice (deviceIdx))
         {
-            output->clearAllPendingMessages();
-            output->startBackgroundThread();
-        } 
+            output = midi.getOutputScheduler().openPort (std::move (device));
+        }
         else
         {
             DBG("[EL] could not open MIDI output: " << deviceIdx << ": " << deviceName);
@@ -240,11 +238,11 @@ void MidiDeviceProcessor::processBlock (AudioBuffer<float>& audio, MidiBuffer& m
     }
     else
     {
-        if (output && ! midi.isEmpty())
+        if (output != nullptr && ! midi.isEmpty())
         {
             const auto delayMs = midiOutLatency.get();
-            output->sendBlockOfMessages (
-                midi, delayMs + Time::getMillisecondCounterHiRes(), getSampleRate());
+            this->midi.getOutputScheduler().send (output, midi,
+                delayMs + Time::getMillisecondCounterHiRes(), getSampleRate());
         }
 
         midi.clear (0, nframes);
@@ -263,9 +261,9 @@ void MidiDeviceProcessor::releaseResources()
         input = nullptr;
     }
 
-    if (output)
+    if (output != nullptr)
     {
-        output->stopBackgroundThread();
+        midi.getOutputScheduler().closePort (output);
         output = nullptr;
     }
 }
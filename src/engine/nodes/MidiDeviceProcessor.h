@@ -20,6 +20,7 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/MidiOutputScheduler.h"
 
 namespace Element {
 
@@ -138,7 +139,7 @@ private:
     String deviceName;
     MidiMessageCollector inputMessages;
     std::unique_ptr<MidiInput> input;
-    std::unique_ptr<MidiOutput> output;
+    MidiOutputScheduler::Port* output = nullptr;
     Atomic<double> midiOutLatency { 0.0 };
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiDeviceProcessor);
 };
@@ -19,6 +19,7 @@
 */
 
 #include "engine/nodes/MidiMonitorNode.h"
+#include "engine/MidiKernels.h"
 
 namespace Element {
 
@@ -28,7 +29,8 @@ MidiMonitorNode::MidiMonitorNode()
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_MIDI_MONITOR, nullptr);
-    midiTemp.ensureSize (3 * 32);
+    scratch.calloc ((size_t) ring.getTotalSize());
+    setHistorySize (10000);
 }
 
 MidiMonitorNode::~MidiMonitorNode()
@@ -39,9 +41,8 @@ MidiMonitorNode::~MidiMonitorNode()
 
 void MidiMonitorNode::prepareToRender (double sampleRate, int maxBufferSize)
 {
-    inputMessages.reset (sampleRate);
+    ignoreUnused (maxBufferSize);
     currentSampleRate = sampleRate;
-    numSamples = 0;
     startTimerHz (refreshRateHz);
 };
 
@@ -50,86 +51,152 @@ void MidiMonitorNode::releaseResources()
     stopTimer();
 }
 
+int MidiMonitorNode::getMessageType (const uint8* data, int size) noexcept
+{
+    if (size <= 0)
+        return otherMessages;
+
+    switch (data[0] & 0xf0)
+    {
+        case 0x80:
+        case 0x90: return noteMessages;
+        case 0xb0: return controllerMessages;
+        case 0xc0: return programMessages;
+        case 0xe0: return pitchMessages;
+        case 0xa0:
+        case 0xd0: return pressureMessages;
+        default: break;
+    }
+
+    switch (data[0])
+    {
+        case 0xf0: return sysexMessages;
+        case 0xf8: return clockMessages;
+        case 0xfa:
+        case 0xfb:
+        case 0xfc: return transportMessages;
+        default: break;
+    }
+
+    return otherMessages;
+}
+
 void MidiMonitorNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
-    auto timestamp = Time::getMillisecondCounterHiRes();
     const auto nframes = audio.getNumSamples();
-
     if (nframes == 0)
         return;
 
-    auto* const midiIn = midi.getWriteBuffer (0);
-    MidiBuffer::Iterator iter (*midiIn);
-    MidiMessage msg;
-    int frame;
+    const double timestamp = Time::getMillisecondCounterHiRes();
+    const double msPerFrame = 1000.0 / currentSampleRate;
+    const int types = typeFilter.get();
+    const int channels = channelFilter.get();
+
+    MidiKernels::forEach (*midi.getReadBuffer (0), [&] (const uint8* data, int size, int frame) {
+        if ((getMessageType (data, size) & types) == 0)
+            return;
+        const int channel = MidiKernels::getChannel (data);
+        if (channel > 0 && (channels & (1 << (channel - 1))) == 0)
+            return;
+        capture (data, size, timestamp + msPerFrame * (double) frame);
+    });
+}
 
-    ScopedLock sl (lock);
-    while (iter.getNextEvent (msg, frame))
-    {
-        msg.setTimeStamp (timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)));
-        inputMessages.addMessageToQueue (msg);
-    }
+void MidiMonitorNode::capture (const uint8* data, int size, double time) noexcept
+{
+    if (! ring.write (Header { time, (int32) size }, data, size))
+        numDropped.set (numDropped.get() + 1);
+}
 
-    numSamples += nframes;
+const MidiMessage& MidiMonitorNode::getLoggedMessage (int index) const noexcept
+{
+    jassert (isPositiveAndBelow (index, numLogged));
+    return history.getReference ((firstLogged + index) % history.size());
 }
 
-void MidiMonitorNode::getMessages (MidiBuffer& destBuffer)
+String MidiMonitorNode::describe (const MidiMessage& msg)
 {
-    ScopedLock sl (lock);
-    if (numSamples <= 0)
+    if (msg.isMidiStart())      return "Start";
+    if (msg.isMidiStop())       return "Stop";
+    if (msg.isMidiContinue())   return "Continue";
+    if (msg.isMidiClock())      return "Clock";
+    return msg.getDescription();
+}
+
+void MidiMonitorNode::setHistorySize (int newSize)
+{
+    newSize = jmax (1, newSize);
+    if (newSize == history.size())
         return;
-    inputMessages.removeNextBlockOfMessages (destBuffer, numSamples);
-    numSamples = 0;
+
+    // keep the newest messages that fit
+    Array<MidiMessage> resized;
+    resized.ensureStorageAllocated (newSize);
+    const int numKept = jmin (numLogged, newSize);
+    for (int i = numLogged - numKept; i < numLogged; ++i)
+        resized.add (getLoggedMessage (i));
+    while (resized.size() < newSize)
+        resized.add (MidiMessage());
+
+    history.swapWith (resized);
+    firstLogged = 0;
+    numLogged = numKept;
+    messagesLogged();
 }
 
 void MidiMonitorNode::clearMessages()
 {
-    midiLog.clearQuick();
-    {
-        ScopedLock sl (lock);
-        inputMessages.reset (currentSampleRate);
-        numSamples = 0;
-    }
+    // the message thread is the only reader
+    ring.discard();
+    firstLogged = numLogged = 0;
+    numDropped.set (0);
     messagesLogged();
 }
 
 void MidiMonitorNode::timerCallback()
 {
-    midiTemp.clear();
-    getMessages (midiTemp);
-    if (midiTemp.getNumEvents() <= 0)
+    Header header;
+    int numReady = ring.getNumReady();
+    if (numReady < (int) sizeof (Header))
         return;
 
-    MidiBuffer::Iterator iter (midiTemp);
-    MidiMessage msg; int frame = 0;
-
-    int numLogged = 0;
-    String text;
-    while (iter.getNextEvent (msg, frame))
+    const int capacity = history.size();
+    while (numReady >= (int) sizeof (Header))
     {
-        if (msg.isMidiClock())
-        {
-            text.clear();
-            continue;
-        }
-
-        if (msg.isMidiStart())
-            text << "Start";
-        else if (msg.isMidiStop())
-            text << "Stop";
-        else if (msg.isMidiContinue())
-            text << "Continue";
-        
-        midiLog.add (text.isNotEmpty() ? text : msg.getDescription());
-        text.clear();
-        ++numLogged;
+        ring.read (&header, (int) sizeof (Header));
+        ring.read (scratch.get(), header.size);
+        numReady -= (int) sizeof (Header) + header.size;
+
+        const int index = (firstLogged + numLogged) % capacity;
+        history.getReference (index) = MidiMessage (scratch.get(), header.size, header.time);
+        if (numLogged < capacity)
+            ++numLogged;
+        else
+            firstLogged = (firstLogged + 1) % capacity;
     }
 
-    if (midiLog.size() > maxLoggedMessages)
-        midiLog.removeRange (0, midiLog.size() - maxLoggedMessages);
+    messagesLogged();
+}
 
-    if (numLogged > 0)
-        messagesLogged();
+void MidiMonitorNode::getState (MemoryBlock& block)
+{
+    ValueTree state ("MidiMonitorState");
+    state.setProperty ("historySize", getHistorySize(), nullptr)
+         .setProperty ("types", getTypeFilter(), nullptr)
+         .setProperty ("channels", getChannelFilter(), nullptr);
+    MemoryOutputStream stream (block, false);
+    state.writeToStream (stream);
 }
 
-};
+void MidiMonitorNode::setState (const void* data, int size)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) size);
+    if (! state.hasType ("MidiMonitorState"))
+        return;
+
+    setHistorySize (state.getProperty ("historySize", getHistorySize()));
+    setTypeFilter (state.getProperty ("types", getTypeFilter()));
+    setChannelFilter (state.getProperty ("channels", getChannelFilter()));
+}
+
+}
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "engine/ByteRing.h"
 #include "engine/MidiPipe.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
@@ -49,6 +50,21 @@ public:
         desc.version            = "1.0.0";
     }
 
+    /** Kinds of message that can be captured */
+    enum MessageType
+    {
+        noteMessages        = 1 << 0,
+        controllerMessages  = 1 << 1,
+        programMessages     = 1 << 2,
+        pitchMessages       = 1 << 3,
+        pressureMessages    = 1 << 4,
+        clockMessages       = 1 << 5,
+        transportMessages   = 1 << 6,
+        sysexMessages       = 1 << 7,
+        otherMessages       = 1 << 8,
+        allMessages         = (1 << 9) - 1
+    };
+
     void clear() {};
 
     void prepareToRender (double sampleRate, int maxBufferSize) override;
@@ -56,25 +72,69 @@ public:
 
     void render (AudioSampleBuffer& audio, MidiPipe& midi) override;
 
-    void setState (const void* data, int size) override {};
-    void getState (MemoryBlock& block) override {};
+    void setState (const void* data, int size) override;
+    void getState (MemoryBlock& block) override;
 
+    /** Discard the history and anything not yet logged */
     void clearMessages();
-    
-    const StringArray& getLog() const { return midiLog; }
+
+    /** Returns the number of messages in the history */
+    int getNumLogged() const noexcept { return numLogged; }
+
+    /** Returns a message from the history, oldest first. The timestamp is
+        in milliseconds on the Time::getMillisecondCounterHiRes() clock */
+    const MidiMessage& getLoggedMessage (int index) const noexcept;
+
+    /** Returns the text shown for a message in the log */
+    static String describe (const MidiMessage& message);
+
+    /** Set how many messages are kept. Older ones are discarded */
+    void setHistorySize (int newSize);
+
+    /** Returns how many messages are kept */
+    int getHistorySize() const noexcept { return history.size(); }
+
+    /** Set which kinds of message are captured, a combination of MessageType */
+    void setTypeFilter (int types) noexcept             { typeFilter.set (types & allMessages); }
+
+    /** Returns which kinds of message are captured */
+    int getTypeFilter() const noexcept                  { return typeFilter.get(); }
+
+    /** Set which channels are captured. Bit 0 is channel 1 */
+    void setChannelFilter (int channels) noexcept       { channelFilter.set (channels & 0xffff); }
+
+    /** Returns which channels are captured */
+    int getChannelFilter() const noexcept               { return channelFilter.get(); }
+
+    /** Returns the number of messages lost because the capture ring was full */
+    int getNumDropped() const noexcept                  { return numDropped.get(); }
+
+    /** Returns the MessageType of a raw message */
+    static int getMessageType (const uint8* data, int size) noexcept;
 
 private:
     friend class MidiMonitorNodeEditor;
-     Signal<void()> messagesLogged;
+    Signal<void()> messagesLogged;
     double currentSampleRate = 44100.0;
-    int numSamples = 0;
-    MidiMessageCollector inputMessages;
     bool createdPorts = false;
-    CriticalSection lock;
-    
-    MidiBuffer  midiTemp;
-    StringArray midiLog;
-    int maxLoggedMessages { 100 };
+
+    struct Header
+    {
+        double time;
+        int32 size;
+    };
+
+    // written by the audio thread, read by the timer
+    ByteRing ring { 1 << 18 };
+    HeapBlock<uint8> scratch;
+    Atomic<int> typeFilter { allMessages & ~clockMessages };
+    Atomic<int> channelFilter { 0xffff };
+    Atomic<int> numDropped { 0 };
+
+    // message thread only
+    Array<MidiMessage> history;
+    int firstLogged = 0;
+    int numLogged = 0;
     float refreshRateHz { 60.0 };
 
     inline void createPorts() override
@@ -88,7 +148,7 @@ private:
         createdPorts = true;
     }
 
-    void getMessages (MidiBuffer &destBuffer);
+    void capture (const uint8* data, int size, double time) noexcept;
     void timerCallback() override;
 };
 
@@ -18,6 +18,7 @@
 */
 
 #include "engine/nodes/MidiProgramMapNode.h"
+#include "engine/MidiKernels.h"
 
 namespace Element {
 
@@ -72,33 +73,21 @@ void MidiProgramMapNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
     auto* const midiIn = midi.getWriteBuffer (0);
 
     ScopedLock sl (lock);
-    MidiMessage msg; int frame = 0;
 
     if (! toSendMidi.isEmpty())
     {
-        MidiBuffer::Iterator iter1 (toSendMidi);
-        while (iter1.getNextEvent (msg, frame))
-            midiIn->addEvent (msg, frame);
+        MidiKernels::merge (*midiIn, toSendMidi, tempMidi);
         toSendMidi.clear();
     }
 
-    MidiBuffer::Iterator iter2 (*midiIn);
     int program = -1;
-
-    while (iter2.getNextEvent (msg, frame))
-    {
-        if (msg.isProgramChange() && programMap [msg.getProgramChangeNumber()] >= 0)
+    MidiKernels::forEach (*midiIn, [this, &program] (uint8* data, int size, int) {
+        if (size >= 2 && (data[0] & 0xf0) == 0xc0 && programMap [data[1] & 0x7f] >= 0)
         {
-            program = msg.getProgramChangeNumber();
-            tempMidi.addEvent (MidiMessage::programChange (
-                msg.getChannel(), programMap [msg.getProgramChangeNumber()]),
-                frame);
+            program = data[1] & 0x7f;
+            data[1] = static_cast<uint8> (programMap [program] & 0x7f);
         }
-        else
-        {
-            tempMidi.addEvent (msg, frame);
-        }
-    }
+    });
 
     if (program >= 0 && program != lastProgram)
     {
@@ -106,9 +95,7 @@ void MidiProgramMapNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
         triggerAsyncUpdate();
     }
 
-    midiIn->swapWith (tempMidi);
     traceMidi (*midiIn);
-    tempMidi.clear();
 }
 
 void MidiProgramMapNode::sendProgramChange (int program, int channel)
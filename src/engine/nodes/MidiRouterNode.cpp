@@ -19,6 +19,7 @@
 
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiRouterNode.h"
+#include "engine/MidiKernels.h"
 #include "Common.h"
 
 #define TRACE_MIDI_ROUTER(output) 
@@ -105,21 +106,14 @@ void MidiRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     jassert (midi.getNumBuffers() >= numDestinations);
     
-    const auto nsamples = audio.getNumSamples();
     const auto nbuffers = midi.getNumBuffers();
     audio.clear();
 
     ScopedLock sl (getLock());
-    for (int src = 0; src < numSources; ++src)
-    {
-        if (src >= nbuffers)
-            break;
-        
-        const auto& rb = *midi.getReadBuffer (src);
-        for (int dst = 0; dst < numDestinations; ++dst)
-            if (toggles.get (src, dst))
-                midiOuts.getUnchecked(dst)->addEvents (rb, 0, nsamples, 0);
-    }
+    toggles.forEachRoute ([&] (int src, int dst) {
+        if (src < jmin (numSources, nbuffers) && dst < numDestinations)
+            MidiKernels::merge (*midiOuts.getUnchecked (dst), *midi.getReadBuffer (src), tempMidi);
+    });
 
     for (int i = midiOuts.size(); --i >= 0;)
     {
@@ -182,6 +176,8 @@ void MidiRouterNode::initMidiOuts (OwnedArray<MidiBuffer>& outs)
         auto* const buf = outs.add (new MidiBuffer());
         buf->ensureSize (16 * 3);
     }
+
+    tempMidi.ensureSize (16 * 3);
 }
 
 }
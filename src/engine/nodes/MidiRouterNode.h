@@ -117,6 +117,7 @@ private:
     bool togglesChanged { false };
 
     OwnedArray<MidiBuffer> midiOuts;
+    MidiBuffer tempMidi;
     void initMidiOuts (OwnedArray<MidiBuffer>& outs);
 };
 
@@ -0,0 +1,350 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "engine/MidiPipe.h"
+
+namespace Element {
+
+/** The thread scripts are compiled on. Nodes hold it with a
+    SharedResourcePointer so they all queue on the same one */
+class ScriptCompiler : public ThreadPool
+{
+public:
+    ScriptCompiler() : ThreadPool (1) { }
+};
+
+/** Swaps compiled scripts in to a node's render path.
+
+    A new context is built on the ScriptCompiler thread and handed back on
+    the message thread, where the node finishes setting it up and calls
+    publish(). Publishing swaps an atomic pointer, so render() never takes
+    a lock. The context that was replaced is retired, and deleted on the
+    message thread once the audio thread has stopped using it.
+
+    When a context replaces another during playback, both are rendered for
+    a short crossfade instead of cutting over. The outgoing context renders
+    a copy of the input audio with no MIDI, and its MIDI output is dropped.
+
+    ContextType needs render (AudioSampleBuffer&, MidiPipe&) and release().
+    Exceptions thrown by render are caught and leave the block silent.
+ */
+template<class ContextType>
+class ScriptHotSwap : private AsyncUpdater,
+                      private Timer
+{
+public:
+    /** Builds a new context. Called on the compiler thread */
+    using Builder = std::function<Result (ContextType&)>;
+
+    /** Receives a built context on the message thread. The context is null
+        if building failed */
+    using Finisher = std::function<void (const Result&, std::unique_ptr<ContextType>)>;
+
+    ScriptHotSwap() = default;
+
+    ~ScriptHotSwap()
+    {
+        for (auto* job : jobs)
+            compiler->removeJob (job, true, -1);
+        cancelPendingUpdate();
+        stopTimer();
+        jobs.clear();
+        retired.clear();
+    }
+
+    /** Returns the context most recently published. Message thread only */
+    ContextType* getContext() const noexcept { return current.get(); }
+
+    /** Returns true while contexts are being built */
+    bool isCompiling() const noexcept { return numCompiling.get() > 0; }
+
+    /** Build a context on the compiler thread, then pass it to finish on
+        the message thread */
+    void compile (Builder build, Finisher finish)
+    {
+        auto* job = jobs.add (new CompileJob (*this, std::move (build), std::move (finish)));
+        numCompiling.set (numCompiling.get() + 1);
+        compiler->addJob (job, false);
+    }
+
+    /** Make a context the one that renders. Message thread only */
+    void publish (std::unique_ptr<ContextType> newContext)
+    {
+        if (current != nullptr)
+            retired.add (current.release());
+        current = std::move (newContext);
+        active.set (current.get());
+        collectRetired();
+    }
+
+    /** Set the crossfade length in seconds. Zero swaps with a hard cut */
+    void setFadeTime (double seconds) noexcept
+    {
+        fadeTime = jmax (0.0, seconds);
+        fadeLength.set (roundToInt (fadeTime * sampleRate));
+    }
+
+    /** Returns the crossfade length in seconds */
+    double getFadeTime() const noexcept { return fadeTime; }
+
+    /** Allocate crossfade buffers. Call when the node is prepared */
+    void prepare (double newSampleRate, int numChannels, int blockSize)
+    {
+        sampleRate = newSampleRate;
+        setFadeTime (fadeTime);
+        fadeAudio.setSize (jmax (2, numChannels), blockSize, false, true, false);
+        while (fadeMidi.size() < maxFadeMidi)
+            fadeMidi.add (new MidiBuffer())->ensureSize (512);
+    }
+
+    /** Forget what the audio thread was rendering and free retired
+        contexts. Call when the node is released, while render isn't */
+    void release()
+    {
+        fadeFrom = renderedLast = nullptr;
+        pinned = false;
+        fadeTotal = fadeRemaining = 0;
+        fading.set (nullptr);
+        rendering.set (nullptr);
+        collectRetired();
+    }
+
+    /** Pick the contexts the next render() uses, so a context published in
+        between can't take their place. Returns true if check passes for
+        every context the render will run. Call on the thread that owns
+        the node's rendering, before handing the render to another one */
+    template<class Check>
+    bool pin (Check check) noexcept
+    {
+        auto* const context = acquire();
+        pinned = true;
+        return context != nullptr && check (*context)
+            && (fadeFrom == nullptr || check (*fadeFrom));
+    }
+
+    /** Render the published context, or the ones pinned for this block,
+        crossfading from the one before it after a swap */
+    void render (AudioSampleBuffer& audio, MidiPipe& midi) noexcept
+    {
+        auto* const context = pinned ? renderedLast : acquire();
+        pinned = false;
+
+        if (context == nullptr)
+            return;
+
+        if (fadeFrom != nullptr && (audio.getNumChannels() > fadeAudio.getNumChannels()
+            || audio.getNumSamples() > fadeAudio.getNumSamples()
+            || midi.getNumBuffers() > fadeMidi.size()))
+        {
+            fadeFrom = nullptr;
+            fading.set (nullptr);
+        }
+
+        if (fadeFrom == nullptr)
+        {
+            renderContext (*context, audio, midi);
+            return;
+        }
+
+        const int numChannels = audio.getNumChannels();
+        const int numSamples  = audio.getNumSamples();
+        for (int c = 0; c < numChannels; ++c)
+            fadeAudio.copyFrom (c, 0, audio, c, 0, numSamples);
+
+        MidiBuffer* buffers [maxFadeMidi];
+        for (int i = 0; i < midi.getNumBuffers(); ++i)
+        {
+            buffers[i] = fadeMidi.getUnchecked (i);
+            buffers[i]->clear();
+        }
+
+        {
+            AudioSampleBuffer outgoing (fadeAudio.getArrayOfWritePointers(), numChannels, numSamples);
+            MidiPipe outgoingMidi (buffers, midi.getNumBuffers());
+            renderContext (*fadeFrom, outgoing, outgoingMidi);
+        }
+
+        renderContext (*context, audio, midi);
+
+        const float length = (float) fadeTotal;
+        const float startGain = 1.f - (float) fadeRemaining / length;
+        fadeRemaining = jmax (0, fadeRemaining - numSamples);
+        const float endGain = 1.f - (float) fadeRemaining / length;
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            audio.applyGainRamp (c, 0, numSamples, startGain, endGain);
+            audio.addFromWithRamp (c, 0, fadeAudio.getReadPointer (c), numSamples,
+                                   1.f - startGain, 1.f - endGain);
+        }
+
+        if (fadeRemaining == 0)
+        {
+            fadeFrom = nullptr;
+            fading.set (nullptr);
+        }
+    }
+
+private:
+    class CompileJob : public ThreadPoolJob
+    {
+    public:
+        CompileJob (ScriptHotSwap& s, Builder b, Finisher f)
+            : ThreadPoolJob ("ScriptCompile"), swap (s),
+              build (std::move (b)), finish (std::move (f)) { }
+
+        JobStatus runJob() override
+        {
+            context.reset (new ContextType());
+            result = build (*context);
+            if (result.failed())
+                context.reset();
+            finished = true;
+            swap.triggerAsyncUpdate();
+            return jobHasFinished;
+        }
+
+        ScriptHotSwap& swap;
+        Builder build;
+        Finisher finish;
+        Result result { Result::ok() };
+        std::unique_ptr<ContextType> context;
+        std::atomic<bool> finished { false };
+    };
+
+    enum { maxFadeMidi = 8 };
+
+    SharedResourcePointer<ScriptCompiler> compiler;
+    OwnedArray<CompileJob> jobs;
+    Atomic<int> numCompiling { 0 };
+
+    // message thread
+    std::unique_ptr<ContextType> current;
+    OwnedArray<ContextType> retired;
+    double sampleRate = 44100.0;
+    double fadeTime = 0.02;
+
+    // shared
+    Atomic<ContextType*> active { nullptr };
+    Atomic<ContextType*> rendering { nullptr };
+    Atomic<ContextType*> fading { nullptr };
+    Atomic<int> fadeLength { 0 };
+
+    // audio thread
+    ContextType* renderedLast = nullptr;
+    ContextType* fadeFrom = nullptr;
+    bool pinned = false;
+    int fadeTotal = 0;
+    int fadeRemaining = 0;
+    AudioSampleBuffer fadeAudio;
+    OwnedArray<MidiBuffer> fadeMidi;
+
+    /** Render one context. A script error leaves silence rather than
+        escaping the audio callback */
+    static void renderContext (ContextType& context, AudioSampleBuffer& audio, MidiPipe& midi) noexcept
+    {
+        try
+        {
+            context.render (audio, midi);
+        }
+        catch (...)
+        {
+            audio.clear();
+            midi.clear();
+        }
+    }
+
+    /** Marks the published context as in use and starts a fade if it
+        changed since the last render. Returns the context */
+    ContextType* acquire() noexcept
+    {
+        // hold on to the outgoing context for the fade before letting go of it
+        if (active.get() != renderedLast && renderedLast != nullptr)
+        {
+            // the length is kept, setFadeTime() may change it mid fade
+            fadeTotal = fadeLength.get();
+            fadeFrom = fadeTotal > 0 ? renderedLast : nullptr;
+            fadeRemaining = fadeTotal;
+            fading.set (fadeFrom);
+        }
+
+        // mark the context as in use, then make sure it wasn't retired
+        // before the mark was visible to the message thread
+        ContextType* context = nullptr;
+        do {
+            context = active.get();
+            rendering.set (context);
+        } while (context != active.get());
+        renderedLast = context;
+        return context;
+    }
+
+    /** Frees retired contexts the audio thread has finished with. The audio
+        thread marks a fade before moving the render mark, so reading them
+        in the opposite order can't miss a context in use */
+    void collectRetired()
+    {
+        auto* const inUse = rendering.get();
+        auto* const fadingOut = fading.get();
+        for (int i = retired.size(); --i >= 0;)
+        {
+            auto* const context = retired.getUnchecked (i);
+            if (context == inUse || context == fadingOut)
+                continue;
+            context->release();
+            retired.remove (i);
+        }
+
+        if (retired.isEmpty())
+            stopTimer();
+        else if (! isTimerRunning())
+            startTimer (25);
+    }
+
+    void timerCallback() override
+    {
+        collectRetired();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        for (;;)
+        {
+            // finish in the order compiles were asked for
+            CompileJob* job = jobs.getFirst();
+            if (job == nullptr || ! job->finished)
+                break;
+            jobs.removeObject (job, false);
+
+            compiler->removeJob (job, false, -1);
+            std::unique_ptr<CompileJob> deleter (job);
+            numCompiling.set (numCompiling.get() - 1);
+            if (job->finish)
+                job->finish (job->result, std::move (job->context));
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScriptHotSwap)
+};
+
+}
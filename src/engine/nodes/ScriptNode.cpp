@@ -25,93 +25,187 @@
 
 #include "ElementApp.h"
 #include "engine/nodes/ScriptNode.h"
+#include "engine/GraphProcessor.h"
 #include "engine/MidiPipe.h"
 #include "engine/Parameter.h"
-#include "scripting/LuaBindings.h"
 #include "scripting/DSPScript.h"
+#include "scripting/LuaBindings.h"
+#include "scripting/LuaStatePool.h"
 #include "scripting/Script.h"
 
 #define EL_LUA_DBG(x)
 // #define EL_LUA_DBG(x) DBG(x)
 
-static const String initScript = 
-R"(
-require ('kv.AudioBuffer')
-require ('kv.MidiBuffer')
-require ('kv.MidiMessage')
-require ('kv.midi')
-require ('kv.audio')
-require ('el.MidiPipe')
-)";
-
 namespace Element {
 
+//=============================================================================
+/** A DSP script with the Lua state it runs in, which comes from the pool */
+struct ScriptNode::Context
+{
+    Context()
+        : pooled (statePool->acquire()),
+          allocator (pooled->getAllocator()),
+          lua (pooled->getState())
+    {
+        script.reset (new DSPScript (lua.create_table()));
+        // garbage is collected in steps after each block, see render()
+        lua.collect_garbage();
+        LuaAllocator::stopCollector (lua.lua_state());
+    }
+
+    ~Context()
+    {
+        script->cleanup();
+        script.reset();
+        statePool->recycle (std::move (pooled));
+    }
+
+    /** Load and instantiate a script, then prepare it like the node. This
+        doesn't touch the node, so it can run on any thread */
+    Result build (const String& code, bool shouldPrepare, double rate, int block)
+    {
+        auto result = DSPScript::validate (code);
+        if (result.failed())
+            return result;
+
+        Script loader (lua);
+        loader.load (code);
+        if (loader.hasError())
+            return Result::fail (loader.getErrorMessage());
+
+        auto dsp = loader();
+        if (! dsp.valid() || dsp.get_type() != sol::type::table)
+            return Result::fail ("Could not instantiate script");
+
+        // scripts that set parallel = true can't reach the session
+        sol::table desc = dsp;
+        parallel = desc["parallel"].get_or (false);
+        if (parallel && ! Lua::isolateState (lua))
+            return Result::fail ("parallel scripts can't use the session modules");
+
+        script.reset (new DSPScript (dsp));
+        if (script->getLayoutError().isNotEmpty())
+            return Result::fail (script->getLayoutError());
+        if (shouldPrepare)
+            script->prepare (rate, block);
+        lua.collect_garbage();
+        return Result::ok();
+    }
+
+    void prepare (double rate, int block)   { script->prepare (rate, block); }
+    void release()                          { script->release(); }
+
+    /** Errors are left to ScriptHotSwap, which silences the block */
+    void render (AudioSampleBuffer& audio, MidiPipe& midi)
+    {
+        if (profiler != nullptr)
+            profiler->begin (lua.lua_state(), &allocator);
+
+        try
+        {
+            script->process (audio, midi);
+        }
+        catch (...)
+        {
+            if (profiler != nullptr)
+                profiler->end (lua.lua_state());
+            throw;
+        }
+
+        if (profiler != nullptr)
+            profiler->end (lua.lua_state());
+        allocator.step (lua.lua_state());
+    }
+
+    SharedResourcePointer<LuaStatePool> statePool;
+    std::unique_ptr<LuaStatePool::State> pooled;
+    LuaAllocator& allocator;
+    sol::state& lua;
+    std::unique_ptr<DSPScript> script;
+    LuaProfiler* profiler = nullptr;
+    bool parallel = false;
+};
+
 //=============================================================================
 ScriptNode::ScriptNode() noexcept
     : GraphNode (0)
 {
-    Lua::initializeState (lua);
-    script.reset (new DSPScript (lua.create_table()));
+    auto context = std::make_unique<Context>();
+    context->profiler = &profiler;
+    contexts.publish (std::move (context));
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, EL_INTERNAL_FORMAT_NAME, nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_SCRIPT, nullptr);
 }
 
-ScriptNode::~ScriptNode()
-{
-    script.reset();
-}
+ScriptNode::~ScriptNode() { }
 
 void ScriptNode::createPorts()
 {
-    if (script == nullptr)
+    auto* const context = contexts.getContext();
+    if (context == nullptr)
         return;
     ports.clearQuick();
-    script->getPorts (ports);
+    context->script->getPorts (ports);
 }
 
 Parameter::Ptr ScriptNode::getParameter (const PortDescription& port)
 {
     jassert (port.type == PortType::Control);
-    return script ? script->getParameterObject (port.channel, port.input) : nullptr;
+    auto* const context = contexts.getContext();
+    return context != nullptr ? context->script->getParameterObject (port.channel, port.input) : nullptr;
 }
 
 Result ScriptNode::loadScript (const String& newCode)
 {
-    auto result = DSPScript::validate (newCode);
-    if (result.failed())
-        return result;
-
-    Script loader (lua);
-    loader.load (newCode);
-    if (loader.hasError())
-        return Result::fail (loader.getErrorMessage());
-
-    auto dsp = loader();
-    if (! dsp.valid() || dsp.get_type() != sol::type::table)
-        return Result::fail ("Could not instantiate script");
-
-    auto newScript = std::make_unique<DSPScript> (dsp);
-    
-    if (true)
-    {
-        if (prepared)
-            newScript->prepare (sampleRate, blockSize);
-        triggerPortReset();
-        ScopedLock sl (lock);
-        if (script != nullptr)
-            newScript->copyParameterValues (*script);
-        script.swap (newScript);
-    }
+    auto newContext = std::make_unique<Context>();
+    auto result = newContext->build (newCode, prepared, sampleRate, blockSize);
+    if (result.wasOk())
+        swapContext (std::move (newContext), prepared, sampleRate, blockSize);
+    return result;
+}
 
-    if (newScript != nullptr)
-    {
-        newScript->release();
-        newScript->cleanup();
-        newScript.reset();
-    }
+void ScriptNode::loadScriptAsync (const String& newCode, std::function<void (const Result&)> callback)
+{
+    const bool wasPrepared = prepared;
+    const double rate = sampleRate;
+    const int block = blockSize;
+
+    contexts.compile (
+        [newCode, wasPrepared, rate, block] (Context& context) {
+            return context.build (newCode, wasPrepared, rate, block);
+        },
+        [this, wasPrepared, rate, block, callback] (const Result& result, std::unique_ptr<Context> context) {
+            if (context != nullptr)
+                swapContext (std::move (context), wasPrepared, rate, block);
+            if (callback)
+                callback (result);
+        });
+}
 
-    return Result::ok();
+void ScriptNode::swapContext (std::unique_ptr<Context> newContext, bool wasPrepared, double rate, int block)
+{
+    // the node may have been prepared or released while compiling
+    const bool sameSetup = wasPrepared == prepared && rate == sampleRate && block == blockSize;
+    if (wasPrepared && ! sameSetup)
+        newContext->release();
+    if (prepared && ! sameSetup)
+        newContext->prepare (sampleRate, blockSize);
+
+    if (auto* const oldContext = contexts.getContext())
+        newContext->script->copyParameterValues (*oldContext->script);
+    newContext->profiler = &profiler;
+    profiler.reset();
+
+    const bool wasParallel = isParallelSafe();
+    const bool nowParallel = newContext->parallel;
+    contexts.publish (std::move (newContext));
+    parallel.set (nowParallel ? 1 : 0);
+
+    if (wasParallel != nowParallel)
+        if (auto* const graph = getParentGraph())
+            graph->triggerAsyncUpdate();
+    triggerPortReset();
 }
 
 void ScriptNode::fillInPluginDescription (PluginDescription& desc)
@@ -135,7 +229,9 @@ void ScriptNode::prepareToRender (double rate, int block)
         return;
     sampleRate = rate;
     blockSize = block;
-    script->prepare (sampleRate, blockSize);
+    contexts.getContext()->prepare (sampleRate, blockSize);
+    contexts.prepare (sampleRate, jmax (getNumPorts (PortType::Audio, true),
+                                        getNumPorts (PortType::Audio, false)), blockSize);
     prepared = true;
 }
 
@@ -144,13 +240,18 @@ void ScriptNode::releaseResources()
     if (! prepared)
         return;
     prepared = false;
-    script->release();
+    contexts.getContext()->release();
+    contexts.release();
+}
+
+bool ScriptNode::beginParallelRender()
+{
+    return contexts.pin ([] (const Context& context) { return context.parallel; });
 }
 
 void ScriptNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
-    ScopedLock sl (lock);
-    script->process (audio, midi);
+    contexts.render (audio, midi);
 }
 
 void ScriptNode::setState (const void* data, int size)
@@ -170,10 +271,13 @@ void ScriptNode::setState (const void* data, int size)
                 const var& data = state.getProperty ("data");
                 if (data.isBinaryData())
                     if (auto* block = data.getBinaryData())
-                        script->restore (block->getData(), block->getSize());
+                        contexts.getContext()->script->restore (block->getData(), block->getSize());
             }
         }
 
+        if (state.hasProperty ("crossfade"))
+            setCrossfadeTime ((double) state.getProperty ("crossfade"));
+
         sendChangeMessage();
     }
 }
@@ -182,10 +286,11 @@ void ScriptNode::getState (MemoryBlock& out)
 {
     ValueTree state ("ScriptNode");
     state.setProperty ("dspCode", dspCode.getAllContent(), nullptr)
-         .setProperty ("editorCode", edCode.getAllContent(), nullptr);
+         .setProperty ("editorCode", edCode.getAllContent(), nullptr)
+         .setProperty ("crossfade", getCrossfadeTime(), nullptr);
 
     MemoryBlock block;
-    script->save (block);
+    contexts.getContext()->script->save (block);
     if (block.getSize() > 0)
         state.setProperty ("data", block, nullptr);
     block.reset();
@@ -197,9 +302,21 @@ void ScriptNode::getState (MemoryBlock& out)
     }
 }
 
+LuaAllocator::Stats ScriptNode::getMemoryStats() const
+{
+    auto* const context = contexts.getContext();
+    return context != nullptr ? context->allocator.getStats() : LuaAllocator::Stats();
+}
+
+String ScriptNode::getMemoryStatusText() const
+{
+    auto* const context = contexts.getContext();
+    return context != nullptr ? context->allocator.getStatusText() : String();
+}
+
 void ScriptNode::setParameter (int index, float value)
 {
-    ScopedLock sl (lock);
+    ignoreUnused (index, value);
 }
 
 }
@@ -20,7 +20,10 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/nodes/ScriptHotSwap.h"
 #include "engine/GraphNode.h"
+#include "scripting/LuaAllocator.h"
+#include "scripting/LuaProfiler.h"
 #include "sol/sol.hpp"
 
 namespace Element {
@@ -42,13 +45,50 @@ public:
     void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override;
     void render (AudioSampleBuffer& audio, MidiPipe& midi) override;
+
+    /** Returns true if the running script set parallel = true in its
+        descriptor */
+    bool isParallelSafe() const override { return parallel.get() == 1; }
+    bool beginParallelRender() override;
     void setState (const void* data, int size) override;
     void getState (MemoryBlock& block) override;
 
+    /** Compile a script and swap it in. This blocks until the script
+        is compiled, but never holds up rendering */
     Result loadScript (const String&);
 
+    /** Compile a script on a background thread, then swap it in. The
+        callback gets the result on the message thread */
+    void loadScriptAsync (const String&, std::function<void (const Result&)> callback = nullptr);
+
+    /** Returns true while a script is compiling in the background */
+    bool isCompiling() const { return contexts.isCompiling(); }
+
+    /** Set how long the old and new scripts are crossfaded when a script
+        is swapped in during playback. Zero swaps immediately */
+    void setCrossfadeTime (double seconds) { contexts.setFadeTime (seconds); }
+
+    /** Returns the crossfade time in seconds */
+    double getCrossfadeTime() const { return contexts.getFadeTime(); }
+
     CodeDocument& getCodeDocument (bool forEditor = false) { return forEditor ? edCode : dspCode; }
 
+    /** Returns memory pool and garbage collection measurements of the
+        DSP state */
+    LuaAllocator::Stats getMemoryStats() const;
+
+    /** Returns the memory measurements as a line of text */
+    String getMemoryStatusText() const;
+
+    /** Turn the profiler on or off for the DSP script */
+    void setProfiling (bool shouldProfile) { profiler.setEnabled (shouldProfile); }
+
+    /** Returns true if the DSP script is being profiled */
+    bool isProfiling() const { return profiler.isEnabled(); }
+
+    /** Returns the profiler that times the DSP script */
+    LuaProfiler& getProfiler() noexcept { return profiler; }
+
     /** Set a parameter value by index
      
         @param index    The parameter index to set
@@ -62,15 +102,17 @@ protected:
     Parameter::Ptr getParameter (const PortDescription& port) override;
 
 private:
-    CriticalSection lock;
-    sol::state lua;
     CodeDocument dspCode, edCode;
-    std::unique_ptr<DSPScript> script;
+    LuaProfiler profiler;
+    ScriptHotSwap<Context> contexts;
     ParameterArray inParams, outParams;
+    Atomic<int> parallel { 0 };
 
     int blockSize = 512;
     double sampleRate = 44100.0;
     bool prepared = false;
+
+    void swapContext (std::unique_ptr<Context>, bool wasPrepared, double rate, int block);
 };
 
 }
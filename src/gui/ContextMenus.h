@@ -441,6 +441,62 @@ private:
         }
     };
 
+    struct FreezeNodeOp : public ResultOp
+    {
+        const Node node;
+        FreezeNodeOp (const Node& n) : node (n) { }
+        bool isActive() override { return node.getGraphNode() != nullptr && ! node.isIONode(); }
+        bool isTicked() override
+        {
+            GraphNodePtr ptr = node.getGraphNode();
+            return ptr != nullptr && (ptr->isFrozen() || ptr->isFreezePending());
+        }
+
+        bool perform() override
+        {
+            GraphNodePtr ptr = node.getGraphNode();
+            auto* const graph = ptr != nullptr ? ptr->getParentGraph() : nullptr;
+            if (graph == nullptr)
+                return false;
+
+            if (ptr->isFrozen() || ptr->isFreezePending())
+            {
+                ptr->unfreeze();
+                return true;
+            }
+
+            AlertWindow win ("Freeze Node", "Number of bars to render from the start of the session:",
+                             AlertWindow::NoIcon, nullptr);
+            win.addTextEditor ("bars", "16", "", false);
+            win.addButton ("Freeze", 1, KeyPress (KeyPress::returnKey));
+            win.addButton ("Cancel", 0, KeyPress (KeyPress::escapeKey));
+            if (1 != win.runModalLoop())
+                return true;
+
+            const int bars = jmax (1, win.getTextEditorContents ("bars").getIntValue());
+            AudioPlayHead::CurrentPositionInfo pos;
+            pos.resetToDefault();
+            if (auto* playhead = graph->getPlayHead())
+                playhead->getCurrentPosition (pos);
+
+            const double secondsPerBar = (60.0 / pos.bpm) * pos.timeSigNumerator
+                                            * (4.0 / (double) pos.timeSigDenominator);
+            const auto numFrames = static_cast<int64> (secondsPerBar * bars * graph->getSampleRate());
+
+            MouseCursor::showWaitCursor();
+            const bool frozen = ptr->freeze ({ 0, numFrames });
+            MouseCursor::hideWaitCursor();
+
+            if (! frozen)
+                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Freeze Node",
+                    "Could not freeze " + node.getName() + ". Nodes without audio outputs or with oversampling can't be frozen.");
+            else if (ptr->isFreezePending())
+                AlertWindow::showMessageBoxAsync (AlertWindow::InfoIcon, "Freeze Node",
+                    node.getName() + " has connected inputs. It will be frozen after the transport plays from the start of the session through " + String (bars) + " bars.");
+            return true;
+        }
+    };
+
     struct SingleConnectOp : public ResultOp
     {
         SingleConnectOp (const Node& sn, const Port& sp, const Node& dn, const Port& dp)
@@ -581,6 +637,7 @@ private:
 
         addItemInternal (*this, node.isEnabled() ? "Disable" : "Enable", new EnableNodeOp (node));
         addItemInternal (*this, "Rename", new RenameNodeOp (node));
+        addItemInternal (*this, "Freeze", new FreezeNodeOp (node));
         addSeparator();
 
         {
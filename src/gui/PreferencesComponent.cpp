@@ -26,11 +26,13 @@
 #include "gui/MainWindow.h"
 #include "gui/ViewHelpers.h"
 #include "controllers/OSCController.h"
+#include "engine/WorkerPool.h"
 #include "Globals.h"
 #include "Settings.h"
 
 #define EL_GENERAL_SETTINGS_NAME "General"
 #define EL_AUDIO_SETTINGS_NAME "Audio"
+#define EL_ENGINE_SETTINGS_NAME "Engine"
 #define EL_MIDI_SETTINGS_NAME "MIDI"
 #define EL_OSC_SETTINGS_NAME "OSC"
 #define EL_PLUGINS_PREFERENCE_NAME  "Plugins"
@@ -682,6 +684,160 @@ namespace Element {
         DeviceManager& devices;
     };
 
+    // MARK: Engine Settings
+
+    class EngineSettingsPage : public SettingsPage,
+                               private Timer
+    {
+    public:
+        EngineSettingsPage (Globals& g)
+            : settings (g.getSettings()),
+              engine (g.getAudioEngine()),
+              midi (g.getMidiEngine())
+        {
+            addAndMakeVisible (inlineSubGraphsLabel);
+            inlineSubGraphsLabel.setText ("Render nested graphs inline", dontSendNotification);
+            inlineSubGraphsLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (inlineSubGraphs);
+            inlineSubGraphs.setClickingTogglesState (true);
+            inlineSubGraphs.setToggleState (settings.inlineSubGraphs(), dontSendNotification);
+            inlineSubGraphs.onClick = [this]()
+            {
+                settings.setInlineSubGraphs (inlineSubGraphs.getToggleState());
+                applySettings();
+            };
+
+            addAndMakeVisible (workerThreadsLabel);
+            workerThreadsLabel.setText ("Worker threads", dontSendNotification);
+            workerThreadsLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (workerThreads);
+            workerThreads.textFromValueFunction = [](double value) -> String {
+                return value < 1.0 ? String ("Off") : String (roundToInt (value));
+            };
+            workerThreads.setRange (0.0, (double) SystemStats::getNumCpus(), 1.0);
+            workerThreads.setValue ((double) settings.getWorkerThreads(), dontSendNotification);
+            workerThreads.setSliderStyle (Slider::IncDecButtons);
+            workerThreads.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            workerThreads.onValueChange = [this]()
+            {
+                settings.setWorkerThreads (roundToInt (workerThreads.getValue()));
+                applySettings();
+            };
+
+            addAndMakeVisible (priorityOffsetLabel);
+            priorityOffsetLabel.setText ("Worker priority offset", dontSendNotification);
+            priorityOffsetLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (priorityOffset);
+            priorityOffset.textFromValueFunction = [](double value) -> String {
+                return String (roundToInt (value));
+            };
+            priorityOffset.setRange (-20.0, 0.0, 1.0);
+            priorityOffset.setValue ((double) settings.getWorkerPriorityOffset(), dontSendNotification);
+            priorityOffset.setSliderStyle (Slider::IncDecButtons);
+            priorityOffset.setTextBoxStyle (Slider::TextBoxLeft, false, 82, 22);
+            priorityOffset.onValueChange = [this]()
+            {
+                settings.setWorkerPriorityOffset (roundToInt (priorityOffset.getValue()));
+                applySettings();
+            };
+
+            addAndMakeVisible (affinityLabel);
+            affinityLabel.setText ("Worker CPUs", dontSendNotification);
+            affinityLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (affinity);
+            affinity.setTextToShowWhenEmpty ("Any", Colours::grey);
+            affinity.setInputRestrictions (64, "0123456789,-");
+            affinity.setText (settings.getWorkerAffinity(), dontSendNotification);
+            affinity.onReturnKey = affinity.onFocusLost = [this]()
+            {
+                settings.setWorkerAffinity (affinity.getText().trim());
+                applySettings();
+            };
+
+            addAndMakeVisible (lockMemoryLabel);
+            lockMemoryLabel.setText ("Lock engine memory", dontSendNotification);
+            lockMemoryLabel.setFont (Font (12.0, Font::bold));
+            addAndMakeVisible (lockMemory);
+            lockMemory.setClickingTogglesState (true);
+            lockMemory.setToggleState (settings.lockMemory(), dontSendNotification);
+            lockMemory.onClick = [this]()
+            {
+                settings.setLockMemory (lockMemory.getToggleState());
+                applySettings();
+            };
+
+            addAndMakeVisible (statusLabel);
+            statusLabel.setFont (Font (12.0, Font::italic));
+            addAndMakeVisible (midiStatusLabel);
+            midiStatusLabel.setFont (Font (12.0, Font::italic));
+            updateStatus();
+            startTimer (1000);
+        }
+
+        ~EngineSettingsPage()
+        {
+            stopTimer();
+        }
+
+        void resized() override
+        {
+            auto r = getLocalBounds();
+            layoutSetting (r, inlineSubGraphsLabel, inlineSubGraphs);
+            layoutSetting (r, workerThreadsLabel, workerThreads, getWidth() / 4);
+            layoutSetting (r, priorityOffsetLabel, priorityOffset, getWidth() / 4);
+            layoutSetting (r, affinityLabel, affinity, getWidth() / 4);
+            layoutSetting (r, lockMemoryLabel, lockMemory);
+            r.removeFromTop (12);
+            statusLabel.setBounds (r.removeFromTop (22));
+            midiStatusLabel.setBounds (r.removeFromTop (22));
+        }
+
+    private:
+        Settings& settings;
+        AudioEnginePtr engine;
+        MidiEngine& midi;
+
+        Label inlineSubGraphsLabel;
+        SettingButton inlineSubGraphs;
+        Label workerThreadsLabel;
+        Slider workerThreads;
+        Label priorityOffsetLabel;
+        Slider priorityOffset;
+        Label affinityLabel;
+        TextEditor affinity;
+        Label lockMemoryLabel;
+        SettingButton lockMemory;
+        Label statusLabel;
+        Label midiStatusLabel;
+
+        void applySettings()
+        {
+            engine->applySettings (settings);
+            settings.saveIfNeeded();
+            updateStatus();
+        }
+
+        void updateStatus()
+        {
+            statusLabel.setText (engine->getWorkerPool().getStatusText(), dontSendNotification);
+            String midiStatus = midi.getOutputScheduler().getStatusText();
+            if (engine->isUsingExternalClock())
+            {
+                const auto clock = engine->getMidiClockDiagnostics();
+                midiStatus << " | clock: ";
+                if (clock.locked)
+                    midiStatus << String (clock.bpm, 2) << " BPM, jitter " << String (clock.jitterMs, 2)
+                               << " ms, drift " << String (clock.driftMs, 2) << " ms, "
+                               << clock.numRealigns << " realigned";
+                else
+                    midiStatus << "no signal";
+            }
+            midiStatusLabel.setText (midiStatus, dontSendNotification);
+        }
+
+        void timerCallback() override { updateStatus(); }
+    };
+
     // MARK: MIDI Settings
 
     class MidiSettingsPage : public SettingsPage,
@@ -1022,6 +1178,7 @@ PreferencesComponent::PreferencesComponent (Globals& g, GuiController& _gui)
     //[Constructor] You can add your own custom stuff here..
     addPage (EL_GENERAL_SETTINGS_NAME);
     addPage (EL_AUDIO_SETTINGS_NAME);
+    addPage (EL_ENGINE_SETTINGS_NAME);
     addPage (EL_MIDI_SETTINGS_NAME);
     addPage (EL_OSC_SETTINGS_NAME);
     setPage (EL_GENERAL_SETTINGS_NAME);
@@ -1081,6 +1238,8 @@ Component* PreferencesComponent::createPageForName (const String& name)
         return new GeneralSettingsPage (world, gui);
     } else if (name == EL_AUDIO_SETTINGS_NAME) {
         return new AudioSettingsComponent (world.getDeviceManager());
+    } else if (name == EL_ENGINE_SETTINGS_NAME) {
+        return new EngineSettingsPage (world);
     } else if (name == EL_PLUGINS_PREFERENCE_NAME) {
         return new PluginSettingsComponent (world);
     } else if (name == EL_MIDI_SETTINGS_NAME) {
@@ -154,13 +154,19 @@ LuaNodeEditor::LuaNodeEditor (const Node& node)
     {
         if (auto* const lua = getNodeObjectOfType<LuaNode>())
         {
-            const auto script = document.getAllContent();
-            auto result = lua->loadScript (script);
-            if (! result.wasOk())
+            // compiles in the background, the old script keeps playing meanwhile
+            compileButton.setEnabled (false);
+            Component::SafePointer<LuaNodeEditor> safeThis (this);
+            lua->loadScriptAsync (document.getAllContent(), [safeThis] (const Result& result)
             {
-                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
-                    "Script Error", result.getErrorMessage());
-            }
+                if (safeThis != nullptr)
+                    safeThis->compileButton.setEnabled (true);
+                if (! result.wasOk())
+                {
+                    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
+                        "Script Error", result.getErrorMessage());
+                }
+            });
         }
     };
 
@@ -174,9 +180,29 @@ LuaNodeEditor::LuaNodeEditor (const Node& node)
         resized();
     };
 
+    addAndMakeVisible (profileButton);
+    profileButton.setButtonText ("Profile");
+    profileButton.setTooltip ("Time the script, the report is shown when stopped");
+    profileButton.setColour (TextButton::buttonOnColourId, Colors::toggleBlue);
+    profileButton.setToggleState (lua->isProfiling(), dontSendNotification);
+    profileButton.onClick = [this]()
+    {
+        const bool profiling = ! profileButton.getToggleState();
+        profileButton.setToggleState (profiling, dontSendNotification);
+        lua->setProfiling (profiling);
+        if (! profiling)
+            showProfile();
+    };
+
     addAndMakeVisible (props);
     props.setVisible (editorButton.getToggleState());
 
+    addAndMakeVisible (statusLabel);
+    statusLabel.setFont (Font (11.f));
+    statusLabel.setJustificationType (Justification::centredLeft);
+    timerCallback();
+    startTimer (1000);
+
     updateProperties();
     lua->addChangeListener (this);
     portsChangedConnection = lua->portsChanged.connect (
@@ -186,11 +212,13 @@ LuaNodeEditor::LuaNodeEditor (const Node& node)
 
 LuaNodeEditor::~LuaNodeEditor()
 {
+    stopTimer();
     portsChangedConnection.disconnect();
     if (auto* const lua = getNodeObjectOfType<LuaNode>())
     {
         lua->removeChangeListener (this);
         lua->setDraftScript (document.getAllContent());
+        lua->setProfiling (false);
     }
 }
 
@@ -212,6 +240,24 @@ void LuaNodeEditor::onPortsChanged()
     updateProperties();
 }
 
+void LuaNodeEditor::showProfile()
+{
+    auto report = std::make_unique<TextEditor>();
+    report->setMultiLine (true);
+    report->setReadOnly (true);
+    report->setScrollbarsShown (true);
+    report->setFont (Font (Font::getDefaultMonospacedFontName(), 12.f, Font::plain));
+    report->setText (lua->getProfiler().getSummary(), false);
+    report->setSize (480, 320);
+    CallOutBox::launchAsynchronously (std::move (report),
+        profileButton.getScreenBounds(), nullptr);
+}
+
+void LuaNodeEditor::timerCallback()
+{
+    statusLabel.setText (lua->getMemoryStatusText(), dontSendNotification);
+}
+
 void LuaNodeEditor::changeListenerCallback (ChangeBroadcaster*)
 {
     editor->loadContent (lua->getDraftScript());
@@ -233,6 +279,10 @@ void LuaNodeEditor::resized()
     compileButton.setBounds (r2.removeFromLeft (compileButton.getWidth()));
     editorButton.changeWidthToFitText (r2.getHeight());
     editorButton.setBounds (r2.removeFromRight (editorButton.getWidth()));
+    r2.removeFromRight (2);
+    profileButton.changeWidthToFitText (r2.getHeight());
+    profileButton.setBounds (r2.removeFromRight (profileButton.getWidth()));
+    statusLabel.setBounds (r2.reduced (4, 0));
 
     r1.removeFromTop (2);
     if (props.isVisible())
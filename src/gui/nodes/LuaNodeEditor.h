@@ -27,7 +27,8 @@
 namespace Element {
 
 class LuaNodeEditor : public NodeEditorComponent,
-                      public ChangeListener
+                      public ChangeListener,
+                      private Timer
 {
 public:
     explicit LuaNodeEditor (const Node&);
@@ -44,12 +45,16 @@ private:
     std::unique_ptr<CodeEditorComponent> editor;
     TextButton compileButton;
     TextButton editorButton;
+    TextButton profileButton;
     PropertyPanel props;
+    Label statusLabel;
     SignalConnection portsChangedConnection;
     LuaNode::Ptr lua;
 
     void updateProperties();
     void onPortsChanged();
+    void showProfile();
+    void timerCallback() override;
 };
 
 }
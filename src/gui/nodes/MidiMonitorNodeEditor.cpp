@@ -48,23 +48,23 @@ public:
         node = nullptr;
     }
 
-    int getNumRows() override { return node->getLog().size(); }
+    int getNumRows() override { return node->getNumLogged(); }
 
     void paintListBoxItem (int row, Graphics& g, int width, int height, bool rowIsSelected) override
     {
-        const auto& logList = node->getLog();
+        // only rows on screen are ever formatted
         ignoreUnused (rowIsSelected);
         g.setFont (Font (Font::getDefaultMonospacedFontName(), 
                    g.getCurrentFont().getHeight(), Font::plain));
-        if (isPositiveAndBelow (row, logList.size()))
-            ViewHelpers::drawBasicTextRow (logList[row], g, width, height, false);
+        if (isPositiveAndBelow (row, node->getNumLogged()))
+            ViewHelpers::drawBasicTextRow (MidiMonitorNode::describe (node->getLoggedMessage (row)),
+                                           g, width, height, false);
     }
 
     void handleAsyncUpdate() override
     {
-        const auto& logList = node->getLog();
         updateContent();
-        scrollToEnsureRowIsOnscreen (logList.size() - 1);
+        scrollToEnsureRowIsOnscreen (node->getNumLogged() - 1);
         repaint();
     }
 
@@ -87,6 +87,10 @@ MidiMonitorNodeEditor::MidiMonitorNodeEditor (const Node& node)
             n->clearMessages();
     };
 
+    addAndMakeVisible (filterButton);
+    filterButton.setButtonText ("Filter");
+    filterButton.onClick = [this]() { showFilterMenu(); };
+
     setSize (320, 160);
 }
 
@@ -95,11 +99,60 @@ MidiMonitorNodeEditor::~MidiMonitorNodeEditor()
     logger.reset();
 }
 
+void MidiMonitorNodeEditor::showFilterMenu()
+{
+    auto* const node = getNodeObjectOfType<MidiMonitorNode>();
+    if (node == nullptr)
+        return;
+
+    const int types = node->getTypeFilter();
+    const int channels = node->getChannelFilter();
+    const std::pair<int, const char*> typeNames[] = {
+        { MidiMonitorNode::noteMessages,        "Notes" },
+        { MidiMonitorNode::controllerMessages,  "Controllers" },
+        { MidiMonitorNode::programMessages,     "Program Changes" },
+        { MidiMonitorNode::pitchMessages,       "Pitch Bend" },
+        { MidiMonitorNode::pressureMessages,    "Aftertouch" },
+        { MidiMonitorNode::clockMessages,       "Clock" },
+        { MidiMonitorNode::transportMessages,   "Start/Stop" },
+        { MidiMonitorNode::sysexMessages,       "SysEx" },
+        { MidiMonitorNode::otherMessages,       "Other" }
+    };
+
+    PopupMenu menu, channelMenu, historyMenu;
+    for (const auto& type : typeNames)
+        menu.addItem (type.first, type.second, true, (types & type.first) != 0);
+
+    channelMenu.addItem (1000, "All", true, channels == 0xffff);
+    for (int ch = 0; ch < 16; ++ch)
+        channelMenu.addItem (1001 + ch, String (ch + 1), true, (channels & (1 << ch)) != 0);
+    menu.addSubMenu ("Channels", channelMenu);
+
+    for (const int size : { 100, 1000, 10000, 100000 })
+        historyMenu.addItem (2000 + size, String (size), true, node->getHistorySize() == size);
+    menu.addSubMenu ("History", historyMenu);
+
+    const int result = menu.showAt (&filterButton);
+    if (result <= 0)
+        return;
+
+    if (result == 1000)
+        node->setChannelFilter (channels == 0xffff ? 0 : 0xffff);
+    else if (result > 1000 && result <= 1016)
+        node->setChannelFilter (channels ^ (1 << (result - 1001)));
+    else if (result > 2000)
+        node->setHistorySize (result - 2000);
+    else
+        node->setTypeFilter (types ^ result);
+}
+
 void MidiMonitorNodeEditor::resized ()
 {
     auto r1 = getLocalBounds().reduced (4);
     clearButton.changeWidthToFitText (24);
     clearButton.setBounds (r1.getX(), r1.getY(), clearButton.getWidth(), clearButton.getHeight());
+    filterButton.changeWidthToFitText (24);
+    filterButton.setBounds (clearButton.getRight() + 4, r1.getY(), filterButton.getWidth(), filterButton.getHeight());
     r1.removeFromTop (24 + 2);
     logger->setBounds (r1);
 }
@@ -35,6 +35,8 @@ public:
 private:
     class Logger; std::unique_ptr<Logger> logger;
     TextButton clearButton;
+    TextButton filterButton;
+    void showFilterMenu();
 };
 
 }
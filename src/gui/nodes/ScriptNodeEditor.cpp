@@ -339,13 +339,19 @@ ScriptNodeEditor::ScriptNodeEditor (ScriptingEngine& scripts, const Node& node)
     compileButton.setButtonText ("Compile");
     compileButton.onClick = [this]()
     {
-        const auto script = lua->getCodeDocument(false).getAllContent();
-        auto result = lua->loadScript (script);
-        if (! result.wasOk())
+        // compiles in the background, the old script keeps playing meanwhile
+        compileButton.setEnabled (false);
+        Component::SafePointer<ScriptNodeEditor> safeThis (this);
+        lua->loadScriptAsync (lua->getCodeDocument(false).getAllContent(), [safeThis] (const Result& result)
         {
-            AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
-                "Script Error", result.getErrorMessage());
-        }
+            if (safeThis != nullptr)
+                safeThis->compileButton.setEnabled (true);
+            if (! result.wasOk())
+            {
+                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
+                    "Script Error", result.getErrorMessage());
+            }
+        });
     };
 
     addAndMakeVisible (paramsButton);
@@ -404,9 +410,29 @@ ScriptNodeEditor::ScriptNodeEditor (ScriptingEngine& scripts, const Node& node)
         }
     };
 
+    addAndMakeVisible (profileButton);
+    profileButton.setButtonText ("Profile");
+    profileButton.setTooltip ("Time the DSP script, the report goes to the console when stopped");
+    profileButton.setColour (TextButton::buttonOnColourId, Colors::toggleBlue);
+    profileButton.setToggleState (lua->isProfiling(), dontSendNotification);
+    profileButton.onClick = [this]()
+    {
+        const bool profiling = ! profileButton.getToggleState();
+        profileButton.setToggleState (profiling, dontSendNotification);
+        lua->setProfiling (profiling);
+        if (! profiling)
+            console.addText (lua->getProfiler().getSummary());
+    };
+
     addAndMakeVisible (props);
     props.setVisible (paramsButton.getToggleState());
 
+    addAndMakeVisible (statusLabel);
+    statusLabel.setFont (Font (11.f));
+    statusLabel.setJustificationType (Justification::centredLeft);
+    timerCallback();
+    startTimer (1000);
+
     addAndMakeVisible (console);
     console.setEnvironment (env);
 
@@ -421,8 +447,10 @@ ScriptNodeEditor::ScriptNodeEditor (ScriptingEngine& scripts, const Node& node)
 
 ScriptNodeEditor::~ScriptNodeEditor()
 {
+    stopTimer();
     portsChangedConnection.disconnect();
     lua->removeChangeListener (this);
+    lua->setProfiling (false);
     editor.reset();
 }
 
@@ -565,6 +593,11 @@ void ScriptNodeEditor::onPortsChanged()
     updateProperties();
 }
 
+void ScriptNodeEditor::timerCallback()
+{
+    statusLabel.setText (lua->getMemoryStatusText(), dontSendNotification);
+}
+
 CodeDocument& ScriptNodeEditor::getActiveDoc()
 {
     return lua->getCodeDocument (uiButton.getToggleState());
@@ -603,6 +636,10 @@ void ScriptNodeEditor::resized()
     
     paramsButton.changeWidthToFitText (r2.getHeight());
     paramsButton.setBounds (r2.removeFromRight (paramsButton.getWidth()));
+    r2.removeFromRight (2);
+    profileButton.changeWidthToFitText (r2.getHeight());
+    profileButton.setBounds (r2.removeFromRight (profileButton.getWidth()));
+    statusLabel.setBounds (r2.reduced (4, 0));
 
     r1.removeFromTop (2);
 
@@ -29,7 +29,8 @@ namespace Element {
 
 class ScriptingEngine;
 class ScriptNodeEditor : public NodeEditorComponent,
-                         public ChangeListener
+                         public ChangeListener,
+                         private Timer
 {
 public:
     explicit ScriptNodeEditor (ScriptingEngine& scripts, const Node& node);
@@ -56,8 +57,10 @@ private:
     TextButton dspButton;
     TextButton uiButton;
     TextButton previewButton;
+    TextButton profileButton;
 
     PropertyPanel props;
+    Label statusLabel;
     SignalConnection portsChangedConnection;
     ScriptNode::Ptr lua;
 
@@ -73,6 +76,7 @@ private:
     void updateProperties();
     void updateScriptsCombo();
     void onPortsChanged();
+    void timerCallback() override;
     sol::table createContext();
 };
 
@@ -0,0 +1,257 @@
+/*
+    This file is part of Element
+    Copyright (C) 2021  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "lua.hpp"
+#include "scripting/BytecodeCache.h"
+#include "DataPath.h"
+
+namespace Element {
+
+static int writeChunk (lua_State*, const void* data, size_t size, void* stream)
+{
+    return static_cast<OutputStream*> (stream)->write (data, size) ? 0 : 1;
+}
+
+static bool isBytecode (const char* source, size_t size)
+{
+    return size > 0 && source[0] == LUA_SIGNATURE[0];
+}
+
+// bytecode files start with a tag and the SHA-256 of the bytecode after it
+static const char fileTag[] = { 'E', 'L', 'B', 'C' };
+static const size_t fileHeaderSize = sizeof (fileTag) + 32;
+
+//=============================================================================
+BytecodeCache::BytecodeCache()
+    : BytecodeCache (getDefaultDirectory()) { }
+
+BytecodeCache::BytecodeCache (const File& dir)
+    : directory (dir) { }
+
+BytecodeCache::~BytecodeCache() { }
+
+File BytecodeCache::getDefaultDirectory()
+{
+    return DataPath::applicationDataDir().getChildFile ("Cache/Lua");
+}
+
+String BytecodeCache::getKey (const char* source, size_t size, const char* chunkName)
+{
+    MemoryOutputStream mo;
+    mo << LUA_RELEASE << ':' << (int) sizeof (lua_Integer) << ':' << (int) sizeof (lua_Number)
+       << ':' << (ByteOrder::isBigEndian() ? "be" : "le") << ':' << (chunkName != nullptr ? chunkName : "") << ':';
+    mo.write (source, size);
+    return SHA256 (mo.getData(), mo.getDataSize()).toHexString();
+}
+
+int BytecodeCache::load (lua_State* L, const char* source, size_t size, const char* chunkName)
+{
+    if (isBytecode (source, size))
+        return luaL_loadbufferx (L, source, size, chunkName, nullptr);
+
+    const auto key = getKey (source, size, chunkName);
+    MemoryBlock bytecode;
+
+    if (lookup (key, bytecode))
+    {
+        if (luaL_loadbufferx (L, (const char*) bytecode.getData(), bytecode.getSize(), chunkName, "b") == LUA_OK)
+        {
+            const ScopedLock sl (lock);
+            ++stats.numHits;
+            return LUA_OK;
+        }
+
+        // made by another build of Lua or damaged, compile it again
+        lua_pop (L, 1);
+    }
+
+    const int status = luaL_loadbufferx (L, source, size, chunkName, "t");
+    if (status != LUA_OK)
+        return status;
+
+    {
+        const ScopedLock sl (lock);
+        ++stats.numCompiled;
+    }
+
+    bytecode.reset();
+    bool dumped = false;
+    {
+        MemoryOutputStream out (bytecode, false);
+        dumped = lua_dump (L, writeChunk, &out, 0) == 0;
+    }
+
+    if (dumped && bytecode.getSize() > 0)
+        store (key, bytecode);
+    return LUA_OK;
+}
+
+sol::load_result BytecodeCache::load (sol::state_view& view, const String& source, const String& chunkName)
+{
+    lua_State* const L = view.lua_state();
+    const int status = load (L, source.toRawUTF8(), source.getNumBytesAsUTF8(), chunkName.toRawUTF8());
+    return sol::load_result (L, lua_absindex (L, -1), 1, 1, static_cast<sol::load_status> (status));
+}
+
+int BytecodeCache::loadEmbedded (lua_State* L, const String& moduleName)
+{
+    const auto resource = moduleName.replaceCharacter ('.', '_') + "_luac";
+    int size = 0;
+    const char* const data = BinaryData::getNamedResource (resource.toRawUTF8(), size);
+    if (data == nullptr || size <= 0)
+    {
+        lua_pushfstring (L, "no embedded '%s'", moduleName.toRawUTF8());
+        return LUA_ERRFILE;
+    }
+
+    return luaL_loadbufferx (L, data, (size_t) size, moduleName.toRawUTF8(), "b");
+}
+
+void BytecodeCache::setLimits (int maxChunksInMemory, int maxFilesOnDisk)
+{
+    const ScopedLock sl (lock);
+    maxChunks = jmax (1, maxChunksInMemory);
+    maxFiles  = jmax (1, maxFilesOnDisk);
+}
+
+void BytecodeCache::clear()
+{
+    const ScopedLock sl (lock);
+    chunks.clear();
+    if (directory.isDirectory())
+        for (const auto& file : directory.findChildFiles (File::findFiles, false, "*.luac"))
+            file.deleteFile();
+}
+
+BytecodeCache::Stats BytecodeCache::getStats() const
+{
+    const ScopedLock sl (lock);
+    return stats;
+}
+
+bool BytecodeCache::lookup (const String& key, MemoryBlock& bytecode)
+{
+    {
+        const ScopedLock sl (lock);
+        auto iter = chunks.find (key);
+        if (iter != chunks.end())
+        {
+            iter->second.lastUsed = ++useCount;
+            bytecode = iter->second.bytecode;
+            return true;
+        }
+    }
+
+    if (directory == File())
+        return false;
+
+    const auto file = directory.getChildFile (key + ".luac");
+    if (! readFile (file, bytecode))
+        return false;
+
+    // files are pruned by modification time, so a used one counts as new
+    file.setLastModificationTime (Time::getCurrentTime());
+    remember (key, bytecode);
+    return true;
+}
+
+void BytecodeCache::store (const String& key, const MemoryBlock& bytecode)
+{
+    remember (key, bytecode);
+
+    if (directory == File() || directory.createDirectory().failed())
+        return;
+
+    if (writeFile (directory.getChildFile (key + ".luac"), bytecode))
+        pruneFiles();
+}
+
+void BytecodeCache::remember (const String& key, const MemoryBlock& bytecode)
+{
+    const ScopedLock sl (lock);
+    auto& chunk = chunks[key];
+    chunk.bytecode = bytecode;
+    chunk.lastUsed = ++useCount;
+
+    while ((int) chunks.size() > maxChunks)
+    {
+        auto oldest = chunks.begin();
+        for (auto iter = chunks.begin(); iter != chunks.end(); ++iter)
+            if (iter->second.lastUsed < oldest->second.lastUsed)
+                oldest = iter;
+        chunks.erase (oldest);
+    }
+}
+
+void BytecodeCache::pruneFiles()
+{
+    auto files = directory.findChildFiles (File::findFiles, false, "*.luac");
+    int limit = 0;
+    {
+        const ScopedLock sl (lock);
+        limit = maxFiles;
+    }
+
+    if (files.size() <= limit)
+        return;
+
+    std::sort (files.begin(), files.end(), [] (const File& a, const File& b) {
+        return a.getLastModificationTime() < b.getLastModificationTime();
+    });
+
+    for (int i = 0; i < files.size() - limit; ++i)
+        files.getReference(i).deleteFile();
+}
+
+bool BytecodeCache::readFile (const File& file, MemoryBlock& bytecode)
+{
+    MemoryBlock data;
+    if (! file.existsAsFile() || ! file.loadFileAsData (data) || data.getSize() <= fileHeaderSize)
+        return false;
+
+    const auto* const bytes = static_cast<const char*> (data.getData());
+    if (memcmp (bytes, fileTag, sizeof (fileTag)) != 0)
+        return false;
+
+    // a damaged or tampered file could crash the Lua VM, so it's never
+    // handed to the loader unless the checksum matches
+    const auto* const body = bytes + fileHeaderSize;
+    const size_t size = data.getSize() - fileHeaderSize;
+    if (SHA256 (body, size).getRawData() != MemoryBlock (bytes + sizeof (fileTag), 32))
+        return false;
+
+    bytecode = MemoryBlock (body, size);
+    return true;
+}
+
+bool BytecodeCache::writeFile (const File& file, const MemoryBlock& bytecode)
+{
+    MemoryBlock data;
+    data.append (fileTag, sizeof (fileTag));
+    data.append (SHA256 (bytecode).getRawData().getData(), 32);
+    data.append (bytecode.getData(), bytecode.getSize());
+
+    // written aside and moved in place, so a reader never sees half a file
+    TemporaryFile temp (file);
+    return temp.getFile().replaceWithData (data.getData(), data.getSize())
+        && temp.overwriteTargetFileWithTemporary();
+}
+
+}
@@ -0,0 +1,117 @@
+/*
+    This file is part of Element
+    Copyright (C) 2021  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "JuceHeader.h"
+#include "sol/sol.hpp"
+
+namespace Element {
+
+/** Compiled Lua chunks, kept in memory and on disk.
+
+    Loading a chunk through the cache skips the Lua parser whenever the same
+    source was compiled before, in this run or an earlier one. Chunks are
+    keyed by a hash of the source text, the chunk name, the Lua release and
+    the number format, so an edited script or a different Lua build simply
+    compiles again. Each file is written with a SHA-256 of its bytecode,
+    which is checked before the bytecode reaches the Lua loader; a file that
+    doesn't match is compiled and written again.
+
+    Old chunks are dropped once the cache holds more than its limits, the
+    least recently used first, both in memory and on disk.
+
+    The cache is thread safe. Hold one with a SharedResourcePointer so the
+    chunks in memory are shared.
+ */
+class BytecodeCache final
+{
+public:
+    /** Creates a cache in the default directory */
+    BytecodeCache();
+
+    /** Creates a cache that writes to a directory. Pass File() to only
+        keep chunks in memory */
+    explicit BytecodeCache (const File& directory);
+    ~BytecodeCache();
+
+    /** Returns the default directory for bytecode files */
+    static File getDefaultDirectory();
+
+    /** Returns the directory bytecode is written to */
+    const File& getDirectory() const noexcept { return directory; }
+
+    /** Returns the key a chunk is cached with */
+    static String getKey (const char* source, size_t size, const char* chunkName);
+
+    /** Load a chunk of source. This works like luaL_loadbufferx, pushing
+        the compiled function or an error message, and returns the status */
+    int load (lua_State* L, const char* source, size_t size, const char* chunkName);
+
+    /** Load a chunk of source in to a sol state */
+    sol::load_result load (sol::state_view& view, const String& source, const String& chunkName);
+
+    /** Load one of the built-in modules embedded in BinaryData. The
+        module name is as passed to require(), e.g. 'el.script'. Returns
+        LUA_ERRFILE if the module isn't embedded, or an error status if
+        the bytecode doesn't fit this build of Lua */
+    static int loadEmbedded (lua_State* L, const String& moduleName);
+
+    /** Remove all chunks from memory and disk */
+    void clear();
+
+    /** Set how many chunks are kept in memory and on disk */
+    void setLimits (int maxChunksInMemory, int maxFilesOnDisk);
+
+    struct Stats
+    {
+        int numHits = 0;        ///< chunks loaded from memory or disk
+        int numCompiled = 0;    ///< chunks compiled from source
+    };
+
+    /** Returns hit and miss counts */
+    Stats getStats() const;
+
+private:
+    struct Chunk
+    {
+        MemoryBlock bytecode;
+        uint32 lastUsed = 0;
+    };
+
+    File directory;
+    CriticalSection lock;
+    std::map<String, Chunk> chunks;
+    uint32 useCount = 0;
+    int maxChunks = 128;
+    int maxFiles = 512;
+    Stats stats;
+
+    bool lookup (const String& key, MemoryBlock& bytecode);
+    void store (const String& key, const MemoryBlock& bytecode);
+    void remember (const String& key, const MemoryBlock& bytecode);
+    void pruneFiles();
+    static bool readFile (const File& file, MemoryBlock& bytecode);
+    static bool writeFile (const File& file, const MemoryBlock& bytecode);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BytecodeCache)
+};
+
+}
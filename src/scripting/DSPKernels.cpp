@@ -0,0 +1,311 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "lua.hpp"
+#include "lua-kv.h"
+#include "kv/lua/factories.hpp"
+#include "JuceHeader.h"
+
+extern int luaopen_kv_AudioBuffer32 (lua_State*);
+
+namespace Element {
+
+/** Block operations for kv.AudioBuffer and a biquad filter.
+
+    Every call runs over a whole buffer, or one channel of it, in native
+    code using FloatVectorOperations, so a script only loops per block
+    instead of per sample. Channels are counted from zero like the rest of
+    the kv bindings. None of these allocate, so they are safe in render.
+ */
+struct DSPKernels
+{
+    using Buffer = AudioBuffer<float>;
+
+    static Buffer& checkBuffer (lua_State* L, int index)
+    {
+        return **(Buffer**) luaL_checkudata (L, index, LKV_MT_AUDIO_BUFFER_32);
+    }
+
+    /** Returns the channel range to work on. With no channel argument that
+        is every channel, otherwise just the one given */
+    static Range<int> checkChannels (lua_State* L, const Buffer& buffer, int index)
+    {
+        if (lua_isnoneornil (L, index))
+            return { 0, buffer.getNumChannels() };
+        const auto channel = (int) luaL_checkinteger (L, index);
+        luaL_argcheck (L, isPositiveAndBelow (channel, buffer.getNumChannels()), index, "channel out of range");
+        return { channel, channel + 1 };
+    }
+
+    /** buffer:gain (g [, channel]) */
+    static int gain (lua_State* L)
+    {
+        auto& buffer = checkBuffer (L, 1);
+        const auto g = (float) luaL_checknumber (L, 2);
+        const auto channels = checkChannels (L, buffer, 3);
+        if (g == 1.f)
+            return 0;
+        for (int c = channels.getStart(); c < channels.getEnd(); ++c)
+            FloatVectorOperations::multiply (buffer.getWritePointer (c), g, buffer.getNumSamples());
+        return 0;
+    }
+
+    /** buffer:ramp (from, to [, channel]) */
+    static int ramp (lua_State* L)
+    {
+        auto& buffer = checkBuffer (L, 1);
+        const auto from = (float) luaL_checknumber (L, 2);
+        const auto to   = (float) luaL_checknumber (L, 3);
+        const auto channels = checkChannels (L, buffer, 4);
+        for (int c = channels.getStart(); c < channels.getEnd(); ++c)
+            buffer.applyGainRamp (c, 0, buffer.getNumSamples(), from, to);
+        return 0;
+    }
+
+    /** buffer:fill (value [, channel]) */
+    static int fill (lua_State* L)
+    {
+        auto& buffer = checkBuffer (L, 1);
+        const auto value = (float) luaL_checknumber (L, 2);
+        const auto channels = checkChannels (L, buffer, 3);
+        for (int c = channels.getStart(); c < channels.getEnd(); ++c)
+            FloatVectorOperations::fill (buffer.getWritePointer (c), value, buffer.getNumSamples());
+        return 0;
+    }
+
+    /** Shared by mix and copy. Arguments are
+        (dest, source [, gain [, source channel [, dest channel]]]). Without
+        channels, each source channel goes to the same dest channel */
+    template<bool add>
+    static int transfer (lua_State* L)
+    {
+        auto& dest = checkBuffer (L, 1);
+        auto& source = checkBuffer (L, 2);
+        const auto g = (float) luaL_optnumber (L, 3, 1.0);
+        const int numSamples = jmin (dest.getNumSamples(), source.getNumSamples());
+
+        Range<int> channels { 0, jmin (dest.getNumChannels(), source.getNumChannels()) };
+        int offset = 0;
+        if (! lua_isnoneornil (L, 4))
+        {
+            channels = checkChannels (L, source, 4);
+            const int destChannel = (int) luaL_optinteger (L, 5, channels.getStart());
+            luaL_argcheck (L, isPositiveAndBelow (destChannel, dest.getNumChannels()), 5, "channel out of range");
+            offset = destChannel - channels.getStart();
+        }
+
+        for (int c = channels.getStart(); c < channels.getEnd(); ++c)
+        {
+            auto* d = dest.getWritePointer (c + offset);
+            const auto* s = source.getReadPointer (c);
+            if (add)
+                FloatVectorOperations::addWithMultiply (d, s, g, numSamples);
+            else if (g == 1.f)
+                FloatVectorOperations::copy (d, s, numSamples);
+            else
+                FloatVectorOperations::copyWithMultiply (d, s, g, numSamples);
+        }
+
+        return 0;
+    }
+
+    /** buffer:peak ([channel]) */
+    static int peak (lua_State* L)
+    {
+        auto& buffer = checkBuffer (L, 1);
+        const auto channels = checkChannels (L, buffer, 2);
+        float level = 0.f;
+        for (int c = channels.getStart(); c < channels.getEnd(); ++c)
+            level = jmax (level, buffer.getMagnitude (c, 0, buffer.getNumSamples()));
+        lua_pushnumber (L, level);
+        return 1;
+    }
+
+    /** buffer:rms ([channel]). Over several channels this is the level of
+        all their samples together */
+    static int rms (lua_State* L)
+    {
+        auto& buffer = checkBuffer (L, 1);
+        const auto channels = checkChannels (L, buffer, 2);
+        double sum = 0.0;
+        for (int c = channels.getStart(); c < channels.getEnd(); ++c)
+        {
+            const float level = buffer.getRMSLevel (c, 0, buffer.getNumSamples());
+            sum += (double) level * level;
+        }
+
+        lua_pushnumber (L, channels.isEmpty() ? 0.0 : std::sqrt (sum / channels.getLength()));
+        return 1;
+    }
+};
+
+/** A biquad with its own state per channel, from el.dsp.biquad() */
+struct LuaBiquad
+{
+    enum { maxChannels = 32 };
+    IIRFilter filters [maxChannels];
+
+    static LuaBiquad& check (lua_State* L)
+    {
+        return **(LuaBiquad**) luaL_checkudata (L, 1, "el.Biquad");
+    }
+
+    void setCoefficients (const IIRCoefficients& coefficients)
+    {
+        for (auto& filter : filters)
+            filter.setCoefficients (coefficients);
+    }
+
+    /** filter:lowpass (rate, frequency [, q]) and the like */
+    template<IIRCoefficients (*make) (double, double, double)>
+    static int design (lua_State* L)
+    {
+        check (L).setCoefficients (make (luaL_checknumber (L, 2), luaL_checknumber (L, 3),
+                                         luaL_optnumber (L, 4, 1.0 / MathConstants<double>::sqrt2)));
+        return 0;
+    }
+
+    /** filter:lowshelf (rate, frequency, q, gain) and the like. gain is a
+        linear factor */
+    template<IIRCoefficients (*make) (double, double, double, float)>
+    static int designWithGain (lua_State* L)
+    {
+        check (L).setCoefficients (make (luaL_checknumber (L, 2), luaL_checknumber (L, 3),
+                                         luaL_checknumber (L, 4), (float) luaL_checknumber (L, 5)));
+        return 0;
+    }
+
+    static int reset (lua_State* L)
+    {
+        for (auto& filter : check (L).filters)
+            filter.reset();
+        return 0;
+    }
+
+    /** filter:process (buffer [, channel]) */
+    static int process (lua_State* L)
+    {
+        auto& self = check (L);
+        auto& buffer = DSPKernels::checkBuffer (L, 2);
+        const auto channels = DSPKernels::checkChannels (L, buffer, 3);
+        for (int c = channels.getStart(); c < jmin ((int) maxChannels, channels.getEnd()); ++c)
+            self.filters[c].processSamples (buffer.getWritePointer (c), buffer.getNumSamples());
+        return 0;
+    }
+};
+
+}
+
+using namespace Element;
+
+static IIRCoefficients makeLowPass (double r, double f, double q)   { return IIRCoefficients::makeLowPass (r, f, q); }
+static IIRCoefficients makeHighPass (double r, double f, double q)  { return IIRCoefficients::makeHighPass (r, f, q); }
+static IIRCoefficients makeBandPass (double r, double f, double q)  { return IIRCoefficients::makeBandPass (r, f, q); }
+static IIRCoefficients makeLowShelf (double r, double f, double q, float g)     { return IIRCoefficients::makeLowShelf (r, f, q, g); }
+static IIRCoefficients makeHighShelf (double r, double f, double q, float g)    { return IIRCoefficients::makeHighShelf (r, f, q, g); }
+static IIRCoefficients makePeakFilter (double r, double f, double q, float g)   { return IIRCoefficients::makePeakFilter (r, f, q, g); }
+
+static int biquad_new (lua_State* L)
+{
+    kv::lua::new_userdata<LuaBiquad> (L, "el.Biquad");
+    return 1;
+}
+
+static int biquad_gc (lua_State* L)
+{
+    auto** filter = (LuaBiquad**) lua_touserdata (L, 1);
+    if (nullptr != *filter)
+        deleteAndZero (*filter);
+    return 0;
+}
+
+static const luaL_Reg biquad_methods[] = {
+    { "__gc",       biquad_gc },
+    { "lowpass",    LuaBiquad::design<makeLowPass> },
+    { "highpass",   LuaBiquad::design<makeHighPass> },
+    { "bandpass",   LuaBiquad::design<makeBandPass> },
+    { "lowshelf",   LuaBiquad::designWithGain<makeLowShelf> },
+    { "highshelf",  LuaBiquad::designWithGain<makeHighShelf> },
+    { "peaking",    LuaBiquad::designWithGain<makePeakFilter> },
+    { "reset",      LuaBiquad::reset },
+    { "process",    LuaBiquad::process },
+    { nullptr, nullptr }
+};
+
+static const luaL_Reg buffer_methods[] = {
+    { "gain",       DSPKernels::gain },
+    { "ramp",       DSPKernels::ramp },
+    { "fill",       DSPKernels::fill },
+    { "mix",        DSPKernels::transfer<true> },
+    { "copyfrom",   DSPKernels::transfer<false> },
+    { "peak",       DSPKernels::peak },
+    { "rms",        DSPKernels::rms },
+    { nullptr, nullptr }
+};
+
+/** Add the kernels to kv.AudioBuffer objects, leaving alone any method the
+    buffer already has */
+static void addBufferMethods (lua_State* L)
+{
+    if (luaL_getmetatable (L, LKV_MT_AUDIO_BUFFER_32) != LUA_TTABLE)
+    {
+        lua_pop (L, 1);
+        luaopen_kv_AudioBuffer32 (L);
+        lua_pop (L, 1);
+        luaL_getmetatable (L, LKV_MT_AUDIO_BUFFER_32);
+    }
+
+    if (lua_getfield (L, -1, "__index") != LUA_TTABLE)
+    {
+        lua_pop (L, 2);
+        return;
+    }
+
+    for (const auto* reg = buffer_methods; reg->name != nullptr; ++reg)
+    {
+        if (lua_getfield (L, -1, reg->name) == LUA_TNIL)
+        {
+            lua_pushcfunction (L, reg->func);
+            lua_setfield (L, -3, reg->name);
+        }
+        lua_pop (L, 1);
+    }
+
+    lua_pop (L, 2);
+}
+
+int luaopen_el_dsp (lua_State* L)
+{
+    addBufferMethods (L);
+
+    if (luaL_newmetatable (L, "el.Biquad")) {
+        lua_pushvalue (L, -1);
+        lua_setfield (L, -2, "__index");
+        luaL_setfuncs (L, biquad_methods, 0);
+    }
+    lua_pop (L, 1);
+
+    // the module has the buffer kernels as functions too, so
+    // dsp.gain (buffer, g) works the same as buffer:gain (g)
+    luaL_newlib (L, buffer_methods);
+    lua_pushcfunction (L, biquad_new);
+    lua_setfield (L, -2, "biquad");
+    return 1;
+}
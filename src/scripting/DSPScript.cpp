@@ -46,7 +46,8 @@ class DSPScript::Parameter : public ControlPortParameter,
 public:
     Parameter (DSPScript* c, const PortDescription& port)
         : ControlPortParameter (port),
-          ctx (c)
+          ctx (c),
+          input (port.input)
     {
         const auto sp = getPort();
         set (sp.defaultValue);
@@ -68,7 +69,8 @@ public:
 
     void controlValueChanged (int index, float value) override
     {
-        if (ctx != nullptr) // index may not be set so use port channel.
+        // outputs are set by the script, only inputs feed back into it
+        if (ctx != nullptr && input) // index may not be set so use port channel.
             ctx->setParameter (getPortChannel(), convertFrom0to1 (value));
     }
 
@@ -81,8 +83,64 @@ public:
         addListener (this);
     }
 
+    /** Hand over a value from the audio thread, it is set by the publisher */
+    void post (float value) noexcept
+    {
+        posted.set (value);
+        pending.set (1);
+    }
+
+    /** Set the last value posted, if any. Message thread only */
+    void publish()
+    {
+        if (pending.compareAndSetBool (0, 1))
+            set (posted.get());
+    }
+
 private:
     DSPScript* ctx { nullptr };
+    const bool input;
+    Atomic<float> posted { 0.f };
+    Atomic<int> pending { 0 };
+};
+
+//==============================================================================
+/** Sets output parameters on the message thread, so the audio thread never
+    calls parameter listeners */
+class DSPScript::OutputPublisher : private Timer
+{
+public:
+    OutputPublisher()   { startTimerHz (30); }
+    ~OutputPublisher()  { stopTimer(); }
+
+    void add (Parameter* param)
+    {
+        const ScopedLock sl (lock);
+        params.addIfNotAlreadyThere (param);
+    }
+
+    void remove (Parameter* param)
+    {
+        const ScopedLock sl (lock);
+        params.removeObject (param);
+    }
+
+private:
+    CriticalSection lock;
+    ReferenceCountedArray<Parameter> params;
+
+    void timerCallback() override
+    {
+        // the copy keeps parameters alive if a script lets go of them
+        ReferenceCountedArray<Parameter> toPublish;
+        {
+            const ScopedLock sl (lock);
+            toPublish = params;
+        }
+
+        for (auto* param : toPublish)
+            param->publish();
+    }
 };
 
 //==============================================================================
@@ -106,6 +164,7 @@ DSPScript::DSPScript (sol::table tbl)
             require ('kv.MidiBuffer')
             require ('kv.MidiMessage')
             require ('el.MidiPipe')
+            require ('el.dsp')
         )").status() == sol::call_status::ok;
     }
 
@@ -132,18 +191,19 @@ DSPScript::DSPScript (sol::table tbl)
     }
 
     if (ok)
-    {
-        addAudioMidiPorts();
+        ok = addAudioMidiPorts();
+    if (ok)
         addParameterPorts();
-    }
 
     if (ok)
     {
         sol::state_view view (L);
         auto tmp = view.create_table();
         tmp["params"] = &paramData;
+        tmp["outputs"] = &outputData;
         params = tmp["params"];
-        ok = params.valid();
+        outputs = tmp["outputs"];
+        ok = params.valid() && outputs.valid();
     }
 
     loaded = ok;
@@ -251,6 +311,15 @@ void DSPScript::process (AudioSampleBuffer& a, MidiPipe& m)
     if (! loaded)
         return;
 
+    const int numSamples = a.getNumSamples();
+    samplesSinceCall += numSamples;
+    if (controlRate > 0 && samplesUntilCall > 0)
+    {
+        samplesUntilCall -= numSamples;
+        updateOutputs();
+        return;
+    }
+
     if (lua_rawgeti (L, LUA_REGISTRYINDEX, processRef) == LUA_TFUNCTION)
     {
         if (lua_rawgeti (L, LUA_REGISTRYINDEX, audioRef) == LUA_TUSERDATA)
@@ -259,13 +328,31 @@ void DSPScript::process (AudioSampleBuffer& a, MidiPipe& m)
             {
                 if (lua_rawgeti (L, LUA_REGISTRYINDEX, params.registry_index()) == LUA_TUSERDATA)
                 {
-                    (*audio)->setDataToReferTo (a.getArrayOfWritePointers(),
-                            a.getNumChannels(), a.getNumSamples());
-                    (*midi)->swapWith (m);
-
-                    lua_call (L, 3, 0);
-                    
-                    (*midi)->swapWith (m);
+                    if (lua_rawgeti (L, LUA_REGISTRYINDEX, outputs.registry_index()) == LUA_TUSERDATA)
+                    {
+                        (*audio)->setDataToReferTo (a.getArrayOfWritePointers(),
+                                a.getNumChannels(), numSamples);
+                        (*midi)->referTo (&m);
+                        lua_pushinteger (L, samplesSinceCall);
+                        syncParameters();
+
+                        // the ramp starts where the last one got to
+                        for (int i = 0; i < numOutputs; ++i)
+                            outputFrom[i] = outputValue[i];
+
+                        // errors are caught here so the pipe is always let go of
+                        if (lua_pcall (L, 5, 0, 0) != LUA_OK)
+                        {
+                            lua_pop (L, 1);
+                            a.clear();
+                            m.clear();
+                        }
+
+                        (*midi)->referTo (nullptr);
+                        samplesUntilCall = controlRate - numSamples;
+                        samplesSinceCall = numSamples;
+                        updateOutputs();
+                    }
                 }
             }
         }
@@ -276,6 +363,34 @@ void DSPScript::process (AudioSampleBuffer& a, MidiPipe& m)
     }
 }
 
+void DSPScript::syncParameters() noexcept
+{
+    // mapped changes are set on the parameters without telling listeners
+    for (auto* const param : inParams)
+    {
+        const int channel = param->getPortChannel();
+        const float value = param->get();
+        if (value != paramSynced[channel])
+            paramData[channel] = paramSynced[channel] = value;
+    }
+}
+
+void DSPScript::updateOutputs()
+{
+    // block rate scripts jump straight to the new values
+    const float pos = controlRate > 0
+        ? jmin (1.f, (float) samplesSinceCall / (float) controlRate) : 1.f;
+
+    for (int i = 0; i < numOutputs; ++i)
+    {
+        const float value = outputFrom[i] + (outputData[i] - outputFrom[i]) * pos;
+        if (value == outputValue[i])
+            continue;
+        outputValue[i] = value;
+        outParams.getUnchecked(i)->post (value);
+    }
+}
+
 void DSPScript::save (MemoryBlock& out)
 {
     ValueTree state ("DSP");
@@ -391,6 +506,8 @@ void DSPScript::copyParameterValues (const DSPScript& o)
 {
     for (int i = jmin (numParams, o.numParams); --i >= 0;)
         paramData[i] = o.paramData[i];
+    for (auto* const param : inParams)
+        param->update (paramData [param->getPortChannel()]);
 }
 
 void DSPScript::getParameterData (MemoryBlock& block)
@@ -425,11 +542,11 @@ void DSPScript::deref()
     midiRef = LUA_REFNIL;
 }
 
-void DSPScript::addAudioMidiPorts()
+bool DSPScript::addAudioMidiPorts()
 {
     sol::function f = DSP ["layout"];
     if (! f.valid())
-        return;
+        return true;
 
     try {
         int numAudioIn = 0, numAudioOut = 0,
@@ -445,6 +562,14 @@ void DSPScript::addAudioMidiPorts()
         sol::table midi     = layout["midi"].get_or_create<sol::table>();
         numMidiIn           = midi[1].get_or (0);
         numMidiOut          = midi[2].get_or (0);
+        controlRate         = jmax (0, layout["control_rate"].get_or (0));
+
+        // skipped blocks would pass audio and midi through unprocessed
+        if (controlRate > 0 && (numAudioOut > 0 || numMidiOut > 0))
+        {
+            layoutError = "control rate scripts can't have audio or MIDI outputs";
+            return false;
+        }
 
         int index = ports.size();
         int channel = 0;
@@ -485,6 +610,8 @@ void DSPScript::addAudioMidiPorts()
     } catch (const std::exception&) {
 
     }
+
+    return true;
 }
 
 Element::Parameter::Ptr
@@ -539,6 +666,11 @@ void DSPScript::addParameterPorts()
             {
                 paramData[channel] = dfault;
             }
+            else if (channel < maxParams)
+            {
+                outputData[channel] = outputFrom[channel]
+                                    = outputValue[channel] = dfault;
+            }
 
             ports.addControl (index++, channel, sym, name,
                               min, max, dfault, isInput);
@@ -552,8 +684,9 @@ void DSPScript::addParameterPorts()
             if (port->type == PortType::Control && port->input)
                 inParams.add (new Parameter (this, *port));
             else if (port->type == PortType::Control && !port->input)
-                outParams.add (new Parameter (this, *port));
+                publisher->add (outParams.add (new Parameter (this, *port)));
         }
+        numOutputs = jmin ((int) maxParams, outParams.size());
     }
     catch (const std::exception&) {}
 }
@@ -563,7 +696,10 @@ void DSPScript::unlinkParams()
     for (auto* p : inParams)
         p->unlink();
     for (auto* p : outParams)
+    {
         p->unlink();
+        publisher->remove (p);
+    }
     
     inParams.clearQuick();
     outParams.clearQuick();
@@ -42,9 +42,16 @@ public:
 
     static Result validate (const String& script);
 
+    /** Returns true if the script loaded and can be processed */
+    bool isLoaded() const noexcept { return loaded; }
+
+    /** Returns why the script's layout was refused, empty if it wasn't */
+    const String& getLayoutError() const noexcept { return layoutError; }
+
     //==========================================================================
     void prepare (double rate, int block)
     {
+        samplesUntilCall = samplesSinceCall = 0;
         if (sol::function f = DSP ["prepare"])
             f (rate, block);
     }
@@ -55,8 +62,17 @@ public:
     }
 
     //==========================================================================
+    /** Calls the script's process function. Scripts that set control_rate
+        in their layout are only called once that many samples have gone by,
+        the blocks in between just move the output parameters along. Audio
+        and MIDI in those blocks isn't seen, so control rate scripts can't
+        have audio or MIDI outputs */
     void process (AudioSampleBuffer& a, MidiPipe& m);
 
+    /** Returns the samples between calls to process, zero when the script
+        runs every block */
+    int getControlRate() const { return controlRate; }
+
     //==========================================================================
     void save (MemoryBlock& block);
     void restore (const void* data, size_t size);
@@ -86,19 +102,35 @@ private:
     int numParams               = 0;
     enum { maxParams = 128 };
     float paramData [maxParams];
+    float paramSynced [maxParams] {};   // parameter values last copied to paramData
     sol::userdata params;
+
+    int numOutputs              = 0;
+    float outputData [maxParams];   // written by the script
+    float outputFrom [maxParams];   // where the ramp to outputData started
+    float outputValue [maxParams];  // last value given to the parameters
+    sol::userdata outputs;
+
+    int controlRate             = 0;
+    int samplesUntilCall        = 0;
+    int samplesSinceCall        = 0;
+    String layoutError;
     kv::PortList ports;
 
     class Parameter; friend class Parameter;
     ReferenceCountedArray<Parameter> inParams, outParams;
+    class OutputPublisher;
+    SharedResourcePointer<OutputPublisher> publisher;
 
     void deref();
     void getParameterData (MemoryBlock&);
     void setParameterData (MemoryBlock&);
-    void addAudioMidiPorts();
+    bool addAudioMidiPorts();
     void addParameterPorts();
     void unlinkParams();
     void setParameter (int, float);
+    void syncParameters() noexcept;
+    void updateOutputs();
 };
 
 }
@@ -0,0 +1,389 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "lua.hpp"
+#include "scripting/LuaAllocator.h"
+
+namespace Element {
+
+namespace {
+
+inline int highestBit (size_t value) noexcept
+{
+   #if JUCE_MSVC
+    unsigned long index = 0;
+    _BitScanReverse64 (&index, (unsigned __int64) value);
+    return (int) index;
+   #else
+    return 63 - __builtin_clzll ((unsigned long long) value);
+   #endif
+}
+
+inline int lowestBit (uint32 value) noexcept
+{
+    return countNumberOfBits ((value & (~value + 1)) - 1);
+}
+
+}
+
+/** Blocks sit back to back in the arena. The two list pointers are only
+    used while the block is free, and overlap the start of its payload */
+struct LuaAllocator::Block
+{
+    static constexpr size_t freeBit = 1;
+    static constexpr size_t headerSize = 2 * sizeof (void*);
+    static constexpr size_t minPayload = 2 * sizeof (void*);
+
+    size_t size;            // payload size, freeBit set when free
+    Block* prevPhys;        // the block before this one in memory
+    Block* nextFree;
+    Block* prevFree;
+
+    size_t getSize() const noexcept     { return size & ~freeBit; }
+    bool isFree() const noexcept        { return (size & freeBit) != 0; }
+    uint8* payload() noexcept           { return reinterpret_cast<uint8*> (this) + headerSize; }
+    Block* next() noexcept              { return reinterpret_cast<Block*> (payload() + getSize()); }
+
+    static Block* fromPayload (void* ptr) noexcept
+    {
+        return reinterpret_cast<Block*> (static_cast<uint8*> (ptr) - headerSize);
+    }
+};
+
+//==============================================================================
+LuaAllocator::LuaAllocator (size_t poolSize)
+{
+    zeromem (slBitmaps, sizeof (slBitmaps));
+    zeromem (freeLists, sizeof (freeLists));
+
+    const size_t alignment = (size_t) 1 << alignLog2;
+    poolSize = jmax ((size_t) 4096, poolSize & ~(alignment - 1));
+    memory.malloc (poolSize + alignment);
+
+    arenaStart = reinterpret_cast<uint8*> ((reinterpret_cast<pointer_sized_uint> (memory.get()) + alignment - 1)
+                                           & ~(pointer_sized_uint) (alignment - 1));
+    arenaEnd = arenaStart + poolSize;
+
+    // one free block covering the arena, then an empty used block at the
+    // end so every real block has a next
+    auto* const first = reinterpret_cast<Block*> (arenaStart);
+    first->size     = (poolSize - 2 * Block::headerSize) | Block::freeBit;
+    first->prevPhys = nullptr;
+
+    auto* const sentinel = first->next();
+    sentinel->size      = 0;
+    sentinel->prevPhys  = first;
+
+    capacity = first->getSize() + Block::headerSize;
+    insertFree (first);
+}
+
+LuaAllocator::~LuaAllocator() { }
+
+//==============================================================================
+void* LuaAllocator::allocate (void* userData, void* ptr, size_t oldSize, size_t newSize) noexcept
+{
+    auto& pool = *static_cast<LuaAllocator*> (userData);
+    void* result = nullptr;
+
+    // oldSize is a type tag when ptr is null
+    if (ptr == nullptr)
+        pool.numBytesAllocated += (int64) newSize;
+    else if (newSize > oldSize)
+        pool.numBytesAllocated += (int64) (newSize - oldSize);
+
+    if (newSize == 0)
+    {
+        if (pool.owns (ptr))
+            pool.poolFree (ptr);
+        else
+            std::free (ptr);
+    }
+    else if (ptr == nullptr)
+    {
+        result = pool.poolAllocate (newSize);
+        if (result == nullptr)
+        {
+            result = std::malloc (newSize);
+            pool.numFallbacks.set (pool.numFallbacks.get() + 1);
+        }
+    }
+    else if (pool.owns (ptr))
+    {
+        result = pool.poolReallocate (ptr, newSize);
+        if (result == nullptr)
+        {
+            // Lua keeps the old block if this fails, so only free it once
+            // the copy is made
+            if ((result = std::malloc (newSize)) != nullptr)
+            {
+                memcpy (result, ptr, jmin (newSize, Block::fromPayload (ptr)->getSize()));
+                pool.poolFree (ptr);
+            }
+            pool.numFallbacks.set (pool.numFallbacks.get() + 1);
+        }
+    }
+    else
+    {
+        result = std::realloc (ptr, newSize);
+    }
+
+    pool.updateUsage();
+    return result;
+}
+
+void LuaAllocator::stopCollector (lua_State* L) noexcept
+{
+    lua_gc (L, LUA_GCSTOP);
+}
+
+void LuaAllocator::step (lua_State* L) noexcept
+{
+    // KB of allocation the step should make up for
+    const int budget = used.get() > (int64) (capacity * 3 / 4) ? 64 : 8;
+
+    const auto start = Time::getHighResolutionTicks();
+    lua_gc (L, LUA_GCSTEP, budget);
+    const double us = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) * 1.0e6;
+
+    const double average = gcAverageUs.get();
+    gcAverageUs.set (average + 0.01 * (us - average));
+    if (us > gcMaxUs.get())
+        gcMaxUs.set (us);
+}
+
+LuaAllocator::Stats LuaAllocator::getStats() const noexcept
+{
+    Stats stats;
+    stats.poolSize      = (int64) capacity;
+    stats.used          = used.get();
+    stats.peak          = peak.get();
+    stats.numFallbacks  = numFallbacks.get();
+    stats.gcAverageUs   = gcAverageUs.get();
+    stats.gcMaxUs       = gcMaxUs.get();
+    return stats;
+}
+
+void LuaAllocator::resetStats() noexcept
+{
+    peak.set (used.get());
+    numFallbacks.set (0);
+    gcAverageUs.set (0.0);
+    gcMaxUs.set (0.0);
+}
+
+String LuaAllocator::getStatusText() const
+{
+    const auto stats = getStats();
+    String text;
+    text << "Memory: " << File::descriptionOfSizeInBytes (stats.used)
+         << " of " << File::descriptionOfSizeInBytes (stats.poolSize)
+         << " (peak " << File::descriptionOfSizeInBytes (stats.peak) << ")"
+         << ", GC " << String (stats.gcAverageUs, 1) << " us avg, "
+         << String (stats.gcMaxUs, 1) << " us max";
+    if (stats.numFallbacks > 0)
+        text << ", " << stats.numFallbacks << " outside pool";
+    return text;
+}
+
+//==============================================================================
+bool LuaAllocator::owns (const void* ptr) const noexcept
+{
+    return ptr >= arenaStart && ptr < arenaEnd;
+}
+
+size_t LuaAllocator::roundUp (size_t size) noexcept
+{
+    const size_t mask = ((size_t) 1 << alignLog2) - 1;
+    return (jmax (size, Block::minPayload) + mask) & ~mask;
+}
+
+void LuaAllocator::mapping (size_t size, int& fl, int& sl) noexcept
+{
+    if (size < ((size_t) 1 << flShift))
+    {
+        fl = 0;
+        sl = (int) (size >> alignLog2);
+    }
+    else
+    {
+        const int bit = highestBit (size);
+        sl = (int) (size >> (bit - slLog2)) ^ slCount;
+        fl = bit - flShift + 1;
+    }
+}
+
+LuaAllocator::Block* LuaAllocator::findFree (size_t size) noexcept
+{
+    // round up to the next class, so any block in it is big enough
+    if (size >= ((size_t) 1 << flShift))
+        size += ((size_t) 1 << (highestBit (size) - slLog2)) - 1;
+
+    int fl, sl;
+    mapping (size, fl, sl);
+    if (fl >= flCount)
+        return nullptr;
+
+    uint32 slMap = slBitmaps[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        const uint32 flMap = fl + 1 < flCount ? flBitmap & (~0u << (fl + 1)) : 0u;
+        if (flMap == 0)
+            return nullptr;
+        fl = lowestBit (flMap);
+        slMap = slBitmaps[fl];
+    }
+
+    return freeLists [fl][lowestBit (slMap)];
+}
+
+void LuaAllocator::insertFree (Block* block) noexcept
+{
+    int fl, sl;
+    mapping (block->getSize(), fl, sl);
+    block->size |= Block::freeBit;
+    block->prevFree = nullptr;
+    block->nextFree = freeLists[fl][sl];
+    if (block->nextFree != nullptr)
+        block->nextFree->prevFree = block;
+    freeLists[fl][sl] = block;
+    flBitmap |= 1u << fl;
+    slBitmaps[fl] |= 1u << sl;
+    freeBytes += block->getSize() + Block::headerSize;
+}
+
+void LuaAllocator::removeFree (Block* block) noexcept
+{
+    int fl, sl;
+    mapping (block->getSize(), fl, sl);
+    if (block->prevFree != nullptr)
+        block->prevFree->nextFree = block->nextFree;
+    else
+        freeLists[fl][sl] = block->nextFree;
+    if (block->nextFree != nullptr)
+        block->nextFree->prevFree = block->prevFree;
+
+    if (freeLists[fl][sl] == nullptr)
+    {
+        slBitmaps[fl] &= ~(1u << sl);
+        if (slBitmaps[fl] == 0)
+            flBitmap &= ~(1u << fl);
+    }
+
+    block->size &= ~Block::freeBit;
+    freeBytes -= block->getSize() + Block::headerSize;
+}
+
+void LuaAllocator::trim (Block* block, size_t size) noexcept
+{
+    // give the end of a used block back if there's room for another block
+    if (block->getSize() < size + Block::headerSize + Block::minPayload)
+        return;
+
+    auto* const rest = reinterpret_cast<Block*> (block->payload() + size);
+    rest->size      = block->getSize() - size - Block::headerSize;
+    rest->prevPhys  = block;
+    block->size     = size;
+
+    auto* const next = rest->next();
+    if (next->isFree())
+    {
+        removeFree (next);
+        rest->size += next->getSize() + Block::headerSize;
+    }
+
+    rest->next()->prevPhys = rest;
+    insertFree (rest);
+}
+
+void* LuaAllocator::poolAllocate (size_t size) noexcept
+{
+    size = roundUp (size);
+    auto* const block = findFree (size);
+    if (block == nullptr)
+        return nullptr;
+
+    removeFree (block);
+    trim (block, size);
+    return block->payload();
+}
+
+void* LuaAllocator::poolReallocate (void* ptr, size_t size) noexcept
+{
+    auto* const block = Block::fromPayload (ptr);
+    size = roundUp (size);
+
+    // grow in to the next block when it's free and big enough
+    if (block->getSize() < size)
+    {
+        auto* const next = block->next();
+        if (! next->isFree() || block->getSize() + Block::headerSize + next->getSize() < size)
+        {
+            auto* const result = poolAllocate (size);
+            if (result != nullptr)
+            {
+                memcpy (result, ptr, block->getSize());
+                poolFree (ptr);
+            }
+            return result;
+        }
+
+        removeFree (next);
+        block->size += next->getSize() + Block::headerSize;
+        block->next()->prevPhys = block;
+    }
+
+    trim (block, size);
+    return ptr;
+}
+
+void LuaAllocator::poolFree (void* ptr) noexcept
+{
+    auto* block = Block::fromPayload (ptr);
+
+    if (auto* const prev = block->prevPhys)
+    {
+        if (prev->isFree())
+        {
+            removeFree (prev);
+            prev->size += block->getSize() + Block::headerSize;
+            block = prev;
+        }
+    }
+
+    auto* const next = block->next();
+    if (next->isFree())
+    {
+        removeFree (next);
+        block->size += next->getSize() + Block::headerSize;
+    }
+
+    block->next()->prevPhys = block;
+    insertFree (block);
+}
+
+void LuaAllocator::updateUsage() noexcept
+{
+    const auto inUse = (int64) (capacity - freeBytes);
+    used.set (inUse);
+    if (inUse > peak.get())
+        peak.set (inUse);
+}
+
+}
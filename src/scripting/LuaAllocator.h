@@ -0,0 +1,132 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+struct lua_State;
+
+namespace Element {
+
+/** A memory pool for Lua states that run on the audio thread.
+
+    Memory comes from one block allocated up front and is handed out with a
+    two level segregated fit scheme (TLSF): free blocks are kept in lists
+    by size class, found through two bitmaps, and merged with their
+    neighbours when freed. Allocating and freeing take constant time and
+    never call in to the system allocator. If the pool runs out, memory is
+    taken from the system instead and counted, so the script keeps running
+    and the pool can be made bigger.
+
+    Pass allocate() and the pool to lua_newstate() or sol::state. The pool
+    is not thread safe, which is fine as long as only one thread at a time
+    uses the state.
+
+    The pool also drives garbage collection for its state. Once a script is
+    loaded, stopCollector() turns off automatic collection, and step() runs
+    an incremental step of fixed size after each render call. Time spent
+    collecting is measured along with pool usage.
+ */
+class LuaAllocator
+{
+public:
+    struct Stats
+    {
+        int64 poolSize = 0;         ///< bytes in the pool
+        int64 used = 0;             ///< bytes of the pool in use
+        int64 peak = 0;             ///< most bytes in use since the pool was made
+        int numFallbacks = 0;       ///< allocations the pool couldn't serve
+        double gcAverageUs = 0.0;   ///< average time of a GC step
+        double gcMaxUs = 0.0;       ///< longest GC step
+    };
+
+    static constexpr size_t defaultPoolSize = 2 * 1024 * 1024;
+
+    explicit LuaAllocator (size_t poolSize = defaultPoolSize);
+    ~LuaAllocator();
+
+    /** The lua_Alloc function. userData is the LuaAllocator */
+    static void* allocate (void* userData, void* ptr, size_t oldSize, size_t newSize) noexcept;
+
+    /** Stop automatic garbage collection in a state */
+    static void stopCollector (lua_State* L) noexcept;
+
+    /** Run a bounded incremental collection step and time it. The step is
+        bigger when the pool is getting full */
+    void step (lua_State* L) noexcept;
+
+    /** Returns memory and collection measurements. Safe to call from any thread */
+    Stats getStats() const noexcept;
+
+    /** Start the peak, fallback and collection measurements over, e.g.
+        when the state is reused for another script */
+    void resetStats() noexcept;
+
+    /** Returns a short description of the stats */
+    String getStatusText() const;
+
+    /** Returns a running total of bytes Lua has asked for. It isn't
+        synchronised, so only read it on the thread using the state */
+    int64 getNumBytesAllocated() const noexcept { return numBytesAllocated; }
+
+private:
+    struct Block;
+    enum
+    {
+        alignLog2   = 4,
+        slLog2      = 4,
+        slCount     = 1 << slLog2,
+        flShift     = slLog2 + alignLog2,
+        flCount     = 24
+    };
+
+    HeapBlock<uint8> memory;
+    uint8* arenaStart = nullptr;
+    uint8* arenaEnd = nullptr;
+    size_t capacity = 0;
+    size_t freeBytes = 0;
+    int64 numBytesAllocated = 0;
+
+    uint32 flBitmap = 0;
+    uint32 slBitmaps [flCount];
+    Block* freeLists [flCount][slCount];
+
+    Atomic<int64> used { 0 }, peak { 0 };
+    Atomic<int> numFallbacks { 0 };
+    Atomic<double> gcAverageUs { 0.0 }, gcMaxUs { 0.0 };
+
+    bool owns (const void* ptr) const noexcept;
+    void* poolAllocate (size_t size) noexcept;
+    void* poolReallocate (void* ptr, size_t size) noexcept;
+    void poolFree (void* ptr) noexcept;
+
+    Block* findFree (size_t size) noexcept;
+    void insertFree (Block*) noexcept;
+    void removeFree (Block*) noexcept;
+    void trim (Block*, size_t size) noexcept;
+    void updateUsage() noexcept;
+
+    static size_t roundUp (size_t size) noexcept;
+    static void mapping (size_t size, int& fl, int& sl) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LuaAllocator)
+};
+
+}
@@ -24,6 +24,7 @@
 #include "engine/AudioEngine.h"
 #include "engine/MidiPipe.h"
 #include "gui/SystemTray.h"
+#include "scripting/BytecodeCache.h"
 #include "scripting/ScriptManager.h"
 #include "session/CommandManager.h"
 #include "session/MediaManager.h"
@@ -79,6 +80,7 @@ extern int luaopen_kv_Point (lua_State*);
 extern int luaopen_kv_Rectangle (lua_State*);
 extern int luaopen_kv_Slider (lua_State*);
 extern int luaopen_el_MidiPipe (lua_State*);
+extern int luaopen_el_dsp (lua_State*);
 
 
 using namespace sol;
@@ -365,6 +367,10 @@ static int searchInternalModules (lua_State* L)
     {
         sol::stack::push (L, luaopen_el_Session);
     }
+    else if (mod == "el.dsp")
+    {
+        sol::stack::push (L, luaopen_el_dsp);
+    }
     
     
 #define EL_LUA_INTERNAL_MOD_KV      1
@@ -457,6 +463,54 @@ static int searchInternalModules (lua_State* L)
 	return 1;
 }
 
+//==============================================================================
+/** Loads the built-in modules from the bytecode in BinaryData. If it
+    doesn't fit this build of Lua the sources are found on the path instead */
+static int searchEmbeddedModules (lua_State* L)
+{
+    const auto mod = sol::stack::get<std::string> (L);
+    if (BytecodeCache::loadEmbedded (L, mod) != LUA_OK)
+        return 1;
+    lua_pushliteral (L, ":embedded:");
+    return 2;
+}
+
+static bool loadCachedFile (lua_State* L, const String& filename)
+{
+    MemoryBlock source;
+    if (! File (filename).loadFileAsData (source))
+    {
+        lua_pushliteral (L, "cannot read file");
+        return false;
+    }
+
+    SharedResourcePointer<BytecodeCache> cache;
+    return cache->load (L, (const char*) source.getData(), source.getSize(),
+                        ("@" + filename).toRawUTF8()) == LUA_OK;
+}
+
+/** Finds Lua modules on package.path like the standard searcher, but
+    compiles them through the bytecode cache */
+static int searchCachedModules (lua_State* L)
+{
+    const char* name = luaL_checkstring (L, 1);
+    lua_getglobal (L, "package");
+    lua_getfield (L, -1, "searchpath");
+    lua_pushvalue (L, 1);
+    lua_getfield (L, -3, "path");
+    lua_call (L, 2, 2);
+    if (lua_isnil (L, -2))
+        return 1;
+
+    lua_pop (L, 1);
+    const char* filename = lua_tostring (L, -1);
+    if (! loadCachedFile (L, String::fromUTF8 (filename)))
+        return luaL_error (L, "error loading module '%s' from file '%s':\n\t%s",
+                           name, filename, lua_tostring (L, -1));
+    lua_insert (L, -2);
+    return 2;
+}
+
 //==============================================================================
 void setGlobals (sol::state_view& view, Globals& g)
 {
@@ -468,6 +522,35 @@ void clearGlobals (sol::state_view& view)
     view.globals().set ("el.globals", sol::lua_nil);
 }
 
+//==============================================================================
+/** Modules that reach objects shared with the message thread */
+static const char* const sharedModules[] = {
+    "el.CommandManager", "el.Globals", "el.Node", "el.Session"
+};
+
+static int refuseSharedModule (lua_State* L)
+{
+    return luaL_error (L, "module '%s' can't be used by a parallel script", lua_tostring (L, 1));
+}
+
+bool isolateState (sol::state_view& view)
+{
+    bool isolated = true;
+    sol::table loaded  = view["package"]["loaded"];
+    sol::table preload = view["package"]["preload"];
+
+    // preloaders are searched first, so these win over the internal modules
+    for (const auto* const mod : sharedModules)
+    {
+        if (loaded[mod].get_type() != sol::type::lua_nil)
+            isolated = false;
+        preload[mod] = refuseSharedModule;
+    }
+
+    clearGlobals (view);
+    return isolated;
+}
+
 //==============================================================================
 void initializeState (sol::state_view& view)
 {
@@ -477,8 +560,14 @@ void initializeState (sol::state_view& view)
     auto newSearchers = view.create_table();
     newSearchers.add (package ["searchers"][1]);
     newSearchers.add (searchInternalModules);
+   #if ! JUCE_DEBUG
+    // debug builds load the sources so edits show without new bytecode
+    newSearchers.add (searchEmbeddedModules);
+   #endif
+    // replaces the standard Lua file searcher
+    newSearchers.add (searchCachedModules);
     sol::table packageSearchers = package["searchers"];
-    for (int i = 2; i <= packageSearchers.size(); ++i)
+    for (int i = 3; i <= packageSearchers.size(); ++i)
         newSearchers.add (package["searchers"][i]);
     package["searchers"] = newSearchers;
 
@@ -30,6 +30,11 @@ extern void initializeState (sol::state_view&);
 extern void initializeState (sol::state_view&, Globals&);
 extern void setGlobals (sol::state_view&, Globals&);
 extern void clearGlobals (sol::state_view&);
+
+/** Refuse the modules that reach the session and other shared application
+    state, for a state whose script may render on an engine worker. Returns
+    false if the script loaded one of them already */
+extern bool isolateState (sol::state_view&);
 }
 
 }
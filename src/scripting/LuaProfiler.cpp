@@ -0,0 +1,298 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "lua.hpp"
+#include "scripting/LuaAllocator.h"
+#include "scripting/LuaProfiler.h"
+
+namespace Element {
+
+namespace {
+// the hook only gets the state, this finds the profiler that installed it
+thread_local LuaProfiler* activeProfiler = nullptr;
+
+inline double ticksToMs (int64 ticks)
+{
+    return Time::highResolutionTicksToSeconds (ticks) * 1000.0;
+}
+}
+
+//==============================================================================
+struct LuaProfiler::Slot
+{
+    Atomic<int> used { 0 };
+    char source [LUA_IDSIZE];
+    char function [32];
+    int defined = 0;
+    int line = 0;
+    Atomic<int64> ticks { 0 }, bytes { 0 };
+    Atomic<int> numSamples { 0 };
+};
+
+//==============================================================================
+LuaProfiler::LuaProfiler (int instructionsPerSample)
+    : slots (new Slot [numSlots]),
+      period (jmax (1, instructionsPerSample))
+{
+}
+
+LuaProfiler::~LuaProfiler()
+{
+    jassert (! hooked);
+}
+
+void LuaProfiler::setEnabled (bool shouldBeEnabled) noexcept
+{
+    // each run starts with a clean table
+    if (shouldBeEnabled && ! isEnabled())
+        reset();
+    enabled.set (shouldBeEnabled ? 1 : 0);
+}
+
+void LuaProfiler::reset() noexcept
+{
+    resetPending.set (1);
+}
+
+void LuaProfiler::begin (lua_State* L, LuaAllocator* pool) noexcept
+{
+    if (resetPending.compareAndSetBool (0, 1))
+        clear();
+    if (! isEnabled())
+        return;
+
+    allocator = pool;
+    lastSlot = nullptr;
+    lastBytes = allocator != nullptr ? allocator->getNumBytesAllocated() : 0;
+    startTicks = lastTicks = Time::getHighResolutionTicks();
+
+    activeProfiler = this;
+    lua_sethook (L, &LuaProfiler::hook, LUA_MASKCOUNT, period);
+    hooked = true;
+}
+
+void LuaProfiler::end (lua_State* L) noexcept
+{
+    if (! hooked)
+        return;
+
+    lua_sethook (L, nullptr, 0, 0);
+    activeProfiler = nullptr;
+    hooked = false;
+
+    // whatever ran after the last sample most likely stayed put
+    if (lastSlot != nullptr)
+        charge (lastSlot, false);
+
+    totalTicks += Time::getHighResolutionTicks() - startTicks;
+    numCalls += 1;
+}
+
+void LuaProfiler::hook (lua_State* L, lua_Debug* ar)
+{
+    if (auto* const profiler = activeProfiler)
+        profiler->sample (L, ar);
+}
+
+void LuaProfiler::sample (lua_State* L, lua_Debug* ar) noexcept
+{
+    if (lua_getinfo (L, "nSl", ar) == 0)
+        return;
+    lastSlot = find (*ar);
+    charge (lastSlot, true);
+}
+
+void LuaProfiler::charge (Slot* slot, bool countSample) noexcept
+{
+    const auto now = Time::getHighResolutionTicks();
+    const auto allocated = allocator != nullptr ? allocator->getNumBytesAllocated() : 0;
+
+    if (slot != nullptr)
+    {
+        slot->ticks += now - lastTicks;
+        slot->bytes += allocated - lastBytes;
+        if (countSample)
+            slot->numSamples += 1;
+    }
+
+    lastTicks = now;
+    lastBytes = allocated;
+}
+
+LuaProfiler::Slot* LuaProfiler::find (const lua_Debug& ar) noexcept
+{
+    uint32 hash = 2166136261u;
+    for (const char* c = ar.short_src; *c != 0; ++c)
+        hash = (hash ^ (uint8) *c) * 16777619u;
+    hash = (hash ^ (uint32) ar.linedefined) * 16777619u;
+    hash = (hash ^ (uint32) ar.currentline) * 16777619u;
+
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& slot = slots[(hash + (uint32) i) % numSlots];
+        if (slot.used.get() == 0)
+        {
+            strncpy (slot.source, ar.short_src, sizeof (slot.source) - 1);
+            slot.source [sizeof (slot.source) - 1] = 0;
+
+            const char* name = ar.name != nullptr ? ar.name
+                : (ar.what != nullptr && strcmp (ar.what, "main") == 0 ? "main chunk" : "?");
+            strncpy (slot.function, name, sizeof (slot.function) - 1);
+            slot.function [sizeof (slot.function) - 1] = 0;
+
+            slot.defined = ar.linedefined;
+            slot.line = ar.currentline;
+            slot.used.set (1);
+            return &slot;
+        }
+
+        if (slot.line == ar.currentline && slot.defined == ar.linedefined
+            && strcmp (slot.source, ar.short_src) == 0)
+            return &slot;
+    }
+
+    // table is full, the sample is dropped
+    return nullptr;
+}
+
+void LuaProfiler::clear() noexcept
+{
+    for (int i = 0; i < numSlots; ++i)
+    {
+        auto& slot = slots[i];
+        slot.used.set (0);
+        slot.ticks.set (0);
+        slot.bytes.set (0);
+        slot.numSamples.set (0);
+    }
+
+    lastSlot = nullptr;
+    totalTicks.set (0);
+    numCalls.set (0);
+}
+
+//==============================================================================
+Array<LuaProfiler::Line> LuaProfiler::getLines() const
+{
+    Array<Line> lines;
+    for (int i = 0; i < numSlots; ++i)
+    {
+        const auto& slot = slots[i];
+        if (slot.used.get() == 0)
+            continue;
+
+        Line line;
+        line.function   = String (CharPointer_UTF8 (slot.function));
+        line.source     = String (CharPointer_UTF8 (slot.source));
+        line.defined    = slot.defined;
+        line.line       = slot.line;
+        line.ms         = ticksToMs (slot.ticks.get());
+        line.bytes      = slot.bytes.get();
+        line.numSamples = slot.numSamples.get();
+        lines.add (line);
+    }
+
+    std::sort (lines.begin(), lines.end(), [] (const Line& a, const Line& b) {
+        return a.ms > b.ms;
+    });
+
+    return lines;
+}
+
+double LuaProfiler::getTotalMs() const noexcept
+{
+    return ticksToMs (totalTicks.get());
+}
+
+String LuaProfiler::getSummary (int maxLinesPerFunction) const
+{
+    const auto lines = getLines();
+    const int calls = getNumCalls();
+    const double total = getTotalMs();
+
+    String text ("Lua profile: ");
+    text << calls << " calls, " << String (calls > 0 ? total / calls : 0.0, 4)
+         << " ms per call" << newLine;
+    if (lines.isEmpty() || total <= 0.0)
+        return text << "  nothing sampled yet" << newLine;
+
+    struct Function
+    {
+        String name, where;
+        double ms = 0.0;
+        int64 bytes = 0;
+        Array<int> lines;
+    };
+
+    // lines are busiest first, so each function's lines stay in order
+    Array<Function> functions;
+    for (int i = 0; i < lines.size(); ++i)
+    {
+        const auto& line = lines.getReference (i);
+        const String where = line.source + ":" + String (line.defined);
+
+        int index = 0;
+        while (index < functions.size() && functions.getReference (index).where != where)
+            ++index;
+        if (index == functions.size())
+        {
+            Function function;
+            function.name  = line.function;
+            function.where = where;
+            functions.add (function);
+        }
+
+        auto& function = functions.getReference (index);
+        function.ms    += line.ms;
+        function.bytes += line.bytes;
+        function.lines.add (i);
+    }
+
+    std::sort (functions.begin(), functions.end(), [] (const Function& a, const Function& b) {
+        return a.ms > b.ms;
+    });
+
+    auto percent = [total] (double ms) {
+        return String (100.0 * ms / total, 1).paddedLeft (' ', 5) + "%";
+    };
+
+    for (const auto& function : functions)
+    {
+        const double share = jlimit (0.0, 1.0, function.ms / total);
+        text << percent (function.ms) << " "
+             << String::repeatedString ("#", roundToInt (share * 20.0)).paddedRight (' ', 20) << " "
+             << function.name << " (" << function.where << ")";
+        if (function.bytes > 0 && calls > 0)
+            text << ", " << File::descriptionOfSizeInBytes (function.bytes / calls) << " per call";
+        text << newLine;
+
+        for (int i = 0; i < jmin (maxLinesPerFunction, function.lines.size()); ++i)
+        {
+            const auto& line = lines.getReference (function.lines.getUnchecked (i));
+            text << "       " << percent (line.ms) << "  line " << line.line;
+            if (line.bytes > 0)
+                text << ", " << File::descriptionOfSizeInBytes (line.bytes) << " allocated";
+            text << newLine;
+        }
+    }
+
+    return text;
+}
+
+}
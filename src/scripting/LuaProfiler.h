@@ -0,0 +1,115 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+struct lua_State;
+struct lua_Debug;
+
+namespace Element {
+
+class LuaAllocator;
+
+/** Finds out where a DSP script spends its time and memory.
+
+    While enabled, a count hook interrupts the script every so many VM
+    instructions. Time and pool allocations since the last interruption
+    are charged to the function and line running at that moment, so the
+    busiest lines collect the most. Samples are kept in a fixed table,
+    nothing is allocated on the audio thread, and results can be read
+    from any thread while the script keeps running.
+
+    Wrap each call in to the script with begin() and end() on the thread
+    that makes it. The hook is only installed in between.
+ */
+class LuaProfiler
+{
+public:
+    /** What was charged to one line of a script */
+    struct Line
+    {
+        String function;        ///< function name, or "?" if Lua couldn't tell
+        String source;          ///< short name of the chunk
+        int defined = 0;        ///< line the function starts on
+        int line = 0;           ///< line that was running
+        double ms = 0.0;        ///< time charged to the line
+        int64 bytes = 0;        ///< bytes allocated while on the line
+        int numSamples = 0;     ///< times the hook landed on the line
+    };
+
+    explicit LuaProfiler (int instructionsPerSample = 200);
+    ~LuaProfiler();
+
+    /** Turn profiling on or off. Takes effect at the next begin() */
+    void setEnabled (bool shouldBeEnabled) noexcept;
+
+    /** Returns true if calls are being profiled */
+    bool isEnabled() const noexcept { return enabled.get() != 0; }
+
+    /** Forget everything collected. Takes effect at the next begin() */
+    void reset() noexcept;
+
+    /** Call before running the script. The allocator may be null, in
+        which case no allocations are counted */
+    void begin (lua_State* L, LuaAllocator* allocator) noexcept;
+
+    /** Call after the script returns */
+    void end (lua_State* L) noexcept;
+
+    /** Returns the lines sampled so far, busiest first */
+    Array<Line> getLines() const;
+
+    /** Returns the number of profiled calls */
+    int getNumCalls() const noexcept { return numCalls.get(); }
+
+    /** Returns the time spent in profiled calls */
+    double getTotalMs() const noexcept;
+
+    /** Returns a text report with functions ordered by time and their
+        busiest lines under each. Bars show the share of the total */
+    String getSummary (int maxLinesPerFunction = 4) const;
+
+private:
+    struct Slot;
+    enum { numSlots = 256 };
+    std::unique_ptr<Slot[]> slots;
+    const int period;
+
+    Atomic<int> enabled { 0 }, resetPending { 0 };
+    Atomic<int> numCalls { 0 };
+    Atomic<int64> totalTicks { 0 };
+
+    // only touched by the thread running the script
+    bool hooked = false;
+    LuaAllocator* allocator = nullptr;
+    Slot* lastSlot = nullptr;
+    int64 startTicks = 0, lastTicks = 0, lastBytes = 0;
+
+    static void hook (lua_State*, lua_Debug*);
+    void sample (lua_State*, lua_Debug*) noexcept;
+    void charge (Slot*, bool countSample) noexcept;
+    Slot* find (const lua_Debug&) noexcept;
+    void clear() noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LuaProfiler)
+};
+
+}
@@ -0,0 +1,282 @@
+/*
+    This file is part of Element
+    Copyright (C) 2021  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#include "scripting/LuaBindings.h"
+#include "scripting/LuaStatePool.h"
+
+namespace Element {
+
+/** Modules the DSP nodes use, loaded in every state */
+static const char* dspModules = R"(
+require ('kv.AudioBuffer')
+require ('kv.MidiBuffer')
+require ('kv.MidiMessage')
+require ('kv.midi')
+require ('kv.audio')
+require ('el.MidiPipe')
+require ('el.dsp')
+)";
+
+/** Records the fields and metatables of the globals, and of the tables
+    in the registry, two tables deep, along with the upvalues of functions
+    found there and the metatables shared by each type, e.g. strings.
+    Returns a function that puts them all back. Library functions are kept
+    as upvalues so a script can't break the reset by replacing them */
+static const char* snapshotScript = R"(
+local next, rawset, type = next, rawset, type
+local getmetatable, setmetatable = debug.getmetatable, debug.setmetatable
+local getupvalue, setupvalue = debug.getupvalue, debug.setupvalue
+local saved, upvalues = {}, {}
+local save
+
+local function saveUpvalues (f)
+    if upvalues[f] then return end
+    local values, i = {}, 1
+    while true do
+        local name, v = getupvalue (f, i)
+        if name == nil then break end
+        values[i] = { v }
+        if type (v) == 'table' then save (v, 0) end
+        i = i + 1
+    end
+    upvalues[f] = values
+end
+
+save = function (t, depth)
+    if saved[t] then return end
+    local fields = {}
+    for k, v in next, t do fields[k] = v end
+    saved[t] = { fields = fields, meta = getmetatable (t) }
+    if depth > 0 then
+        for _, v in next, fields do
+            if type (v) == 'table' then save (v, depth - 1)
+            elseif type (v) == 'function' then saveUpvalues (v) end
+        end
+    end
+end
+
+-- one value of each type whose metatable is shared by the whole type
+local samples = { false, 0, '', next }
+if coroutine then samples[#samples + 1] = coroutine.create (next) end
+local typeMetas, nilMeta = {}, getmetatable (nil)
+for i, v in next, samples do
+    typeMetas[i] = getmetatable (v)
+    if typeMetas[i] then save (typeMetas[i], 1) end
+end
+
+for k, v in next, debug.getregistry() do
+    if type (k) == 'string' and type (v) == 'table' then save (v, 2) end
+end
+save (_G, 2)
+
+return function()
+    for t, s in next, saved do
+        local fields = s.fields
+        for k in next, t do
+            if fields[k] == nil then rawset (t, k, nil) end
+        end
+        for k, v in next, fields do rawset (t, k, v) end
+        setmetatable (t, s.meta)
+    end
+
+    for f, values in next, upvalues do
+        for i, v in next, values do setupvalue (f, i, v[1]) end
+    end
+
+    for i, v in next, samples do setmetatable (v, typeMetas[i]) end
+    setmetatable (nil, nilMeta)
+end
+)";
+
+//=============================================================================
+LuaStatePool::State::State()
+    : lua (sol::default_at_panic, &LuaAllocator::allocate, &allocator),
+      resetRef (LUA_NOREF)
+{
+    Lua::initializeState (lua);
+    auto loaded = lua.safe_script (dspModules, sol::script_pass_on_error);
+    jassert (loaded.valid());
+
+    auto snapshot = lua.safe_script (snapshotScript, sol::script_pass_on_error);
+    if (snapshot.valid() && snapshot.get_type() == sol::type::function)
+    {
+        sol::function resetFunction = snapshot;
+        sol::stack::push (lua, resetFunction);
+        resetRef = luaL_ref (lua, LUA_REGISTRYINDEX);
+    }
+
+    jassert (resetRef != LUA_NOREF);
+    lua.collect_garbage();
+}
+
+LuaStatePool::State::~State() { }
+
+bool LuaStatePool::State::reset()
+{
+    auto* const L = getLuaState();
+    lua_settop (L, 0);
+    lua_gc (L, LUA_GCRESTART);
+
+    if (resetRef == LUA_NOREF || lua_rawgeti (L, LUA_REGISTRYINDEX, resetRef) != LUA_TFUNCTION
+        || lua_pcall (L, 0, 0, 0) != LUA_OK)
+    {
+        lua_settop (L, 0);
+        return false;
+    }
+
+    lua_gc (L, LUA_GCCOLLECT);
+    allocator.resetStats();
+    return true;
+}
+
+//=============================================================================
+LuaStatePool::LuaStatePool()
+    : Thread ("elLuaPool")
+{
+    startThread();
+}
+
+LuaStatePool::~LuaStatePool()
+{
+    stopThread (5000);
+}
+
+std::unique_ptr<LuaStatePool::State> LuaStatePool::acquire()
+{
+    {
+        const ScopedLock sl (lock);
+        if (ready.size() > 0)
+        {
+            std::unique_ptr<State> state (ready.removeAndReturn (ready.size() - 1));
+            notify();
+            return state;
+        }
+
+        ++stats.numMisses;
+    }
+
+    notify();
+    return makeState();
+}
+
+void LuaStatePool::recycle (std::unique_ptr<State> state)
+{
+    if (state == nullptr)
+        return;
+
+    {
+        const ScopedLock sl (lock);
+        returned.add (state.release());
+    }
+
+    notify();
+}
+
+void LuaStatePool::setNumReady (int numStates)
+{
+    {
+        const ScopedLock sl (lock);
+        numReady = jmax (0, numStates);
+    }
+
+    notify();
+}
+
+int LuaStatePool::getNumReady() const
+{
+    const ScopedLock sl (lock);
+    return ready.size();
+}
+
+bool LuaStatePool::waitUntilReady (int timeoutMs)
+{
+    const auto end = Time::getMillisecondCounter() + (uint32) jmax (0, timeoutMs);
+    for (;;)
+    {
+        {
+            const ScopedLock sl (lock);
+            if (ready.size() >= numReady && returned.isEmpty())
+                return true;
+        }
+
+        if (Time::getMillisecondCounter() >= end)
+            return false;
+        Thread::sleep (1);
+    }
+}
+
+LuaStatePool::Stats LuaStatePool::getStats() const
+{
+    const ScopedLock sl (lock);
+    return stats;
+}
+
+std::unique_ptr<LuaStatePool::State> LuaStatePool::makeState()
+{
+    const auto start = Time::getHighResolutionTicks();
+    std::unique_ptr<State> state (new State());
+    const double ms = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) * 1000.0;
+
+    const ScopedLock sl (lock);
+    ++stats.numMade;
+    stats.averageMakeMs += (ms - stats.averageMakeMs) / (double) stats.numMade;
+    return state;
+}
+
+void LuaStatePool::run()
+{
+    while (! threadShouldExit())
+    {
+        std::unique_ptr<State> state;
+        bool wantsMore = false;
+
+        {
+            const ScopedLock sl (lock);
+            state.reset (returned.removeAndReturn (0));
+            wantsMore = ready.size() < numReady;
+        }
+
+        if (state != nullptr)
+        {
+            // states that can't be reset or aren't needed are deleted here
+            if (state->reset())
+            {
+                const ScopedLock sl (lock);
+                if (ready.size() < numReady)
+                {
+                    ready.add (state.release());
+                    ++stats.numReused;
+                }
+            }
+        }
+        else if (wantsMore)
+        {
+            auto made = makeState();
+            const ScopedLock sl (lock);
+            ready.add (made.release());
+        }
+        else
+        {
+            wait (-1);
+        }
+    }
+}
+
+}
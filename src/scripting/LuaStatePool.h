@@ -0,0 +1,113 @@
+/*
+    This file is part of Element
+    Copyright (C) 2021  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+
+#pragma once
+
+#include "scripting/LuaAllocator.h"
+#include "sol/sol.hpp"
+
+namespace Element {
+
+/** Lua states for script nodes, made ready ahead of time.
+
+    A new state has to open the standard libraries, register the Element
+    bindings and load the DSP modules before it can run a script. That
+    adds up when several script nodes are made at once or a session full
+    of them loads. The pool keeps a few states ready, made on a background
+    thread, and makes more as they are handed out.
+
+    Nodes give their state back when done with it. The pool resets it to
+    how it was when first made: globals, loaded modules and the tables
+    they hold get back their original fields and metatables, then garbage
+    is collected. Reset states are handed out again, so hold one with a
+    SharedResourcePointer to share the pool.
+ */
+class LuaStatePool : private Thread
+{
+public:
+    /** A Lua state with its own memory pool */
+    class State final
+    {
+    public:
+        ~State();
+
+        LuaAllocator& getAllocator() noexcept   { return allocator; }
+        sol::state& getState() noexcept         { return lua; }
+        lua_State* getLuaState() const noexcept { return lua.lua_state(); }
+
+        /** Put the state back how it was when made. Returns false if that
+            failed, and the state shouldn't be used again */
+        bool reset();
+
+    private:
+        friend class LuaStatePool;
+        State();
+
+        LuaAllocator allocator;
+        sol::state lua;
+        int resetRef;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (State)
+    };
+
+    struct Stats
+    {
+        int numMade = 0;            ///< states made from scratch
+        int numReused = 0;          ///< states given back and reset for reuse
+        int numMisses = 0;          ///< requests that found nothing ready
+        double averageMakeMs = 0.0; ///< time to make and set up a state
+    };
+
+    LuaStatePool();
+    ~LuaStatePool();
+
+    /** Take a ready state. If none is ready one is made on the calling
+        thread */
+    std::unique_ptr<State> acquire();
+
+    /** Give a state back. It gets reset on the background thread */
+    void recycle (std::unique_ptr<State>);
+
+    /** Set how many states are kept ready */
+    void setNumReady (int numStates);
+
+    /** Returns how many states are ready right now */
+    int getNumReady() const;
+
+    /** Block until the pool is topped up, or the timeout passes. Returns
+        true if the pool is full */
+    bool waitUntilReady (int timeoutMs);
+
+    /** Returns counts and timing */
+    Stats getStats() const;
+
+private:
+    CriticalSection lock;
+    OwnedArray<State> ready, returned;
+    int numReady = 2;
+    Stats stats;
+
+    std::unique_ptr<State> makeState();
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LuaStatePool)
+};
+
+}
@@ -18,6 +18,7 @@
 */
 
 #include "sol/sol.hpp"
+#include "scripting/BytecodeCache.h"
 #include "scripting/LuaBindings.h"
 #include "scripting/ScriptDescription.h"
 #include "scripting/Script.h"
@@ -78,11 +79,12 @@ bool Script::load (const String& buffer)
     
     sol::state_view view (L);
     info = ScriptDescription::parse (buffer);
-    std::string chunk = info.name.isNotEmpty() ? info.name.toStdString() : "script=";
+    const String chunk = info.name.isNotEmpty() ? info.name : String ("script=");
     error = "";
 
     try {
-        loaded = view.load_buffer (buffer.toRawUTF8(), (size_t) buffer.length(), chunk);
+        SharedResourcePointer<BytecodeCache> cache;
+        loaded = cache->load (view, buffer, chunk);
         switch (loaded.status())
         {
             case sol::load_status::file:
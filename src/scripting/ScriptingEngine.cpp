@@ -18,6 +18,8 @@
 */
 
 #include "sol/sol.hpp"
+#include "scripting/BytecodeCache.h"
+#include "scripting/LuaStatePool.h"
 #include "scripting/ScriptingEngine.h"
 #include "scripting/ScriptManager.h"
 #include "scripting/LuaBindings.h"
@@ -64,6 +66,10 @@ private:
     friend class ScriptingEngine;
     ScriptingEngine& owner;
     ScriptManager manager;
+    // keeps compiled chunks in memory while the app runs
+    SharedResourcePointer<BytecodeCache> bytecode;
+    // keeps states ready for script nodes
+    SharedResourcePointer<LuaStatePool> statePool;
 };
 
 //=============================================================================
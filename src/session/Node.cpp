@@ -361,7 +361,7 @@ bool Node::writeToFile (const File& targetFile) const
     return false;
 }
 
-bool Node::savePresetTo (const DataPath& path, const String& name) const
+bool Node::savePresetTo (const DataPath& path, const String& name, File* savedFile) const
 {
     {
         // hack: ensure the plugin's state info is up-to-date
@@ -374,6 +374,8 @@ bool Node::savePresetTo (const DataPath& path, const String& name) const
     preset.addChild (data, -1, 0);
     
     const auto targetFile = path.createNewPresetFile (*this, name);
+    if (savedFile != nullptr)
+        *savedFile = targetFile;
     data.setProperty (Tags::name, targetFile.getFileNameWithoutExtension(), 0);
     data.setProperty (Tags::type, Tags::node.toString(), 0);
     
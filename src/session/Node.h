@@ -409,8 +409,9 @@ public:
     /** Write the contents of this node to file */
     bool writeToFile (const File& file) const;
 
-    /** Save this node as a preset to file */
-    bool savePresetTo (const DataPath& path, const String& name) const;
+    /** Save this node as a preset to file. If savedFile isn't null it is set
+        to the file that was written */
+    bool savePresetTo (const DataPath& path, const String& name, File* savedFile = nullptr) const;
     
     /** Get an array of possible sources that can connect to this Node */
     void getPossibleSources (NodeArray& nodes) const;
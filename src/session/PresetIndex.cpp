@@ -0,0 +1,388 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "session/Node.h"
+#include "session/PresetIndex.h"
+#include "DataPath.h"
+
+namespace Element {
+
+namespace {
+const int indexVersion = 2;
+
+inline bool lessByKey (const PresetDescription& a, const PresetDescription& b)
+{
+    const int formats = a.format.compare (b.format);
+    return formats != 0 ? formats < 0 : a.identifier.compare (b.identifier) < 0;
+}
+
+inline bool lessByKeyAndName (const PresetDescription& a, const PresetDescription& b)
+{
+    if (lessByKey (a, b)) return true;
+    if (lessByKey (b, a)) return false;
+    return a.name < b.name;
+}
+
+inline bool lessByFile (const PresetDescription& a, const PresetDescription& b)
+{
+    const int formats = a.format.compare (b.format);
+    return formats != 0 ? formats < 0 : a.fileOrIdentifier.compare (b.fileOrIdentifier) < 0;
+}
+
+inline bool lessByFileAndName (const PresetDescription& a, const PresetDescription& b)
+{
+    if (lessByFile (a, b)) return true;
+    if (lessByFile (b, a)) return false;
+    return a.name < b.name;
+}
+}
+
+//==============================================================================
+PresetIndex::PresetIndex()
+    : PresetIndex (DataPath().getRootDir().getChildFile ("Presets"), getDefaultIndexFile())
+{
+}
+
+PresetIndex::PresetIndex (const File& dir, const File& file)
+    : Thread ("elPresetIndex"),
+      directory (dir),
+      indexFile (file)
+{
+}
+
+PresetIndex::~PresetIndex()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (5000);
+}
+
+File PresetIndex::getDefaultIndexFile()
+{
+    return DataPath::applicationDataDir().getChildFile ("Cache/Presets.index");
+}
+
+void PresetIndex::scanAsync()
+{
+    scanPending.set (1);
+    if (! isThreadRunning())
+        startThread (3);
+    notify();
+}
+
+void PresetIndex::scanNow()
+{
+    scan();
+}
+
+void PresetIndex::update()
+{
+    loadSaved();
+    scanAsync();
+}
+
+void PresetIndex::addFile (const File& file)
+{
+    Entry entry;
+    parse (file, entry.preset);
+    entry.preset.file = file;
+    entry.size = file.getSize();
+    entry.modified = file.getLastModificationTime().toMilliseconds();
+    ++numFilesParsed;
+
+    {
+        const ScopedLock sl (addedLock);
+        added[file.getFullPathName()] = entry;
+    }
+
+    // a running scan merges the file when its walk is done
+    const ScopedTryLock stl (scanLock);
+    if (stl.isLocked())
+    {
+        loadSaved();
+        takeAdded (entries);
+        publish();
+        save();
+    }
+    else
+    {
+        publishAdded (entry.preset);
+    }
+
+    sendChangeMessage();
+}
+
+void PresetIndex::run()
+{
+    while (! threadShouldExit())
+    {
+        if (scanPending.compareAndSetBool (0, 1))
+            scan();
+        else
+            wait (-1);
+    }
+}
+
+void PresetIndex::getPresetsFor (const String& format, const String& identifier,
+                                 OwnedArray<PresetDescription>& results) const
+{
+    PresetDescription key;
+    key.format = format;
+    key.identifier = identifier;
+
+    const ScopedLock sl (lock);
+    for (auto* iter = std::lower_bound (presets.begin(), presets.end(), key, lessByKey);
+         iter != presets.end() && ! lessByKey (key, *iter); ++iter)
+    {
+        results.add (new PresetDescription (*iter));
+    }
+}
+
+void PresetIndex::getPresetsForFileOrIdentifier (const String& format, const String& fileOrIdentifier,
+                                                 OwnedArray<PresetDescription>& results) const
+{
+    PresetDescription key;
+    key.format = format;
+    key.fileOrIdentifier = fileOrIdentifier;
+
+    const ScopedLock sl (lock);
+    for (auto* iter = std::lower_bound (byFile.begin(), byFile.end(), key, lessByFile);
+         iter != byFile.end() && ! lessByFile (key, *iter); ++iter)
+    {
+        results.add (new PresetDescription (*iter));
+    }
+}
+
+int PresetIndex::getNumPresets() const
+{
+    const ScopedLock sl (lock);
+    return presets.size();
+}
+
+void PresetIndex::clear()
+{
+    const ScopedLock sl (scanLock);
+    loadSaved();
+    entries.clear();
+    {
+        const ScopedLock sl2 (addedLock);
+        added.clear();
+    }
+    publish();
+}
+
+//==============================================================================
+void PresetIndex::scan()
+{
+    const ScopedLock sl (scanLock);
+
+    // what was saved last time is good to use while the scan runs
+    loadSaved();
+
+    std::map<String, Entry> found;
+    int numParsed = 0;
+
+    if (directory.isDirectory())
+    {
+        DirectoryIterator iter (directory, true, EL_PRESET_FILE_EXTENSIONS);
+        bool isDirectory = false, isHidden = false, isReadOnly = false;
+        int64 size = 0;
+        Time modified, created;
+
+        while (iter.next (&isDirectory, &isHidden, &size, &modified, &created, &isReadOnly))
+        {
+            if (threadShouldExit())
+                return;
+
+            const auto file = iter.getFile();
+            const auto path = file.getFullPathName();
+            const auto known = entries.find (path);
+            if (known != entries.end() && known->second.size == size
+                && known->second.modified == modified.toMilliseconds())
+            {
+                found.emplace (path, known->second);
+                continue;
+            }
+
+            // files that aren't presets are kept too, so they aren't parsed
+            // on every scan
+            Entry entry;
+            parse (file, entry.preset);
+            entry.preset.file = file;
+            entry.size = size;
+            entry.modified = modified.toMilliseconds();
+            found.emplace (path, entry);
+            ++numParsed;
+        }
+    }
+
+    numFilesParsed += numParsed;
+    const bool hadAdded = takeAdded (found);
+    if (! hadAdded && numParsed == 0 && found.size() == entries.size())
+        return;
+
+    entries.swap (found);
+    publish();
+    save();
+    sendChangeMessage();
+}
+
+void PresetIndex::loadSaved()
+{
+    const ScopedLock sl (loadLock);
+    if (loaded)
+        return;
+    load();
+    loaded = true;
+    publish();
+}
+
+void PresetIndex::publish()
+{
+    Array<PresetDescription> newPresets;
+    {
+        // files still waiting to be merged stay visible
+        const ScopedLock sl (addedLock);
+        newPresets.ensureStorageAllocated ((int) (entries.size() + added.size()));
+        for (const auto& entry : entries)
+            if (entry.second.preset.format.isNotEmpty() && entry.second.preset.identifier.isNotEmpty()
+                && added.find (entry.first) == added.end())
+                newPresets.add (entry.second.preset);
+        for (const auto& entry : added)
+            if (entry.second.preset.format.isNotEmpty() && entry.second.preset.identifier.isNotEmpty())
+                newPresets.add (entry.second.preset);
+    }
+
+    Array<PresetDescription> newByFile (newPresets);
+    std::sort (newPresets.begin(), newPresets.end(), lessByKeyAndName);
+    std::sort (newByFile.begin(), newByFile.end(), lessByFileAndName);
+
+    const ScopedLock sl (lock);
+    presets.swapWith (newPresets);
+    byFile.swapWith (newByFile);
+}
+
+void PresetIndex::publishAdded (const PresetDescription& preset)
+{
+    const ScopedLock sl (lock);
+    for (int i = presets.size(); --i >= 0;)
+        if (presets.getReference (i).file == preset.file)
+            presets.remove (i);
+    for (int i = byFile.size(); --i >= 0;)
+        if (byFile.getReference (i).file == preset.file)
+            byFile.remove (i);
+
+    if (preset.format.isEmpty() || preset.identifier.isEmpty())
+        return;
+
+    presets.insert ((int) (std::upper_bound (presets.begin(), presets.end(), preset, lessByKeyAndName)
+                            - presets.begin()), preset);
+    byFile.insert ((int) (std::upper_bound (byFile.begin(), byFile.end(), preset, lessByFileAndName)
+                            - byFile.begin()), preset);
+}
+
+bool PresetIndex::takeAdded (std::map<String, Entry>& target)
+{
+    const ScopedLock sl (addedLock);
+    if (added.empty())
+        return false;
+    for (const auto& entry : added)
+        target[entry.first] = entry.second;
+    added.clear();
+    return true;
+}
+
+bool PresetIndex::parse (const File& file, PresetDescription& preset)
+{
+    const Node node (Node::parse (file), false);
+    if (! node.isValid())
+        return false;
+
+    preset.name = node.getName();
+    if (preset.name.isEmpty())
+        preset.name = file.getFileNameWithoutExtension();
+    preset.format     = node.getFormat().toString();
+    preset.identifier = node.getIdentifier().toString();
+    preset.fileOrIdentifier = node.getFileOrIdentifier().toString();
+    return preset.format.isNotEmpty() && preset.identifier.isNotEmpty();
+}
+
+//==============================================================================
+void PresetIndex::load()
+{
+    if (! indexFile.existsAsFile())
+        return;
+
+    FileInputStream input (indexFile);
+    if (! input.openedOk())
+        return;
+
+    GZIPDecompressorInputStream gzip (input);
+    const auto index = ValueTree::readFromStream (gzip);
+    if (! index.hasType ("presetIndex") || (int) index.getProperty ("version") != indexVersion)
+        return;
+
+    for (int i = 0; i < index.getNumChildren(); ++i)
+    {
+        const auto child = index.getChild (i);
+        Entry entry;
+        entry.preset.file       = File (child.getProperty ("path").toString());
+        entry.preset.name       = child.getProperty ("name").toString();
+        entry.preset.format     = child.getProperty ("format").toString();
+        entry.preset.identifier = child.getProperty ("identifier").toString();
+        entry.preset.fileOrIdentifier = child.getProperty ("fileOrIdentifier").toString();
+        entry.size              = (int64) child.getProperty ("size");
+        entry.modified          = (int64) child.getProperty ("modified");
+        entries.emplace (entry.preset.file.getFullPathName(), entry);
+    }
+}
+
+void PresetIndex::save() const
+{
+    if (indexFile == File() || indexFile.getParentDirectory().createDirectory().failed())
+        return;
+
+    ValueTree index ("presetIndex");
+    index.setProperty ("version", indexVersion, nullptr);
+    for (const auto& entry : entries)
+    {
+        ValueTree child ("preset");
+        child.setProperty ("path",       entry.first, nullptr)
+             .setProperty ("name",       entry.second.preset.name, nullptr)
+             .setProperty ("format",     entry.second.preset.format, nullptr)
+             .setProperty ("identifier", entry.second.preset.identifier, nullptr)
+             .setProperty ("fileOrIdentifier", entry.second.preset.fileOrIdentifier, nullptr)
+             .setProperty ("size",       entry.second.size, nullptr)
+             .setProperty ("modified",   entry.second.modified, nullptr);
+        index.addChild (child, -1, nullptr);
+    }
+
+    TemporaryFile temp (indexFile);
+    if (auto out = std::unique_ptr<FileOutputStream> (temp.getFile().createOutputStream()))
+    {
+        {
+            GZIPCompressorOutputStream gzip (*out);
+            index.writeToStream (gzip);
+        }
+        out.reset();
+        temp.overwriteTargetFileWithTemporary();
+    }
+}
+
+}
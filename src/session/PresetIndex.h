@@ -0,0 +1,145 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+struct PresetDescription
+{
+    String name;
+    String identifier;
+    String format;
+    File file;
+    String fileOrIdentifier;    // what the node is loaded from, see Node::getFileOrIdentifier()
+};
+
+/** An index of the preset files in a directory, saved between runs.
+
+    Presets are looked up by format and identifier with a binary search, so
+    building a preset menu doesn't touch the disk. Scanning walks the
+    directory and only parses files that are new or whose size or
+    modification time changed since they were indexed. The rest come from
+    the saved index, which is written again when anything changed.
+
+    Scans run on a background thread with scanAsync(), or on the calling
+    thread with scanNow(). Lookups are safe from any thread and see the
+    last finished scan, a change message is sent each time a scan
+    publishes something new. Hold one with a SharedResourcePointer to share
+    the default index.
+ */
+class PresetIndex : public ChangeBroadcaster,
+                    private Thread
+{
+public:
+    /** Creates an index of the user's presets directory, saved in the
+        cache directory */
+    PresetIndex();
+
+    /** Creates an index of a directory. Pass File() as the index file to
+        keep the index in memory only */
+    PresetIndex (const File& directory, const File& indexFile);
+    ~PresetIndex();
+
+    /** Returns the file the default index is saved to */
+    static File getDefaultIndexFile();
+
+    /** Returns the directory being indexed */
+    const File& getDirectory() const noexcept { return directory; }
+
+    /** Start a scan on the background thread. Returns right away */
+    void scanAsync();
+
+    /** Scan on the calling thread, waiting for a background scan if one
+        is running */
+    void scanNow();
+
+    /** Make sure lookups see at least the saved index, then start a scan in
+        the background so later lookups see changes on disk. Only waits to
+        read the saved index the first time */
+    void update();
+
+    /** Index one file right away, e.g. a preset that was just saved. Lookups
+        see it when this returns. If a scan is running the file is queued and
+        merged in and saved when the scan is done, so this never waits on
+        the directory walk */
+    void addFile (const File& file);
+
+    /** Add presets matching a format and identifier to the results,
+        sorted by name */
+    void getPresetsFor (const String& format, const String& identifier,
+                        OwnedArray<PresetDescription>& results) const;
+
+    /** Add presets matching a format and file or identifier to the results,
+        sorted by name. This matches what Node::getFileOrIdentifier() returns
+        for the preset's node */
+    void getPresetsForFileOrIdentifier (const String& format, const String& fileOrIdentifier,
+                                        OwnedArray<PresetDescription>& results) const;
+
+    /** Returns the number of indexed presets */
+    int getNumPresets() const;
+
+    /** Returns how many files were parsed by scans so far */
+    int getNumFilesParsed() const noexcept { return numFilesParsed.get(); }
+
+    /** Forget everything indexed, the next scan parses every file again */
+    void clear();
+
+private:
+    struct Entry
+    {
+        PresetDescription preset;
+        int64 size = 0;
+        int64 modified = 0;
+    };
+
+    const File directory, indexFile;
+    CriticalSection scanLock;
+    std::map<String, Entry> entries;    // by path, only used while scanning
+
+    // entries are changed with scanLock held, or with loadLock held before
+    // the saved index was loaded
+    CriticalSection loadLock;
+    bool loaded = false;
+
+    CriticalSection addedLock;
+    std::map<String, Entry> added;      // by path, files added while scanning
+
+    CriticalSection lock;
+    Array<PresetDescription> presets;   // sorted by format, identifier and name
+    Array<PresetDescription> byFile;    // sorted by format, file or identifier and name
+    Atomic<int> numFilesParsed { 0 };
+    Atomic<int> scanPending { 0 };
+
+    void run() override;
+    void scan();
+    void publish();
+    void publishAdded (const PresetDescription&);
+    bool takeAdded (std::map<String, Entry>&);
+    void loadSaved();
+    void load();
+    void save() const;
+    static bool parse (const File&, PresetDescription&);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetIndex)
+};
+
+}
@@ -21,17 +21,10 @@
 
 #include "ElementApp.h"
 #include "session/Node.h"
+#include "session/PresetIndex.h"
 
 namespace Element {
 
-struct PresetDescription
-{
-    String name;
-    String identifier;
-    String format;
-    File file;
-};
-
 class PresetCollection
 {
 public:
@@ -52,17 +45,20 @@ public:
     PresetCollection() { }
     ~PresetCollection() { }
 
+    /** Forget the indexed presets, the next refresh parses every file */
     inline void clear()
     {
-        presets.clear();
+        index->clear();
     }
 
     inline void getPresetsFor (const Node& node, OwnedArray<PresetDescription>& results) const
     {
+        OwnedArray<PresetDescription> found;
+        index->getPresetsFor (node.getFormat().toString(), node.getIdentifier().toString(), found);
+
         SortByName sorter;
-        for (const auto* const preset : presets)
-            if (preset->identifier == node.getIdentifier().toString() && preset->format == node.getFormat().toString())
-                results.addSorted (sorter, new PresetDescription (*preset));
+        while (! found.isEmpty())
+            results.addSorted (sorter, found.removeAndReturn (0));
     }
 
     inline void addPresetFor (const Node& node, const String& name)
@@ -70,38 +66,21 @@ public:
         jassertfalse;
     }
 
+    /** Update the index in the background. Only new and changed files are
+        read, lookups see the old presets until it finishes */
     inline void refresh()
     {
-        clear();
-        
-        StringArray files; path.findPresetFiles (files);
-        for (const auto& filename : files)
-        {
-            const File file (filename);
-            const Node node (Node::parse (file), false);
-            if (node.isValid())
-            {
-                std::unique_ptr<PresetDescription> item;
-                item.reset (new PresetDescription());
-                item->file          = file;
-                item->name          = node.getName();
-                if (item->name.isEmpty())
-                    item->name = file.getFileNameWithoutExtension();
-                item->format        = node.getFormat();
-                item->identifier    = node.getIdentifier();
-                if (item->format.isEmpty() || item->identifier.isEmpty())
-                    continue;
-
-                presets.add (item.release());
-            }
-        }
+        index->scanAsync();
+    }
 
-        presets.minimiseStorageOverheads();
+    /** Index a preset file that was just saved, so it shows up right away */
+    inline void add (const File& file)
+    {
+        index->addFile (file);
     }
 
 private:
-    DataPath path;
-    OwnedArray<PresetDescription> presets;
+    SharedResourcePointer<PresetIndex> index;
 };
 
 }
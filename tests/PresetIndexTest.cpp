@@ -0,0 +1,171 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "session/PresetIndex.h"
+
+namespace Element {
+
+class PresetIndexTest : public UnitTestBase
+{
+public:
+    PresetIndexTest() : UnitTestBase ("Preset Index", "presets", "index") { }
+
+    void runTest() override
+    {
+        const auto root = File::getSpecialLocation (File::tempDirectory)
+            .getNonexistentChildFile ("PresetIndexTest", "");
+        const auto dir = root.getChildFile ("Presets");
+        const auto indexFile = root.getChildFile ("Presets.index");
+        dir.getChildFile ("Synths").createDirectory();
+
+        writePreset (dir.getChildFile ("Synths/Bass.elpreset"), "Bass", "VST", "synth");
+        writePreset (dir.getChildFile ("Synths/Arp.elpreset"), "Arp", "VST", "synth");
+        writePreset (dir.getChildFile ("Delay.elpreset"), "Slap", "VST", "delay");
+        dir.getChildFile ("notes.elpreset").replaceWithText ("not a preset");
+
+        {
+            beginTest ("lookup by format and identifier");
+            PresetIndex index (dir, indexFile);
+            index.scanNow();
+            expectEquals (index.getNumPresets(), 3);
+            expectEquals (index.getNumFilesParsed(), 4);
+
+            OwnedArray<PresetDescription> presets;
+            index.getPresetsFor ("VST", "synth", presets);
+            expectEquals (presets.size(), 2);
+            expectEquals (presets[0]->name, String ("Arp"));
+            expectEquals (presets[1]->name, String ("Bass"));
+
+            presets.clear();
+            index.getPresetsFor ("AudioUnit", "synth", presets);
+            expect (presets.isEmpty());
+
+            beginTest ("rescan only parses changed files");
+            index.scanNow();
+            expectEquals (index.getNumFilesParsed(), 4);
+
+            const auto delay = dir.getChildFile ("Delay.elpreset");
+            writePreset (delay, "Slapback", "VST", "delay");
+            delay.setLastModificationTime (Time::getCurrentTime() + RelativeTime::seconds (10));
+            dir.getChildFile ("Synths/Arp.elpreset").deleteFile();
+            index.scanNow();
+            expectEquals (index.getNumFilesParsed(), 5);
+            expectEquals (index.getNumPresets(), 2);
+
+            presets.clear();
+            index.getPresetsFor ("VST", "delay", presets);
+            expectEquals (presets.size(), 1);
+            expectEquals (presets.getFirst()->name, String ("Slapback"));
+
+            beginTest ("lookup by file or identifier");
+            const auto lv2 = dir.getChildFile ("Reverb.elpreset");
+            writePreset (lv2, "Hall", "LV2", "reverb");
+            Node node (Node::parse (lv2), false);
+            node.setProperty (Tags::file, "/plugins/reverb.lv2");
+            node.writeToFile (lv2);
+
+            index.addFile (lv2);
+            expectEquals (index.getNumFilesParsed(), 6);
+            presets.clear();
+            index.getPresetsForFileOrIdentifier ("LV2", "/plugins/reverb.lv2", presets);
+            expectEquals (presets.size(), 1);
+            expectEquals (presets.getFirst()->name, String ("Hall"));
+
+            presets.clear();
+            index.getPresetsForFileOrIdentifier ("VST", "delay", presets);
+            expectEquals (presets.size(), 1);
+
+            beginTest ("added files aren't parsed again");
+            index.scanNow();
+            expectEquals (index.getNumFilesParsed(), 6);
+            expectEquals (index.getNumPresets(), 3);
+            lv2.deleteFile();
+            index.scanNow();
+        }
+
+        {
+            beginTest ("saved index is reused");
+            expect (indexFile.existsAsFile());
+            PresetIndex index (dir, indexFile);
+            index.scanNow();
+            expectEquals (index.getNumFilesParsed(), 0);
+            expectEquals (index.getNumPresets(), 2);
+        }
+
+        {
+            beginTest ("background scan");
+            PresetIndex index (dir, File());
+            index.scanAsync();
+            for (int i = 0; i < 500 && index.getNumPresets() < 2; ++i)
+                Thread::sleep (10);
+            expectEquals (index.getNumPresets(), 2);
+        }
+
+        {
+            beginTest ("files added during a scan");
+            dir.getChildFile ("Many").createDirectory();
+            for (int i = 0; i < 200; ++i)
+                writePreset (dir.getChildFile ("Many/" + String (i) + ".elpreset"),
+                             "Many " + String (i), "VST", "many");
+            indexFile.deleteFile();
+
+            PresetIndex index (dir, indexFile);
+            index.scanAsync();
+            const auto saved = dir.getChildFile ("Saved.elpreset");
+            writePreset (saved, "Saved", "VST", "saved");
+            index.addFile (saved);
+
+            OwnedArray<PresetDescription> presets;
+            index.getPresetsFor ("VST", "saved", presets);
+            expectEquals (presets.size(), 1);
+
+            for (int i = 0; i < 500 && index.getNumPresets() < 203; ++i)
+                Thread::sleep (10);
+            expectEquals (index.getNumPresets(), 203);
+
+            presets.clear();
+            index.getPresetsFor ("VST", "saved", presets);
+            expectEquals (presets.size(), 1);
+        }
+
+        {
+            beginTest ("files added during a scan are saved");
+            PresetIndex index (dir, indexFile);
+            index.update();
+            expectEquals (index.getNumPresets(), 203);
+        }
+
+        root.deleteRecursively();
+    }
+
+private:
+    static void writePreset (const File& file, const String& name,
+                             const String& format, const String& identifier)
+    {
+        Node node (Tags::node);
+        node.setProperty (Tags::name, name)
+            .setProperty (Tags::format, format)
+            .setProperty (Tags::identifier, identifier);
+        node.writeToFile (file);
+    }
+};
+
+static PresetIndexTest sPresetIndexTest;
+
+}
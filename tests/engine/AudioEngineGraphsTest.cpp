@@ -0,0 +1,116 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class AudioEngineGraphsTest : public UnitTestBase
+{
+public:
+    AudioEngineGraphsTest() : UnitTestBase ("AudioEngine Graphs", "engine", "audioEngineGraphs") { }
+    virtual ~AudioEngineGraphsTest() { }
+
+    void initialise() override
+    {
+        initializeWorld();
+    }
+
+    void shutdown() override
+    {
+        shutdownWorld();
+    }
+
+    void runTest() override
+    {
+        AudioEngine engine (getWorld());
+        engine.prepareExternalPlayback (44100.0, blockSize, 2, 2);
+
+        RootGraph first, second;
+        engine.addGraph (&first);
+        engine.addGraph (&second);
+
+        beginTest ("first graph is active");
+        render (engine);
+        expectEquals (engine.getActiveGraph(), 0);
+        expect (engine.getGraph (1) == &second);
+
+        beginTest ("selection");
+        engine.setActiveGraph (1);
+        expectEquals (engine.getActiveGraph(), 1);
+        render (engine);
+        expectEquals (engine.getActiveGraph(), 1);
+
+        beginTest ("add and remove while rendering");
+        {
+            RenderThread thread (engine);
+            thread.startThread();
+            for (int i = 0; i < 50; ++i)
+            {
+                RootGraph extra;
+                engine.addGraph (&extra);
+                Thread::sleep (1);
+                engine.removeGraph (&extra);
+            }
+            thread.stopThread (1000);
+            expect (thread.numBlocks.get() > 0);
+        }
+
+        beginTest ("active graph follows removal");
+        engine.removeGraph (&second);
+        render (engine);
+        expectEquals (engine.getActiveGraph(), 0);
+        expect (engine.getGraph (1) == nullptr);
+
+        engine.removeGraph (&first);
+        render (engine);
+        expectEquals (engine.getActiveGraph(), -1);
+        engine.releaseExternalResources();
+    }
+
+private:
+    enum { blockSize = 256 };
+
+    static void render (AudioEngine& engine)
+    {
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        audio.clear();
+        engine.processExternalBuffers (audio, midi);
+    }
+
+    struct RenderThread : public Thread
+    {
+        RenderThread (AudioEngine& e) : Thread ("render"), engine (e) { }
+        void run() override
+        {
+            while (! threadShouldExit())
+            {
+                render (engine);
+                ++numBlocks;
+            }
+        }
+
+        AudioEngine& engine;
+        Atomic<int> numBlocks { 0 };
+    };
+};
+
+static AudioEngineGraphsTest sAudioEngineGraphsTest;
+
+}
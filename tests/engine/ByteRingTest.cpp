@@ -0,0 +1,69 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/ByteRing.h"
+
+namespace Element {
+
+class ByteRingTest : public UnitTestBase
+{
+public:
+    ByteRingTest() : UnitTestBase ("ByteRing", "engine", "byteRing") { }
+    virtual ~ByteRingTest() { }
+
+    void runTest() override
+    {
+        beginTest ("records wrap around the end");
+        ByteRing ring (64);
+        const uint8 bytes[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+        uint8 read[10];
+        int32 header = 0;
+
+        for (int i = 0; i < 20; ++i)
+        {
+            expect (ring.write ((int32) i, bytes, i % 10));
+            expectEquals (ring.getNumReady(), 4 + i % 10);
+
+            ring.read (&header, (int) sizeof (header));
+            expectEquals ((int) header, i);
+            zeromem (read, sizeof (read));
+            ring.read (read, i % 10);
+            expect (memcmp (read, bytes, (size_t) (i % 10)) == 0);
+        }
+
+        beginTest ("full");
+        const int free = ring.getFreeSpace();
+        expect (! ring.write ((int32) 0, bytes, free));
+        expectEquals (ring.getNumReady(), 0);
+        expect (ring.write ((int32) 1, bytes, 10));
+        expect (ring.write ((int32) 2, bytes, 10));
+
+        beginTest ("skip and discard");
+        ring.read (&header, (int) sizeof (header));
+        ring.skip (10);
+        ring.read (&header, (int) sizeof (header));
+        expectEquals ((int) header, 2);
+        ring.discard();
+        expectEquals (ring.getNumReady(), 0);
+    }
+};
+
+static ByteRingTest sByteRingTest;
+
+}
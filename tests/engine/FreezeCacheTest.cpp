@@ -0,0 +1,117 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/FreezeCache.h"
+
+namespace Element {
+
+class FreezeCacheTest : public UnitTestBase
+{
+public:
+    FreezeCacheTest() : UnitTestBase ("FreezeCache", "engine", "freezeCache") { }
+    virtual ~FreezeCacheTest() { }
+
+    void runTest() override
+    {
+        testReadBack();
+        testCapture();
+    }
+
+private:
+    void testReadBack()
+    {
+        beginTest ("read back");
+        const int blockSize = 128;
+        FreezeCache cache;
+        expect (cache.open (2, 44100.0));
+        expect (! cache.isReady());
+
+        AudioSampleBuffer block (2, blockSize);
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+                for (int s = 0; s < blockSize; ++s)
+                    block.setSample (ch, s, (float)(i * blockSize + s) / 1024.f);
+            expect (cache.write (block, blockSize));
+        }
+
+        expect (cache.finish ({ 1000, 1000 + 4 * blockSize }));
+        expect (cache.isReady());
+        expectEquals (cache.getNumChannels(), 2);
+
+        AudioSampleBuffer out (2, blockSize);
+        cache.read (out, 2, 1000 + blockSize, blockSize);
+        expectEquals (out.getSample (0, 0), (float) blockSize / 1024.f);
+        expectEquals (out.getSample (1, 10), (float) (blockSize + 10) / 1024.f);
+
+        // outside the rendered range is silent
+        out.setSample (0, 0, 1.f);
+        cache.read (out, 2, 0, blockSize);
+        expectEquals (out.getMagnitude (0, blockSize), 0.f);
+    }
+
+    void testCapture()
+    {
+        beginTest ("capture");
+        const int blockSize = 64;
+        FreezeCapture capture (1, { 100, 300 });
+        expect (capture.isValid());
+        expect (! FreezeCapture (1, { 100, 100 }).isValid());
+
+        AudioSampleBuffer block (1, blockSize);
+        MidiBuffer midi;
+        for (int64 frame = 0; frame < 400; frame += blockSize)
+        {
+            for (int s = 0; s < blockSize; ++s)
+                block.setSample (0, s, (float) (frame + s));
+            midi.clear();
+            midi.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 10);
+            capture.write (block, midi, frame, blockSize);
+
+            // blocks that jump past the next frame are ignored
+            if (frame == 128)
+            {
+                capture.write (block, midi, 1000, blockSize);
+                expect (! capture.isComplete());
+            }
+        }
+
+        expect (capture.isComplete());
+
+        AudioSampleBuffer out (1, blockSize);
+        capture.read (out, midi, 64, blockSize);
+        expectEquals (out.getSample (0, 0), 0.f);
+        expectEquals (out.getSample (0, 36), 100.f);
+        expectEquals (midi.getNumEvents(), 0);
+
+        capture.read (out, midi, 128, blockSize);
+        expectEquals (out.getSample (0, 10), 138.f);
+        expectEquals (midi.getNumEvents(), 1);
+        expectEquals (midi.getFirstEventTime(), 10);
+
+        capture.read (out, midi, 256, blockSize);
+        expectEquals (out.getSample (0, 43), 299.f);
+        expectEquals (out.getSample (0, 44), 0.f);
+        expectEquals (midi.getNumEvents(), 1);
+    }
+};
+
+static FreezeCacheTest sFreezeCacheTest;
+
+}
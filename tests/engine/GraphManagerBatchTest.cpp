@@ -0,0 +1,83 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "controllers/GraphManager.h"
+#include "engine/nodes/PlaceholderProcessor.h"
+
+namespace Element {
+
+class GraphManagerBatchTest : public UnitTestBase
+{
+public:
+    GraphManagerBatchTest() : UnitTestBase ("GraphManager Batch", "engine", "graphBatch") { }
+
+    void initialise() override
+    {
+        initializeWorld();
+    }
+
+    void shutdown() override
+    {
+        shutdownWorld();
+    }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        std::unique_ptr<GraphManager> manager;
+        manager.reset (new GraphManager (graph, getWorld().getPluginManager()));
+        manager->setNodeModel (Node (Tags::graph));
+        const auto arcs = [&manager]() {
+            return manager->getGraphModel().getArcsValueTree().getNumChildren();
+        };
+
+        GraphNodePtr a = graph.addNode (new PlaceholderProcessor (2, 2, false, false));
+        GraphNodePtr b = graph.addNode (new PlaceholderProcessor (2, 2, false, false));
+        const int numBefore = arcs();
+        const auto out = [&a] (int channel) { return (int) a->getPortForChannel (PortType::Audio, channel, false); };
+        const auto in  = [&b] (int channel) { return (int) b->getPortForChannel (PortType::Audio, channel, true); };
+
+        beginTest ("arcs are updated once the batch ends");
+        {
+            GraphManager::ScopedBatch batch;
+            expect (GraphManager::isBatching());
+            expect (manager->addConnection (a->nodeId, out (0), b->nodeId, in (0)));
+
+            {
+                GraphManager::ScopedBatch nested;
+                expect (manager->addConnection (a->nodeId, out (1), b->nodeId, in (1)));
+            }
+
+            expectEquals (arcs(), numBefore);
+        }
+
+        expect (! GraphManager::isBatching());
+        expectEquals (arcs(), numBefore + 2);
+
+        beginTest ("unbatched changes update right away");
+        manager->removeConnection (a->nodeId, (uint32) out (1), b->nodeId, (uint32) in (1));
+        expectEquals (arcs(), numBefore + 1);
+
+        manager.reset();
+    }
+};
+
+static GraphManagerBatchTest sGraphManagerBatchTest;
+
+}
@@ -240,6 +240,43 @@ public:
 
 static GetTypeStringTest sGetTypeStringTest;
 
+/** Test nodes with upstream signal wait for their input */
+class FreezeTest : public GraphNodeTest
+{
+public:
+    FreezeTest() : GraphNodeTest ("Node Freeze", "freeze") { }
+    void runTest() override
+    {
+        GraphNodePtr source = graph->addNode (new PlaceholderProcessor (2, 2, false, false));
+        GraphNodePtr effect = graph->addNode (new PlaceholderProcessor (2, 2, false, false));
+        expect (graph->connectChannels (PortType::Audio, source->nodeId, 0, effect->nodeId, 0));
+        runDispatchLoop();
+
+        beginTest ("connected inputs");
+        expect (effect->freeze ({ 0, 4096 }));
+        expect (effect->isFreezePending());
+        expect (! effect->isFrozen());
+        effect->unfreeze();
+        expect (! effect->isFreezePending());
+
+        beginTest ("unconnected inputs");
+        expect (source->freeze ({ 0, 4096 }));
+        expect (source->isFrozen());
+
+        beginTest ("connecting an input unfreezes");
+        GraphNodePtr other = graph->addNode (new PlaceholderProcessor (2, 2, false, false));
+        expect (graph->connectChannels (PortType::Audio, other->nodeId, 0, source->nodeId, 0));
+        runDispatchLoop();
+        expect (! source->isFrozen());
+
+        graph->removeNode (source->nodeId);
+        graph->removeNode (effect->nodeId);
+        graph->removeNode (other->nodeId);
+    }
+};
+
+static FreezeTest sFreezeTest;
+
 }
 
 }
@@ -1,5 +1,6 @@
 
 #include "engine/nodes/LuaNode.h"
+#include "engine/WorkerPool.h"
 #include "LuaUnitTest.h"
 
 using namespace Element;
@@ -244,3 +245,240 @@ private:
 };
 
 static LuaNodeValidateTest sLuaNodeValidateTest;
+
+//=============================================================================
+static const String levelScript = R"(
+function node_io_ports()
+    return { audio_ins = 2, audio_outs = 2, midi_ins = 1, midi_outs = 0 }
+end
+
+function node_params() return {} end
+
+function node_render (a, m)
+    a:fill (%LEVEL%)
+end
+)";
+
+// fails when rendered by a node, but not while the script is validated
+static const String renderErrorScript = R"(
+function node_io_ports()
+    return { audio_ins = 2, audio_outs = 2, midi_ins = 1, midi_outs = 0 }
+end
+
+function node_params() return {} end
+
+function node_render (a, m)
+    a:fill (1.0)
+    if __ln_validate_nframes == nil then
+        error ('render failed')
+    end
+end
+)";
+
+class LuaNodeHotSwapTest : public UnitTestBase
+{
+public:
+    LuaNodeHotSwapTest() : UnitTestBase ("Lua Node Hot Swap", "LuaNode", "hotSwap") { }
+    virtual ~LuaNodeHotSwapTest() {}
+
+    void runTest() override
+    {
+        ReferenceCountedObjectPtr<LuaNode> node (new LuaNode());
+        expect (node->loadScript (levelScript.replace ("%LEVEL%", "1.0")).wasOk());
+        node->setCrossfadeTime (256.0 / 44100.0);
+        node->prepareToRender (44100.0, 64);
+
+        AudioSampleBuffer audio (2, 64);
+        MidiBuffer midi;
+        MidiBuffer* buffers[] = { &midi };
+        MidiPipe pipe (buffers, 1);
+        node->render (audio, pipe);
+        expectEquals (audio.getSample (0, 63), 1.f);
+
+        beginTest ("async compile");
+        bool finished = false;
+        Result result = Result::fail ("not called");
+        node->loadScriptAsync (levelScript.replace ("%LEVEL%", "0.0"), [&] (const Result& r) {
+            result = r;
+            finished = true;
+        });
+
+        for (int i = 0; i < 500 && ! finished; ++i)
+        {
+            // the old script renders while the new one compiles
+            node->render (audio, pipe);
+            expectEquals (audio.getSample (1, 0), 1.f);
+            runDispatchLoop (10);
+        }
+
+        expect (finished && result.wasOk());
+        expect (! node->isCompiling());
+
+        beginTest ("crossfade");
+        node->render (audio, pipe);
+        expect (audio.getSample (0, 0) > 0.f && audio.getSample (0, 63) < audio.getSample (0, 0));
+        for (int i = 0; i < 4; ++i)
+            node->render (audio, pipe);
+        expectEquals (audio.getMagnitude (0, 64), 0.f);
+
+        beginTest ("async failure");
+        finished = false;
+        node->loadScriptAsync ("bad script", [&] (const Result& r) {
+            result = r;
+            finished = true;
+        });
+        for (int i = 0; i < 500 && ! finished; ++i)
+            runDispatchLoop (10);
+        expect (finished && result.failed());
+        node->render (audio, pipe);
+        expectEquals (audio.getMagnitude (0, 64), 0.f);
+
+        beginTest ("fade time changed mid fade");
+        expect (node->loadScript (levelScript.replace ("%LEVEL%", "1.0")).wasOk());
+        node->render (audio, pipe);
+        node->setCrossfadeTime (0.0);
+        for (int i = 0; i < 4; ++i)
+        {
+            node->render (audio, pipe);
+            for (int s = 0; s < 64; ++s)
+                expect (std::isfinite (audio.getSample (0, s)));
+        }
+        expectEquals (audio.getSample (0, 63), 1.f);
+
+        beginTest ("render error");
+        expect (node->loadScript (renderErrorScript).wasOk());
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        node->render (audio, pipe);
+        expectEquals (audio.getMagnitude (0, 64), 0.f);
+        expect (midi.isEmpty());
+        expect (node->loadScript (levelScript.replace ("%LEVEL%", "1.0")).wasOk());
+        node->render (audio, pipe);
+        expectEquals (audio.getSample (0, 63), 1.f);
+
+        node->releaseResources();
+    }
+};
+
+static LuaNodeHotSwapTest sLuaNodeHotSwapTest;
+
+//=============================================================================
+static const String sessionScript = R"(
+local Session = require ('el.Session')
+node_parallel = true
+function node_io_ports() return { audio_ins = 2, audio_outs = 2, midi_ins = 0, midi_outs = 0 } end
+function node_params() return {} end
+function node_render (a, m) end
+)";
+
+static const String requireInRenderScript = R"(
+node_parallel = true
+function node_io_ports() return { audio_ins = 2, audio_outs = 2, midi_ins = 0, midi_outs = 0 } end
+function node_params() return {} end
+function node_render (a, m)
+    a:fill (pcall (require, 'el.Globals') and 1.0 or 0.5)
+end
+)";
+
+class LuaNodeParallelTest : public UnitTestBase
+{
+public:
+    LuaNodeParallelTest() : UnitTestBase ("Lua Node Parallel", "LuaNode", "parallel") { }
+    virtual ~LuaNodeParallelTest() {}
+
+    void runTest() override
+    {
+        beginTest ("declare parallel");
+        ReferenceCountedObjectPtr<LuaNode> node (new LuaNode());
+        expect (node->loadScript (levelScript.replace ("%LEVEL%", "1.0")).wasOk());
+        expect (! node->isParallelSafe());
+        expect (node->loadScript (parallelLevel (1.0)).wasOk());
+        expect (node->isParallelSafe());
+
+        beginTest ("session modules refused");
+        expect (node->loadScript (sessionScript).failed());
+        expect (node->isParallelSafe());
+        expect (node->loadScript (requireInRenderScript).wasOk());
+        node->prepareToRender (44100.0, blockSize);
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        MidiBuffer* buffers[] = { &midi };
+        MidiPipe pipe (buffers, 1);
+        node->render (audio, pipe);
+        expectEquals (audio.getSample (0, 0), 0.5f);
+
+        beginTest ("pinned context renders after a swap");
+        node->setCrossfadeTime (0.0);
+        expect (node->loadScript (parallelLevel (1.0)).wasOk());
+        expect (node->beginParallelRender());
+        expect (node->loadScript (levelScript.replace ("%LEVEL%", "0.25")).wasOk());
+        expect (! node->isParallelSafe());
+        node->render (audio, pipe);
+        expectEquals (audio.getSample (0, 0), 1.f);
+        expect (! node->beginParallelRender());
+        node->render (audio, pipe);
+        expectEquals (audio.getSample (0, 0), 0.25f);
+        node->releaseResources();
+        node = nullptr;
+
+        testRenderOnWorkers();
+    }
+
+private:
+    enum { blockSize = 128 };
+
+    static String parallelLevel (double level)
+    {
+        return levelScript.replace ("%LEVEL%", String (level)) + "\nnode_parallel = true\n";
+    }
+
+    void testRenderOnWorkers()
+    {
+        beginTest ("render on workers");
+        SharedResourcePointer<WorkerPool> pool;
+        const auto oldOptions = pool->getOptions();
+        auto options = oldOptions;
+        options.numThreads = jmin (2, SystemStats::getNumCpus());
+        pool->setOptions (options);
+
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.prepareToPlay (44100.0, blockSize);
+        GraphNodePtr out = graph.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+
+        // four independent nodes mixed in to the output
+        const double levels[] = { 0.125, 0.25, 0.5, 1.0 };
+        ReferenceCountedArray<LuaNode> nodes;
+        for (const auto level : levels)
+        {
+            auto* node = nodes.add (new LuaNode());
+            expect (node->loadScript (parallelLevel (level)).wasOk());
+            graph.addNode (node);
+        }
+        runDispatchLoop (20);
+
+        for (auto* node : nodes)
+            for (int ch = 0; ch < 2; ++ch)
+                expect (graph.connectChannels (PortType::Audio, node->nodeId, ch, out->nodeId, ch));
+        graph.handleUpdateNowIfNeeded();
+
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        for (int i = 0; i < 50; ++i)
+        {
+            audio.clear();
+            graph.processBlock (audio, midi);
+        }
+
+        for (int ch = 0; ch < 2; ++ch)
+            expectEquals (audio.getSample (ch, blockSize - 1), 1.875f);
+
+        out = nullptr;
+        nodes.clear();
+        graph.releaseResources();
+        graph.clear();
+        pool->setOptions (oldOptions);
+    }
+};
+
+static LuaNodeParallelTest sLuaNodeParallelTest;
@@ -0,0 +1,143 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MappingDispatchTable.h"
+
+namespace Element {
+
+class MappingDispatchTableTest : public UnitTestBase
+{
+public:
+    MappingDispatchTableTest() : UnitTestBase ("MappingDispatchTable", "engine", "mappingDispatchTable") { }
+    virtual ~MappingDispatchTableTest() { }
+
+    void runTest() override
+    {
+        testDispatch();
+        testBenchmark();
+    }
+
+private:
+    struct Handler
+    {
+        Handler (int k, int ch, int num) : kind (k), channel (ch), number (num) { }
+
+        bool wants (const MidiMessage& msg) const
+        {
+            const bool kindMatches = kind == Table::Controller
+                ? msg.isController() && msg.getControllerNumber() == number
+                : msg.isNoteOnOrOff() && msg.getNoteNumber() == number;
+            return kindMatches && (channel == 0 || msg.getChannel() == channel);
+        }
+
+        const int kind, channel, number;
+        int count = 0;
+    };
+
+    using Table = MappingDispatchTable<Handler>;
+
+    static int dispatch (const Table& table, const MidiMessage& msg)
+    {
+        return table.visit (msg.getRawData(), msg.getRawDataSize(), [&msg] (Handler* h) {
+            if (h->wants (msg))
+                ++h->count;
+        });
+    }
+
+    void testDispatch()
+    {
+        beginTest ("dispatch");
+        Handler omni (Table::Controller, 0, 7), chan2 (Table::Controller, 2, 7),
+                note (Table::Note, 1, 60), other (Table::Controller, 1, 8);
+        Table table;
+        table.add (Table::Controller, 2, 7, &chan2);
+        table.add (Table::Controller, 0, 7, &omni);
+        table.add (Table::Note, 1, 60, &note);
+        table.add (Table::Controller, 1, 8, &other);
+        table.compile();
+        expectEquals (table.size(), 4);
+
+        expectEquals (dispatch (table, MidiMessage::controllerEvent (2, 7, 100)), 2);
+        expectEquals (dispatch (table, MidiMessage::controllerEvent (3, 7, 100)), 1);
+        expectEquals (dispatch (table, MidiMessage::noteOn (1, 60, 0.5f)), 1);
+        expectEquals (dispatch (table, MidiMessage::noteOff (1, 60)), 1);
+        expectEquals (dispatch (table, MidiMessage::noteOn (2, 60, 0.5f)), 0);
+        expectEquals (dispatch (table, MidiMessage::pitchWheel (1, 100)), 0);
+        expectEquals (omni.count, 2);
+        expectEquals (chan2.count, 1);
+        expectEquals (note.count, 2);
+        expectEquals (other.count, 0);
+    }
+
+    void testBenchmark()
+    {
+        beginTest ("benchmark");
+        OwnedArray<Handler> handlers;
+        Table table;
+
+        // a bank of 320 mappings: CCs on every channel plus a few notes
+        for (int ch = 1; ch <= 16; ++ch)
+        {
+            for (int cc = 0; cc < 16; ++cc)
+                table.add (Table::Controller, ch, cc, handlers.add (new Handler (Table::Controller, ch, cc)));
+            for (int n = 36; n < 40; ++n)
+                table.add (Table::Note, ch, n, handlers.add (new Handler (Table::Note, ch, n)));
+        }
+        table.compile();
+
+        const int numEvents = 100000;
+        Array<MidiMessage> events;
+        Random random (1234);
+        for (int i = 0; i < 1024; ++i)
+            events.add (MidiMessage::controllerEvent (1 + random.nextInt (16), random.nextInt (16), random.nextInt (128)));
+
+        const double linearNs = measure ([&] (const MidiMessage& msg) {
+            for (auto* h : handlers)
+                if (h->wants (msg))
+                    ++h->count;
+        }, events, numEvents);
+
+        const double indexedNs = measure ([&] (const MidiMessage& msg) {
+            dispatch (table, msg);
+        }, events, numEvents);
+
+        int total = 0;
+        for (auto* h : handlers)
+            total += h->count;
+        expectEquals (total, numEvents * 2);
+
+        logMessage (String ("dispatch per event: linear ") + String (linearNs, 1)
+            + "ns, indexed " + String (indexedNs, 1) + "ns ("
+            + String (handlers.size()) + " mappings)");
+    }
+
+    template<class Fn>
+    static double measure (Fn&& fn, const Array<MidiMessage>& events, const int numEvents)
+    {
+        const auto start = Time::getHighResolutionTicks();
+        for (int i = 0; i < numEvents; ++i)
+            fn (events.getReference (i & 1023));
+        const auto elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        return elapsed * 1.0e9 / (double) numEvents;
+    }
+};
+
+static MappingDispatchTableTest sMappingDispatchTableTest;
+
+}
@@ -0,0 +1,144 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiClock.h"
+
+namespace Element {
+
+class MidiClockTest : public UnitTestBase,
+                      public MidiClock::Listener
+{
+public:
+    MidiClockTest() : UnitTestBase ("MidiClock", "engine", "midiClock") { }
+    virtual ~MidiClockTest() { }
+
+    void runTest() override
+    {
+        testJitter();
+        testSongPosition();
+        testDropout();
+    }
+
+    void midiClockSignalAcquired() override { ++numAcquired; }
+    void midiClockSignalDropped() override { ++numDropped; }
+    void midiClockTempoChanged (const float bpm) override { lastBpm = bpm; }
+
+private:
+    int numAcquired = 0, numDropped = 0;
+    float lastBpm = 0.f;
+
+    static void send (MidiClock& clock, MidiMessage msg, double time)
+    {
+        msg.setTimeStamp (time);
+        clock.process (msg);
+    }
+
+    /** Sends ticks at a tempo with up to +/- jitterMs of noise. Returns the
+        time of the last tick without noise */
+    static double sendTicks (MidiClock& clock, double start, double bpm,
+                             int numTicks, double jitterMs, Random& random)
+    {
+        const double period = 60.0 / (bpm * 24.0);
+        for (int i = 0; i < numTicks; ++i)
+        {
+            const double noise = (random.nextDouble() * 2.0 - 1.0) * jitterMs * 0.001;
+            send (clock, MidiMessage::midiClock(), start + (double) i * period + noise);
+        }
+        return start + (double) (numTicks - 1) * period;
+    }
+
+    void testJitter()
+    {
+        beginTest ("tempo through jitter");
+        MidiClock clock;
+        clock.addListener (this);
+        clock.reset (48000.0, 512);
+        numAcquired = numDropped = 0;
+
+        Random random (4321);
+        sendTicks (clock, 100.0, 120.0, 24 * 32, 1.0, random);
+        expectEquals (numAcquired, 1);
+        expectWithinAbsoluteError (clock.getTempo(), 120.0, 0.25);
+        expectWithinAbsoluteError ((double) lastBpm, 120.0, 0.25);
+
+        const auto diag = clock.getDiagnostics();
+        expect (diag.locked);
+        expect (diag.jitterMs > 0.0 && diag.jitterMs < 1.5);
+        clock.removeListener (this);
+    }
+
+    void testSongPosition()
+    {
+        beginTest ("song position");
+        MidiClock clock;
+        clock.reset (48000.0, 512);
+        Random random (99);
+        double beats = 0.0;
+
+        // not running yet
+        double last = sendTicks (clock, 10.0, 120.0, 96, 0.0, random);
+        expect (! clock.getBeatPosition (last, beats));
+
+        // start, then two beats of clock: position 0 lands on the first tick
+        const double start = last + 1.0 / 48.0;
+        send (clock, MidiMessage::midiStart(), start - 0.001);
+        last = sendTicks (clock, start, 120.0, 49, 0.0, random);
+        expect (clock.getBeatPosition (last, beats));
+        expectWithinAbsoluteError (beats, 2.0, 0.01);
+        expect (clock.getBeatPosition (last + 0.25, beats));
+        expectWithinAbsoluteError (beats, 2.5, 0.01);
+
+        // bar 3 as sixteenths, the next tick is on beat 8
+        send (clock, MidiMessage::songPositionPointer (32), last + 0.001);
+        last = sendTicks (clock, last + 1.0 / 48.0, 120.0, 1, 0.0, random);
+        expect (clock.getBeatPosition (last, beats));
+        expectWithinAbsoluteError (beats, 8.0, 0.01);
+
+        send (clock, MidiMessage::midiStop(), last + 0.001);
+        expect (! clock.getBeatPosition (last, beats));
+    }
+
+    void testDropout()
+    {
+        beginTest ("dropout");
+        MidiClock clock;
+        clock.addListener (this);
+        clock.reset (48000.0, 512);
+        numAcquired = numDropped = 0;
+
+        Random random (7);
+        const double last = sendTicks (clock, 1.0, 90.0, 96, 0.5, random);
+        expectEquals (numAcquired, 1);
+
+        // a second of silence, then a new clock at another tempo
+        sendTicks (clock, last + 1.0, 140.0, 24 * 16, 0.5, random);
+        expectEquals (numDropped, 1);
+        expectEquals (numAcquired, 2);
+        expectWithinAbsoluteError (clock.getTempo(), 140.0, 0.25);
+
+        clock.reportTransportOffset (3.5, true);
+        expectEquals (clock.getDiagnostics().numRealigns, 1);
+        expectWithinAbsoluteError (clock.getDiagnostics().driftMs, 3.5, 0.0001);
+        clock.removeListener (this);
+    }
+};
+
+static MidiClockTest sMidiClockTest;
+
+}
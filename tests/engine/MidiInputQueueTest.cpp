@@ -0,0 +1,119 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+class MidiInputQueueTest : public UnitTestBase
+{
+public:
+    MidiInputQueueTest() : UnitTestBase ("MidiInputQueue", "engine", "midiInputQueue") { }
+    virtual ~MidiInputQueueTest() { }
+
+    void runTest() override
+    {
+        testOffsets();
+        testSysex();
+        testOverflow();
+    }
+
+private:
+    static int firstFrame (const MidiBuffer& midi)
+    {
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = -1;
+        iter.getNextEvent (msg, frame);
+        return frame;
+    }
+
+    void testOffsets()
+    {
+        beginTest ("timestamps to sample offsets");
+        MidiInputQueue queue;
+        const double sampleRate = 48000.0;
+        const int numSamples = 480; // 10ms
+        const double callbackTime = 10000.0;
+        const auto note = MidiMessage::noteOn (1, 60, 1.f);
+
+        // the block covers the 10ms leading up to the callback
+        expect (queue.push (note.getRawData(), note.getRawDataSize(), callbackTime - 10.0));
+        expect (queue.push (note.getRawData(), note.getRawDataSize(), callbackTime - 5.0));
+        expect (queue.push (note.getRawData(), note.getRawDataSize(), callbackTime + 3.0));
+
+        MidiBuffer midi;
+        queue.render (midi, callbackTime, numSamples, sampleRate);
+        expectEquals (midi.getNumEvents(), 3);
+
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        expect (iter.getNextEvent (msg, frame)); expectEquals (frame, 0);
+        expect (iter.getNextEvent (msg, frame)); expectEquals (frame, 240);
+        expect (iter.getNextEvent (msg, frame)); expectEquals (frame, numSamples - 1);
+        expect (msg.isNoteOn());
+
+        beginTest ("stale messages are dropped");
+        midi.clear();
+        expect (queue.push (note.getRawData(), note.getRawDataSize(), callbackTime - 5000.0));
+        queue.render (midi, callbackTime, numSamples, sampleRate);
+        expectEquals (midi.getNumEvents(), 0);
+    }
+
+    void testSysex()
+    {
+        beginTest ("sysex");
+        MidiInputQueue queue (256);
+        uint8 data[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+        const auto sysex = MidiMessage::createSysExMessage (data, (int) sizeof (data));
+
+        // cycle the ring so messages wrap around the end
+        for (int i = 0; i < 20; ++i)
+        {
+            expect (queue.push (sysex.getRawData(), sysex.getRawDataSize(), 100.0));
+            MidiBuffer midi;
+            queue.render (midi, 100.0, 64, 44100.0);
+            MidiBuffer::Iterator iter (midi);
+            MidiMessage msg; int frame = 0;
+            expect (iter.getNextEvent (msg, frame));
+            expect (msg.isSysEx() && msg.getSysExDataSize() == (int) sizeof (data));
+            expectEquals ((int) msg.getSysExData()[4], 5);
+        }
+    }
+
+    void testOverflow()
+    {
+        beginTest ("overflow");
+        MidiInputQueue queue (256);
+        const auto cc = MidiMessage::controllerEvent (1, 7, 100);
+        int numPushed = 0;
+        while (queue.push (cc.getRawData(), cc.getRawDataSize(), 100.0))
+            ++numPushed;
+        expect (numPushed > 0);
+        expectEquals (queue.getNumDropped(), 1);
+
+        MidiBuffer midi;
+        queue.render (midi, 100.0, 64, 44100.0);
+        expectEquals (midi.getNumEvents(), numPushed);
+        expectEquals (firstFrame (midi), 63);
+    }
+};
+
+static MidiInputQueueTest sMidiInputQueueTest;
+
+}
@@ -0,0 +1,240 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiKernels.h"
+#include "engine/VelocityCurve.h"
+
+namespace Element {
+
+class MidiKernelsTest : public UnitTestBase
+{
+public:
+    MidiKernelsTest() : UnitTestBase ("MidiKernels", "engine", "midiKernels") { }
+    virtual ~MidiKernelsTest() { }
+
+    void runTest() override
+    {
+        testFilter();
+        testRemapAndVelocity();
+        testSplit();
+        testMerge();
+        testBenchmark();
+    }
+
+private:
+    static Array<MidiMessage> toArray (const MidiBuffer& midi)
+    {
+        Array<MidiMessage> result;
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+        {
+            msg.setTimeStamp ((double) frame);
+            result.add (msg);
+        }
+        return result;
+    }
+
+    void testFilter()
+    {
+        beginTest ("filter");
+        MidiBuffer midi, scratch;
+        for (int i = 0; i < 8; ++i)
+            midi.addEvent (MidiMessage::noteOn (1 + (i % 2), 60 + i, 1.f), i);
+
+        // keeping everything changes nothing
+        MidiKernels::filter (midi, scratch, [] (const uint8*, int, int) { return true; });
+        expectEquals (midi.getNumEvents(), 8);
+
+        MidiKernels::filter (midi, scratch, [] (const uint8* data, int, int) {
+            return MidiKernels::getChannel (data) == 2;
+        });
+
+        const auto events = toArray (midi);
+        expectEquals (events.size(), 4);
+        for (int i = 0; i < events.size(); ++i)
+        {
+            expectEquals (events[i].getChannel(), 2);
+            expectEquals (events[i].getNoteNumber(), 61 + i * 2);
+            expectEquals (roundToInt (events[i].getTimeStamp()), 1 + i * 2);
+        }
+
+        expect (scratch.isEmpty());
+    }
+
+    void testRemapAndVelocity()
+    {
+        beginTest ("channel remap and velocity table");
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::noteOn (3, 60, (uint8) 64), 0);
+        midi.addEvent (MidiMessage::noteOff (3, 60), 1);
+        midi.addEvent (MidiMessage::midiClock(), 2);
+
+        uint8 table [16];
+        for (int i = 0; i < 16; ++i)
+            table[i] = (uint8) i;
+        table[2] = 9;
+        MidiKernels::remapChannels (midi, table);
+
+        VelocityCurve curve;
+        curve.setMode (VelocityCurve::Max);
+        MidiKernels::applyVelocityTable (midi, curve.getTable());
+        MidiKernels::transpose (midi, 12);
+
+        const auto events = toArray (midi);
+        expectEquals (events.size(), 3);
+        expectEquals (events[0].getChannel(), 10);
+        expectEquals ((int) events[0].getVelocity(), 127);
+        expectEquals (events[0].getNoteNumber(), 72);
+        expectEquals (events[1].getChannel(), 10);
+        expect (events[1].isNoteOff());
+        expectEquals (events[1].getNoteNumber(), 72);
+        expect (events[2].isMidiClock());
+
+        curve.setMode (VelocityCurve::Soft_1);
+        expectEquals ((int) curve.getTable()[0], 0);
+        expect (curve.process ((uint8) 127) >= curve.process ((uint8) 1));
+
+        beginTest ("transpose stops at the end of the block");
+        midi.clear();
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 64);
+        MidiKernels::transpose (midi, -12, 64);
+        const auto transposed = toArray (midi);
+        expectEquals (transposed[0].getNoteNumber(), 48);
+        expectEquals (transposed[1].getNoteNumber(), 60);
+    }
+
+    void testSplit()
+    {
+        beginTest ("split by channel");
+        OwnedArray<MidiBuffer> outs;
+        MidiBuffer* dests [16];
+        for (int i = 0; i < 16; ++i)
+            dests[i] = outs.add (new MidiBuffer());
+
+        MidiBuffer midi;
+        for (int i = 0; i < 32; ++i)
+            midi.addEvent (MidiMessage::controllerEvent (1 + (i % 16), 7, i), i);
+        midi.addEvent (MidiMessage::midiStart(), 32);
+
+        MidiKernels::splitByChannel (midi, dests);
+        for (int i = 0; i < 16; ++i)
+        {
+            const auto events = toArray (*dests[i]);
+            expectEquals (events.size(), 2);
+            expectEquals (events[0].getChannel(), i + 1);
+            expectEquals (roundToInt (events[1].getTimeStamp()), i + 16);
+        }
+    }
+
+    void testMerge()
+    {
+        beginTest ("merge");
+        MidiBuffer a, b, scratch, expected;
+        for (int i = 0; i < 16; ++i)
+        {
+            a.addEvent (MidiMessage::noteOn (1, i, 1.f), i * 2);
+            b.addEvent (MidiMessage::noteOn (2, i, 1.f), i * 3);
+        }
+
+        expected = a;
+        expected.addEvents (b, 0, -1, 0);
+        MidiKernels::merge (a, b, scratch);
+
+        const auto merged = toArray (a);
+        const auto reference = toArray (expected);
+        expectEquals (merged.size(), reference.size());
+        for (int i = 0; i < jmin (merged.size(), reference.size()); ++i)
+        {
+            expectEquals (roundToInt (merged[i].getTimeStamp()), roundToInt (reference[i].getTimeStamp()));
+            expectEquals (merged[i].getChannel(), reference[i].getChannel());
+            expectEquals (merged[i].getNoteNumber(), reference[i].getNoteNumber());
+        }
+
+        MidiBuffer empty;
+        MidiKernels::merge (empty, b, scratch);
+        expectEquals (empty.getNumEvents(), b.getNumEvents());
+    }
+
+    void testBenchmark()
+    {
+        beginTest ("benchmark");
+
+        // a dense block: 2048 events across all channels in 512 frames
+        MidiBuffer dense;
+        Random random (1234);
+        for (int i = 0; i < 2048; ++i)
+            dense.addEvent (MidiMessage::noteOn (1 + random.nextInt (16), random.nextInt (128),
+                                                 (uint8) (1 + random.nextInt (127))), i / 4);
+
+        bool channelOn [17];
+        for (int ch = 0; ch <= 16; ++ch)
+            channelOn[ch] = ch != 16;
+        VelocityCurve curve;
+        curve.setMode (VelocityCurve::Hard_2);
+
+        MidiBuffer work, scratch;
+        work.ensureSize ((size_t) dense.data.size());
+        scratch.ensureSize ((size_t) dense.data.size());
+        const int numBlocks = 200;
+
+        const double decodedUs = measure ([&]() {
+            scratch.clear();
+            MidiBuffer::Iterator iter (dense);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+            {
+                if (msg.getChannel() > 0 && ! channelOn [msg.getChannel()])
+                    continue;
+                if (msg.isNoteOn())
+                    msg.setVelocity (curve.process (msg.getFloatVelocity()));
+                scratch.addEvent (msg, frame);
+            }
+        }, numBlocks);
+        const int numDecoded = scratch.getNumEvents();
+
+        const double rawUs = measure ([&]() {
+            work.clear();
+            work.data.addArray (dense.data.begin(), dense.data.size());
+            MidiKernels::filter (work, scratch, [&channelOn] (const uint8* data, int, int) {
+                return channelOn [MidiKernels::getChannel (data)];
+            });
+            MidiKernels::applyVelocityTable (work, curve.getTable());
+        }, numBlocks);
+
+        expectEquals (work.getNumEvents(), numDecoded);
+        logMessage (String ("filter + velocity per block of ") + String (dense.getNumEvents())
+            + " events: decoded " + String (decodedUs, 1) + "us, raw " + String (rawUs, 1) + "us");
+    }
+
+    template<class Fn>
+    static double measure (Fn&& fn, const int numBlocks)
+    {
+        const auto start = Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+            fn();
+        const auto elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        return elapsed * 1.0e6 / (double) numBlocks;
+    }
+};
+
+static MidiKernelsTest sMidiKernelsTest;
+
+}
@@ -0,0 +1,122 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/MidiMonitorNode.h"
+
+namespace Element {
+
+class MidiMonitorNodeTest : public UnitTestBase
+{
+public:
+    MidiMonitorNodeTest() : UnitTestBase ("MidiMonitorNode", "engine", "midiMonitor") { }
+    virtual ~MidiMonitorNodeTest() { }
+
+    void runTest() override
+    {
+        testFilters();
+        testHistory();
+        testState();
+    }
+
+private:
+    static void render (MidiMonitorNode& node, MidiBuffer& midi)
+    {
+        AudioSampleBuffer audio (1, 512);
+        MidiBuffer* buffers[] = { &midi };
+        MidiPipe pipe (buffers, 1);
+        node.render (audio, pipe);
+    }
+
+    void testFilters()
+    {
+        beginTest ("capture filters");
+        ReferenceCountedObjectPtr<MidiMonitorNode> node (new MidiMonitorNode());
+        node->prepareToRender (44100.0, 512);
+        node->setTypeFilter (MidiMonitorNode::noteMessages | MidiMonitorNode::transportMessages);
+        node->setChannelFilter (1 << 0);
+
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        midi.addEvent (MidiMessage::noteOn (2, 61, 1.f), 1);
+        midi.addEvent (MidiMessage::controllerEvent (1, 7, 100), 2);
+        midi.addEvent (MidiMessage::midiClock(), 3);
+        midi.addEvent (MidiMessage::midiStart(), 4);
+        render (*node, midi);
+
+        // the monitor passes everything through untouched
+        expectEquals (midi.getNumEvents(), 5);
+
+        runDispatchLoop (80);
+        expectEquals (node->getNumLogged(), 2);
+        if (node->getNumLogged() == 2)
+        {
+            expectEquals (node->getLoggedMessage(0).getNoteNumber(), 60);
+            expectEquals (MidiMonitorNode::describe (node->getLoggedMessage (1)), String ("Start"));
+        }
+
+        node->clearMessages();
+        expectEquals (node->getNumLogged(), 0);
+        node->releaseResources();
+    }
+
+    void testHistory()
+    {
+        beginTest ("history wraps");
+        ReferenceCountedObjectPtr<MidiMonitorNode> node (new MidiMonitorNode());
+        node->prepareToRender (44100.0, 512);
+        node->setHistorySize (3);
+
+        MidiBuffer midi;
+        for (int i = 0; i < 8; ++i)
+            midi.addEvent (MidiMessage::noteOn (1, 60 + i, 1.f), i);
+        render (*node, midi);
+        runDispatchLoop (80);
+
+        expectEquals (node->getNumLogged(), 3);
+        for (int i = 0; i < node->getNumLogged(); ++i)
+            expectEquals (node->getLoggedMessage(i).getNoteNumber(), 65 + i);
+
+        node->setHistorySize (2);
+        expectEquals (node->getNumLogged(), 2);
+        expectEquals (node->getLoggedMessage(0).getNoteNumber(), 66);
+        node->releaseResources();
+    }
+
+    void testState()
+    {
+        beginTest ("state");
+        MidiMonitorNode node;
+        node.setHistorySize (500);
+        node.setTypeFilter (MidiMonitorNode::sysexMessages);
+        node.setChannelFilter (0x00ff);
+
+        MemoryBlock block;
+        node.getState (block);
+
+        MidiMonitorNode other;
+        other.setState (block.getData(), (int) block.getSize());
+        expectEquals (other.getHistorySize(), 500);
+        expectEquals (other.getTypeFilter(), (int) MidiMonitorNode::sysexMessages);
+        expectEquals (other.getChannelFilter(), 0x00ff);
+    }
+};
+
+static MidiMonitorNodeTest sMidiMonitorNodeTest;
+
+}
@@ -0,0 +1,106 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiOutputScheduler.h"
+
+namespace Element {
+
+class MidiOutputSchedulerTest : public UnitTestBase
+{
+public:
+    MidiOutputSchedulerTest() : UnitTestBase ("MidiOutputScheduler", "engine", "midiOutputScheduler") { }
+    virtual ~MidiOutputSchedulerTest() { }
+
+    void runTest() override
+    {
+        testClosedPorts();
+        testOverflow();
+    }
+
+private:
+    static void waitForStats (MidiOutputScheduler& scheduler, int numDropped)
+    {
+        for (int i = 0; i < 200 && scheduler.getStats().numDropped < numDropped; ++i)
+            Thread::sleep (5);
+    }
+
+    void testClosedPorts()
+    {
+        beginTest ("events for closed ports are dropped when due");
+        MidiOutputScheduler scheduler;
+        auto* port = scheduler.openPort (nullptr);
+        expect (port != nullptr && ! port->isClosed());
+
+        MidiBuffer midi;
+        midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        midi.addEvent (MidiMessage::noteOff (1, 60), 480);
+
+        // the second event is due 10ms after the first
+        const double start = Time::getMillisecondCounterHiRes();
+        scheduler.send (port, midi, start, 48000.0);
+        waitForStats (scheduler, 2);
+        expectEquals (scheduler.getStats().numDropped, 2);
+        expect (Time::getMillisecondCounterHiRes() - start >= 10.0);
+        expectEquals (scheduler.getStats().numSent, 0);
+
+        scheduler.closePort (port);
+        expect (port->isClosed());
+        scheduler.send (port, midi, start, 48000.0);
+        Thread::sleep (20);
+        expectEquals (scheduler.getStats().numDropped, 2);
+
+        scheduler.resetStats();
+        expectEquals (scheduler.getStats().numDropped, 0);
+
+        beginTest ("closed ports are deleted");
+        scheduler.openPort (nullptr);
+        expectEquals (scheduler.getNumPorts(), 2);
+        for (int i = 0; i < 200 && scheduler.getNumPorts() > 1; ++i)
+            Thread::sleep (5);
+        expectEquals (scheduler.getNumPorts(), 1);
+    }
+
+    void testOverflow()
+    {
+        beginTest ("overflow");
+        MidiOutputScheduler scheduler (256);
+        auto* port = scheduler.openPort (nullptr);
+
+        // hold events in the future so the ring fills up
+        MidiBuffer midi;
+        for (int i = 0; i < 64; ++i)
+            midi.addEvent (MidiMessage::noteOn (1, 60, 1.f), i);
+        scheduler.send (port, midi, Time::getMillisecondCounterHiRes() + 60000.0, 48000.0);
+        expect (scheduler.getStats().numDropped > 0);
+        expect (scheduler.getStatusText().contains ("dropped"));
+
+        beginTest ("ports have their own queues");
+        scheduler.resetStats();
+        auto* other = scheduler.openPort (nullptr);
+        MidiBuffer one;
+        one.addEvent (MidiMessage::noteOn (1, 60, 1.f), 0);
+        scheduler.send (other, one, Time::getMillisecondCounterHiRes(), 48000.0);
+        waitForStats (scheduler, 1);
+        expectEquals (scheduler.getStats().numDropped, 1);
+    }
+};
+
+static MidiOutputSchedulerTest sMidiOutputSchedulerTest;
+
+}
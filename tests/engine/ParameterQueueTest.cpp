@@ -0,0 +1,180 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/ParameterQueue.h"
+
+namespace Element {
+
+class ParameterQueueTest : public UnitTestBase
+{
+public:
+    ParameterQueueTest() : UnitTestBase ("ParameterQueue", "engine", "parameterQueue") { }
+    virtual ~ParameterQueueTest() { }
+
+    void runTest() override
+    {
+        Parameter::Ptr first = new TestParameter(), second = new TestParameter();
+        CountingListener listener;
+        first->addListener (&listener);
+
+        ParameterQueue queue (64);
+        auto* firstTarget  = queue.addTarget (first.get());
+        auto* secondTarget = queue.addTarget (second.get());
+        expect (queue.addTarget (first.get()) == firstTarget);
+        expectEquals (queue.getNumTargets(), 2);
+
+        beginTest ("coalesces to the latest value");
+        expect (queue.push (firstTarget, 0.1f));
+        expect (queue.push (firstTarget, 0.2f));
+        expect (queue.push (secondTarget, 0.5f));
+        expect (queue.push (firstTarget, 0.3f));
+        expectEquals (first->getValue(), 0.f);
+        queue.process();
+        expectEquals (first->getValue(), 0.3f);
+        expectEquals (second->getValue(), 0.5f);
+        expectEquals (dynamic_cast<TestParameter*> (first.get())->numSets, 1);
+
+        beginTest ("notifies on the message thread");
+        expectEquals (listener.count, 0);
+        runDispatchLoop (80);
+        expectEquals (listener.count, 1);
+
+        beginTest ("shared targets stay until the last user is gone");
+        expect (queue.push (firstTarget, 0.9f));
+        queue.removeTarget (firstTarget);
+        expectEquals (queue.getNumTargets(), 2);
+        expect (queue.push (firstTarget, 0.8f));
+        queue.process();
+        expectEquals (first->getValue(), 0.8f);
+        runDispatchLoop (80);
+        expectEquals (listener.count, 2);
+
+        beginTest ("removing a target applies its changes");
+        expect (queue.push (firstTarget, 0.9f));
+        queue.removeTarget (firstTarget);
+        expectEquals (first->getValue(), 0.9f);
+        expectEquals (listener.count, 3);
+        expectEquals (queue.getNumTargets(), 1);
+
+        beginTest ("latest value");
+        expect (queue.push (secondTarget, 0.1f));
+        expectEquals (second->getValue(), 0.5f);
+        expectEquals (queue.getLatestValue (secondTarget), 0.1f);
+        queue.process();
+        expectEquals (queue.getLatestValue (secondTarget), 0.1f);
+
+        beginTest ("superseded changes are dropped");
+        expect (queue.push (secondTarget, 0.2f));
+        queue.supersede (secondTarget, 0.7f);
+        second->setValue (0.7f);
+        expectEquals (queue.getLatestValue (secondTarget), 0.7f);
+        queue.process();
+        expectEquals (second->getValue(), 0.7f);
+        expect (queue.push (secondTarget, 0.4f));
+        queue.process();
+        expectEquals (second->getValue(), 0.4f);
+
+        beginTest ("idle queues are applied on the message thread");
+        runDispatchLoop (150);
+        expect (queue.push (secondTarget, 0.6f));
+        runDispatchLoop (80);
+        expectEquals (second->getValue(), 0.6f);
+
+        beginTest ("full queue");
+        for (int i = 0; i < 64; ++i)
+            expect (queue.push (secondTarget, 0.f));
+        expect (! queue.push (secondTarget, 1.f));
+        queue.process();
+        expect (queue.push (secondTarget, 1.f));
+        queue.process();
+
+        beginTest ("several producers");
+        testProducers();
+
+        first->removeListener (&listener);
+    }
+
+private:
+    void testProducers()
+    {
+        ParameterQueue queue (4096);
+        ReferenceCountedArray<Parameter> params;
+        OwnedArray<Thread> producers;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto* const param = params.add (new TestParameter());
+            producers.add (new Producer (queue, queue.addTarget (param), (float) (i + 1) * 0.1f));
+        }
+
+        for (auto* const producer : producers)
+            producer->startThread();
+        for (auto* const producer : producers)
+            producer->stopThread (5000);
+
+        queue.process();
+        for (int i = 0; i < params.size(); ++i)
+        {
+            auto* const param = dynamic_cast<TestParameter*> (params.getUnchecked (i));
+            expectEquals (param->value, (float) (i + 1) * 0.1f);
+            expectEquals (param->numSets, 1);
+        }
+    }
+
+    struct Producer : public Thread
+    {
+        Producer (ParameterQueue& q, ParameterQueue::Target* t, float v)
+            : Thread ("producer"), queue (q), target (t), value (v) { }
+
+        void run() override
+        {
+            for (int i = 0; i < 1000; ++i)
+                queue.push (target, i == 999 ? value : 0.f);
+        }
+
+        ParameterQueue& queue;
+        ParameterQueue::Target* target;
+        const float value;
+    };
+
+    struct TestParameter : public Parameter
+    {
+        int getPortIndex() const noexcept override                  { return 0; }
+        int getParameterIndex() const noexcept override             { return 0; }
+        float getValue() const override                             { return value; }
+        void setValue (float newValue) override                     { value = newValue; ++numSets; }
+        float getDefaultValue() const override                      { return 0.f; }
+        float getValueForText (const String& text) const override   { return text.getFloatValue(); }
+        String getName (int) const override                         { return "Test"; }
+        String getLabel() const override                            { return {}; }
+
+        float value = 0.f;
+        int numSets = 0;
+    };
+
+    struct CountingListener : public Parameter::Listener
+    {
+        void controlValueChanged (int, float) override  { ++count; }
+        void controlTouched (int, bool) override        { }
+        int count = 0;
+    };
+};
+
+static ParameterQueueTest sParameterQueueTest;
+
+}
@@ -0,0 +1,118 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+
+namespace Element {
+
+class SubGraphInlineTest : public UnitTestBase
+{
+public:
+    SubGraphInlineTest() : UnitTestBase ("Sub Graph Inlining", "engine", "subGraphInline") { }
+    virtual ~SubGraphInlineTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        GraphNodePtr audioIn, audioOut;
+        addIONodes (graph, audioIn, audioOut);
+
+        auto* sub = new GraphProcessor();
+        {
+            GraphNodePtr subIn, subOut;
+            addIONodes (*sub, subIn, subOut);
+            for (int ch = 0; ch < 2; ++ch)
+                expect (sub->connectChannels (PortType::Audio, subIn->nodeId, ch, subOut->nodeId, ch));
+            sub->handleUpdateNowIfNeeded();
+        }
+
+        GraphNodePtr subNode = graph.addNode (sub);
+        runDispatchLoop (20);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            expect (graph.connectChannels (PortType::Audio, audioIn->nodeId, ch, subNode->nodeId, ch));
+            expect (graph.connectChannels (PortType::Audio, subNode->nodeId, ch, audioOut->nodeId, ch));
+        }
+
+        graph.handleUpdateNowIfNeeded();
+
+        beginTest ("renders nested graph");
+        expect (! graph.isInliningSubGraphs());
+        expectPassThrough (graph);
+
+        beginTest ("renders nested graph inline");
+        graph.setInlineSubGraphs (true);
+        graph.handleUpdateNowIfNeeded();
+        expect (graph.isInliningSubGraphs());
+        expectPassThrough (graph);
+
+        beginTest ("muted nested graph isn't inlined");
+        subNode->setMuted (true);
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        fillRamp (audio);
+        graph.processBlock (audio, midi);
+        graph.handleUpdateNowIfNeeded(); // guard op asked for a rebuild
+        fillRamp (audio);
+        graph.processBlock (audio, midi);
+        expectEquals (audio.getMagnitude (0, blockSize), 0.f);
+
+        subNode = nullptr; audioIn = nullptr; audioOut = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    enum { blockSize = 256 };
+
+    void addIONodes (GraphProcessor& g, GraphNodePtr& in, GraphNodePtr& out)
+    {
+        g.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        g.prepareToPlay (44100.0, blockSize);
+
+        in  = g.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioInputNode));
+        out = g.addNode (new GraphProcessor::AudioGraphIOProcessor (
+            GraphProcessor::AudioGraphIOProcessor::audioOutputNode));
+        runDispatchLoop (20);
+    }
+
+    static void fillRamp (AudioSampleBuffer& audio)
+    {
+        for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+            for (int i = 0; i < audio.getNumSamples(); ++i)
+                audio.setSample (ch, i, (float) (i + ch) / (float) blockSize);
+    }
+
+    void expectPassThrough (GraphProcessor& g)
+    {
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        fillRamp (audio);
+        g.processBlock (audio, midi);
+
+        for (int ch = 0; ch < 2; ++ch)
+            for (int i = 0; i < blockSize; i += 17)
+                expectEquals (audio.getSample (ch, i), (float) (i + ch) / (float) blockSize);
+    }
+};
+
+static SubGraphInlineTest sSubGraphInlineTest;
+
+}
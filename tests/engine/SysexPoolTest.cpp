@@ -0,0 +1,144 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/MidiInputQueue.h"
+#include "engine/SysexPool.h"
+
+namespace Element {
+
+class SysexPoolTest : public UnitTestBase
+{
+public:
+    SysexPoolTest() : UnitTestBase ("SysexPool", "engine", "sysexPool") { }
+    virtual ~SysexPoolTest() { }
+
+    void runTest() override
+    {
+        testRefs();
+        testExhaustion();
+        testInputQueue();
+    }
+
+private:
+    static MemoryBlock createDump (int size)
+    {
+        MemoryBlock block ((size_t) size);
+        auto* data = static_cast<uint8*> (block.getData());
+        data[0] = 0xf0;
+        for (int i = 1; i < size - 1; ++i)
+            data[i] = (uint8) (i & 0x7f);
+        data[size - 1] = 0xf7;
+        return block;
+    }
+
+    void testRefs()
+    {
+        beginTest ("references");
+        SysexPool pool;
+        const int numSlots = pool.getNumFree();
+        const auto dump = createDump (3000);
+
+        {
+            auto ref = pool.allocate (static_cast<const uint8*> (dump.getData()), (int) dump.getSize());
+            expect (ref.isValid());
+            expectEquals (ref.getSize(), 3000);
+            expect (memcmp (ref.getData(), dump.getData(), dump.getSize()) == 0);
+            expectEquals (pool.getNumFree(), numSlots - 1);
+
+            SysexPool::Ref copy (ref);
+            ref.reset();
+            expect (! ref.isValid());
+            expectEquals (pool.getNumFree(), numSlots - 1);
+
+            auto* slot = copy.detach();
+            expect (! copy.isValid());
+            auto adopted = SysexPool::Ref::adopt (slot);
+            expectEquals (adopted.getSize(), 3000);
+        }
+
+        expectEquals (pool.getNumFree(), numSlots);
+    }
+
+    void testExhaustion()
+    {
+        beginTest ("exhaustion");
+        SysexPool pool;
+        const auto dump = createDump (pool.getMaxSize());
+        const auto* data = static_cast<const uint8*> (dump.getData());
+
+        Array<SysexPool::Ref> refs;
+        for (;;)
+        {
+            auto ref = pool.allocate (data, (int) dump.getSize());
+            if (! ref.isValid())
+                break;
+            refs.add (ref);
+        }
+
+        expect (refs.size() > 0);
+        expectEquals (pool.getNumFailed(), 1);
+        expect (! pool.allocate (data, pool.getMaxSize() + 1).isValid());
+
+        // smaller messages still fit the smaller slots
+        expect (pool.allocate (data, 512).isValid());
+        refs.clear();
+    }
+
+    void testInputQueue()
+    {
+        beginTest ("dumps bigger than the input ring");
+        SysexPool pool;
+        MidiInputQueue queue (1024, &pool);
+        const auto dump = createDump (100000);
+
+        expect (queue.push (static_cast<const uint8*> (dump.getData()), (int) dump.getSize(), 100.0));
+        expectEquals (queue.getNumDropped(), 0);
+
+        MidiBuffer midi;
+        queue.render (midi, 100.0, 64, 44100.0);
+        MidiBuffer::Iterator iter (midi);
+        const uint8* data; int size, frame;
+        expect (iter.getNextEvent (data, size, frame));
+        expectEquals (size, 100000);
+        expect (memcmp (data, dump.getData(), dump.getSize()) == 0);
+
+        // queued and cleared dumps go back to the pool
+        const int numFree = pool.getNumFree();
+        expect (queue.push (static_cast<const uint8*> (dump.getData()), (int) dump.getSize(), 100.0));
+        expectEquals (pool.getNumFree(), numFree - 1);
+        queue.clear();
+        expectEquals (pool.getNumFree(), numFree);
+
+        beginTest ("multi megabyte dumps");
+        const auto bank = createDump (4 << 20);
+        expect (pool.getMaxSize() >= (int) bank.getSize());
+        expect (queue.push (static_cast<const uint8*> (bank.getData()), (int) bank.getSize(), 100.0));
+        midi.clear();
+        queue.render (midi, 100.0, 64, 44100.0);
+        MidiBuffer::Iterator bankIter (midi);
+        expect (bankIter.getNextEvent (data, size, frame));
+        expectEquals (size, (int) bank.getSize());
+        expect (memcmp (data, bank.getData(), bank.getSize()) == 0);
+    }
+};
+
+static SysexPoolTest sSysexPoolTest;
+
+}
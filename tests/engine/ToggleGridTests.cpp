@@ -29,6 +29,7 @@ public:
     void runTest() override
     {
         testToggleGrid();
+        testRoutes();
     }
 
 private:
@@ -67,6 +68,45 @@ private:
                 grid4.getNumOutputs() == matrix.getNumColumns());
         expect (grid4.get (3, 3) == matrix.connected (3, 3));
     }
+
+    void testRoutes()
+    {
+        beginTest ("routes");
+        ToggleGrid current (80, 80);
+        ToggleGrid next (80, 80);
+        current.set (0, 0, true);
+        current.set (5, 63, true);
+        current.set (5, 64, true);
+        current.set (79, 79, true);
+        expectEquals (current.getNumRoutes(), 4);
+        expect (current.get (5, 64) && ! current.get (5, 65));
+
+        int visited = 0;
+        current.forEachRoute ([&] (int in, int out) {
+            expect (current.get (in, out));
+            ++visited;
+        });
+        expectEquals (visited, 4);
+
+        beginTest ("changes");
+        next = current;
+        next.set (0, 0, false);
+        next.set (40, 70, true);
+
+        int steady = 0, fadeIn = 0, fadeOut = 0;
+        ToggleGrid::forEachChange (current, next, [&] (int in, int out, ToggleGrid::Change change) {
+            if (change == ToggleGrid::Steady)
+                ++steady;
+            else if (change == ToggleGrid::FadeIn)
+                { ++fadeIn; expect (in == 40 && out == 70); }
+            else
+                { ++fadeOut; expect (in == 0 && out == 0); }
+        });
+
+        expectEquals (steady, 3);
+        expectEquals (fadeIn, 1);
+        expectEquals (fadeOut, 1);
+    }
 };
 
 static ToggleGridTest sToggleGridTest;
@@ -0,0 +1,129 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/WorkerPool.h"
+
+namespace Element {
+
+class WorkerPoolTest : public UnitTestBase
+{
+public:
+    WorkerPoolTest() : UnitTestBase ("WorkerPool", "engine", "workerPool") { }
+    virtual ~WorkerPoolTest() { }
+
+    void runTest() override
+    {
+        testAffinityMask();
+        testPerform();
+    }
+
+private:
+    struct CountJob : public WorkerPool::Job
+    {
+        Atomic<int> count { 0 };
+        void perform() override { ++count; }
+    };
+
+    struct PerformThread : public Thread
+    {
+        PerformThread (WorkerPool& p, Array<WorkerPool::Job*>& j)
+            : Thread ("perform"), pool (p), jobs (j) { }
+
+        void run() override
+        {
+            for (int i = 0; i < 100; ++i)
+                pool.perform (jobs.getRawDataPointer(), jobs.size());
+        }
+
+        WorkerPool& pool;
+        Array<WorkerPool::Job*>& jobs;
+    };
+
+    void testAffinityMask()
+    {
+        beginTest ("affinity mask");
+        expectEquals ((int) WorkerPool::parseAffinityMask (""), 0);
+        expectEquals ((int) WorkerPool::parseAffinityMask ("0"), 1);
+        expectEquals ((int) WorkerPool::parseAffinityMask ("0-3"), 15);
+        expectEquals ((int) WorkerPool::parseAffinityMask ("1, 4-5"), 2 | 16 | 32);
+    }
+
+    void testPerform()
+    {
+        WorkerPool pool;
+        OwnedArray<CountJob> jobs;
+        Array<WorkerPool::Job*> ptrs;
+        for (int i = 0; i < 32; ++i)
+            ptrs.add (jobs.add (new CountJob()));
+
+        beginTest ("performs jobs without workers");
+        pool.perform (ptrs.getRawDataPointer(), ptrs.size());
+        for (auto* job : jobs)
+            expectEquals (job->count.get(), 1);
+
+        beginTest ("performs jobs with workers");
+        WorkerPool::Options opts;
+        opts.numThreads = jmin (2, SystemStats::getNumCpus());
+        pool.setOptions (opts);
+        expectEquals (pool.getNumWorkers(), opts.numThreads);
+
+        for (int i = 0; i < 100; ++i)
+            pool.perform (ptrs.getRawDataPointer(), ptrs.size());
+        for (auto* job : jobs)
+            expectEquals (job->count.get(), 101);
+
+        beginTest ("back to back batches of different sizes");
+        for (auto* job : jobs)
+            job->count.set (0);
+        for (int i = 0; i < 2000; ++i)
+            pool.perform (ptrs.getRawDataPointer(), (i % 2) == 0 ? 2 : 3);
+        expectEquals (jobs[0]->count.get(), 2000);
+        expectEquals (jobs[1]->count.get(), 2000);
+        expectEquals (jobs[2]->count.get(), 1000);
+        expectEquals (jobs[3]->count.get(), 0);
+        for (auto* job : jobs)
+            job->count.set (101);
+
+        beginTest ("performs jobs from two threads");
+        OwnedArray<CountJob> otherJobs;
+        Array<WorkerPool::Job*> otherPtrs;
+        for (int i = 0; i < 8; ++i)
+            otherPtrs.add (otherJobs.add (new CountJob()));
+        {
+            // the second caller runs its own jobs while the pool is busy
+            PerformThread other (pool, otherPtrs);
+            other.startThread();
+            for (int i = 0; i < 100; ++i)
+                pool.perform (ptrs.getRawDataPointer(), ptrs.size());
+            other.stopThread (5000);
+        }
+        for (auto* job : jobs)
+            expectEquals (job->count.get(), 201);
+        for (auto* job : otherJobs)
+            expectEquals (job->count.get(), 100);
+
+        opts.numThreads = 0;
+        pool.setOptions (opts);
+        expectEquals (pool.getNumWorkers(), 0);
+    }
+};
+
+static WorkerPoolTest sWorkerPoolTest;
+
+}
@@ -0,0 +1,232 @@
+/*
+    This file is part of Element
+    Copyright (C) 2021  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "scripting/BytecodeCache.h"
+#include "sol/sol.hpp"
+
+namespace Element {
+
+class BytecodeCacheTest : public UnitTestBase
+{
+public:
+    BytecodeCacheTest() : UnitTestBase ("BytecodeCache", "scripting", "bytecodeCache") { }
+    virtual ~BytecodeCacheTest() { }
+
+    void runTest() override
+    {
+        testMemory();
+        testDisk();
+        testErrors();
+        testLimits();
+        testEmbedded();
+    }
+
+private:
+    static constexpr const char* source = "local x = ... or 20; return x + 1";
+
+    int load (BytecodeCache& cache, sol::state& lua, const char* code)
+    {
+        return cache.load (lua.lua_state(), code, strlen (code), "=test");
+    }
+
+    int call (sol::state& lua)
+    {
+        sol::protected_function f (lua, -1);
+        lua_pop (lua.lua_state(), 1);
+        return f().get<int>();
+    }
+
+    void testMemory()
+    {
+        beginTest ("memory");
+        BytecodeCache cache { File() };
+        sol::state lua;
+        expectEquals (load (cache, lua, source), (int) LUA_OK);
+        expectEquals (call (lua), 21);
+        expectEquals (load (cache, lua, source), (int) LUA_OK);
+        expectEquals (call (lua), 21);
+        expectEquals (cache.getStats().numCompiled, 1);
+        expectEquals (cache.getStats().numHits, 1);
+
+        // a different chunk name or source is another chunk
+        expect (BytecodeCache::getKey (source, strlen (source), "=test") !=
+                BytecodeCache::getKey (source, strlen (source), "=other"));
+        expectEquals (load (cache, lua, "return 7"), (int) LUA_OK);
+        expectEquals (call (lua), 7);
+        expectEquals (cache.getStats().numCompiled, 2);
+
+        sol::state_view view (lua);
+        auto chunk = cache.load (view, "return 5", "=test");
+        expect (chunk.valid());
+        sol::protected_function f = chunk;
+        expectEquals (f().get<int>(), 5);
+    }
+
+    void testDisk()
+    {
+        beginTest ("disk");
+        TemporaryFile dir;
+        sol::state lua;
+        const auto key = BytecodeCache::getKey (source, strlen (source), "=test");
+        const auto file = dir.getFile().getChildFile (key + ".luac");
+
+        {
+            BytecodeCache cache (dir.getFile());
+            expectEquals (load (cache, lua, source), (int) LUA_OK);
+            lua_pop (lua.lua_state(), 1);
+            expect (file.existsAsFile());
+        }
+
+        {
+            BytecodeCache cache (dir.getFile());
+            expectEquals (load (cache, lua, source), (int) LUA_OK);
+            expectEquals (call (lua), 21);
+            expectEquals (cache.getStats().numHits, 1);
+            expectEquals (cache.getStats().numCompiled, 0);
+        }
+
+        // a damaged file is compiled and written again
+        file.replaceWithText ("not bytecode");
+        {
+            BytecodeCache cache (dir.getFile());
+            expectEquals (load (cache, lua, source), (int) LUA_OK);
+            expectEquals (call (lua), 21);
+            expectEquals (cache.getStats().numCompiled, 1);
+            expect (file.getSize() > 12);
+        }
+
+        // bytecode that doesn't match its checksum never reaches the loader
+        {
+            MemoryBlock data;
+            file.loadFileAsData (data);
+            data[(int) data.getSize() - 1] ^= 0x55;
+            file.replaceWithData (data.getData(), data.getSize());
+
+            BytecodeCache cache (dir.getFile());
+            expectEquals (load (cache, lua, source), (int) LUA_OK);
+            expectEquals (call (lua), 21);
+            expectEquals (cache.getStats().numHits, 0);
+            expectEquals (cache.getStats().numCompiled, 1);
+            cache.clear();
+            expect (! file.existsAsFile());
+        }
+
+        dir.getFile().deleteRecursively();
+    }
+
+    void testErrors()
+    {
+        beginTest ("errors");
+        BytecodeCache cache { File() };
+        sol::state lua;
+        expectEquals (load (cache, lua, "return +"), (int) LUA_ERRSYNTAX);
+        expect (String (lua_tostring (lua.lua_state(), -1)).startsWith ("test:1:"));
+        lua_pop (lua.lua_state(), 1);
+        expectEquals (cache.getStats().numCompiled, 0);
+
+        expectEquals (BytecodeCache::loadEmbedded (lua.lua_state(), "el.none"), (int) LUA_ERRFILE);
+        lua_pop (lua.lua_state(), 1);
+    }
+
+    void testLimits()
+    {
+        beginTest ("limits");
+        sol::state lua;
+        {
+            BytecodeCache cache { File() };
+            cache.setLimits (2, 2);
+            for (const char* code : { "return 0", "return 1", "return 0", "return 2", "return 1" })
+            {
+                expectEquals (load (cache, lua, code), (int) LUA_OK);
+                lua_pop (lua.lua_state(), 1);
+            }
+
+            // 1 was the least recently used when 2 came in
+            expectEquals (cache.getStats().numHits, 1);
+            expectEquals (cache.getStats().numCompiled, 4);
+        }
+
+        TemporaryFile dir;
+        {
+            BytecodeCache cache (dir.getFile());
+            cache.setLimits (2, 3);
+            for (int i = 0; i < 5; ++i)
+            {
+                const String code = "return " + String (i);
+                expectEquals (load (cache, lua, code.toRawUTF8()), (int) LUA_OK);
+                lua_pop (lua.lua_state(), 1);
+            }
+
+            expectEquals (dir.getFile().findChildFiles (File::findFiles, false, "*.luac").size(), 3);
+        }
+
+        dir.getFile().deleteRecursively();
+    }
+
+    /** Returns the source tree this test was built from */
+    static File getSourceRoot()
+    {
+        // this file is tests/scripting/BytecodeCacheTest.cpp
+        const auto root = File::getCurrentWorkingDirectory().getChildFile (__FILE__)
+            .getParentDirectory().getParentDirectory().getParentDirectory();
+        if (root.getChildFile ("libs/element/lua").isDirectory())
+            return root;
+        return File::getCurrentWorkingDirectory();
+    }
+
+    void testEmbedded()
+    {
+        beginTest ("embedded modules match their sources");
+        const StringArray modules { "el.command", "el.script", "element" };
+        for (const auto& mod : modules)
+        {
+            sol::state lua;
+            auto* L = lua.lua_state();
+            expectEquals (BytecodeCache::loadEmbedded (L, mod), (int) LUA_OK);
+            lua_pop (L, 1);
+
+            // the bytecode must be regenerated with tools/lua-bytecode.lua
+            // after editing a module
+            int size = 0;
+            const auto* embedded = BinaryData::getNamedResource (
+                (mod.replaceCharacter ('.', '_') + "_luac").toRawUTF8(), size);
+            const auto file = getSourceRoot().getChildFile (
+                "libs/element/lua/" + mod.replaceCharacter ('.', '/') + ".lua");
+            expect (file.existsAsFile(), "source of " + mod + " not found");
+            if (! file.existsAsFile())
+                continue;
+
+            expectEquals (luaL_loadfilex (L, file.getFullPathName().toRawUTF8(), "t"), (int) LUA_OK);
+            MemoryBlock dumped;
+            {
+                MemoryOutputStream out (dumped, false);
+                lua_dump (L, [](lua_State*, const void* data, size_t n, void* stream) {
+                    return static_cast<OutputStream*> (stream)->write (data, n) ? 0 : 1;
+                }, &out, 0);
+            }
+
+            expect (dumped == MemoryBlock (embedded, (size_t) size), mod + " bytecode is out of date");
+        }
+    }
+};
+
+static BytecodeCacheTest sBytecodeCacheTest;
+
+}
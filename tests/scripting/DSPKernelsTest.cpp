@@ -0,0 +1,187 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "LuaUnitTest.h"
+#include "engine/MidiPipe.h"
+
+using namespace Element;
+
+//=============================================================================
+const static String sAudioKernels = R"(
+local AudioBuffer = require ('kv.AudioBuffer')
+local dsp = require ('el.dsp')
+
+local a = AudioBuffer (2, 64)
+local b = AudioBuffer (2, 64)
+
+begintest ("fill and measure")
+a:fill (0.5)
+expect (a:peak() == 0.5)
+expect (math.abs (a:rms (1) - 0.5) < 0.0001)
+
+begintest ("gain")
+a:gain (2.0, 0)
+expect (a:peak (0) == 1.0 and a:peak (1) == 0.5)
+
+begintest ("mix and copy")
+b:fill (0.25)
+a:mix (b, 2.0)
+expect (a:peak (0) == 1.5 and a:peak (1) == 1.0)
+a:copyfrom (b, 1.0, 0, 1)
+expect (a:peak (0) == 1.5 and a:peak (1) == 0.25)
+
+begintest ("ramp")
+a:fill (1.0)
+a:ramp (0.0, 1.0)
+expect (a:peak() <= 1.0 and a:rms() < 1.0)
+
+begintest ("module functions")
+dsp.gain (a, 0.0)
+expect (a:peak() == 0.0)
+
+begintest ("biquad")
+local f = dsp.biquad()
+f:lowpass (44100, 1000)
+b:fill (1.0)
+f:process (b)
+expect (b:peak() > 0.0)
+
+begintest ("bad channel")
+expect (not pcall (function() a:gain (1.0, 2) end))
+)";
+
+const static String sMidiKernels = R"(
+local MidiPipe = require ('el.MidiPipe')
+local midi = require ('kv.midi')
+
+local m = MidiPipe (1)
+local b = m:get (0)
+b:insert (0, midi.noteon (1, 60, 100))
+b:insert (4, midi.noteon (2, 64, 90))
+b:insert (8, midi.noteoff (1, 60, 0))
+
+begintest ("events")
+local count = 0
+for _, frame, status, d1, d2 in m:events (0) do
+    count = count + 1
+    if count == 1 then
+        expect (frame == 0 and status == 0x90 and d1 == 60 and d2 == 100)
+    end
+end
+expect (count == 3)
+
+begintest ("transpose and velocity")
+m:transpose (12)
+m:velocity (0.5)
+for _, frame, status, d1, d2 in m:events() do
+    if status == 0x90 then expect (d1 == 72 and d2 == 50) end
+end
+
+begintest ("channels")
+m:keepchannels (1)
+count = 0
+for _ in m:events() do count = count + 1 end
+expect (count == 2)
+m:setchannel (10)
+for _, _, status in m:events() do expect (status & 0x0f == 9) end
+
+begintest ("filter")
+m:filter (function (status) return status & 0xf0 == 0x80 end)
+count = 0
+for _ in m:events() do count = count + 1 end
+expect (count == 1)
+
+begintest ("add and count")
+m:add (0x90, 48, 127, 16)
+m:add (0xc0, 5)
+expect (m:numevents (0) == 3)
+count = 0
+for _, frame, status, d1, d2 in m:events() do
+    count = count + 1
+    if count == 2 then expect (frame == 16 and d1 == 48 and d2 == 127) end
+    if count == 3 then expect (status == 0xc0 and d1 == 5 and d2 == 0) end
+end
+expect (count == 3)
+expect (not pcall (function() m:add (0x40, 1, 2) end))
+expect (not pcall (function() m:numevents (1) end))
+)";
+
+const static String sReferTo = R"(
+local midi = require ('kv.midi')
+expect (pipe:size() == 2)
+expect (pipe:numevents (0) == 1 and pipe:numevents (1) == 0)
+for _, frame, status, d1 in pipe:events (0) do
+    expect (frame == 0 and status == 0x90 and d1 == 60)
+end
+pipe:transpose (2, 0)
+pipe:add (0x80, 62, 0, 10, 1)
+pipe:get(0):insert (5, midi.noteon (1, 67, 64))
+expect (pipe:numevents (0) == 2)
+)";
+
+//=============================================================================
+class DSPKernelsTest : public LuaUnitTest
+{
+public:
+    DSPKernelsTest()
+        : LuaUnitTest ("DSP Kernels", "Script", "kernels") {}
+
+    void runTest() override
+    {
+        expect (lua.safe_script (sAudioKernels.toStdString()).valid());
+        expect (lua.safe_script (sMidiKernels.toStdString()).valid());
+        testReferTo();
+    }
+
+private:
+    void testReferTo()
+    {
+        beginTest ("refer to engine buffers");
+        MidiBuffer buffer1, buffer2;
+        MidiBuffer* buffers[] = { &buffer1, &buffer2 };
+        MidiPipe engine (buffers, 2);
+        buffer1.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 0);
+
+        lua.script ("require ('el.MidiPipe')");
+        auto* L = lua.lua_state();
+        auto** pipe = LuaMidiPipe::create (L, 2);
+        lua_setglobal (L, "pipe");
+
+        (*pipe)->referTo (&engine);
+        expect ((*pipe)->getReadBuffer (0) == &buffer1);
+        expect (lua.safe_script (sReferTo.toStdString()).valid());
+        (*pipe)->referTo (nullptr);
+
+        // the buffer taken with get() is swapped back with the edits in it
+        expect (buffer1.getNumEvents() == 2);
+        expect (buffer2.getNumEvents() == 1);
+        expect ((*pipe)->getReadBuffer (0) != &buffer1);
+        expect ((*pipe)->getReadBuffer (0)->isEmpty());
+
+        MidiBuffer::Iterator iter (buffer1);
+        MidiMessage msg; int frame = 0;
+        iter.getNextEvent (msg, frame);
+        expect (msg.getNoteNumber() == 62);
+
+        lua_pushnil (L);
+        lua_setglobal (L, "pipe");
+        lua.collect_garbage();
+    }
+};
+
+static DSPKernelsTest sDSPKernelsTest;
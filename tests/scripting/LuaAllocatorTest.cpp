@@ -0,0 +1,118 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "scripting/LuaAllocator.h"
+#include "sol/sol.hpp"
+
+namespace Element {
+
+class LuaAllocatorTest : public UnitTestBase
+{
+public:
+    LuaAllocatorTest() : UnitTestBase ("LuaAllocator", "scripting", "luaAllocator") { }
+    virtual ~LuaAllocatorTest() { }
+
+    void runTest() override
+    {
+        testPool();
+        testFallback();
+        testState();
+    }
+
+private:
+    static void* alloc (LuaAllocator& pool, void* ptr, size_t oldSize, size_t newSize)
+    {
+        return LuaAllocator::allocate (&pool, ptr, oldSize, newSize);
+    }
+
+    void testPool()
+    {
+        beginTest ("allocate, grow and free");
+        LuaAllocator pool (64 * 1024);
+        Array<void*> blocks;
+        for (int i = 0; i < 64; ++i)
+        {
+            auto* block = static_cast<uint8*> (alloc (pool, nullptr, 0, 100));
+            expect (block != nullptr);
+            expect ((pointer_sized_int) block % 16 == 0);
+            memset (block, i, 100);
+            blocks.add (block);
+        }
+
+        expect (pool.getStats().used > 0);
+        expectEquals (pool.getStats().numFallbacks, 0);
+
+        // growing keeps the contents
+        auto* grown = static_cast<uint8*> (alloc (pool, blocks[10], 100, 2000));
+        expect (grown != nullptr);
+        expectEquals ((int) grown[99], 10);
+        blocks.set (10, grown);
+
+        for (int i = 0; i < blocks.size(); ++i)
+            alloc (pool, blocks[i], i == 10 ? 2000 : 100, 0);
+        expect (pool.getStats().used == 0);
+
+        // neighbours were merged back in to one block
+        void* big = alloc (pool, nullptr, 0, 48 * 1024);
+        expect (big != nullptr);
+        expectEquals (pool.getStats().numFallbacks, 0);
+        alloc (pool, big, 48 * 1024, 0);
+        expect (pool.getStats().peak >= 48 * 1024);
+    }
+
+    void testFallback()
+    {
+        beginTest ("system fallback");
+        LuaAllocator pool (16 * 1024);
+        void* big = alloc (pool, nullptr, 0, 64 * 1024);
+        expect (big != nullptr);
+        expectEquals (pool.getStats().numFallbacks, 1);
+        memset (big, 0, 64 * 1024);
+        alloc (pool, big, 64 * 1024, 0);
+        expect (pool.getStatusText().isNotEmpty());
+    }
+
+    void testState()
+    {
+        beginTest ("lua state with stepped collection");
+        LuaAllocator pool;
+        {
+            sol::state lua (sol::default_at_panic, LuaAllocator::allocate, &pool);
+            lua.open_libraries (sol::lib::base);
+            LuaAllocator::stopCollector (lua.lua_state());
+            auto render = lua.load ("local t = {} for i = 1, 64 do t[i] = { i } end");
+            for (int i = 0; i < 500; ++i)
+            {
+                render();
+                pool.step (lua.lua_state());
+            }
+
+            const auto stats = pool.getStats();
+            expectEquals (stats.numFallbacks, 0);
+            expect (stats.used > 0 && stats.used < stats.poolSize / 2);
+            expect (stats.gcMaxUs >= stats.gcAverageUs);
+        }
+
+        expect (pool.getStats().used == 0);
+    }
+};
+
+static LuaAllocatorTest sLuaAllocatorTest;
+
+}
@@ -0,0 +1,106 @@
+/*
+    This file is part of Element
+    Copyright (C) 2020  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "scripting/LuaAllocator.h"
+#include "scripting/LuaProfiler.h"
+#include "sol/sol.hpp"
+
+namespace Element {
+
+static const char* sProfiledScript = R"(
+local t = {}
+function busy()
+    local x = 0
+    for i = 1, 20000 do
+        x = x + math.sin (i)
+    end
+    return x
+end
+
+function allocates()
+    for i = 1, 200 do
+        t[i] = { i }
+    end
+end
+)";
+
+class LuaProfilerTest : public UnitTestBase
+{
+public:
+    LuaProfilerTest() : UnitTestBase ("LuaProfiler", "scripting", "luaProfiler") { }
+    virtual ~LuaProfilerTest() { }
+
+    void runTest() override
+    {
+        LuaAllocator pool;
+        sol::state lua (sol::default_at_panic, LuaAllocator::allocate, &pool);
+        lua.open_libraries (sol::lib::base, sol::lib::math);
+        lua.script (sProfiledScript);
+        sol::function busy = lua["busy"], allocates = lua["allocates"];
+
+        LuaProfiler profiler (100);
+
+        beginTest ("disabled");
+        profiler.begin (lua.lua_state(), &pool);
+        busy();
+        profiler.end (lua.lua_state());
+        expectEquals (profiler.getNumCalls(), 0);
+        expect (profiler.getLines().isEmpty());
+
+        beginTest ("time goes to the busy function");
+        profiler.setEnabled (true);
+        for (int i = 0; i < 4; ++i)
+        {
+            profiler.begin (lua.lua_state(), &pool);
+            busy();
+            allocates();
+            profiler.end (lua.lua_state());
+        }
+
+        expectEquals (profiler.getNumCalls(), 4);
+        expect (profiler.getTotalMs() > 0.0);
+        auto lines = profiler.getLines();
+        expect (lines.size() > 0);
+        // called from C, so Lua can't name them, busy() starts on line 3
+        expectEquals (lines.getFirst().defined, 3);
+
+        beginTest ("allocations go to the allocating function");
+        int64 busyBytes = 0, allocatingBytes = 0;
+        for (const auto& line : lines)
+            (line.defined == 11 ? allocatingBytes : busyBytes) += line.bytes;
+        expect (allocatingBytes > busyBytes);
+
+        beginTest ("summary");
+        const auto summary = profiler.getSummary();
+        expect (summary.contains ("4 calls"));
+        expect (summary.contains (":3)"));
+
+        beginTest ("reset");
+        profiler.reset();
+        profiler.setEnabled (false);
+        profiler.begin (lua.lua_state(), &pool);
+        profiler.end (lua.lua_state());
+        expectEquals (profiler.getNumCalls(), 0);
+        expect (profiler.getLines().isEmpty());
+    }
+};
+
+static LuaProfilerTest sLuaProfilerTest;
+
+}
@@ -0,0 +1,148 @@
+/*
+    This file is part of Element
+    Copyright (C) 2021  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "scripting/LuaStatePool.h"
+
+namespace Element {
+
+class LuaStatePoolTest : public UnitTestBase
+{
+public:
+    LuaStatePoolTest() : UnitTestBase ("LuaStatePool", "scripting", "luaStatePool") { }
+    virtual ~LuaStatePoolTest() { }
+
+    void runTest() override
+    {
+        testAcquire();
+        testReset();
+        testBenchmark();
+    }
+
+private:
+    void testAcquire()
+    {
+        beginTest ("acquire");
+        LuaStatePool pool;
+        pool.setNumReady (2);
+        expect (pool.waitUntilReady (10000));
+        expectEquals (pool.getNumReady(), 2);
+
+        auto state = pool.acquire();
+        expect (state != nullptr);
+        auto& lua = state->getState();
+        expect (lua.safe_script ("return package.loaded['el.dsp'] ~= nil and "
+                                 "package.loaded['kv.AudioBuffer'] ~= nil").get<bool>());
+        expectEquals (pool.getStats().numMisses, 0);
+
+        pool.recycle (std::move (state));
+        expect (pool.waitUntilReady (10000));
+        expectEquals (pool.getNumReady(), 2);
+    }
+
+    void testReset()
+    {
+        beginTest ("reset");
+        LuaStatePool pool;
+        pool.setNumReady (0);
+        auto state = pool.acquire();
+        auto& lua = state->getState();
+
+        lua.safe_script (R"(
+            leaked = { 1, 2, 3 }
+            string.shout = string.upper
+            math.pi = 3
+            print = nil
+            package.loaded['el.dsp'] = nil
+            package.path = ''
+            setmetatable (_G, { __index = function() return 'gotcha' end })
+        )");
+        lua_pushinteger (state->getLuaState(), 1);
+
+        expect (state->reset());
+        expectEquals (lua_gettop (state->getLuaState()), 0);
+        expect (lua.safe_script ("return rawget (_G, 'leaked') == nil and "
+                                 "string.shout == nil and print ~= nil and "
+                                 "getmetatable (_G) == nil and math.pi > 3.14 and "
+                                 "package.loaded['el.dsp'] ~= nil and #package.path > 0").get<bool>());
+        expect (lua.safe_script ("return require ('el.dsp') ~= nil").get<bool>());
+
+        beginTest ("reset type metatables and upvalues");
+        lua.safe_script (R"(
+            getmetatable ('').__index = function() return 'gotcha' end
+            getmetatable ('').__len = function() return 0 end
+            debug.setmetatable (0, { __index = function() return 'gotcha' end })
+            debug.setmetatable (nil, { __index = function() return 'gotcha' end })
+            debug.setmetatable (print, { __index = function() return 'gotcha' end })
+            debug.setupvalue (require, 1, {})
+        )");
+
+        expect (state->reset());
+        expect (lua.safe_script ("return ('abc'):upper() == 'ABC' and #'abc' == 3 and "
+                                 "getmetatable ('').__len == nil and "
+                                 "debug.getmetatable (0) == nil and "
+                                 "debug.getmetatable (nil) == nil and "
+                                 "debug.getmetatable (print) == nil").get<bool>());
+        expect (lua.safe_script ("return require ('el.dsp') ~= nil").get<bool>());
+
+        // still resets after the first time
+        lua.safe_script ("leaked = true");
+        expect (state->reset());
+        expect (lua.safe_script ("return leaked == nil").get<bool>());
+    }
+
+    void testBenchmark()
+    {
+        beginTest ("benchmark");
+        const int numStates = 8;
+        LuaStatePool pool;
+        std::vector<std::unique_ptr<LuaStatePool::State>> states;
+
+        pool.setNumReady (0);
+        auto start = Time::getHighResolutionTicks();
+        for (int i = 0; i < numStates; ++i)
+            states.push_back (pool.acquire());
+        const double madeMs = Time::highResolutionTicksToSeconds (
+            Time::getHighResolutionTicks() - start) * 1000.0 / (double) numStates;
+        for (auto& state : states)
+            pool.recycle (std::move (state));
+        states.clear();
+
+        pool.setNumReady (numStates);
+        expect (pool.waitUntilReady (30000));
+        const int numMisses = pool.getStats().numMisses;
+        start = Time::getHighResolutionTicks();
+        for (int i = 0; i < numStates; ++i)
+            states.push_back (pool.acquire());
+        const double pooledMs = Time::highResolutionTicksToSeconds (
+            Time::getHighResolutionTicks() - start) * 1000.0 / (double) numStates;
+
+        for (const auto& state : states)
+            expect (state != nullptr);
+        expectEquals (pool.getStats().numMisses, numMisses);
+
+        logMessage (String ("state per node: made ") + String (madeMs, 3)
+            + "ms, from pool " + String (pooledMs, 3) + "ms (average make "
+            + String (pool.getStats().averageMakeMs, 3) + "ms)");
+    }
+};
+
+static LuaStatePoolTest sLuaStatePoolTest;
+
+}
@@ -223,8 +223,65 @@ public:
             expect (Amp.get_or ("released", false) == true);
         }
 
+        testControlRate();
         lua.collect_garbage();
     }
+
+private:
+    void testControlRate()
+    {
+        beginTest ("control rate");
+        auto script = std::unique_ptr<Script> (new Script (lua));
+        script->load (readSnippet ("test_dsp_script_02.lua"));
+        sol::table follower = script->call();
+        DSPScript dsp (follower);
+        expect (dsp.getControlRate() == 256);
+
+        auto* const level = dynamic_cast<ControlPortParameter*> (
+            dsp.getParameterObject (0, false).get());
+        expect (level != nullptr);
+        if (level == nullptr)
+            return;
+
+        dsp.prepare (44100, 64);
+        AudioSampleBuffer audio (0, 64);
+        MidiPipe midi;
+
+        // called on the first block, then ramped toward the output. Values
+        // reach the parameter on the message thread
+        dsp.process (audio, midi);
+        expect (follower.get_or ("calls", 0) == 1);
+        expect (follower.get_or ("elapsed", 0) == 64);
+        runDispatchLoop (80);
+        expectWithinAbsoluteError (level->get(), 0.25f, 0.0001f);
+
+        for (int i = 0; i < 3; ++i)
+            dsp.process (audio, midi);
+        expect (follower.get_or ("calls", 0) == 1);
+        runDispatchLoop (80);
+        expectWithinAbsoluteError (level->get(), 1.f, 0.0001f);
+
+        // the next call starts ramping back down from there
+        dsp.process (audio, midi);
+        runDispatchLoop (80);
+        expect (follower.get_or ("calls", 0) == 2);
+        expect (follower.get_or ("elapsed", 0) == 256);
+        expectWithinAbsoluteError (level->get(), 0.75f, 0.0001f);
+
+        beginTest ("control rate with audio outputs");
+        sol::table passthrough = lua.script (R"(
+            return {
+                layout = function()
+                    return { audio = { 2, 2 }, midi = { 1, 1 }, control_rate = 64 }
+                end,
+                process = function() end
+            }
+        )");
+        DSPScript refused (passthrough);
+        expect (! refused.isLoaded());
+        expect (refused.getLayoutError().isNotEmpty());
+        expect (refused.getPorts().size() == 0);
+    }
 };
 
 static DSPScriptTest sDSPScriptTest;
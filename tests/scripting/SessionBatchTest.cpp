@@ -0,0 +1,113 @@
+/*
+    This file is part of Element
+    Copyright (C) 2021  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "LuaUnitTest.h"
+#include "controllers/GraphManager.h"
+#include "session/Session.h"
+
+static const String sBatch = R"(
+begintest ("nodes and arcs are added once the batch ends")
+local nodesBefore, arcsBefore = numnodes(), numarcs()
+local first, last = session:batch (function (count)
+    local first = session:addnode (graph, "Element", "element.audioRouter")
+    local prev = first
+    for i = 2, count do
+        local node = session:addnode (graph, "Element", "element.audioRouter")
+        expect (node ~= nil, "node not added")
+        expect (session:connect (graph, prev, audioport (prev, 0, false),
+                                        node, audioport (node, 0, true)))
+        prev = node
+    end
+
+    expect (numnodes() == nodesBefore, "nodes changed during the batch")
+    expect (numarcs() == arcsBefore, "arcs changed during the batch")
+    return first, prev
+end, 50)
+
+expect (numnodes() == nodesBefore + 50, numnodes())
+expect (numarcs() == arcsBefore + 49, numarcs())
+expect (first.nodeid ~= last.nodeid)
+
+begintest ("errors are raised after the batch ends")
+nodesBefore = numnodes()
+local ok, err = pcall (function()
+    session:batch (function()
+        session:addnode (graph, "Element", "element.audioRouter")
+        error ("boom")
+    end)
+end)
+
+expect (not ok)
+expect (string.find (tostring (err), "boom") ~= nil, err)
+expect (not batching())
+expect (numnodes() == nodesBefore + 1, numnodes())
+)";
+
+namespace Element {
+
+class SessionBatchTest : public LuaUnitTest
+{
+public:
+    SessionBatchTest()
+        : LuaUnitTest ("Session Batch", "Script", "batch") { }
+
+    void initialise() override
+    {
+        initializeWorld();
+        LuaUnitTest::initialise();
+    }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        std::unique_ptr<GraphManager> manager;
+        manager.reset (new GraphManager (graph, getWorld().getPluginManager()));
+        const Node model (Tags::graph);
+        manager->setNodeModel (model);
+        expect (GraphManager::findFor (model) == manager.get());
+
+        lua.script ("require ('el.Node'); require ('el.Session')");
+        lua["session"]  = getWorld().getSession().get();
+        lua["graph"]    = model;
+        lua["numnodes"] = [model]() { return model.getNumNodes(); };
+        lua["numarcs"]  = [model]() { return model.getArcsValueTree().getNumChildren(); };
+        lua["batching"] = []() { return GraphManager::isBatching(); };
+        lua["audioport"] = [](const Node& node, int channel, bool input) {
+            return (int) node.getGraphNode()->getPortForChannel (PortType::Audio, channel, input);
+        };
+
+        auto result = lua.safe_script (sBatch.toStdString(), sol::script_pass_on_error);
+        if (! result.valid())
+        {
+            sol::error e = result;
+            expect (false, e.what());
+        }
+
+        expectEquals (model.getNumNodes(), graph.getNumNodes());
+        expectEquals (model.getArcsValueTree().getNumChildren(), graph.getNumConnections());
+
+        lua["graph"] = sol::lua_nil;
+        lua.collect_garbage();
+        manager.reset();
+        expect (GraphManager::findFor (model) == nullptr);
+    }
+};
+
+static SessionBatchTest sSessionBatchTest;
+
+}
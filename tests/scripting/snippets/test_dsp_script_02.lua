@@ -0,0 +1,32 @@
+local Follower = {}
+
+Follower.calls = 0
+Follower.elapsed = 0
+
+function Follower.layout()
+    return {
+        audio = { 0, 0 },
+        midi  = { 0, 0 },
+        control_rate = 256
+    }
+end
+
+function Follower.parameters()
+    return {
+        {
+            name    = "Level",
+            flow    = "output",
+            min     = 0.0,
+            max     = 1.0,
+            default = 0.0
+        }
+    }
+end
+
+function Follower.process (a, m, params, outputs, elapsed)
+    Follower.calls = Follower.calls + 1
+    Follower.elapsed = elapsed
+    outputs[1] = Follower.calls % 2 == 1 and 1.0 or 0.0
+end
+
+return Follower
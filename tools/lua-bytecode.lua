@@ -0,0 +1,24 @@
+--- Compile the built-in Lua modules to bytecode.
+-- The output in data/lua is embedded in BinaryData, so resave the jucer
+-- projects after running this from the top of the source tree:
+--     lua tools/lua-bytecode.lua
+-- Use the same Lua release as libs/lua. Modules are compiled with their
+-- source path as chunk name and keep debug info for error messages.
+
+local modules = {
+    ['el.command']  = 'libs/element/lua/el/command.lua',
+    ['el.script']   = 'libs/element/lua/el/script.lua',
+    ['element']     = 'libs/element/lua/element.lua'
+}
+
+local names = {}
+for name in pairs (modules) do names[#names + 1] = name end
+table.sort (names)
+
+for _, name in ipairs (names) do
+    local chunk = assert (loadfile (modules[name], 't'))
+    local out = assert (io.open ('data/lua/' .. name .. '.luac', 'wb'))
+    out:write (string.dump (chunk))
+    out:close()
+    print (name .. ' -> data/lua/' .. name .. '.luac')
+end